@@ -180,7 +180,6 @@ APP_UTIL_SRC_C = $(addprefix util/,\
 	random.c \
 	mpexception.c \
 	fifo.c \
-	socketfifo.c \
 	mpirq.c \
 	mpsleep.c \
 	timeutils.c \
@@ -209,6 +208,8 @@ APP_LORA_SRC_C = $(addprefix lora/,\
 	sx1276-board.c \
 	sx1272-board.c \
 	board.c \
+	aggregate.c \
+	rxring.c \
 	)
 
 APP_LORA_OPENTHREAD_SRC_C = $(addprefix lora/,\
@@ -292,17 +293,28 @@ APP_MODS_LTE_SRC_C = $(addprefix mods/,\
 
 APP_TELNET_SRC_C = $(addprefix telnet/,\
 	telnet.c \
+	telnetport.c \
 	)
 
 APP_FTP_SRC_C = $(addprefix ftp/,\
 	ftp.c \
+	ftpport.c \
 	updater.c \
+	updater_stream.c \
 	)
 
 APP_CAN_SRC_C = $(addprefix can/,\
 	CAN.c \
 	)
 
+APP_COAP_SRC_C = $(addprefix coap/,\
+	coapres.c \
+	)
+
+APP_SNIFFER_SRC_C = $(addprefix sniffer/,\
+	sniffer.c \
+	)
+
 BOOT_SRC_C = $(addprefix bootloader/,\
 	bootloader.c \
 	bootmgr.c \
@@ -339,7 +351,7 @@ endif # ifeq ($(OPENTHREAD), on)
 OBJ += $(addprefix $(BUILD)/, $(APP_MAIN_SRC_C:.c=.o) $(APP_HAL_SRC_C:.c=.o) $(APP_LIB_SRC_C:.c=.o))
 OBJ += $(addprefix $(BUILD)/, $(APP_MODS_SRC_C:.c=.o) $(APP_STM_SRC_C:.c=.o))
 OBJ += $(addprefix $(BUILD)/, $(APP_FATFS_SRC_C:.c=.o) $(APP_LITTLEFS_SRC_C:.c=.o) $(APP_UTIL_SRC_C:.c=.o) $(APP_TELNET_SRC_C:.c=.o))
-OBJ += $(addprefix $(BUILD)/, $(APP_FTP_SRC_C:.c=.o) $(APP_CAN_SRC_C:.c=.o))
+OBJ += $(addprefix $(BUILD)/, $(APP_FTP_SRC_C:.c=.o) $(APP_CAN_SRC_C:.c=.o) $(APP_COAP_SRC_C:.c=.o) $(APP_SNIFFER_SRC_C:.c=.o))
 OBJ += $(BUILD)/pins.o
 
 BOOT_OBJ = $(addprefix $(BUILD)/, $(BOOT_SRC_C:.c=.o))
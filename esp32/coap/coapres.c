@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "coapres.h"
+
+#if defined(COAPRES_HOST)
+#include <stdlib.h>
+#define COAPRES_NEW_SLOTS(n)                    calloc((n), sizeof(coapres_slot_t))
+#define COAPRES_DEL_SLOTS(p, n)                 free(p)
+#else
+#include "py/mpconfig.h"
+#include "py/misc.h"
+#define COAPRES_NEW_SLOTS(n)                    m_new0(coapres_slot_t, (n))
+#define COAPRES_DEL_SLOTS(p, n)                 m_del(coapres_slot_t, (p), (n))
+#endif
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define COAPRES_INITIAL_SIZE                    16
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static uint32_t coapres_key (const uint8_t *key);
+static uint32_t coapres_slot (const coapres_index_t *index, uint32_t key);
+static bool coapres_grow (coapres_index_t *index);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void *coapres_find (const coapres_index_t *index, const uint8_t *key) {
+    if (index->count == 0) {
+        return NULL;
+    }
+    uint32_t k = coapres_key(key);
+    uint32_t mask = index->size - 1;
+    for (uint32_t i = coapres_slot(index, k); index->slots[i].item != NULL; i = (i + 1) & mask) {
+        if (index->slots[i].key == k) {
+            return index->slots[i].item;
+        }
+    }
+    return NULL;
+}
+
+bool coapres_insert (coapres_index_t *index, const uint8_t *key, void *item) {
+    if (coapres_find(index, key) != NULL) {
+        return false;
+    }
+    // keep the load under 3/4 so that the probe sequences stay short
+    if ((index->count + 1) * 4 > index->size * 3 && !coapres_grow(index)) {
+        return false;
+    }
+    uint32_t k = coapres_key(key);
+    uint32_t mask = index->size - 1;
+    uint32_t i = coapres_slot(index, k);
+    while (index->slots[i].item != NULL) {
+        i = (i + 1) & mask;
+    }
+    index->slots[i].key = k;
+    index->slots[i].item = item;
+    index->count++;
+    return true;
+}
+
+void *coapres_remove (coapres_index_t *index, const uint8_t *key) {
+    if (index->count == 0) {
+        return NULL;
+    }
+    uint32_t k = coapres_key(key);
+    uint32_t mask = index->size - 1;
+    uint32_t i = coapres_slot(index, k);
+    while (index->slots[i].item != NULL && index->slots[i].key != k) {
+        i = (i + 1) & mask;
+    }
+    void *item = index->slots[i].item;
+    if (item == NULL) {
+        return NULL;
+    }
+    // shift the entries after it back instead of leaving a tombstone, each one
+    // can move into the hole if its home slot is not between the hole and it
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & mask; index->slots[j].item != NULL; j = (j + 1) & mask) {
+        uint32_t home = coapres_slot(index, index->slots[j].key);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            index->slots[hole] = index->slots[j];
+            hole = j;
+        }
+    }
+    index->slots[hole].item = NULL;
+    index->slots[hole].key = 0;
+    index->count--;
+    return item;
+}
+
+void coapres_clear (coapres_index_t *index) {
+    if (index->slots != NULL) {
+        COAPRES_DEL_SLOTS(index->slots, index->size);
+    }
+    index->slots = NULL;
+    index->size = 0;
+    index->count = 0;
+}
+
+uint8_t coapres_encode_uint (uint8_t *buf, uint32_t value) {
+    uint8_t len = 0;
+    for (uint32_t v = value; v != 0; v >>= 8) {
+        len++;
+    }
+    for (uint8_t i = len; i > 0; i--) {
+        buf[i - 1] = value & 0xFF;
+        value >>= 8;
+    }
+    return len;
+}
+
+uint32_t coapres_decode_uint (const uint8_t *buf, uint32_t len) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < len && i < COAPRES_UINT_MAX_LEN; i++) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+int64_t coapres_block (uint32_t len, uint32_t num, uint8_t szx, uint32_t *offset, uint32_t *chunk) {
+    uint32_t size = COAPRES_BLOCK_SIZE(szx);
+    uint64_t start = (uint64_t)num * size;
+    // block 0 of an empty value is still a valid (empty) block
+    if (start >= len && !(num == 0 && len == 0)) {
+        return -1;
+    }
+    *offset = start;
+    *chunk = (len - start > size) ? size : (len - start);
+    bool more = (start + size) < len;
+    return ((int64_t)num << 4) | (more ? 0x08 : 0) | szx;
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static uint32_t coapres_key (const uint8_t *key) {
+    uint32_t k;
+    memcpy(&k, key, sizeof(k));
+    return k;
+}
+
+static uint32_t coapres_slot (const coapres_index_t *index, uint32_t key) {
+    // the libcoap path hash mostly changes the low bits, spread them over the
+    // top ones before taking them as the slot
+    return (key * 2654435761U) >> (32 - __builtin_ctz(index->size));
+}
+
+static bool coapres_grow (coapres_index_t *index) {
+    uint32_t size = index->size ? index->size * 2 : COAPRES_INITIAL_SIZE;
+    coapres_slot_t *slots = COAPRES_NEW_SLOTS(size);
+    if (slots == NULL) {
+        return false;
+    }
+    coapres_index_t grown = { .slots = slots, .size = size, .count = index->count };
+    for (uint32_t i = 0; i < index->size; i++) {
+        if (index->slots[i].item != NULL) {
+            uint32_t j = coapres_slot(&grown, index->slots[i].key);
+            while (slots[j].item != NULL) {
+                j = (j + 1) & (size - 1);
+            }
+            slots[j] = index->slots[i];
+        }
+    }
+    if (index->slots != NULL) {
+        COAPRES_DEL_SLOTS(index->slots, index->size);
+    }
+    *index = grown;
+    return true;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef COAPRES_H_
+#define COAPRES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// libcoap keys resources by a 4 byte hash of their path (coap_key_t)
+#define COAPRES_KEY_LEN                         4
+
+// an unsigned CoAP option value takes at most 4 bytes
+#define COAPRES_UINT_MAX_LEN                    4
+
+// the block size of Block2 responses is 2^(szx + 4); 5 means 512 bytes
+#ifndef COAPRES_BLOCK_SZX
+#define COAPRES_BLOCK_SZX                       5
+#endif
+#define COAPRES_BLOCK_SIZE(szx)                 (1U << ((szx) + 4))
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint32_t                key;
+    void                    *item;          // NULL if the slot is free
+} coapres_slot_t;
+
+// open addressing hash table from resource keys to resources; the slots are
+// allocated from the MicroPython heap on the device, so that the GC sees the
+// resources through them
+typedef struct {
+    coapres_slot_t          *slots;
+    uint32_t                size;           // power of 2, 0 while nothing was added
+    uint32_t                count;
+} coapres_index_t;
+
+// option values encoded once per value update rather than once per request
+typedef struct {
+    uint8_t                 etag[COAPRES_UINT_MAX_LEN];
+    uint8_t                 content_format[COAPRES_UINT_MAX_LEN];
+    uint8_t                 max_age[COAPRES_UINT_MAX_LEN];
+    uint8_t                 etag_len;
+    uint8_t                 content_format_len;
+    uint8_t                 max_age_len;
+} coapres_opts_t;
+
+/******************************************************************************
+ DECLARE EXPORTED FUNCTIONS
+ ******************************************************************************/
+/**
+ * @brief  Looks up a resource by its key.
+ *
+ * @return the resource, or NULL if there is none with that key.
+ */
+extern void *coapres_find (const coapres_index_t *index, const uint8_t *key);
+
+/**
+ * @brief  Adds a resource, growing the table if needed.
+ *
+ * @return false if a resource with the same key is already there.
+ */
+extern bool coapres_insert (coapres_index_t *index, const uint8_t *key, void *item);
+
+/**
+ * @brief  Removes a resource.
+ *
+ * @return the resource removed, or NULL if there was none with that key.
+ */
+extern void *coapres_remove (coapres_index_t *index, const uint8_t *key);
+
+/**
+ * @brief  Releases the table.
+ */
+extern void coapres_clear (coapres_index_t *index);
+
+/**
+ * @brief  Encodes an unsigned option value in as few bytes as possible.
+ *
+ * @return the number of bytes written to buf (0 for the value 0).
+ */
+extern uint8_t coapres_encode_uint (uint8_t *buf, uint32_t value);
+
+/**
+ * @brief  Decodes an unsigned option value.
+ */
+extern uint32_t coapres_decode_uint (const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief  Works out the part of a value sent in a Block2 response.
+ *
+ * @param  len      length of the whole value
+ * @param  num      block number requested
+ * @param  szx      block size exponent, already limited to COAPRES_BLOCK_SZX
+ * @param  offset   set to the offset of the block in the value
+ * @param  chunk    set to the length of the block
+ *
+ * @return the Block2 option value to send back, or -1 if the block is past
+ *         the end of the value.
+ */
+extern int64_t coapres_block (uint32_t len, uint32_t num, uint8_t szx, uint32_t *offset, uint32_t *chunk);
+
+#endif /* COAPRES_H_ */
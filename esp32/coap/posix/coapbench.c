@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+/*
+ * Serves GET requests for a table of resources the way mods/modcoap.c does,
+ * over a loopback UDP socket, and measures the requests per second a client
+ * process gets out of it:
+ *   ./coapbench [-l] [-n resources] [-s value size] [-t seconds] [-w window]
+ * -l looks the resources up in a list and encodes the options for every
+ * request, like the module did before the index. The wire format is a small
+ * subset of RFC 7252/7959, since libcoap is only available for the device.
+ *   ./coapbench test
+ * checks the index against a brute force search.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "coapres.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define BENCH_PDU_SIZE                          1280
+#define BENCH_TOKEN_LEN                         2
+#define BENCH_RETRANSMIT_MS                     100
+
+#define COAP_TYPE_CON                           0
+#define COAP_TYPE_ACK                           2
+#define COAP_CODE_GET                           1
+#define COAP_CODE(c, d)                         (((c) << 5) | (d))
+
+#define COAP_OPTION_ETAG                        4
+#define COAP_OPTION_URI_PATH                    11
+#define COAP_OPTION_CONTENT_FORMAT              12
+#define COAP_OPTION_MAXAGE                      14
+#define COAP_OPTION_BLOCK2                      23
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct bench_resource_s {
+    uint8_t                 key[COAPRES_KEY_LEN];
+    struct bench_resource_s *next;
+    uint8_t                 *value;
+    uint32_t                value_len;
+    uint32_t                max_age;
+    uint16_t                etag_value;
+    uint8_t                 mediatype;
+    coapres_opts_t          opts;
+} bench_resource_t;
+
+typedef struct {
+    uint8_t                 *buf;
+    uint32_t                len;
+    uint32_t                last_option;
+} bench_pdu_t;
+
+typedef struct {
+    uint32_t                resource;
+    uint32_t                num;            // block being fetched
+    bool                    busy;
+} bench_transfer_t;
+
+/******************************************************************************
+ DEFINE PRIVATE VARIABLES
+ ******************************************************************************/
+static bool bench_list;
+static uint32_t bench_resources = 300;
+static uint32_t bench_value_size = 16;
+static uint32_t bench_seconds = 3;
+static uint32_t bench_window = 8;
+
+static bench_resource_t *bench_table;
+static bench_resource_t *bench_head;
+static coapres_index_t bench_index;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// libcoap's coap_hash(), applied to each path segment by coap_hash_path()
+static void bench_hash (const uint8_t *s, uint32_t len, uint8_t *h) {
+    while (len--) {
+        for (int j = COAPRES_KEY_LEN - 1; j > 0; j--) {
+            h[j] = ((h[j] << 7) | (h[j - 1] >> 1)) + h[j];
+        }
+        h[0] = (h[0] << 7) + h[0] + *s++;
+    }
+}
+
+static void bench_hash_path (const char *path, uint8_t *key) {
+    memset(key, 0, COAPRES_KEY_LEN);
+    while (*path) {
+        const char *end = strchr(path, '/');
+        uint32_t len = end ? (uint32_t)(end - path) : strlen(path);
+        bench_hash((const uint8_t *)path, len, key);
+        path += len + (end ? 1 : 0);
+    }
+}
+
+static uint8_t bench_value_byte (uint32_t resource, uint32_t offset) {
+    return (resource * 31 + offset) & 0xFF;
+}
+
+static void bench_update_opts (bench_resource_t *r) {
+    r->opts.etag_len = coapres_encode_uint(r->opts.etag, r->etag_value);
+    r->opts.content_format_len = coapres_encode_uint(r->opts.content_format, r->mediatype);
+    r->opts.max_age_len = coapres_encode_uint(r->opts.max_age, r->max_age);
+}
+
+static void bench_setup (void) {
+    bench_table = calloc(bench_resources, sizeof(bench_resource_t));
+    for (uint32_t i = 0; i < bench_resources; i++) {
+        bench_resource_t *r = &bench_table[i];
+        char path[32];
+        snprintf(path, sizeof(path), "sensors/s%u", (unsigned)i);
+        bench_hash_path(path, r->key);
+        r->value = malloc(bench_value_size);
+        for (uint32_t j = 0; j < bench_value_size; j++) {
+            r->value[j] = bench_value_byte(i, j);
+        }
+        r->value_len = bench_value_size;
+        r->max_age = 60;
+        r->etag_value = i + 1;
+        r->mediatype = 0;
+        bench_update_opts(r);
+        // the list appends at the end like the module did
+        if (i > 0) {
+            bench_table[i - 1].next = r;
+        } else {
+            bench_head = r;
+        }
+        if (!coapres_insert(&bench_index, r->key, r)) {
+            printf("key collision for %s\n", path);
+            exit(1);
+        }
+    }
+}
+
+static bench_resource_t *bench_find (const uint8_t *key) {
+    if (bench_list) {
+        for (bench_resource_t *r = bench_head; r != NULL; r = r->next) {
+            if (memcmp(r->key, key, COAPRES_KEY_LEN) == 0) {
+                return r;
+            }
+        }
+        return NULL;
+    }
+    return coapres_find(&bench_index, key);
+}
+
+static void bench_add_option (bench_pdu_t *pdu, uint32_t number, const uint8_t *value, uint32_t len) {
+    // options up to 12 bytes long with deltas up to 12 are all this needs
+    pdu->buf[pdu->len++] = ((number - pdu->last_option) << 4) | len;
+    memcpy(pdu->buf + pdu->len, value, len);
+    pdu->len += len;
+    pdu->last_option = number;
+}
+
+static bool bench_next_option (const uint8_t **p, const uint8_t *end, uint32_t *number, const uint8_t **value, uint32_t *len) {
+    if (*p >= end || **p == 0xFF) {
+        return false;
+    }
+    uint32_t delta = **p >> 4;
+    *len = **p & 0x0F;
+    (*p)++;
+    if (delta == 13) {
+        delta = 13 + *(*p)++;
+    }
+    if (*len == 13) {
+        *len = 13 + *(*p)++;
+    }
+    *number += delta;
+    *value = *p;
+    *p += *len;
+    return *p <= end;
+}
+
+static uint32_t bench_respond (const uint8_t *req, uint32_t req_len, uint8_t *resp) {
+    uint32_t tkl = req[0] & 0x0F;
+    const uint8_t *p = req + 4 + tkl;
+    const uint8_t *end = req + req_len;
+    uint8_t key[COAPRES_KEY_LEN] = {0};
+    uint32_t number = 0, len;
+    const uint8_t *value;
+    uint32_t block_num = 0;
+    uint8_t szx = COAPRES_BLOCK_SZX;
+
+    // the key is hashed from the Uri-Path segments, as coap_hash_request_uri() does
+    while (bench_next_option(&p, end, &number, &value, &len)) {
+        if (number == COAP_OPTION_URI_PATH) {
+            bench_hash(value, len, key);
+        } else if (number == COAP_OPTION_BLOCK2) {
+            uint32_t v = coapres_decode_uint(value, len);
+            block_num = v >> 4;
+            if ((v & 0x07) < szx) {
+                szx = v & 0x07;
+            }
+        }
+    }
+
+    bench_pdu_t pdu = { .buf = resp, .len = 4 + tkl, .last_option = 0 };
+    resp[0] = (1 << 6) | (COAP_TYPE_ACK << 4) | tkl;
+    resp[2] = req[2];
+    resp[3] = req[3];
+    memcpy(resp + 4, req + 4, tkl);
+
+    bench_resource_t *r = bench_find(key);
+    if (r == NULL) {
+        resp[1] = COAP_CODE(4, 4);
+        return pdu.len;
+    }
+
+    uint32_t offset = 0, chunk = r->value_len;
+    int64_t block2 = -1;
+    if (block_num != 0 || r->value_len > COAPRES_BLOCK_SIZE(szx)) {
+        block2 = coapres_block(r->value_len, block_num, szx, &offset, &chunk);
+        if (block2 < 0) {
+            resp[1] = COAP_CODE(4, 2);
+            return pdu.len;
+        }
+    }
+    resp[1] = COAP_CODE(2, 5);
+
+    if (bench_list) {
+        // the options are encoded for every request
+        uint8_t buf[COAPRES_UINT_MAX_LEN];
+        bench_add_option(&pdu, COAP_OPTION_ETAG, buf, coapres_encode_uint(buf, r->etag_value));
+        bench_add_option(&pdu, COAP_OPTION_CONTENT_FORMAT, buf, coapres_encode_uint(buf, r->mediatype));
+        bench_add_option(&pdu, COAP_OPTION_MAXAGE, buf, coapres_encode_uint(buf, r->max_age));
+    } else {
+        bench_add_option(&pdu, COAP_OPTION_ETAG, r->opts.etag, r->opts.etag_len);
+        bench_add_option(&pdu, COAP_OPTION_CONTENT_FORMAT, r->opts.content_format, r->opts.content_format_len);
+        bench_add_option(&pdu, COAP_OPTION_MAXAGE, r->opts.max_age, r->opts.max_age_len);
+    }
+    if (block2 >= 0) {
+        uint8_t buf[COAPRES_UINT_MAX_LEN];
+        // Block2 (23) is 9 past Max-Age (14), which fits the short delta
+        bench_add_option(&pdu, COAP_OPTION_BLOCK2, buf, coapres_encode_uint(buf, block2));
+    }
+    if (chunk > 0) {
+        resp[pdu.len++] = 0xFF;
+        memcpy(resp + pdu.len, r->value + offset, chunk);
+        pdu.len += chunk;
+    }
+    return pdu.len;
+}
+
+static void bench_server (int sd) {
+    uint8_t req[BENCH_PDU_SIZE];
+    uint8_t resp[BENCH_PDU_SIZE];
+    for ( ; ; ) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(sd, req, sizeof(req), 0, (struct sockaddr *)&from, &from_len);
+        if (len < 4 || (req[0] >> 6) != 1 || req[1] != COAP_CODE_GET) {
+            continue;
+        }
+        uint32_t resp_len = bench_respond(req, len, resp);
+        sendto(sd, resp, resp_len, 0, (struct sockaddr *)&from, from_len);
+    }
+}
+
+static uint32_t bench_request (uint8_t *buf, uint16_t mid, uint16_t token, const bench_transfer_t *t) {
+    bench_pdu_t pdu = { .buf = buf, .len = 4 + BENCH_TOKEN_LEN, .last_option = 0 };
+    buf[0] = (1 << 6) | (COAP_TYPE_CON << 4) | BENCH_TOKEN_LEN;
+    buf[1] = COAP_CODE_GET;
+    buf[2] = mid >> 8;
+    buf[3] = mid & 0xFF;
+    buf[4] = token >> 8;
+    buf[5] = token & 0xFF;
+    char segment[16];
+    bench_add_option(&pdu, COAP_OPTION_URI_PATH, (const uint8_t *)"sensors", 7);
+    int len = snprintf(segment, sizeof(segment), "s%u", (unsigned)t->resource);
+    bench_add_option(&pdu, COAP_OPTION_URI_PATH, (const uint8_t *)segment, len);
+    if (t->num > 0) {
+        uint8_t opt[COAPRES_UINT_MAX_LEN];
+        uint32_t v = (t->num << 4) | COAPRES_BLOCK_SZX;
+        // Block2 is 12 past Uri-Path, still a short delta
+        bench_add_option(&pdu, COAP_OPTION_BLOCK2, opt, coapres_encode_uint(opt, v));
+    }
+    return pdu.len;
+}
+
+static uint64_t bench_now_ms (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int bench_client (int sd, const struct sockaddr_in *server) {
+    bench_transfer_t *transfers = calloc(bench_window, sizeof(bench_transfer_t));
+    uint8_t buf[BENCH_PDU_SIZE];
+    uint16_t mid = 0;
+    uint64_t responses = 0, values = 0, errors = 0;
+    uint32_t seed = 1;
+
+    uint64_t start = bench_now_ms();
+    uint64_t deadline = start + bench_seconds * 1000;
+    for (uint32_t i = 0; i < bench_window; i++) {
+        seed = seed * 1103515245 + 12345;
+        transfers[i] = (bench_transfer_t){ .resource = (seed >> 8) % bench_resources, .num = 0, .busy = true };
+        uint32_t len = bench_request(buf, mid++, i, &transfers[i]);
+        sendto(sd, buf, len, 0, (const struct sockaddr *)server, sizeof(*server));
+    }
+
+    while (bench_now_ms() < deadline) {
+        struct pollfd pfd = { .fd = sd, .events = POLLIN };
+        if (poll(&pfd, 1, BENCH_RETRANSMIT_MS) <= 0) {
+            // a datagram was dropped, send all the outstanding requests again
+            for (uint32_t i = 0; i < bench_window; i++) {
+                uint32_t len = bench_request(buf, mid++, i, &transfers[i]);
+                sendto(sd, buf, len, 0, (const struct sockaddr *)server, sizeof(*server));
+            }
+            continue;
+        }
+        ssize_t len = recv(sd, buf, sizeof(buf), 0);
+        if (len < 4 + BENCH_TOKEN_LEN) {
+            continue;
+        }
+        uint16_t token = (buf[4] << 8) | buf[5];
+        if (token >= bench_window) {
+            continue;
+        }
+        bench_transfer_t *t = &transfers[token];
+        responses++;
+
+        // check the options and the part of the value received
+        const uint8_t *p = buf + 4 + BENCH_TOKEN_LEN;
+        const uint8_t *end = buf + len;
+        uint32_t number = 0, opt_len, block2 = 0;
+        const uint8_t *value;
+        bool has_block2 = false;
+        while (bench_next_option(&p, end, &number, &value, &opt_len)) {
+            if (number == COAP_OPTION_BLOCK2) {
+                block2 = coapres_decode_uint(value, opt_len);
+                has_block2 = true;
+            }
+        }
+        uint32_t offset = has_block2 ? (block2 >> 4) * COAPRES_BLOCK_SIZE(block2 & 0x07) : 0;
+        bool ok = buf[1] == COAP_CODE(2, 5) && (!has_block2 || (block2 >> 4) == t->num);
+        if (ok && p < end) {
+            p++;
+            for (uint32_t i = 0; p + i < end; i++) {
+                if (p[i] != bench_value_byte(t->resource, offset + i)) {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        if (!ok) {
+            errors++;
+        }
+
+        if (ok && has_block2 && (block2 & 0x08)) {
+            t->num++;
+        } else {
+            values++;
+            seed = seed * 1103515245 + 12345;
+            t->resource = (seed >> 8) % bench_resources;
+            t->num = 0;
+        }
+        uint32_t req_len = bench_request(buf, mid++, token, t);
+        sendto(sd, buf, req_len, 0, (const struct sockaddr *)server, sizeof(*server));
+    }
+
+    double secs = (bench_now_ms() - start) / 1000.0;
+    printf("%s: %u resources of %u bytes, %.0f requests/s, %.0f values/s, %llu errors\n",
+           bench_list ? "list" : "index", (unsigned)bench_resources, (unsigned)bench_value_size,
+           responses / secs, values / secs, (unsigned long long)errors);
+    free(transfers);
+    return errors ? 1 : 0;
+}
+
+static int bench_test (void) {
+    // keys are random here, and items are the key plus one so that they are never NULL
+    enum { N = 5000 };
+    static uint8_t keys[N][COAPRES_KEY_LEN];
+    static bool present[N];
+    coapres_index_t index = { 0 };
+    uint32_t seed = 7;
+
+    for (uint32_t i = 0; i < N; i++) {
+        for (uint32_t j = 0; j < COAPRES_KEY_LEN; j++) {
+            seed = seed * 1103515245 + 12345;
+            keys[i][j] = seed >> 16;
+        }
+        // with small tables most keys only differ in a byte or two, like paths do
+        if (i % 2) {
+            memcpy(keys[i], keys[i - 1], 3);
+        }
+    }
+    for (uint32_t round = 0; round < 20 * N; round++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t i = (seed >> 8) % N;
+        void *item = (void *)(uintptr_t)(i + 1);
+        if (present[i]) {
+            if (coapres_remove(&index, keys[i]) != item) {
+                printf("remove %u failed\n", (unsigned)i);
+                return 1;
+            }
+            present[i] = false;
+        } else {
+            bool dup = false;
+            for (uint32_t j = 0; j < N; j++) {
+                if (present[j] && memcmp(keys[j], keys[i], COAPRES_KEY_LEN) == 0) {
+                    dup = true;
+                }
+            }
+            if (coapres_insert(&index, keys[i], item) == dup) {
+                printf("insert %u failed\n", (unsigned)i);
+                return 1;
+            }
+            present[i] = !dup;
+        }
+        if (round % 1000 == 0) {
+            uint32_t count = 0;
+            for (uint32_t j = 0; j < N; j++) {
+                void *found = coapres_find(&index, keys[j]);
+                if (present[j] && found != (void *)(uintptr_t)(j + 1)) {
+                    printf("find %u failed\n", (unsigned)j);
+                    return 1;
+                }
+                count += present[j];
+            }
+            if (count != index.count) {
+                printf("count %u != %u\n", (unsigned)index.count, (unsigned)count);
+                return 1;
+            }
+        }
+    }
+
+    // option values and blocks
+    uint8_t buf[COAPRES_UINT_MAX_LEN];
+    uint32_t values[] = { 0, 1, 0xFF, 0x100, 0xFFFF, 0x10000, 0xFFFFFFFF };
+    uint8_t lens[] = { 0, 1, 1, 2, 2, 3, 4 };
+    for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint8_t len = coapres_encode_uint(buf, values[i]);
+        if (len != lens[i] || coapres_decode_uint(buf, len) != values[i]) {
+            printf("uint %u failed\n", (unsigned)values[i]);
+            return 1;
+        }
+    }
+    uint32_t offset, chunk;
+    if (coapres_block(1100, 2, 5, &offset, &chunk) != ((2 << 4) | 5) || offset != 1024 || chunk != 76 ||
+        coapres_block(1100, 1, 5, &offset, &chunk) != ((1 << 4) | 8 | 5) || chunk != 512 ||
+        coapres_block(1024, 2, 5, &offset, &chunk) != -1 ||
+        coapres_block(0, 0, 5, &offset, &chunk) != 5 || chunk != 0) {
+        printf("block failed\n");
+        return 1;
+    }
+
+    coapres_clear(&index);
+    printf("index test passed\n");
+    return 0;
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+int main (int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "test") == 0) {
+        return bench_test();
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "ln:s:t:w:")) != -1) {
+        switch (opt) {
+        case 'l': bench_list = true; break;
+        case 'n': bench_resources = atoi(optarg); break;
+        case 's': bench_value_size = atoi(optarg); break;
+        case 't': bench_seconds = atoi(optarg); break;
+        case 'w': bench_window = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-l] [-n resources] [-s size] [-t seconds] [-w window] | test\n", argv[0]);
+            return 2;
+        }
+    }
+    if (bench_resources == 0 || bench_window == 0 || bench_window > 0xFFFF) {
+        fprintf(stderr, "bad arguments\n");
+        return 2;
+    }
+
+    bench_setup();
+
+    int server_sd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK), .sin_port = 0 };
+    socklen_t server_len = sizeof(server);
+    if (server_sd < 0 || bind(server_sd, (struct sockaddr *)&server, sizeof(server)) != 0 ||
+        getsockname(server_sd, (struct sockaddr *)&server, &server_len) != 0) {
+        perror("server socket");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        bench_server(server_sd);
+        _exit(0);
+    }
+    close(server_sd);
+
+    int sd = socket(AF_INET, SOCK_DGRAM, 0);
+    int ret = bench_client(sd, &server);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return ret;
+}
@@ -10,6 +10,27 @@
 #ifndef FTP_H_
 #define FTP_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// number of clients that can be logged in at the same time
+#ifndef FTP_SESSIONS_MAX
+#define FTP_SESSIONS_MAX                    3
+#endif
+
+// size of the per session buffer used for file and listing transfers
+#ifndef FTP_BUFFER_SIZE
+#define FTP_BUFFER_SIZE                     4096
+#endif
+
+// longest path accepted from a client (MICROPY_ALLOC_PATH_MAX on the device)
+#ifndef FTP_PATH_LEN_MAX
+#define FTP_PATH_LEN_MAX                    128
+#endif
+
 extern void stoupper (char *str);
 
 /******************************************************************************
@@ -17,6 +38,9 @@ extern void stoupper (char *str);
  ******************************************************************************/
 extern void ftp_init (void);
 extern void ftp_run (void);
+// block until one of the ftp sockets is ready or timeout_ms elapses; returns
+// false (without waiting) if the server isn't listening
+extern bool ftp_wait (uint32_t timeout_ms);
 extern void ftp_enable (void);
 extern void ftp_disable (void);
 extern void ftp_reset (void);
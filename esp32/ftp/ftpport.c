@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpstate.h"
+#include "py/obj.h"
+#include "py/lexer.h"
+
+#include "ftpport.h"
+#include "updater.h"
+#include "modusocket.h"
+#include "serverstask.h"
+#include "lib/oofatfs/ff.h"
+#include "extmod/vfs.h"
+#include "extmod/vfs_fat.h"
+#include "vfs_littlefs.h"
+#include "lfs.h"
+#include "timeutils.h"
+#include "machrtc.h"
+#include "mptask.h"
+
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define FTP_PORT_UNIX_TIME_20150101         1420070400ll
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    vfs_lfs_struct_t        *littlefs;      // NULL for FatFS
+    union {
+        FIL                 fp_fat;
+        pycom_lfs_file_t    fp_lfs;
+    } u;
+} ftp_port_file_t;
+
+typedef struct {
+    vfs_lfs_struct_t        *littlefs;      // NULL for FatFS or the root directory
+    mp_vfs_mount_t          *vfs;           // next mount point to list in the root directory
+    bool                    isroot;
+    union {
+        FF_DIR              dp_fat;
+        lfs_dir_t           dp_lfs;
+    } u;
+    char                    path[];         // path relative to the littlefs mount point
+} ftp_port_dir_t;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+// These wrapper functions are used so that the FTP server can access the
+// mounted FatFS and LittleFS devices directly without going through the costly
+// mp_vfs_XXX functions.  The latter may raise exceptions and we would then need
+// to wrap all calls in an nlr handler.
+
+static int64_t ftp_port_fattime_to_seconds (uint16_t fdate, uint16_t ftime) {
+    // entries without a timestamp have all fields set to 0
+    uint month = (fdate >> 5) & 0x0f;
+    uint day = fdate & 0x1f;
+    return timeutils_seconds_since_epoch(1980 + ((fdate >> 9) & 0x7f), month ? month : 1, day ? day : 1,
+                                         (ftime >> 11) & 0x1f, (ftime >> 5) & 0x3f, 2 * (ftime & 0x1f));
+}
+
+static void ftp_port_stat_from_fat (ftp_stat_t *st, const FILINFO *fno) {
+    st->mtime = ftp_port_fattime_to_seconds(fno->fdate, fno->ftime);
+    st->size = fno->fsize;
+    st->isdir = (fno->fattrib & AM_DIR) != 0;
+    strncpy(st->name, fno->fname, FTP_NAME_LEN_MAX - 1);
+    st->name[FTP_NAME_LEN_MAX - 1] = '\0';
+}
+
+static void ftp_port_stat_from_lfs (ftp_stat_t *st, const struct lfs_info *info, const lfs_timestamp_attribute_t *ts) {
+    st->mtime = ftp_port_fattime_to_seconds(ts->fdate, ts->ftime);
+    st->size = info->size;
+    st->isdir = (info->type == LFS_TYPE_DIR);
+    strncpy(st->name, info->name, FTP_NAME_LEN_MAX - 1);
+    st->name[FTP_NAME_LEN_MAX - 1] = '\0';
+}
+
+static bool ftp_port_is_dot_entry (const char *name) {
+    return (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')));
+}
+
+/******************************************************************************
+ DEFINE PORT FUNCTIONS
+ ******************************************************************************/
+void *ftp_port_malloc (uint32_t size) {
+    return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void ftp_port_free (void *ptr) {
+    heap_caps_free(ptr);
+}
+
+uint32_t ftp_port_ticks_ms (void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+int64_t ftp_port_time (void) {
+    return mach_rtc_get_us_since_epoch() / 1000000ll;
+}
+
+const char *ftp_port_user (void) {
+    return servers_user;
+}
+
+const char *ftp_port_pass (void) {
+    return servers_pass;
+}
+
+uint32_t ftp_port_timeout_ms (void) {
+    return servers_get_timeout();
+}
+
+void ftp_port_socket_add (int32_t sd) {
+    modusocket_socket_add(sd, false);
+}
+
+void ftp_port_socket_close (int32_t *sd) {
+    servers_close_socket(sd);
+}
+
+void *ftp_port_open (const char *path, bool write) {
+    const TCHAR *path_relative;
+    BYTE mode = write ? (FA_WRITE | FA_CREATE_ALWAYS) : FA_READ;
+    ftp_port_file_t *fp = ftp_port_malloc(sizeof(ftp_port_file_t));
+    if (!fp) {
+        return NULL;
+    }
+
+    if (isLittleFs(path)) {
+        fp->littlefs = lookup_path_littlefs(path, &path_relative);
+        if (fp->littlefs) {
+            xSemaphoreTake(fp->littlefs->mutex, portMAX_DELAY);
+                int lfs_ret = littlefs_open_common_helper(&fp->littlefs->lfs, path_relative, &fp->u.fp_lfs.fp, fatFsModetoLittleFsMode(mode),
+                                                          &fp->u.fp_lfs.cfg, &fp->u.fp_lfs.timestamp_update);
+            xSemaphoreGive(fp->littlefs->mutex);
+            if (lfs_ret == LFS_ERR_OK) {
+                return fp;
+            }
+        }
+    } else {
+        fp->littlefs = NULL;
+        FATFS *fs = lookup_path_fatfs(path, &path_relative);
+        if (fs && f_open(fs, &fp->u.fp_fat, path_relative, mode) == FR_OK) {
+            return fp;
+        }
+    }
+    ftp_port_free(fp);
+    return NULL;
+}
+
+bool ftp_port_read (void *_fp, void *buf, uint32_t size, uint32_t *actualsize) {
+    ftp_port_file_t *fp = _fp;
+    if (fp->littlefs) {
+        xSemaphoreTake(fp->littlefs->mutex, portMAX_DELAY);
+            lfs_ssize_t len = lfs_file_read(&fp->littlefs->lfs, &fp->u.fp_lfs.fp, buf, size);
+        xSemaphoreGive(fp->littlefs->mutex);
+        *actualsize = (len > 0) ? len : 0;
+        return len >= 0;
+    }
+    UINT len;
+    FRESULT res = f_read(&fp->u.fp_fat, buf, size, &len);
+    *actualsize = len;
+    return res == FR_OK;
+}
+
+bool ftp_port_write (void *_fp, const void *buf, uint32_t size) {
+    ftp_port_file_t *fp = _fp;
+    if (fp->littlefs) {
+        xSemaphoreTake(fp->littlefs->mutex, portMAX_DELAY);
+            lfs_ssize_t len = lfs_file_write(&fp->littlefs->lfs, &fp->u.fp_lfs.fp, buf, size);
+            // Request timestamp update if file has been written successfully
+            if (len >= 0) {
+                fp->u.fp_lfs.timestamp_update = true;
+            }
+        xSemaphoreGive(fp->littlefs->mutex);
+        return len == size;
+    }
+    UINT len;
+    return f_write(&fp->u.fp_fat, buf, size, &len) == FR_OK && len == size;
+}
+
+void ftp_port_close (void *_fp) {
+    ftp_port_file_t *fp = _fp;
+    if (fp->littlefs) {
+        xSemaphoreTake(fp->littlefs->mutex, portMAX_DELAY);
+            littlefs_close_common_helper(&fp->littlefs->lfs, &fp->u.fp_lfs.fp, &fp->u.fp_lfs.cfg, &fp->u.fp_lfs.timestamp_update);
+        xSemaphoreGive(fp->littlefs->mutex);
+    } else {
+        f_close(&fp->u.fp_fat);
+    }
+    ftp_port_free(fp);
+}
+
+void *ftp_port_opendir (const char *path) {
+    const TCHAR *path_relative = "";
+    vfs_lfs_struct_t *littlefs = NULL;
+    FATFS *fs = NULL;
+    bool isroot = (path[0] == '/' && path[1] == '\0');
+
+    // "hack" to detect the root directory, which lists the mount points
+    if (!isroot) {
+        if (isLittleFs(path)) {
+            littlefs = lookup_path_littlefs(path, &path_relative);
+            if (littlefs == NULL) {
+                return NULL;
+            }
+        } else {
+            fs = lookup_path_fatfs(path, &path_relative);
+            if (fs == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    ftp_port_dir_t *dp = ftp_port_malloc(sizeof(ftp_port_dir_t) + strlen(path_relative) + 1);
+    if (!dp) {
+        return NULL;
+    }
+    dp->littlefs = littlefs;
+    dp->vfs = MP_STATE_VM(vfs_mount_table);
+    dp->isroot = isroot;
+    strcpy(dp->path, path_relative);
+
+    if (littlefs) {
+        xSemaphoreTake(littlefs->mutex, portMAX_DELAY);
+            int lfs_ret = lfs_dir_open(&littlefs->lfs, &dp->u.dp_lfs, path_relative);
+        xSemaphoreGive(littlefs->mutex);
+        if (lfs_ret == LFS_ERR_OK) {
+            return dp;
+        }
+    } else if (isroot || f_opendir(fs, &dp->u.dp_fat, path_relative) == FR_OK) {
+        return dp;
+    }
+    ftp_port_free(dp);
+    return NULL;
+}
+
+int ftp_port_readdir (void *_dp, ftp_stat_t *st) {
+    ftp_port_dir_t *dp = _dp;
+
+    if (dp->isroot) {
+        if (dp->vfs == NULL) {
+            return 0;
+        }
+        st->mtime = FTP_PORT_UNIX_TIME_20150101;
+        st->size = 0;
+        st->isdir = true;
+        strncpy(st->name, dp->vfs->str + 1, FTP_NAME_LEN_MAX - 1);
+        st->name[FTP_NAME_LEN_MAX - 1] = '\0';
+        dp->vfs = dp->vfs->next;
+        return 1;
+    }
+
+    if (dp->littlefs) {
+        lfs_ftp_file_stat_t fno;
+        int lfs_ret;
+        xSemaphoreTake(dp->littlefs->mutex, portMAX_DELAY);
+            // LittleFS does not filter out the "." and ".." entries opposed to FatFS
+            do {
+                lfs_ret = lfs_dir_read(&dp->littlefs->lfs, &dp->u.dp_lfs, &fno.info);
+            } while (lfs_ret > 0 && ftp_port_is_dot_entry(fno.info.name));
+
+            if (lfs_ret > 0) {
+                // Fetch the timestamp; the relative path of the entry is the directory plus its name
+                size_t dirlen = strlen(dp->path);
+                char *file_relative_path = ftp_port_malloc(dirlen + strlen(fno.info.name) + 2);
+                int lfs_getattr_ret = LFS_ERR_NOMEM;
+                if (file_relative_path) {
+                    strcpy(file_relative_path, dp->path);
+                    // If the current directory is not root directory need to append extra "/"
+                    if (dirlen > 1) {
+                        strcat(file_relative_path, "/");
+                    }
+                    strcat(file_relative_path, fno.info.name);
+                    lfs_getattr_ret = lfs_getattr(&dp->littlefs->lfs, file_relative_path, LFS_ATTRIBUTE_TIMESTAMP,
+                                                  &fno.timestamp, sizeof(lfs_timestamp_attribute_t));
+                    ftp_port_free(file_relative_path);
+                }
+                // If no timestamp is saved for this entry, fill it with 0
+                if (lfs_getattr_ret < LFS_ERR_OK) {
+                    fno.timestamp.fdate = 0;
+                    fno.timestamp.ftime = 0;
+                }
+            }
+        xSemaphoreGive(dp->littlefs->mutex);
+
+        if (lfs_ret <= 0) {
+            return (lfs_ret < 0) ? -1 : 0;
+        }
+        ftp_port_stat_from_lfs(st, &fno.info, &fno.timestamp);
+        return 1;
+    }
+
+    FILINFO fno;
+    do {
+        if (f_readdir(&dp->u.dp_fat, &fno) != FR_OK) {
+            return -1;
+        }
+        if (fno.fname[0] == '\0') {
+            return 0;
+        }
+    } while (ftp_port_is_dot_entry(fno.fname));
+    ftp_port_stat_from_fat(st, &fno);
+    return 1;
+}
+
+void ftp_port_closedir (void *_dp) {
+    ftp_port_dir_t *dp = _dp;
+    if (dp->littlefs) {
+        xSemaphoreTake(dp->littlefs->mutex, portMAX_DELAY);
+            lfs_dir_close(&dp->littlefs->lfs, &dp->u.dp_lfs);
+        xSemaphoreGive(dp->littlefs->mutex);
+    } else if (!dp->isroot) {
+        f_closedir(&dp->u.dp_fat);
+    }
+    ftp_port_free(dp);
+}
+
+bool ftp_port_stat (const char *path, ftp_stat_t *st) {
+    const TCHAR *path_relative;
+
+    if (isLittleFs(path)) {
+        vfs_lfs_struct_t *littlefs = lookup_path_littlefs(path, &path_relative);
+        if (littlefs == NULL) {
+            return false;
+        }
+        lfs_ftp_file_stat_t fno;
+        xSemaphoreTake(littlefs->mutex, portMAX_DELAY);
+            int lfs_ret = littlefs_stat_common_helper(&littlefs->lfs, path_relative, &fno.info, &fno.timestamp);
+        xSemaphoreGive(littlefs->mutex);
+        if (lfs_ret < LFS_ERR_OK) {
+            return false;
+        }
+        ftp_port_stat_from_lfs(st, &fno.info, &fno.timestamp);
+        return true;
+    }
+
+    FATFS *fs = lookup_path_fatfs(path, &path_relative);
+    FILINFO fno;
+    if (fs == NULL || f_stat(fs, path_relative, &fno) != FR_OK) {
+        return false;
+    }
+    ftp_port_stat_from_fat(st, &fno);
+    return true;
+}
+
+bool ftp_port_mkdir (const char *path) {
+    const TCHAR *path_relative;
+
+    if (isLittleFs(path)) {
+        vfs_lfs_struct_t *littlefs = lookup_path_littlefs(path, &path_relative);
+        if (littlefs == NULL) {
+            return false;
+        }
+        xSemaphoreTake(littlefs->mutex, portMAX_DELAY);
+            int lfs_ret = lfs_mkdir(&littlefs->lfs, path_relative);
+            if (lfs_ret == LFS_ERR_OK) {
+                littlefs_update_timestamp(&littlefs->lfs, path_relative);
+            }
+        xSemaphoreGive(littlefs->mutex);
+        return lfs_ret == LFS_ERR_OK;
+    }
+
+    FATFS *fs = lookup_path_fatfs(path, &path_relative);
+    return fs != NULL && f_mkdir(fs, path_relative) == FR_OK;
+}
+
+bool ftp_port_remove (const char *path) {
+    const TCHAR *path_relative;
+
+    if (isLittleFs(path)) {
+        vfs_lfs_struct_t *littlefs = lookup_path_littlefs(path, &path_relative);
+        if (littlefs == NULL) {
+            return false;
+        }
+        xSemaphoreTake(littlefs->mutex, portMAX_DELAY);
+            int lfs_ret = lfs_remove(&littlefs->lfs, path_relative);
+        xSemaphoreGive(littlefs->mutex);
+        return lfs_ret == LFS_ERR_OK;
+    }
+
+    FATFS *fs = lookup_path_fatfs(path, &path_relative);
+    return fs != NULL && f_unlink(fs, path_relative) == FR_OK;
+}
+
+bool ftp_port_rename (const char *path_old, const char *path_new) {
+    const TCHAR *path_relative_old;
+    const TCHAR *path_relative_new;
+
+    if (isLittleFs(path_old)) {
+        vfs_lfs_struct_t *littlefs_old = lookup_path_littlefs(path_old, &path_relative_old);
+        vfs_lfs_struct_t *littlefs_new = lookup_path_littlefs(path_new, &path_relative_new);
+        if (littlefs_old == NULL || littlefs_old != littlefs_new) {
+            return false;
+        }
+        xSemaphoreTake(littlefs_new->mutex, portMAX_DELAY);
+            int lfs_ret = lfs_rename(&littlefs_new->lfs, path_relative_old, path_relative_new);
+        xSemaphoreGive(littlefs_new->mutex);
+        return lfs_ret == LFS_ERR_OK;
+    }
+
+    FATFS *fs_old = lookup_path_fatfs(path_old, &path_relative_old);
+    FATFS *fs_new = lookup_path_fatfs(path_new, &path_relative_new);
+    if (fs_old == NULL || fs_old != fs_new) {
+        return false;
+    }
+    return f_rename(fs_new, path_relative_old, path_relative_new) == FR_OK;
+}
+
+void ftp_port_fs_changed (void) {
+    mp_import_cache_invalidate();
+}
+
+bool ftp_port_update_check_path (const char *path) {
+    return updater_check_path((void *)path);
+}
+
+bool ftp_port_update_start (void) {
+    return updater_start();
+}
+
+bool ftp_port_update_write (uint8_t *buf, uint32_t len) {
+    return updater_write(buf, len);
+}
+
+bool ftp_port_update_finish (void) {
+    return updater_finish();
+}
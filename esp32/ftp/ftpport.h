@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef FTPPORT_H_
+#define FTPPORT_H_
+
+// The FTP server core (ftp.c) only talks BSD sockets plus the hooks below, so
+// that it can be built both for the device (ftpport.c) and against POSIX
+// sockets and the host file system (posix/ftpport.c) for benchmarking.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#if defined(FTP_PORT_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#else
+#include "lwip/sockets.h"
+#endif
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define FTP_NAME_LEN_MAX                    256
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    int64_t             mtime;          // seconds since 1970
+    uint32_t            size;
+    bool                isdir;
+    char                name[FTP_NAME_LEN_MAX];
+} ftp_stat_t;
+
+/******************************************************************************
+ DECLARE PORT FUNCTIONS
+ ******************************************************************************/
+// memory for the sessions and the transmit queues
+extern void *ftp_port_malloc (uint32_t size);
+extern void ftp_port_free (void *ptr);
+
+// clocks: a free running millisecond tick and the wall clock
+extern uint32_t ftp_port_ticks_ms (void);
+extern int64_t ftp_port_time (void);
+
+// login credentials and the inactivity timeout of the control connection
+extern const char *ftp_port_user (void);
+extern const char *ftp_port_pass (void);
+extern uint32_t ftp_port_timeout_ms (void);
+
+// register a new socket with the network stack, and close one (sets *sd to -1)
+extern void ftp_port_socket_add (int32_t sd);
+extern void ftp_port_socket_close (int32_t *sd);
+
+// file system access; paths are absolute and handles are opaque to the core
+extern void *ftp_port_open (const char *path, bool write);
+extern bool ftp_port_read (void *fp, void *buf, uint32_t size, uint32_t *actualsize);
+extern bool ftp_port_write (void *fp, const void *buf, uint32_t size);
+extern void ftp_port_close (void *fp);
+// readdir returns 1 for an entry, 0 at the end and -1 on errors; "." and ".."
+// are never returned, and "/" lists the mount points
+extern void *ftp_port_opendir (const char *path);
+extern int ftp_port_readdir (void *dp, ftp_stat_t *st);
+extern void ftp_port_closedir (void *dp);
+extern bool ftp_port_stat (const char *path, ftp_stat_t *st);
+extern bool ftp_port_mkdir (const char *path);
+extern bool ftp_port_remove (const char *path);
+extern bool ftp_port_rename (const char *old_path, const char *new_path);
+// called after the file system has been modified
+extern void ftp_port_fs_changed (void);
+
+// firmware updates, uploaded as a special file
+extern bool ftp_port_update_check_path (const char *path);
+extern bool ftp_port_update_start (void);
+extern bool ftp_port_update_write (uint8_t *buf, uint32_t len);
+extern bool ftp_port_update_finish (void);
+
+#endif /* FTPPORT_H_ */
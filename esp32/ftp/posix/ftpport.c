@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Port of the FTP server core to POSIX sockets and the host file system, so
+// that it can be run and benchmarked on a PC. All paths are relative to the
+// directory given with ftp_posix_set_root().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "ftp.h"
+#include "ftpport.h"
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    DIR     *dir;
+    char    path[];
+} ftp_posix_dir_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static const char *ftp_posix_root = ".";
+static const char *ftp_posix_user = "micro";
+static const char *ftp_posix_pass = "python";
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static char *ftp_posix_path (const char *path, const char *name) {
+    static char buf[2][FTP_PATH_LEN_MAX + FTP_NAME_LEN_MAX + 256];
+    static int idx;
+    // two paths can be in use at the same time (rename)
+    char *dest = buf[idx ^= 1];
+    snprintf(dest, sizeof(buf[0]), "%s%s%s%s", ftp_posix_root, path, name ? "/" : "", name ? name : "");
+    return dest;
+}
+
+static bool ftp_posix_stat (const char *hostpath, const char *name, ftp_stat_t *st) {
+    struct stat sb;
+    if (stat(hostpath, &sb) != 0) {
+        return false;
+    }
+    st->mtime = sb.st_mtime;
+    st->size = sb.st_size;
+    st->isdir = S_ISDIR(sb.st_mode);
+    snprintf(st->name, sizeof(st->name), "%s", name);
+    return true;
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void ftp_posix_set_root (const char *root) {
+    ftp_posix_root = root;
+}
+
+void ftp_posix_set_login (const char *user, const char *pass) {
+    ftp_posix_user = user;
+    ftp_posix_pass = pass;
+}
+
+void stoupper (char *str) {
+    while (str && *str != '\0') {
+        *str = (char)toupper((int)(*str));
+        str++;
+    }
+}
+
+/******************************************************************************
+ DEFINE PORT FUNCTIONS
+ ******************************************************************************/
+void *ftp_port_malloc (uint32_t size) {
+    return malloc(size);
+}
+
+void ftp_port_free (void *ptr) {
+    free(ptr);
+}
+
+uint32_t ftp_port_ticks_ms (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int64_t ftp_port_time (void) {
+    return time(NULL);
+}
+
+const char *ftp_port_user (void) {
+    return ftp_posix_user;
+}
+
+const char *ftp_port_pass (void) {
+    return ftp_posix_pass;
+}
+
+uint32_t ftp_port_timeout_ms (void) {
+    return 300000;
+}
+
+void ftp_port_socket_add (int32_t sd) {
+    (void)sd;
+}
+
+void ftp_port_socket_close (int32_t *sd) {
+    if (*sd > 0) {
+        close(*sd);
+        *sd = -1;
+    }
+}
+
+void *ftp_port_open (const char *path, bool write) {
+    return fopen(ftp_posix_path(path, NULL), write ? "wb" : "rb");
+}
+
+bool ftp_port_read (void *fp, void *buf, uint32_t size, uint32_t *actualsize) {
+    *actualsize = fread(buf, 1, size, fp);
+    return !ferror((FILE *)fp);
+}
+
+bool ftp_port_write (void *fp, const void *buf, uint32_t size) {
+    return fwrite(buf, 1, size, fp) == size;
+}
+
+void ftp_port_close (void *fp) {
+    fclose(fp);
+}
+
+void *ftp_port_opendir (const char *path) {
+    ftp_posix_dir_t *dp = malloc(sizeof(ftp_posix_dir_t) + strlen(path) + 1);
+    if (!dp) {
+        return NULL;
+    }
+    dp->dir = opendir(ftp_posix_path(path, NULL));
+    if (!dp->dir) {
+        free(dp);
+        return NULL;
+    }
+    strcpy(dp->path, path);
+    return dp;
+}
+
+int ftp_port_readdir (void *_dp, ftp_stat_t *st) {
+    ftp_posix_dir_t *dp = _dp;
+    struct dirent *de;
+    while ((de = readdir(dp->dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+        if (ftp_posix_stat(ftp_posix_path(dp->path, de->d_name), de->d_name, st)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ftp_port_closedir (void *_dp) {
+    ftp_posix_dir_t *dp = _dp;
+    closedir(dp->dir);
+    free(dp);
+}
+
+bool ftp_port_stat (const char *path, ftp_stat_t *st) {
+    const char *name = strrchr(path, '/');
+    return ftp_posix_stat(ftp_posix_path(path, NULL), name ? name + 1 : path, st);
+}
+
+bool ftp_port_mkdir (const char *path) {
+    return mkdir(ftp_posix_path(path, NULL), 0777) == 0;
+}
+
+bool ftp_port_remove (const char *path) {
+    return remove(ftp_posix_path(path, NULL)) == 0;
+}
+
+bool ftp_port_rename (const char *old_path, const char *new_path) {
+    const char *old_hostpath = ftp_posix_path(old_path, NULL);
+    return rename(old_hostpath, ftp_posix_path(new_path, NULL)) == 0;
+}
+
+void ftp_port_fs_changed (void) {
+}
+
+bool ftp_port_update_check_path (const char *path) {
+    (void)path;
+    return false;
+}
+
+bool ftp_port_update_start (void) {
+    return false;
+}
+
+bool ftp_port_update_write (uint8_t *buf, uint32_t len) {
+    (void)buf;
+    (void)len;
+    return false;
+}
+
+bool ftp_port_update_finish (void) {
+    return true;
+}
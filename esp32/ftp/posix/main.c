@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Stand-alone FTP server on top of the device's FTP core:
+//   ftpserver [root-dir [user pass]]
+// It listens on FTP_CMD_PORT, and serves root-dir (the current directory
+// by default) with the same login as the device (micro/python).
+
+#include <stdio.h>
+#include <signal.h>
+
+#include "ftp.h"
+#include "ftpport.h"
+
+extern void ftp_posix_set_root (const char *root);
+extern void ftp_posix_set_login (const char *user, const char *pass);
+
+int main (int argc, char **argv) {
+    if (argc > 1) {
+        ftp_posix_set_root(argv[1]);
+    }
+    if (argc > 3) {
+        ftp_posix_set_login(argv[2], argv[3]);
+    }
+    // a client going away in the middle of a send must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    ftp_init();
+    ftp_enable();
+    for ( ; ; ) {
+        ftp_run();
+        if (!ftp_wait(1000)) {
+            // not listening yet (or the port is taken), retry in a while
+            usleep(100000);
+        }
+    }
+    return 0;
+}
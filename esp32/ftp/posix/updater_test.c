@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Runs the OTA stream stage (updater_stream.c) against a file backed flash and
+// compares it with writing the raw image and reading it back to verify it:
+//   ./updater_test [image]
+// Without an image a firmware like one is generated. Delta patches made by
+// tools/ota_delta.py are tested against a pair of generated releases with
+//   ./updater_test gen old.bin new.bin
+//   ./updater_test delta old.bin new.bin patch
+// Exits with 1 on failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <openssl/sha.h>
+
+#include "updater_stream.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define FLASH_PATH                      "updater_test.flash"
+#define FLASH_SLOT                      0x10000
+#define FLASH_SLOT_SIZE                 (1536 * 1024)
+// the slot the device would be running from, for delta updates
+#define FLASH_BASE_SLOT                 (FLASH_SLOT + FLASH_SLOT_SIZE)
+#define FLASH_SIZE                      (FLASH_BASE_SLOT + FLASH_SLOT_SIZE)
+#define IMAGE_SIZE                      (1200 * 1024)
+// where the application is linked, to make relocated addresses look real
+#define IMAGE_ADDR                      0x400D0000
+// how often the compressor is told to make a resume point
+#define FLUSH_INTERVAL                  (64 * 1024)
+#define FLUSH_POINTS_MAX                64
+// the largest chunk fed at once, like a socket read
+#define CHUNK_MAX                       1460
+// rough figures of an LTE-M link and the ESP32 flash, to estimate how long
+// the update would take on the device rather than on this PC
+#define LINK_BYTES_PER_S                (300000 / 8)
+#define FLASH_ERASE_MS                  45
+#define FLASH_READ_BYTES_PER_S          (8 * 1024 * 1024)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint32_t in;                        // offset in the compressed data
+    uint32_t out;                       // offset in the image
+} flush_point_t;
+
+typedef struct {
+    uint8_t         *data;
+    uint32_t        len;
+    uint32_t        header_len;         // zlib/gzip header, sent again on resume
+    flush_point_t   points[FLUSH_POINTS_MAX];
+    uint32_t        npoints;
+} packed_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static int flash_fd = -1;
+static uint32_t flash_read_bytes;
+static uint32_t flash_erases;
+static bool flash_failed;
+static uint32_t rand_state = 12345;
+static int failures;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// NOR flash: erasing sets the bits and writing can only clear them
+static bool flash_erase_sector (uint32_t addr) {
+    uint8_t sector[UPDATER_STREAM_SECTOR_SIZE];
+    if (addr % UPDATER_STREAM_SECTOR_SIZE || addr + UPDATER_STREAM_SECTOR_SIZE > FLASH_SIZE) {
+        return false;
+    }
+    memset(sector, 0xFF, sizeof(sector));
+    flash_erases++;
+    return pwrite(flash_fd, sector, sizeof(sector), addr) == sizeof(sector);
+}
+
+static bool flash_write (uint32_t addr, const void *buf, uint32_t len) {
+    uint8_t old[CHUNK_MAX];
+    const uint8_t *src = buf;
+    while (len > 0) {
+        uint32_t n = len < sizeof(old) ? len : sizeof(old);
+        if (addr + n > FLASH_SIZE || pread(flash_fd, old, n, addr) != n) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (src[i] & ~old[i]) {
+                // a bit would have to go from 0 to 1, the sector wasn't erased
+                flash_failed = true;
+            }
+            old[i] &= src[i];
+        }
+        if (pwrite(flash_fd, old, n, addr) != n) {
+            return false;
+        }
+        addr += n;
+        src += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool flash_read (uint32_t addr, void *buf, uint32_t len) {
+    flash_read_bytes += len;
+    return addr + len <= FLASH_SIZE && pread(flash_fd, buf, len, addr) == len;
+}
+
+static const updater_flash_t fake_flash = {
+    .erase_sector = flash_erase_sector,
+    .write = flash_write,
+    .read = flash_read,
+};
+
+static void flash_reset (void) {
+    uint8_t *junk = malloc(FLASH_SIZE);
+    // whatever an earlier image left behind
+    for (uint32_t i = 0; i < FLASH_SIZE; i++) {
+        junk[i] = i * 7;
+    }
+    if (pwrite(flash_fd, junk, FLASH_SIZE, 0) != FLASH_SIZE) {
+        perror(FLASH_PATH);
+        exit(1);
+    }
+    free(junk);
+    flash_read_bytes = 0;
+    flash_erases = 0;
+    flash_failed = false;
+}
+
+static bool flash_holds (const uint8_t *image, uint32_t len) {
+    uint8_t *buf = malloc(len);
+    bool ok = pread(flash_fd, buf, len, FLASH_SLOT) == len && !memcmp(buf, image, len);
+    free(buf);
+    return ok && !flash_failed;
+}
+
+static uint32_t rand_next (void) {
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report (uint32_t sent, uint32_t len, double t) {
+    double device = (double)sent / LINK_BYTES_PER_S + flash_erases * FLASH_ERASE_MS / 1000.0 +
+                    (double)flash_read_bytes / FLASH_READ_BYTES_PER_S;
+    printf("  sent %u bytes (%.1f%%), read back %u bytes, %u erases, %.1f ms here, ~%.1f s on the device\n",
+           sent, 100.0 * sent / len, flash_read_bytes, flash_erases, t * 1000, device);
+}
+
+static void check (bool ok, const char *what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+// code like sections mixed with tables, addresses and some noise, which
+// compresses about as well as a real application image
+static void fill_code (uint8_t *buf, uint32_t size, uint32_t image_size) {
+    static const char *words[] = { "mp_obj_", "nlr_", "esp_", "return ", "0x", "if (", "lwip_", "->", "uint32_t ", ";\n" };
+    uint32_t i = 0;
+    while (i < size) {
+        uint32_t kind = rand_next() % 9;
+        uint32_t n = 16 + rand_next() % 240;
+        for (uint32_t j = 0; j < n && i < size; j++) {
+            if (kind < 4) {
+                const char *w = words[rand_next() % 10];
+                while (*w && i < size) {
+                    buf[i++] = *w++;
+                }
+            } else if (kind < 7) {
+                buf[i++] = (rand_next() % 4) ? (uint8_t)(rand_next() & 0x3F) : 0;
+            } else if (kind < 8) {
+                buf[i++] = rand_next();
+            } else if (i % 4 == 0 && i + 4 <= size) {
+                uint32_t addr = IMAGE_ADDR + (rand_next() % image_size & ~3);
+                memcpy(buf + i, &addr, 4);
+                i += 4;
+            } else {
+                buf[i++] = 0;
+            }
+        }
+    }
+}
+
+// the SHA256 of it all is appended like esptool does (a real image given on
+// the command line must have it too)
+static uint8_t *make_image (uint32_t *len) {
+    uint8_t *image = malloc(IMAGE_SIZE + UPDATER_STREAM_HASH_LEN);
+    fill_code(image, IMAGE_SIZE, IMAGE_SIZE);
+    image[0] = 0xE9;
+    SHA256(image, IMAGE_SIZE, image + IMAGE_SIZE);
+    *len = IMAGE_SIZE + UPDATER_STREAM_HASH_LEN;
+    return image;
+}
+
+// the next release: some functions added, which moves everything after them
+// and so changes the addresses pointing there, plus a few scattered edits
+static uint8_t *make_release (const uint8_t *old, uint32_t old_len, uint32_t *len) {
+    #define RELEASE_INSERTS 6
+    uint32_t at[RELEASE_INSERTS], size[RELEASE_INSERTS], total = 0;
+    uint32_t old_size = old_len - UPDATER_STREAM_HASH_LEN;
+
+    for (int k = 0; k < RELEASE_INSERTS; k++) {
+        at[k] = (old_size / RELEASE_INSERTS) * k + (rand_next() % (old_size / RELEASE_INSERTS) & ~3);
+        size[k] = 1024 + (rand_next() % 3072 & ~3);
+        total += size[k];
+    }
+    uint32_t new_size = old_size + total;
+    uint8_t *image = malloc(new_size + UPDATER_STREAM_HASH_LEN);
+    uint32_t from = 0, to = 0;
+    for (int k = 0; k < RELEASE_INSERTS; k++) {
+        memcpy(image + to, old + from, at[k] - from);
+        to += at[k] - from;
+        from = at[k];
+        fill_code(image + to, size[k], new_size);
+        to += size[k];
+    }
+    memcpy(image + to, old + from, old_size - from);
+
+    // relocate the addresses into the old image
+    for (uint32_t i = 0; i + 4 <= new_size; i += 4) {
+        uint32_t addr;
+        memcpy(&addr, image + i, 4);
+        if (addr >= IMAGE_ADDR && addr < IMAGE_ADDR + old_size) {
+            uint32_t shift = 0;
+            for (int k = 0; k < RELEASE_INSERTS && at[k] <= addr - IMAGE_ADDR; k++) {
+                shift += size[k];
+            }
+            addr += shift;
+            memcpy(image + i, &addr, 4);
+        }
+    }
+    for (int k = 0; k < 200; k++) {
+        image[rand_next() % new_size] = rand_next();
+    }
+    image[0] = 0xE9;
+    SHA256(image, new_size, image + new_size);
+    *len = new_size + UPDATER_STREAM_HASH_LEN;
+    return image;
+}
+
+static uint8_t *load (const char *path, uint32_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    uint8_t *data = malloc(FLASH_SLOT_SIZE);
+    *len = fread(data, 1, FLASH_SLOT_SIZE, f);
+    fclose(f);
+    return data;
+}
+
+static void save (const char *path, const uint8_t *data, uint32_t len) {
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(data, 1, len, f) != len) {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+}
+
+static bool pack (const uint8_t *image, uint32_t len, int wbits, packed_t *p) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    memset(p, 0, sizeof(*p));
+    if (deflateInit2(&z, 9, Z_DEFLATED, wbits, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    uint32_t cap = deflateBound(&z, len) + FLUSH_POINTS_MAX * 16;
+    p->data = malloc(cap);
+    z.next_out = p->data;
+    z.avail_out = cap;
+    // the header is written together with the first output
+    p->header_len = (wbits > 15) ? 10 : 2;
+    for (uint32_t pos = 0; pos < len; ) {
+        uint32_t n = (len - pos < FLUSH_INTERVAL) ? len - pos : FLUSH_INTERVAL;
+        z.next_in = (uint8_t *)image + pos;
+        z.avail_in = n;
+        pos += n;
+        if (deflate(&z, pos < len ? Z_FULL_FLUSH : Z_FINISH) == Z_STREAM_ERROR) {
+            return false;
+        }
+        if (pos < len && p->npoints < FLUSH_POINTS_MAX) {
+            p->points[p->npoints].in = z.total_out;
+            p->points[p->npoints].out = pos;
+            p->npoints++;
+        }
+    }
+    p->len = z.total_out;
+    deflateEnd(&z);
+    return true;
+}
+
+static bool feed (updater_stream_t *s, const uint8_t *data, uint32_t len) {
+    for (uint32_t pos = 0; pos < len; ) {
+        uint32_t n = 1 + rand_next() % CHUNK_MAX;
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        if (!updater_stream_write(s, data + pos, n)) {
+            return false;
+        }
+        pos += n;
+    }
+    return true;
+}
+
+// the way it was done before: the raw image is written and then read back
+static void test_raw (const uint8_t *image, uint32_t len) {
+    updater_stream_t s;
+    uint8_t buf[4096], digest[SHA256_DIGEST_LENGTH];
+    SHA256_CTX sha;
+
+    flash_reset();
+    double t = now();
+    bool ok = updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, false) &&
+              feed(&s, image, len) && updater_stream_finish(&s);
+    SHA256_Init(&sha);
+    for (uint32_t pos = 0; pos < len - SHA256_DIGEST_LENGTH; ) {
+        uint32_t n = len - SHA256_DIGEST_LENGTH - pos;
+        n = n < sizeof(buf) ? n : sizeof(buf);
+        flash_read(FLASH_SLOT + pos, buf, n);
+        SHA256_Update(&sha, buf, n);
+        pos += n;
+    }
+    SHA256_Final(digest, &sha);
+    t = now() - t;
+    check(ok && flash_holds(image, len) && !memcmp(digest, image + len - SHA256_DIGEST_LENGTH, sizeof(digest)),
+          "raw image, verified by reading it back");
+    check(updater_stream_hash_ok(&s), "raw image, hashed while writing");
+    report(len, len, t);
+}
+
+static void test_packed (const uint8_t *image, uint32_t len, int wbits, const char *name) {
+    updater_stream_t s;
+    packed_t p;
+    char what[64];
+
+    if (!pack(image, len, wbits, &p)) {
+        check(false, name);
+        return;
+    }
+
+    // in one go
+    flash_reset();
+    double t = now();
+    bool ok = updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, true) &&
+              feed(&s, p.data, p.len) && updater_stream_finish(&s);
+    t = now() - t;
+    snprintf(what, sizeof(what), "%s, streamed", name);
+    check(ok && flash_holds(image, len) && updater_stream_hash_ok(&s), what);
+    report(p.len, len, t);
+
+    // the link drops after 60%, then the update is resumed from the last flush
+    // point that made it to flash
+    flash_reset();
+    t = now();
+    updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, true);
+    feed(&s, p.data, p.len * 6 / 10);
+    snprintf(what, sizeof(what), "%s, dropped stream not completed", name);
+    check(!updater_stream_finish(&s), what);
+    uint32_t written = s.written, sent = p.len * 6 / 10;
+    flush_point_t *fp = NULL;
+    for (uint32_t i = 0; i < p.npoints && p.points[i].out <= written; i++) {
+        fp = &p.points[i];
+    }
+    ok = fp != NULL && updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, fp->out, true) &&
+         feed(&s, p.data, p.header_len) && feed(&s, p.data + fp->in, p.len - fp->in) &&
+         updater_stream_finish(&s);
+    t = now() - t;
+    sent += p.header_len + p.len - (fp ? fp->in : 0);
+    snprintf(what, sizeof(what), "%s, resumed", name);
+    check(ok && flash_holds(image, len) && updater_stream_hash_ok(&s), what);
+    printf("  resumed at %u, %u bytes had been written\n", fp ? fp->out : 0, written);
+    report(sent, len, t);
+
+    // a flipped bit must not go unnoticed
+    flash_reset();
+    p.data[p.len / 2] ^= 0x10;
+    ok = updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, true) &&
+         feed(&s, p.data, p.len) && updater_stream_finish(&s);
+    snprintf(what, sizeof(what), "%s, corrupted stream rejected", name);
+    check(!ok, what);
+    p.data[p.len / 2] ^= 0x10;
+
+    free(p.data);
+}
+
+// the patch is applied to the image in the base slot, then the same patch to
+// the wrong base must be refused before anything is written
+static void test_delta (const uint8_t *old, uint32_t old_len, const uint8_t *image, uint32_t len,
+                        const uint8_t *patch, uint32_t patch_len) {
+    updater_stream_t s;
+    packed_t p;
+
+    flash_reset();
+    if (pwrite(flash_fd, old, old_len, FLASH_BASE_SLOT) != old_len) {
+        perror(FLASH_PATH);
+        exit(1);
+    }
+    bool compressed = patch_len > 0 && patch[0] != UPDATER_DELTA_MAGIC[0];
+    double t = now();
+    bool ok = updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, compressed) &&
+              updater_stream_set_base(&s, FLASH_BASE_SLOT, FLASH_SLOT_SIZE) &&
+              feed(&s, patch, patch_len) && updater_stream_finish(&s);
+    t = now() - t;
+    check(ok && flash_holds(image, len) && updater_stream_hash_ok(&s), "delta, rebuilt from the base slot");
+    report(patch_len, len, t);
+    printf("  %u bytes read from the base slot\n", s.patch.old_read);
+    if (pack(image, len, 12, &p)) {
+        printf("  the whole image would have been %u bytes compressed\n", p.len);
+        free(p.data);
+    }
+
+    flash_reset();
+    pwrite(flash_fd, image, len, FLASH_BASE_SLOT);
+    ok = updater_stream_start(&s, &fake_flash, FLASH_SLOT, FLASH_SLOT_SIZE, 0, compressed) &&
+         updater_stream_set_base(&s, FLASH_BASE_SLOT, FLASH_SLOT_SIZE) &&
+         feed(&s, patch, patch_len) && updater_stream_finish(&s);
+    check(!ok && flash_erases == 0, "delta, wrong base refused");
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+int main (int argc, char **argv) {
+    uint32_t len;
+    uint8_t *image;
+
+    if (argc == 4 && !strcmp(argv[1], "gen")) {
+        uint32_t new_len;
+        image = make_image(&len);
+        uint8_t *next = make_release(image, len, &new_len);
+        save(argv[2], image, len);
+        save(argv[3], next, new_len);
+        free(image);
+        free(next);
+        return 0;
+    }
+
+    flash_fd = open(FLASH_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (flash_fd < 0) {
+        perror(FLASH_PATH);
+        return 1;
+    }
+
+    if (argc == 5 && !strcmp(argv[1], "delta")) {
+        uint32_t old_len, patch_len;
+        uint8_t *old = load(argv[2], &old_len);
+        uint8_t *patch = load(argv[4], &patch_len);
+        image = load(argv[3], &len);
+        printf("base: %u bytes, image: %u bytes, patch: %u bytes\n", old_len, len, patch_len);
+        test_delta(old, old_len, image, len, patch, patch_len);
+        free(old);
+        free(patch);
+    } else {
+        image = (argc > 1) ? load(argv[1], &len) : make_image(&len);
+        printf("image: %u bytes\n", len);
+        test_raw(image, len);
+        test_packed(image, len, 12, "zlib, 4K window");
+        test_packed(image, len, 15, "zlib, 32K window");
+        test_packed(image, len, 15 + 16, "gzip");
+    }
+
+    close(flash_fd);
+    unlink(FLASH_PATH);
+    free(image);
+    return failures ? 1 : 0;
+}
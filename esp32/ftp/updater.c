@@ -15,8 +15,10 @@
 #include "py/obj.h"
 #include "bootloader.h"
 #include "updater.h"
+#include "updater_stream.h"
 #include "esp_spi_flash.h"
 #include "esp_flash_encrypt.h"
+#include "esp_secure_boot.h"
 #include "esp_image_format.h"
 //#define LOG_LOCAL_LEVEL ESP_LOG_INFO
 #include "esp_log.h"
@@ -39,8 +41,6 @@ typedef struct {
     uint32_t size;
     uint32_t offset;
     uint32_t offset_start_upd;
-    uint32_t chunk_size;
-    uint32_t current_chunk;
 } updater_data_t;
 
 /******************************************************************************
@@ -49,19 +49,31 @@ typedef struct {
 static updater_data_t updater_data = {
     .size = 0,
     .offset = 0,
-    .offset_start_upd = 0,
-    .chunk_size = 0,
-    .current_chunk = 0 };
+    .offset_start_upd = 0 };
 
 //static OsiLockObj_t updater_LockObj;
 static boot_info_t boot_info;
 static uint32_t boot_info_offset;
 
+// the image goes through the stream stage, which inflates and hashes it
+static updater_stream_t updater_stream;
+// true once the digest of the last image written is known
+static bool updater_hashed = false;
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
 static esp_err_t updater_spi_flash_read(size_t src, void *dest, size_t size, bool allow_decrypt);
 static esp_err_t updater_spi_flash_write(size_t dest_addr, void *src, size_t size, bool write_encrypted);
+static bool updater_flash_erase_sector (uint32_t addr);
+static bool updater_flash_write (uint32_t addr, const void *buf, uint32_t len);
+static bool updater_flash_read (uint32_t addr, void *buf, uint32_t len);
+
+static const updater_flash_t updater_flash = {
+    .erase_sector = updater_flash_erase_sector,
+    .write = updater_flash_write,
+    .read = updater_flash_read,
+};
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -99,26 +111,41 @@ bool updater_check_path (void *path) {
 }
 
 bool updater_start (void) {
+    return updater_start_at(0, false, false);
+}
+
+bool updater_start_at (uint32_t offset, bool compressed, bool delta) {
 
     updater_data.size = (esp32_get_chip_rev() > 0 ? IMG_SIZE_8MB : IMG_SIZE_4MB);
     // check which one should be the next active image
-    updater_data.offset = updater_ota_next_slot_address();
+    updater_data.offset_start_upd = updater_ota_next_slot_address();
+
+    ESP_LOGD(TAG, "Updating image at offset = 0x%6X, from 0x%X\n", updater_data.offset_start_upd, offset);
 
-    ESP_LOGD(TAG, "Updating image at offset = 0x%6X\n", updater_data.offset);
-    updater_data.offset_start_upd = updater_data.offset;
+    // drop whatever is left of an update that wasn't finished
+    updater_stream_abort(&updater_stream);
+    updater_hashed = false;
+    updater_data.offset = 0;
 
-    // erase the first 2 sectors
-    if (ESP_OK != spi_flash_erase_sector(updater_data.offset / SPI_FLASH_SEC_SIZE)) {
-        ESP_LOGE(TAG, "Erasing first sector failed!\n");
+    // sectors are erased as the image is written, the ones before offset are kept
+    if (!updater_stream_start(&updater_stream, &updater_flash, updater_data.offset_start_upd,
+                              updater_data.size, offset, compressed)) {
+        ESP_LOGE(TAG, "Starting the update failed!\n");
         return false;
     }
-    if (ESP_OK != spi_flash_erase_sector((updater_data.offset + SPI_FLASH_SEC_SIZE) / SPI_FLASH_SEC_SIZE)) {
-        ESP_LOGE(TAG, "Erasing second sector failed!\n");
-        return false;
+
+    if (delta) {
+        // the patch is applied to the image we are running from
+        int base = updater_ota_running_slot_address();
+        if (base == updater_data.offset_start_upd ||
+            !updater_stream_set_base(&updater_stream, base, updater_data.size)) {
+            ESP_LOGE(TAG, "Can't patch the image at 0x%X\n", base);
+            return false;
+        }
     }
 
-    boot_info.size = 0;
-    updater_data.current_chunk = 0;
+    updater_data.offset = updater_data.offset_start_upd + offset;
+    boot_info.size = offset;
 
     return true;
 }
@@ -127,29 +154,34 @@ bool updater_write (uint8_t *buf, uint32_t len) {
 
     // the actual writing into flash, not-encrypted,
     // because it already came encrypted from OTA server
-    if (ESP_OK != updater_spi_flash_write(updater_data.offset, (void *)buf, len, false)) {
-        ESP_LOGE(TAG, "SPI flash write failed\n");
-        return false;
-    }
+    bool ret = updater_stream_write(&updater_stream, buf, len);
 
-    updater_data.offset += len;
-    updater_data.current_chunk += len;
-    boot_info.size += len;
+    updater_data.offset = updater_data.offset_start_upd + updater_stream.written;
+    boot_info.size = updater_stream.written;
 
-    if (updater_data.current_chunk >= SPI_FLASH_SEC_SIZE) {
-        updater_data.current_chunk -= SPI_FLASH_SEC_SIZE;
-        // erase the next sector
-        if (ESP_OK != spi_flash_erase_sector((updater_data.offset + SPI_FLASH_SEC_SIZE) / SPI_FLASH_SEC_SIZE)) {
-            ESP_LOGE(TAG, "Erasing next sector failed!\n");
-            return false;
-        }
+    if (!ret) {
+        ESP_LOGE(TAG, "Writing the update failed at %d\n", updater_stream.written);
     }
 //    sl_LockObjUnlock (&wlan_LockObj);
-    return true;
+    return ret;
+}
+
+uint32_t updater_get_offset (void) {
+    return updater_stream.written;
 }
 
 bool updater_finish (void) {
     if (updater_data.offset > 0) {
+        // a truncated compressed image, or one that failed to be written, is
+        // left in the slot for a resume, but not booted
+        if (!updater_stream_finish(&updater_stream)) {
+            ESP_LOGE(TAG, "Update incomplete, %d bytes written\n", updater_stream.written);
+            updater_data.offset = 0;
+            return false;
+        }
+        updater_hashed = true;
+        boot_info.size = updater_stream.written;
+
         ESP_LOGI(TAG, "Updater finished, boot status: %d\n", boot_info.Status);
 //        sl_LockObjLock (&wlan_LockObj, SL_OS_WAIT_FOREVER);
         // if we still have an image pending for verification, leave the boot info as it is
@@ -183,6 +215,20 @@ bool updater_verify (void) {
 
     esp_err_t ret;
     esp_image_metadata_t data;
+
+    // the image was hashed while it was written, so if its SHA256 is appended
+    // only the header has to be read back; signatures and encrypted images
+    // still go through the full check
+    if (updater_hashed && !esp_secure_boot_enabled() && !esp_flash_encryption_enabled()) {
+        esp_image_header_t header;
+        if (ESP_OK == updater_spi_flash_read(updater_data.offset_start_upd, &header, sizeof(header), false) &&
+            header.magic == ESP_IMAGE_HEADER_MAGIC && header.hash_appended) {
+            bool ok = updater_stream_hash_ok(&updater_stream);
+            ESP_LOGI(TAG, "streamed hash check: %d\n", ok);
+            return ok;
+        }
+    }
+
     const esp_partition_pos_t part_pos = {
       .offset = updater_data.offset_start_upd,
       .size = boot_info.size,
@@ -243,6 +289,13 @@ bool updater_write_boot_info(boot_info_t *boot_info, uint32_t boot_info_offset)
     return (ESP_OK == ret);
 }
 
+int updater_ota_running_slot_address (void) {
+    // this code is mapped from the slot it was booted from
+    size_t addr = spi_flash_cache2phys((const void *)updater_ota_running_slot_address);
+    int ota_offset = (esp32_get_chip_rev() > 0 ? IMG_UPDATE1_OFFSET_8MB : IMG_UPDATE1_OFFSET_4MB);
+    return (addr != SPI_FLASH_CACHE2PHYS_FAIL && addr >= ota_offset) ? ota_offset : IMG_FACTORY_OFFSET;
+}
+
 int updater_ota_next_slot_address() {
 
     int ota_offset = (esp32_get_chip_rev() > 0 ? IMG_UPDATE1_OFFSET_8MB : IMG_UPDATE1_OFFSET_4MB);
@@ -284,6 +337,27 @@ int updater_ota_next_slot_address() {
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 
+static bool updater_flash_erase_sector (uint32_t addr) {
+    if (ESP_OK != spi_flash_erase_sector(addr / SPI_FLASH_SEC_SIZE)) {
+        ESP_LOGE(TAG, "Erasing sector 0x%X failed!\n", addr);
+        return false;
+    }
+    return true;
+}
+
+static bool updater_flash_write (uint32_t addr, const void *buf, uint32_t len) {
+    if (ESP_OK != updater_spi_flash_write(addr, (void *)buf, len, false)) {
+        ESP_LOGE(TAG, "SPI flash write failed\n");
+        return false;
+    }
+    return true;
+}
+
+static bool updater_flash_read (uint32_t addr, void *buf, uint32_t len) {
+    // read back exactly what was written, i.e. without decrypting
+    return (ESP_OK == updater_spi_flash_read(addr, buf, len, false));
+}
+
 static esp_err_t updater_spi_flash_read(size_t src, void *dest, size_t size, bool allow_decrypt)
 {
     if (allow_decrypt && esp_flash_encryption_enabled()) {
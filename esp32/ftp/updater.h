@@ -30,6 +30,24 @@ extern bool updater_check_path(void *path);
  */
 extern bool updater_start(void);
 
+/**
+ * @brief  Initializes the OTA update process, optionally resuming an interrupted one.
+ *
+ * @note The first offset bytes already in the next slot are kept. A compressed
+ *        image (zlib or gzip) is inflated while it is written; to resume it the
+ *        container header must be sent again, followed by the data from a full
+ *        flush point that decompresses to offset (see tools/ota_compress.py).
+ *        A delta is a patch against the running image (see tools/ota_delta.py),
+ *        which can be compressed too, but not resumed.
+ *
+ * @param  offset     number of image bytes to keep, as returned by updater_get_offset()
+ * @param  compressed true if the image is sent compressed
+ * @param  delta      true if a patch is sent instead of the image
+ *
+ * @return true if initialization succeeded; false otherwise.
+ */
+extern bool updater_start_at(uint32_t offset, bool compressed, bool delta);
+
 
 /**
  * @brief  OTA Write next chunk to Flash.
@@ -45,6 +63,15 @@ extern bool updater_start(void);
  */
 extern bool updater_write(uint8_t *buf, uint32_t len);
 
+/**
+ * @brief  Returns the number of (uncompressed) image bytes written into Flash so far.
+ *
+ * @note Still valid after a failed write or finish, to resume the update from there.
+ *
+ * @return the offset in the image.
+ */
+extern uint32_t updater_get_offset(void);
+
 /**
  * @brief  Closing the OTA process. This provokes updating the boot info from the otadata partition.
  *
@@ -56,7 +83,8 @@ extern bool updater_finish(void);
  * @brief  Verifies the newly written OTA image.
  *
  * @note If Secure Boot is enabled the signature is checked.
- *          Anyway the image integrity (SHA256) is checked.
+ *          Anyway the image integrity (SHA256) is checked, using the digest
+ *          computed while writing if the image has one appended.
  *
  * @return true if boot info was saved successful; false otherwise.
  */
@@ -79,6 +107,13 @@ extern bool updater_read_boot_info(boot_info_t *boot_info, uint32_t *boot_info_o
  */
 extern int updater_ota_next_slot_address();
 
+/**
+ * @brief  Returns the address of the OTA partition the running image was booted from.
+ *
+ * @return address from Flash, in Bytes.
+ */
+extern int updater_ota_running_slot_address(void);
+
 /**
  * @brief  Writes the boot information into the otadata partition.
  *
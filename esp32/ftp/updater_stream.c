@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "updater_stream.h"
+
+// Writes an image into an OTA slot as it arrives, inflating it on the fly if
+// it is zlib or gzip compressed, rebuilding it from the running image if it is
+// sent as a delta patch, and hashing it on the way so that it doesn't have to
+// be read back from flash to be verified. The flash is accessed
+// through updater_flash_t, so that this can also be tested on a PC.
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+// inflated bytes produced per uzlib call, which bounds the input it consumes
+#define UPDATER_STREAM_INFLATE_STEP             256
+
+#if defined(UPDATER_STREAM_HOST)
+#define updater_sha_start(s)                    SHA256_Init(&(s)->sha)
+#define updater_sha_update(s, buf, len)         SHA256_Update(&(s)->sha, (buf), (len))
+#define updater_sha_finish(s)                   SHA256_Final((s)->digest, &(s)->sha)
+#else
+#define updater_sha_start(s)                    do { mbedtls_sha256_init(&(s)->sha); mbedtls_sha256_starts_ret(&(s)->sha, 0); } while (0)
+#define updater_sha_update(s, buf, len)         mbedtls_sha256_update_ret(&(s)->sha, (buf), (len))
+#define updater_sha_finish(s)                   do { mbedtls_sha256_finish_ret(&(s)->sha, (s)->digest); mbedtls_sha256_free(&(s)->sha); } while (0)
+#endif
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static void updater_stream_hash (updater_stream_t *s, const uint8_t *buf, uint32_t len);
+static bool updater_stream_commit (updater_stream_t *s, const uint8_t *buf, uint32_t len);
+static bool updater_stream_emit (updater_stream_t *s, const uint8_t *buf, uint32_t len);
+static bool updater_stream_delta (updater_stream_t *s, const uint8_t *buf, uint32_t len);
+static bool updater_stream_delta_header (updater_stream_t *s);
+static bool updater_stream_delta_flush (updater_stream_t *s);
+static bool updater_stream_read_back (updater_stream_t *s, uint32_t len);
+static bool updater_stream_header (updater_stream_t *s);
+static bool updater_stream_inflate (updater_stream_t *s, bool final);
+static void updater_stream_free (updater_stream_t *s);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+bool updater_stream_start (updater_stream_t *s, const updater_flash_t *flash, uint32_t slot,
+                           uint32_t slot_size, uint32_t offset, bool compressed) {
+    memset(s, 0, sizeof(*s));
+    s->flash = flash;
+    s->slot = slot;
+    s->slot_size = slot_size;
+    s->compressed = compressed;
+    s->format = E_UPDATER_STREAM_RAW;
+    s->resume_adler = 1;
+    s->resume_crc = ~0;
+    updater_sha_start(s);
+
+    if (offset > slot_size) {
+        goto error;
+    }
+    // the output buffer is also used to read back the part being kept
+    if (!(s->out_buf = malloc(UPDATER_STREAM_OUT_BUF_SIZE))) {
+        goto error;
+    }
+    if (compressed && !(s->in_buf = malloc(UPDATER_STREAM_IN_BUF_SIZE))) {
+        goto error;
+    }
+    if (offset > 0 && !updater_stream_read_back(s, offset)) {
+        goto error;
+    }
+    s->written = offset;
+    // a partially written sector was erased before its first byte was written
+    s->erased_end = slot + ((offset + UPDATER_STREAM_SECTOR_SIZE - 1) & ~(UPDATER_STREAM_SECTOR_SIZE - 1));
+    return true;
+
+error:
+    updater_stream_abort(s);
+    return false;
+}
+
+bool updater_stream_set_base (updater_stream_t *s, uint32_t base, uint32_t base_size) {
+    if (s->error || s->written > 0 || !(s->patch.buf = malloc(UPDATER_STREAM_OUT_BUF_SIZE))) {
+        updater_stream_abort(s);
+        return false;
+    }
+    s->patch.base = base;
+    s->patch.base_size = base_size;
+    s->patch.state = E_UPDATER_DELTA_HEADER;
+    s->delta = true;
+    return true;
+}
+
+bool updater_stream_write (updater_stream_t *s, const uint8_t *buf, uint32_t len) {
+    if (s->error) {
+        return false;
+    }
+    s->in_total += len;
+    if (!s->compressed) {
+        if (!updater_stream_emit(s, buf, len)) {
+            goto error;
+        }
+        return true;
+    }
+    while (len > 0 && !s->done) {
+        uint32_t n = UPDATER_STREAM_IN_BUF_SIZE - s->in_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s->in_buf + s->in_len, buf, n);
+        s->in_len += n;
+        buf += n;
+        len -= n;
+        if (!updater_stream_inflate(s, false)) {
+            goto error;
+        }
+    }
+    // anything after the end of the compressed stream is ignored
+    return true;
+
+error:
+    updater_stream_abort(s);
+    return false;
+}
+
+bool updater_stream_finish (updater_stream_t *s) {
+    if (s->error) {
+        return false;
+    }
+    if (s->compressed) {
+        if (!updater_stream_inflate(s, true) || !s->done) {
+            goto error;
+        }
+        if (s->out_len > 0 && !updater_stream_emit(s, s->out_buf, s->out_len)) {
+            goto error;
+        }
+        s->out_len = 0;
+    }
+    if (s->delta && (s->patch.state != E_UPDATER_DELTA_DONE || !updater_stream_delta_flush(s))) {
+        goto error;
+    }
+    // an empty slot would otherwise boot whatever was there before
+    if (s->written == 0) {
+        goto error;
+    }
+    updater_sha_finish(s);
+    updater_stream_free(s);
+    return true;
+
+error:
+    updater_stream_abort(s);
+    return false;
+}
+
+bool updater_stream_hash_ok (updater_stream_t *s) {
+    return !s->error && s->tail_len == UPDATER_STREAM_HASH_LEN &&
+           !memcmp(s->digest, s->tail, UPDATER_STREAM_HASH_LEN);
+}
+
+void updater_stream_abort (updater_stream_t *s) {
+    // the buffers are only held between start and finish, and so is the hash
+    if (s->out_buf) {
+        updater_sha_finish(s);
+    }
+    s->error = true;
+    updater_stream_free(s);
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static void updater_stream_hash (updater_stream_t *s, const uint8_t *buf, uint32_t len) {
+    if (len >= UPDATER_STREAM_HASH_LEN) {
+        updater_sha_update(s, s->tail, s->tail_len);
+        updater_sha_update(s, buf, len - UPDATER_STREAM_HASH_LEN);
+        memcpy(s->tail, buf + len - UPDATER_STREAM_HASH_LEN, UPDATER_STREAM_HASH_LEN);
+        s->tail_len = UPDATER_STREAM_HASH_LEN;
+    } else {
+        // shift out of the tail only what the new bytes push past its end
+        uint32_t over = s->tail_len + len;
+        if (over > UPDATER_STREAM_HASH_LEN) {
+            over -= UPDATER_STREAM_HASH_LEN;
+            updater_sha_update(s, s->tail, over);
+            memmove(s->tail, s->tail + over, s->tail_len - over);
+            s->tail_len -= over;
+        }
+        memcpy(s->tail + s->tail_len, buf, len);
+        s->tail_len += len;
+    }
+}
+
+static bool updater_stream_commit (updater_stream_t *s, const uint8_t *buf, uint32_t len) {
+    if (len > s->slot_size - s->written) {
+        return false;
+    }
+    uint32_t addr = s->slot + s->written;
+    // erase just ahead of the data, the slot is never erased as a whole
+    while (s->erased_end < addr + len) {
+        if (!s->flash->erase_sector(s->erased_end)) {
+            return false;
+        }
+        s->erased_end += UPDATER_STREAM_SECTOR_SIZE;
+    }
+    if (len > 0 && !s->flash->write(addr, buf, len)) {
+        return false;
+    }
+    updater_stream_hash(s, buf, len);
+    s->written += len;
+    return true;
+}
+
+static bool updater_stream_emit (updater_stream_t *s, const uint8_t *buf, uint32_t len) {
+    if (s->delta) {
+        return updater_stream_delta(s, buf, len);
+    }
+    return updater_stream_commit(s, buf, len);
+}
+
+static bool updater_stream_delta (updater_stream_t *s, const uint8_t *buf, uint32_t len) {
+    updater_delta_t *d = &s->patch;
+
+    while (len > 0) {
+        uint32_t n;
+        switch (d->state) {
+        case E_UPDATER_DELTA_HEADER:
+            n = UPDATER_DELTA_HEADER_LEN - d->header_len;
+            n = (n < len) ? n : len;
+            memcpy(d->header + d->header_len, buf, n);
+            d->header_len += n;
+            if (d->header_len == UPDATER_DELTA_HEADER_LEN) {
+                if (!updater_stream_delta_header(s)) {
+                    return false;
+                }
+                d->state = E_UPDATER_DELTA_ADD_LEN;
+            }
+            break;
+
+        case E_UPDATER_DELTA_ADD_LEN:
+        case E_UPDATER_DELTA_COPY_LEN:
+        case E_UPDATER_DELTA_SEEK:
+            n = 1;
+            if (d->shift > 28) {
+                return false;
+            }
+            d->varint |= (uint32_t)(*buf & 0x7F) << d->shift;
+            d->shift += 7;
+            if (*buf & 0x80) {
+                break;
+            }
+            if (d->state == E_UPDATER_DELTA_ADD_LEN) {
+                d->add_len = d->varint;
+                d->state = E_UPDATER_DELTA_COPY_LEN;
+            } else if (d->state == E_UPDATER_DELTA_COPY_LEN) {
+                d->copy_len = d->varint;
+                d->state = E_UPDATER_DELTA_SEEK;
+            } else {
+                d->seek = (int32_t)(d->varint >> 1) ^ -(int32_t)(d->varint & 1);
+                if (d->add_len > d->old_size - d->old_pos ||
+                    (uint64_t)d->add_len + d->copy_len > d->new_size - (s->written + d->buf_len)) {
+                    return false;
+                }
+                d->state = E_UPDATER_DELTA_ADD;
+            }
+            d->varint = 0;
+            d->shift = 0;
+            break;
+
+        case E_UPDATER_DELTA_ADD:
+        case E_UPDATER_DELTA_COPY:
+            n = (d->state == E_UPDATER_DELTA_ADD) ? d->add_len : d->copy_len;
+            n = (n < len) ? n : len;
+            if (n > UPDATER_STREAM_OUT_BUF_SIZE - d->buf_len) {
+                n = UPDATER_STREAM_OUT_BUF_SIZE - d->buf_len;
+            }
+            if (d->state == E_UPDATER_DELTA_ADD) {
+                uint8_t *old = d->buf + d->buf_len;
+                if (!s->flash->read(d->base + d->old_pos, old, n)) {
+                    return false;
+                }
+                d->old_read += n;
+                for (uint32_t i = 0; i < n; i++) {
+                    old[i] += buf[i];
+                }
+                d->old_pos += n;
+                d->add_len -= n;
+            } else {
+                memcpy(d->buf + d->buf_len, buf, n);
+                d->copy_len -= n;
+            }
+            d->buf_len += n;
+            if (d->buf_len == UPDATER_STREAM_OUT_BUF_SIZE && !updater_stream_delta_flush(s)) {
+                return false;
+            }
+            break;
+
+        case E_UPDATER_DELTA_DONE:
+        default:
+            // trailing bytes after the last record
+            return false;
+        }
+        buf += n;
+        len -= n;
+
+        // a record ends once both of its parts are out, this is also the way
+        // out for records without any
+        if (d->state == E_UPDATER_DELTA_ADD && d->add_len == 0) {
+            d->state = E_UPDATER_DELTA_COPY;
+        }
+        if (d->state == E_UPDATER_DELTA_COPY && d->copy_len == 0) {
+            if ((d->seek < 0 && (uint32_t)-d->seek > d->old_pos) ||
+                (d->seek > 0 && (uint32_t)d->seek > d->old_size - d->old_pos)) {
+                return false;
+            }
+            d->old_pos += d->seek;
+            d->state = (s->written + d->buf_len == d->new_size) ? E_UPDATER_DELTA_DONE : E_UPDATER_DELTA_ADD_LEN;
+        }
+    }
+    return true;
+}
+
+static bool updater_stream_delta_header (updater_stream_t *s) {
+    updater_delta_t *d = &s->patch;
+    uint8_t digest[UPDATER_STREAM_HASH_LEN];
+
+    if (memcmp(d->header, UPDATER_DELTA_MAGIC, 4)) {
+        return false;
+    }
+    d->old_size = d->header[4] | (d->header[5] << 8) | (d->header[6] << 16) | ((uint32_t)d->header[7] << 24);
+    d->new_size = d->header[8] | (d->header[9] << 8) | (d->header[10] << 16) | ((uint32_t)d->header[11] << 24);
+    if (d->old_size < UPDATER_STREAM_HASH_LEN || d->old_size > d->base_size ||
+        d->new_size == 0 || d->new_size > s->slot_size) {
+        return false;
+    }
+    // the digest appended to the base identifies it without reading all of it
+    if (!s->flash->read(d->base + d->old_size - UPDATER_STREAM_HASH_LEN, digest, sizeof(digest))) {
+        return false;
+    }
+    d->old_read += sizeof(digest);
+    return !memcmp(digest, d->header + 12, UPDATER_STREAM_HASH_LEN);
+}
+
+static bool updater_stream_delta_flush (updater_stream_t *s) {
+    updater_delta_t *d = &s->patch;
+    bool ok = updater_stream_commit(s, d->buf, d->buf_len);
+    d->buf_len = 0;
+    return ok;
+}
+
+static bool updater_stream_read_back (updater_stream_t *s, uint32_t len) {
+    for (uint32_t pos = 0; pos < len; ) {
+        uint32_t n = len - pos;
+        if (n > UPDATER_STREAM_OUT_BUF_SIZE) {
+            n = UPDATER_STREAM_OUT_BUF_SIZE;
+        }
+        if (!s->flash->read(s->slot + pos, s->out_buf, n)) {
+            return false;
+        }
+        updater_stream_hash(s, s->out_buf, n);
+        if (s->compressed) {
+            // which one is needed is only known once the header arrives
+            s->resume_adler = uzlib_adler32(s->out_buf, n, s->resume_adler);
+            s->resume_crc = uzlib_crc32(s->out_buf, n, s->resume_crc);
+        }
+        s->read_back += n;
+        pos += n;
+    }
+    return true;
+}
+
+static bool updater_stream_header (updater_stream_t *s) {
+    TINF_DATA *d = &s->inflate;
+    uint32_t window;
+
+    if (s->in_len < 2) {
+        return false;
+    }
+    if (s->in_buf[0] == 0x1f && s->in_buf[1] == 0x8b) {
+        if (uzlib_gzip_parse_header(d) != TINF_OK) {
+            return false;
+        }
+        s->format = E_UPDATER_STREAM_GZIP;
+        d->checksum = s->resume_crc;
+        window = 1 << 15;
+    } else {
+        int wbits = uzlib_zlib_parse_header(d);
+        if (wbits < 0) {
+            return false;
+        }
+        s->format = E_UPDATER_STREAM_ZLIB;
+        d->checksum = s->resume_adler;
+        window = 1 << (wbits + 8);
+    }
+    if (d->eof || !(s->dict = malloc(window))) {
+        return false;
+    }
+    // a resumed stream starts at a full flush point, so it never refers back
+    // to data decompressed in an earlier session
+    uzlib_uncompress_init(d, s->dict, window);
+    s->header_done = true;
+    return true;
+}
+
+static bool updater_stream_inflate (updater_stream_t *s, bool final) {
+    TINF_DATA *d = &s->inflate;
+
+    d->source = s->in_buf;
+    d->source_limit = s->in_buf + s->in_len;
+    d->readSource = NULL;
+
+    if (!s->header_done) {
+        if (!final && s->in_len < UPDATER_STREAM_IN_MARGIN) {
+            return true;
+        }
+        if (!updater_stream_header(s)) {
+            return false;
+        }
+    }
+
+    while (!s->done && (final || d->source_limit - d->source >= UPDATER_STREAM_IN_MARGIN)) {
+        uint32_t step = UPDATER_STREAM_OUT_BUF_SIZE - s->out_len;
+        if (step > UPDATER_STREAM_INFLATE_STEP) {
+            step = UPDATER_STREAM_INFLATE_STEP;
+        }
+        d->dest_start = d->dest = s->out_buf + s->out_len;
+        d->dest_limit = d->dest + step;
+
+        int res = uzlib_uncompress_chksum(d);
+        s->out_len = d->dest - s->out_buf;
+        // running dry means a truncated stream, or a wrong margin
+        if (res < 0 || d->eof) {
+            return false;
+        }
+        if (res == TINF_DONE) {
+            s->done = true;
+        }
+        if (s->out_len == UPDATER_STREAM_OUT_BUF_SIZE) {
+            if (!updater_stream_emit(s, s->out_buf, s->out_len)) {
+                return false;
+            }
+            s->out_len = 0;
+        }
+    }
+
+    // keep what hasn't been consumed at the start of the buffer
+    s->in_len = d->source_limit - d->source;
+    memmove(s->in_buf, d->source, s->in_len);
+    return true;
+}
+
+static void updater_stream_free (updater_stream_t *s) {
+    free(s->dict);
+    free(s->in_buf);
+    free(s->out_buf);
+    free(s->patch.buf);
+    s->dict = NULL;
+    s->in_buf = NULL;
+    s->out_buf = NULL;
+    s->patch.buf = NULL;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef UPDATER_STREAM_H_
+#define UPDATER_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "extmod/uzlib/tinf.h"
+
+#if defined(UPDATER_STREAM_HOST)
+#include <openssl/sha.h>
+#else
+#include "mbedtls/sha256.h"
+#endif
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define UPDATER_STREAM_SECTOR_SIZE              4096
+#define UPDATER_STREAM_HASH_LEN                 32
+
+// compressed input is staged here, and only inflated while at least
+// UPDATER_STREAM_IN_MARGIN bytes are buffered, because uzlib can't suspend
+// in the middle of a symbol or a dynamic block header
+#ifndef UPDATER_STREAM_IN_BUF_SIZE
+#define UPDATER_STREAM_IN_BUF_SIZE              4096
+#endif
+#define UPDATER_STREAM_IN_MARGIN                1536
+// inflated data is collected here and written to flash when full
+#ifndef UPDATER_STREAM_OUT_BUF_SIZE
+#define UPDATER_STREAM_OUT_BUF_SIZE             4096
+#endif
+
+// a delta patch (tools/ota_delta.py) starts with the magic, the sizes of the
+// base and the new image (LE) and the SHA256 appended to the base, followed by
+// records of three varints <add> <copy> <seek>, <add> bytes which are added to
+// the base and <copy> bytes which are copied; then <seek> (zigzag encoded)
+// moves the position in the base
+#define UPDATER_DELTA_MAGIC                     "PYDP"
+#define UPDATER_DELTA_HEADER_LEN                (4 + 4 + 4 + UPDATER_STREAM_HASH_LEN)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// flash access; addresses are absolute, erase_sector takes a sector aligned one
+typedef struct {
+    bool (*erase_sector) (uint32_t addr);
+    bool (*write) (uint32_t addr, const void *buf, uint32_t len);
+    bool (*read) (uint32_t addr, void *buf, uint32_t len);
+} updater_flash_t;
+
+typedef enum {
+    E_UPDATER_STREAM_RAW = 0,
+    E_UPDATER_STREAM_ZLIB,
+    E_UPDATER_STREAM_GZIP,
+} updater_stream_format_t;
+
+typedef enum {
+    E_UPDATER_DELTA_HEADER = 0,
+    E_UPDATER_DELTA_ADD_LEN,
+    E_UPDATER_DELTA_COPY_LEN,
+    E_UPDATER_DELTA_SEEK,
+    E_UPDATER_DELTA_ADD,
+    E_UPDATER_DELTA_COPY,
+    E_UPDATER_DELTA_DONE,
+} updater_delta_state_t;
+
+typedef struct {
+    uint32_t                base;           // address of the image the patch applies to
+    uint32_t                base_size;      // size of its slot
+    uint32_t                old_size;
+    uint32_t                new_size;
+    uint32_t                old_pos;
+    uint32_t                old_read;       // bytes read from the base
+    uint32_t                add_len;
+    uint32_t                copy_len;
+    int32_t                 seek;
+    uint32_t                varint;
+    uint8_t                 shift;
+    updater_delta_state_t   state;
+    uint8_t                 header[UPDATER_DELTA_HEADER_LEN];
+    uint32_t                header_len;
+    uint8_t                 *buf;           // patched bytes waiting to be written
+    uint32_t                buf_len;
+} updater_delta_t;
+
+typedef struct {
+    const updater_flash_t   *flash;
+    uint32_t                slot;           // start address of the image
+    uint32_t                slot_size;
+    uint32_t                written;        // image bytes committed to flash
+    uint32_t                erased_end;     // first address not erased yet
+    uint32_t                read_back;      // bytes read back from flash
+    uint32_t                in_total;       // bytes received
+    updater_stream_format_t format;
+    bool                    compressed;     // the caller asked for a compressed stream
+    bool                    delta;          // the stream is a patch against patch.base
+    bool                    header_done;
+    bool                    done;
+    bool                    error;
+
+    // the last UPDATER_STREAM_HASH_LEN bytes aren't hashed yet, because they
+    // are the digest appended to the image if it turns out to be the end
+    uint8_t                 tail[UPDATER_STREAM_HASH_LEN];
+    uint32_t                tail_len;
+#if defined(UPDATER_STREAM_HOST)
+    SHA256_CTX              sha;
+#else
+    mbedtls_sha256_context  sha;
+#endif
+
+    uint8_t                 digest[UPDATER_STREAM_HASH_LEN];
+
+    TINF_DATA               inflate;
+    uint8_t                 *dict;
+    uint32_t                resume_adler;   // container checksums of the bytes kept on resume
+    uint32_t                resume_crc;
+    uint8_t                 *in_buf;
+    uint32_t                in_len;
+    uint8_t                 *out_buf;
+    uint32_t                out_len;
+
+    updater_delta_t         patch;
+} updater_stream_t;
+
+/******************************************************************************
+ DECLARE EXPORTED FUNCTIONS
+ ******************************************************************************/
+/**
+ * @brief  Starts writing an image into a slot.
+ *
+ * @note If offset is not 0 the update is resumed: the first offset bytes
+ *        already in the slot are kept and read back once to seed the hash.
+ *        A compressed stream is resumed by sending its zlib/gzip header
+ *        again, followed by the deflate data from a full flush point which
+ *        decompresses to image offset `offset` (see tools/ota_compress.py).
+ *
+ * @param  s          the stream state
+ * @param  flash      flash access functions
+ * @param  slot       address of the slot, sector aligned
+ * @param  slot_size  size of the slot
+ * @param  offset     image bytes already written to the slot
+ * @param  compressed true if the data is zlib or gzip compressed
+ *
+ * @return true on success.
+ */
+extern bool updater_stream_start (updater_stream_t *s, const updater_flash_t *flash, uint32_t slot,
+                                  uint32_t slot_size, uint32_t offset, bool compressed);
+
+/**
+ * @brief  Makes the stream a delta patch against the image in another slot.
+ *
+ * @note Must be called right after updater_stream_start(), which must have been
+ *        given offset 0 (patches can't be resumed). The data sent is then a patch
+ *        (compressed or not) that is checked against the base as soon as its
+ *        header arrives.
+ *
+ * @param  s          the stream state
+ * @param  base       address of the slot holding the current image
+ * @param  base_size  size of that slot
+ *
+ * @return true on success.
+ */
+extern bool updater_stream_set_base (updater_stream_t *s, uint32_t base, uint32_t base_size);
+
+/**
+ * @brief  Feeds the next chunk of the (possibly compressed) image.
+ *
+ * @return false if the data is corrupted, too large for the slot, or flash access failed.
+ */
+extern bool updater_stream_write (updater_stream_t *s, const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief  Flushes everything buffered to flash and releases the buffers.
+ *
+ * @return true if the whole image was received and, if compressed, its checksum matched.
+ */
+extern bool updater_stream_finish (updater_stream_t *s);
+
+/**
+ * @brief  Compares the digest computed while writing with the one appended to the image.
+ *
+ * @note Only valid after updater_stream_finish() returned true.
+ *
+ * @return true if the image ends with the SHA-256 of all the bytes before it.
+ */
+extern bool updater_stream_hash_ok (updater_stream_t *s);
+
+/**
+ * @brief  Releases the buffers without committing anything (also safe after finish).
+ */
+extern void updater_stream_abort (updater_stream_t *s);
+
+#endif /* UPDATER_STREAM_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <string.h>
+
+#include "aggregate.h"
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void aggregate_init (aggregate_t *ag) {
+    memset(ag, 0, sizeof(*ag));
+}
+
+bool aggregate_fits (const aggregate_t *ag, uint8_t len, uint8_t port, uint8_t dr, bool confirmed, uint8_t max_payload) {
+    if (ag->len == 0) {
+        return false;
+    }
+    if (port != ag->port || dr != ag->dr || confirmed != ag->confirmed) {
+        return false;
+    }
+    return ag->len + 1 + len <= max_payload;
+}
+
+bool aggregate_add (aggregate_t *ag, const uint8_t *data, uint8_t len, uint8_t port, uint8_t dr, bool confirmed,
+                    uint8_t max_payload, uint32_t now_ms, uint32_t delay_ms) {
+    if (ag->len == 0) {
+        if (1 + len > max_payload || 1 + len > AGGREGATE_FRAME_SIZE_MAX) {
+            return false;
+        }
+        ag->port = port;
+        ag->dr = dr;
+        ag->confirmed = confirmed;
+        ag->deadline = now_ms + delay_ms;
+    } else if (!aggregate_fits(ag, len, port, dr, confirmed, max_payload)) {
+        return false;
+    }
+    ag->buf[ag->len] = len;
+    memcpy(&ag->buf[ag->len + 1], data, len);
+    ag->len += 1 + len;
+    ag->count++;
+    ag->stats.payloads++;
+    return true;
+}
+
+bool aggregate_pending (const aggregate_t *ag) {
+    return ag->len > 0;
+}
+
+bool aggregate_due (const aggregate_t *ag, uint32_t now_ms) {
+    // the tick counter wraps around
+    return ag->len > 0 && (int32_t)(now_ms - ag->deadline) >= 0;
+}
+
+void aggregate_flushed (aggregate_t *ag, aggregate_flush_t reason, bool sent) {
+    if (sent) {
+        ag->stats.frames++;
+        ag->stats.frames_saved += ag->count ? ag->count - 1 : 0;
+        switch (reason) {
+        case E_AGGREGATE_FLUSH_FULL:
+            ag->stats.flush_full++;
+            break;
+        case E_AGGREGATE_FLUSH_DEADLINE:
+            ag->stats.flush_deadline++;
+            break;
+        default:
+            ag->stats.flush_change++;
+            break;
+        }
+    } else {
+        ag->stats.dropped += ag->count;
+    }
+    ag->len = 0;
+    ag->count = 0;
+}
+
+int aggregate_next (const uint8_t *frame, uint8_t len, uint8_t *offset, const uint8_t **payload) {
+    if (*offset >= len) {
+        return -1;
+    }
+    uint8_t plen = frame[*offset];
+    if (*offset + 1 + plen > len) {
+        return -1;
+    }
+    *payload = &frame[*offset + 1];
+    *offset += 1 + plen;
+    return plen;
+}
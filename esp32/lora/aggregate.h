@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef AGGREGATE_H_
+#define AGGREGATE_H_
+
+// Aggregation of small LoRaWAN uplinks: the payloads given to send() are
+// gathered in one frame, each one preceded by its length byte, until the next
+// payload would not fit in the largest frame of the data rate, or until the
+// flush deadline set when the first payload went in. The receiving
+// application splits the frame with aggregate_next().
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define AGGREGATE_FRAME_SIZE_MAX                (255)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_AGGREGATE_FLUSH_FULL = 0,                 // the next payload did not fit
+    E_AGGREGATE_FLUSH_DEADLINE,
+    E_AGGREGATE_FLUSH_CHANGE,                   // the next payload goes to another port, data rate or confirmation
+} aggregate_flush_t;
+
+typedef struct {
+    uint32_t                payloads;           // accepted
+    uint32_t                frames;             // sent
+    uint32_t                frames_saved;       // payloads sent minus frames sent
+    uint32_t                flush_full;
+    uint32_t                flush_deadline;
+    uint32_t                flush_change;
+    uint32_t                dropped;            // payloads of frames the stack refused
+} aggregate_stats_t;
+
+typedef struct {
+    uint8_t                 buf[AGGREGATE_FRAME_SIZE_MAX];
+    uint8_t                 len;                // 0 when nothing is pending
+    uint8_t                 count;
+    uint8_t                 port;
+    uint8_t                 dr;
+    bool                    confirmed;
+    uint32_t                deadline;           // ms
+    aggregate_stats_t       stats;
+} aggregate_t;
+
+/******************************************************************************
+ DECLARE EXPORTED FUNCTIONS
+ ******************************************************************************/
+extern void aggregate_init (aggregate_t *ag);
+
+// whether the payload can join the pending frame, max_payload being the
+// largest application payload of the data rate (0 if nothing is pending)
+extern bool aggregate_fits (const aggregate_t *ag, uint8_t len, uint8_t port, uint8_t dr, bool confirmed, uint8_t max_payload);
+
+// adds the payload to the pending frame, or starts a new one due delay_ms from
+// now; the caller flushes first when aggregate_fits says no, and a payload
+// too large for a frame of its own is refused
+extern bool aggregate_add (aggregate_t *ag, const uint8_t *data, uint8_t len, uint8_t port, uint8_t dr, bool confirmed,
+                           uint8_t max_payload, uint32_t now_ms, uint32_t delay_ms);
+
+extern bool aggregate_pending (const aggregate_t *ag);
+extern bool aggregate_due (const aggregate_t *ag, uint32_t now_ms);
+
+// the pending frame has been handed to the stack (sent) or refused by it
+extern void aggregate_flushed (aggregate_t *ag, aggregate_flush_t reason, bool sent);
+
+// walks the payloads of a received frame from *offset on; returns the length
+// of the next one, or -1 at the end of the frame or if it is malformed
+extern int aggregate_next (const uint8_t *frame, uint8_t len, uint8_t *offset, const uint8_t **payload);
+
+#endif /* AGGREGATE_H_ */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef LORA_BOARD_H_
+#define LORA_BOARD_H_
+
+// Stands in for ../board.h when the LoRaWAN stack is built on a PC: the same
+// board API, with the SX127x driver replaced by the virtual radio in
+// simradio.c and the atomic sections reduced to nothing (the simulator runs
+// everything from a single thread). It keeps the include guard of the real
+// one so that ../utilities.c can be built with -include board.h.
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+#include "lora/system/timer.h"
+#include "radio.h"
+#include "timer-board.h"
+#include "utilities.h"
+
+#define MICROPY_BEGIN_ATOMIC_SECTION()              (0)
+#define MICROPY_END_ATOMIC_SECTION(state)           (void)(state)
+
+#define USE_MODEM_LORA
+
+// as in the SX127x drivers
+#define RADIO_WAKEUP_TIME                           1 // [ms]
+
+void BoardInitPeriph( void );
+void BoardInitMcu( void );
+void BoardDeInitMcu( void );
+uint32_t BoardGetRandomSeed( void );
+void BoardGetUniqueId( uint8_t *id );
+uint8_t BoardGetBatteryLevel( void );
+void BoardSetBatteryLevel( uint8_t level );
+
+#endif // LORA_BOARD_H_
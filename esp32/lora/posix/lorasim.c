@@ -0,0 +1,755 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// LoRaWAN network simulation on top of the real MAC:
+//   lorasim bench [-r region] [-n devices] [-t hours] [-p period] [-l length] [-a deadline] [-c] [-d] [-s seed]
+//   lorasim test
+// Every device joins over the air and then sends an uplink every period
+// (seconds, 10% jitter) like a sensor using the lora module would; with a
+// deadline (seconds), the readings are aggregated the way SO_AGGREGATE does.
+// bench reports what the MAC costs in CPU time per uplink; test runs the
+// join, ADR, duty cycle and aggregation regression checks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "simradio.h"
+#include "simnet.h"
+#include "aggregate.h"
+#include "lora/mac/LoRaMacTest.h"
+#include "lora/mac/region/Region.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define LORASIM_RETRY_MS                    (1000)
+#define LORASIM_PAYLOAD_MAGIC               (0xA5)
+#define LORASIM_HOUR_MS                     (3600 * 1000)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    LoRaMacRegion_t     region;
+    uint32_t            period_ms;
+    uint32_t            join_retry_ms;
+    uint32_t            aggregate_ms;       // 0 for a frame per reading
+    uint8_t             payload_len;
+    uint8_t             join_dr;
+    bool                confirmed;
+    bool                duty_cycle;
+    bool                adr;
+} lorasim_config_t;
+
+typedef struct {
+    sim_device_t        *dev;
+    simnet_device_t     *nd;
+    TimerEvent_t        tx_timer;
+    TimerEvent_t        join_timer;
+    uint8_t             dev_eui[8];
+    uint8_t             app_eui[8];
+    uint8_t             app_key[16];
+    uint32_t            rng;
+
+    bool                joined;
+    TimerTime_t         joined_at;
+    uint32_t            join_attempts;
+    uint32_t            seq;
+    uint32_t            sent;
+    uint32_t            confirms;
+    uint32_t            acks;
+    uint32_t            busy;
+    uint32_t            downlinks;
+    int8_t              dr;                 // of the last uplink
+    int8_t              tx_power;
+
+    // aggregation, as the LoRa task of the lora module does it
+    aggregate_t         ag;
+    TimerEvent_t        flush_timer;
+    bool                tx_busy;            // from the request to its confirmation
+    uint8_t             held[SIM_FRAME_SIZE_MAX];
+    uint8_t             held_len;           // a reading waiting for the radio
+
+    // the readings the server got out of the aggregated frames
+    uint32_t            rx_readings;
+    uint32_t            rx_seq;
+    uint32_t            rx_gaps;
+    TimerTime_t         rx_latency_max;
+} lorasim_node_t;
+
+// what the radio saw a device send, for the duty cycle checks
+typedef struct {
+    TimerTime_t         start;
+    TimerTime_t         end;
+    uint32_t            freq;
+} lorasim_tx_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static lorasim_config_t lorasim_cfg;
+static LoRaMacPrimitives_t lorasim_primitives;
+static LoRaMacCallback_t lorasim_callbacks;
+static uint32_t lorasim_payload_errors;
+
+static lorasim_tx_t *lorasim_log;
+static uint32_t lorasim_log_count;
+static uint32_t lorasim_log_size;
+static sim_device_t *lorasim_log_dev;
+
+/******************************************************************************
+ THE NODE APPLICATION, what the lora module does for the user
+ ******************************************************************************/
+static lorasim_node_t *lorasim_node (void) {
+    return sim_device_current()->user;
+}
+
+static void lorasim_join (void) {
+    lorasim_node_t *node = lorasim_node();
+    MibRequestConfirm_t mibReq;
+    MlmeReq_t mlmeReq;
+
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_OTAA;
+    LoRaMacMibSetRequestConfirm(&mibReq);
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.DevEui = node->dev_eui;
+    mlmeReq.Req.Join.AppEui = node->app_eui;
+    mlmeReq.Req.Join.AppKey = node->app_key;
+    mlmeReq.Req.Join.NbTrials = 1;
+    mlmeReq.Req.Join.DR = lorasim_cfg.join_dr;
+    node->join_attempts++;
+    if (LoRaMacMlmeRequest(&mlmeReq) != LORAMAC_STATUS_OK) {
+        TimerSetValue(&node->join_timer, LORASIM_RETRY_MS);
+        TimerStart(&node->join_timer);
+    }
+}
+
+static bool lorasim_request (uint8_t *payload, uint8_t len) {
+    lorasim_node_t *node = lorasim_node();
+    McpsReq_t mcpsReq;
+
+    if (lorasim_cfg.confirmed) {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = 1;
+        mcpsReq.Req.Confirmed.fBuffer = payload;
+        mcpsReq.Req.Confirmed.fBufferSize = len;
+        mcpsReq.Req.Confirmed.NbTrials = 1;
+        mcpsReq.Req.Confirmed.Datarate = lorasim_cfg.join_dr;
+    } else {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = 1;
+        mcpsReq.Req.Unconfirmed.fBuffer = payload;
+        mcpsReq.Req.Unconfirmed.fBufferSize = len;
+        mcpsReq.Req.Unconfirmed.Datarate = lorasim_cfg.join_dr;
+    }
+    if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK) {
+        node->busy++;
+        return false;
+    }
+    node->sent++;
+    node->tx_busy = true;
+    return true;
+}
+
+// the flush timer fires at the deadline, and right after each confirmation
+// like the LoRa task polling its queue once the radio is idle
+static void lorasim_aggregate_arm (void) {
+    lorasim_node_t *node = lorasim_node();
+    if (aggregate_pending(&node->ag) && !node->tx_busy) {
+        int32_t left = (int32_t)(node->ag.deadline - sim_now());
+        TimerSetValue(&node->flush_timer, (left > 0) ? left : 1);
+        TimerStart(&node->flush_timer);
+    }
+}
+
+static void lorasim_aggregate_flush (aggregate_flush_t reason) {
+    lorasim_node_t *node = lorasim_node();
+    // the MAC copies the payload, the frame can be reused right after
+    aggregate_flushed(&node->ag, reason, lorasim_request(node->ag.buf, node->ag.len));
+    TimerStop(&node->flush_timer);
+}
+
+static void lorasim_aggregate (const uint8_t *reading, uint8_t len) {
+    lorasim_node_t *node = lorasim_node();
+    LoRaMacTxInfo_t txInfo;
+
+    if (!node->tx_busy) {
+        LoRaMacQueryTxPossible(0, &txInfo);
+        if (aggregate_pending(&node->ag) &&
+            !aggregate_fits(&node->ag, len, 1, lorasim_cfg.join_dr, lorasim_cfg.confirmed, txInfo.MaxPossiblePayload)) {
+            lorasim_aggregate_flush(E_AGGREGATE_FLUSH_FULL);
+        }
+    }
+    if (node->tx_busy) {
+        // the reading comes back once the radio is done, a second one is lost
+        if (node->held_len) {
+            node->ag.stats.dropped++;
+        } else {
+            memcpy(node->held, reading, len);
+            node->held_len = len;
+        }
+        return;
+    }
+    if (!aggregate_add(&node->ag, reading, len, 1, lorasim_cfg.join_dr, lorasim_cfg.confirmed,
+                       txInfo.MaxPossiblePayload, sim_now(), lorasim_cfg.aggregate_ms)) {
+        node->ag.stats.dropped++;
+    } else if (node->ag.len + 1 > txInfo.MaxPossiblePayload) {
+        lorasim_aggregate_flush(E_AGGREGATE_FLUSH_FULL);
+    }
+    lorasim_aggregate_arm();
+}
+
+static void lorasim_aggregate_poll (void) {
+    lorasim_node_t *node = lorasim_node();
+    if (node->tx_busy) {
+        return;
+    }
+    if (node->held_len) {
+        uint8_t reading[SIM_FRAME_SIZE_MAX];
+        uint8_t len = node->held_len;
+        memcpy(reading, node->held, len);
+        node->held_len = 0;
+        lorasim_aggregate(reading, len);
+    }
+    if (!node->tx_busy && aggregate_due(&node->ag, sim_now())) {
+        lorasim_aggregate_flush(E_AGGREGATE_FLUSH_DEADLINE);
+    }
+    lorasim_aggregate_arm();
+}
+
+static void lorasim_send (void) {
+    lorasim_node_t *node = lorasim_node();
+    uint8_t payload[SIM_FRAME_SIZE_MAX];
+
+    uint32_t jitter = lorasim_cfg.period_ms / 10;
+    TimerSetValue(&node->tx_timer, lorasim_cfg.period_ms - jitter + (jitter ? sim_random(&node->rng) % (2 * jitter) : 0));
+    TimerStart(&node->tx_timer);
+
+    // a sequence number and a pattern the server checks after decryption;
+    // aggregated readings also carry the time they were made at
+    memset(payload, LORASIM_PAYLOAD_MAGIC, sizeof(payload));
+    memcpy(payload, &node->seq, (lorasim_cfg.payload_len < 4) ? lorasim_cfg.payload_len : 4);
+    if (lorasim_cfg.aggregate_ms) {
+        TimerTime_t now = sim_now();
+        memcpy(&payload[4], &now, 4);
+        lorasim_aggregate(payload, lorasim_cfg.payload_len);
+        node->seq++;
+    } else if (lorasim_request(payload, lorasim_cfg.payload_len)) {
+        node->seq++;
+    }
+}
+
+static void McpsConfirm (McpsConfirm_t *mcpsConfirm) {
+    lorasim_node_t *node = lorasim_node();
+    node->tx_busy = false;
+    if (lorasim_cfg.aggregate_ms) {
+        TimerSetValue(&node->flush_timer, 1);
+        TimerStart(&node->flush_timer);
+    }
+    if (mcpsConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        node->confirms++;
+        node->dr = mcpsConfirm->Datarate;
+        node->tx_power = mcpsConfirm->TxPower;
+        if (mcpsConfirm->AckReceived) {
+            node->acks++;
+        }
+    }
+}
+
+static void McpsIndication (McpsIndication_t *mcpsIndication) {
+    if (mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        lorasim_node()->downlinks++;
+    }
+}
+
+static void MlmeConfirm (MlmeConfirm_t *mlmeConfirm) {
+    lorasim_node_t *node = lorasim_node();
+    if (mlmeConfirm->MlmeRequest != MLME_JOIN) {
+        return;
+    }
+    if (mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        node->joined = true;
+        node->joined_at = sim_now();
+        // the first uplink somewhere in the first period
+        TimerSetValue(&node->tx_timer, 1 + sim_random(&node->rng) % lorasim_cfg.period_ms);
+        TimerStart(&node->tx_timer);
+    } else {
+        TimerSetValue(&node->join_timer, lorasim_cfg.join_retry_ms);
+        TimerStart(&node->join_timer);
+    }
+}
+
+static void MlmeIndication (MlmeIndication_t *mlmeIndication) {
+}
+
+static void lorasim_node_start (void *arg) {
+    lorasim_node_t *node = arg;
+    MibRequestConfirm_t mibReq;
+
+    lorasim_primitives.MacMcpsConfirm = McpsConfirm;
+    lorasim_primitives.MacMcpsIndication = McpsIndication;
+    lorasim_primitives.MacMlmeConfirm = MlmeConfirm;
+    lorasim_primitives.MacMlmeIndication = MlmeIndication;
+    lorasim_callbacks.GetBatteryLevel = BoardGetBatteryLevel;
+    LoRaMacInitialization(&lorasim_primitives, &lorasim_callbacks, lorasim_cfg.region);
+
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = lorasim_cfg.adr;
+    LoRaMacMibSetRequestConfirm(&mibReq);
+
+    mibReq.Type = MIB_PUBLIC_NETWORK;
+    mibReq.Param.EnablePublicNetwork = true;
+    LoRaMacMibSetRequestConfirm(&mibReq);
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+    mibReq.Param.Class = CLASS_A;
+    LoRaMacMibSetRequestConfirm(&mibReq);
+
+    LoRaMacTestSetDutyCycleOn(lorasim_cfg.duty_cycle);
+
+    TimerInit(&node->tx_timer, lorasim_send);
+    TimerInit(&node->join_timer, lorasim_join);
+    TimerInit(&node->flush_timer, lorasim_aggregate_poll);
+    // spread the joins over the first period
+    TimerSetValue(&node->join_timer, 1 + sim_random(&node->rng) % lorasim_cfg.period_ms);
+    TimerStart(&node->join_timer);
+}
+
+static lorasim_node_t *lorasim_node_new (uint32_t index, float snr) {
+    lorasim_node_t *node = calloc(1, sizeof(lorasim_node_t));
+    static const uint8_t dev_eui[8] = { 0x70, 0xB3, 0xD5, 0x49, 0x90, 0x00, 0x00, 0x00 };
+    static const uint8_t app_eui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 };
+    memcpy(node->dev_eui, dev_eui, 8);
+    node->dev_eui[6] = index >> 8;
+    node->dev_eui[7] = index;
+    memcpy(node->app_eui, app_eui, 8);
+    for (uint32_t i = 0; i < 16; i++) {
+        node->app_key[i] = (i * 17) ^ index ^ (index >> 8);
+    }
+    node->rng = 0x9e3779b9 ^ (index * 2654435761u);
+    node->rng = node->rng ? node->rng : 1;
+    node->dr = -1;
+    aggregate_init(&node->ag);
+    node->nd = simnet_device_add(index, node->dev_eui, node->app_eui, node->app_key);
+    node->dev = sim_device_new(index, snr, node);
+    sim_device_call(node->dev, lorasim_node_start, node);
+    return node;
+}
+
+/******************************************************************************
+ SIMULATION SETUP
+ ******************************************************************************/
+// splits an aggregated frame, the readings come in order within the deadline
+static void lorasim_readings (lorasim_node_t *node, const sim_frame_t *frame) {
+    simnet_device_t *nd = node->nd;
+    const uint8_t *reading;
+    uint8_t offset = 0;
+    int len;
+
+    while ((len = aggregate_next(nd->payload, nd->payload_len, &offset, &reading)) >= 0) {
+        uint32_t seq;
+        TimerTime_t made;
+        if (len != lorasim_cfg.payload_len) {
+            lorasim_payload_errors++;
+            continue;
+        }
+        for (int i = 8; i < len; i++) {
+            if (reading[i] != LORASIM_PAYLOAD_MAGIC) {
+                lorasim_payload_errors++;
+                break;
+            }
+        }
+        memcpy(&seq, reading, 4);
+        memcpy(&made, &reading[4], 4);
+        if (seq != node->rx_seq) {
+            node->rx_gaps++;
+        }
+        node->rx_seq = seq + 1;
+        node->rx_readings++;
+        if (frame->end - made > node->rx_latency_max) {
+            node->rx_latency_max = frame->end - made;
+        }
+    }
+    if (offset != nd->payload_len) {
+        lorasim_payload_errors++;
+    }
+}
+
+static void lorasim_uplink (sim_device_t *dev, const sim_frame_t *frame) {
+    if (dev == lorasim_log_dev) {
+        if (lorasim_log_count == lorasim_log_size) {
+            lorasim_log_size = lorasim_log_size ? lorasim_log_size * 2 : 256;
+            lorasim_log = realloc(lorasim_log, lorasim_log_size * sizeof(lorasim_tx_t));
+        }
+        lorasim_log[lorasim_log_count++] = (lorasim_tx_t){ frame->start, frame->end, frame->freq };
+    }
+    simnet_device_t *nd = ((lorasim_node_t *)dev->user)->nd;
+    uint32_t uplinks = nd->uplinks;
+    simnet_uplink(dev, frame);
+    if (nd->uplinks != uplinks && nd->port == 1 && lorasim_cfg.aggregate_ms) {
+        lorasim_readings(dev->user, frame);
+    } else if (nd->uplinks != uplinks && nd->port == 1) {
+        // the session keys on both ends agree
+        for (uint32_t i = 4; i < nd->payload_len; i++) {
+            if (nd->payload[i] != LORASIM_PAYLOAD_MAGIC) {
+                lorasim_payload_errors++;
+                break;
+            }
+        }
+        if (nd->payload_len != lorasim_cfg.payload_len) {
+            lorasim_payload_errors++;
+        }
+    }
+}
+
+static void lorasim_setup (const lorasim_config_t *config, uint32_t seed, bool adr) {
+    lorasim_cfg = *config;
+    simnet_config_t net = { .region = config->region, .adr = adr, .mute = false };
+    simnet_init(&net);
+    sim_init(seed, lorasim_uplink);
+    lorasim_payload_errors = 0;
+    lorasim_log_count = 0;
+    lorasim_log_dev = NULL;
+}
+
+static void lorasim_teardown (lorasim_node_t **nodes, uint32_t count) {
+    sim_deinit();
+    simnet_deinit();
+    for (uint32_t i = 0; i < count; i++) {
+        free(nodes[i]);
+    }
+}
+
+static lorasim_config_t lorasim_defaults (LoRaMacRegion_t region) {
+    lorasim_config_t config = {
+        .region = region,
+        .period_ms = 60 * 1000,
+        .join_retry_ms = 10 * 1000,
+        .aggregate_ms = 0,
+        .payload_len = 10,              // fits DR0 of every region (11 bytes in US915)
+        .join_dr = DR_0,
+        .confirmed = false,
+        .duty_cycle = false,
+        .adr = true,
+    };
+    return config;
+}
+
+static bool lorasim_region (const char *name, LoRaMacRegion_t *region) {
+    static const struct { const char *name; LoRaMacRegion_t region; } regions[] = {
+        { "EU868", LORAMAC_REGION_EU868 }, { "US915", LORAMAC_REGION_US915 }, { "AU915", LORAMAC_REGION_AU915 },
+        { "AS923", LORAMAC_REGION_AS923 }, { "IN865", LORAMAC_REGION_IN865 }, { "CN470", LORAMAC_REGION_CN470 },
+    };
+    for (uint32_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        if (strcasecmp(name, regions[i].name) == 0) {
+            *region = regions[i].region;
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************************************************************
+ BENCHMARK
+ ******************************************************************************/
+static int lorasim_bench (int argc, char **argv) {
+    lorasim_config_t config = lorasim_defaults(LORAMAC_REGION_EU868);
+    uint32_t count = 500;
+    uint32_t hours = 24;
+    uint32_t seed = 1;
+    config.period_ms = 600 * 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:t:p:l:a:cds:")) != -1) {
+        switch (opt) {
+        case 'r':
+            if (!lorasim_region(optarg, &config.region)) {
+                fprintf(stderr, "unknown region %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'n': count = atoi(optarg); break;
+        case 't': hours = atoi(optarg); break;
+        case 'p': config.period_ms = atoi(optarg) * 1000; break;
+        case 'l': config.payload_len = atoi(optarg); break;
+        case 'a': config.aggregate_ms = atoi(optarg) * 1000; break;
+        case 'c': config.confirmed = true; break;
+        case 'd': config.duty_cycle = true; break;
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s bench [-r region] [-n devices] [-t hours] [-p period] [-l length] [-a deadline] [-c] [-d] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || hours < 1 || hours > 1000 || config.period_ms < 1000 || config.payload_len < 1 || config.payload_len > 51) {
+        fprintf(stderr, "at least 1 device, 1 to 1000 hours, a period of at least 1 s and 1 to 51 bytes\n");
+        return 2;
+    }
+    if (config.aggregate_ms && config.payload_len < 8) {
+        fprintf(stderr, "aggregated readings take at least 8 bytes\n");
+        return 2;
+    }
+
+    lorasim_setup(&config, seed, true);
+    lorasim_node_t **nodes = malloc(count * sizeof(lorasim_node_t *));
+    uint32_t rng = seed;
+    for (uint32_t i = 0; i < count; i++) {
+        // links from the gateway's doorstep to the edge of the cell
+        float snr = -20.0f + (sim_random(&rng) % 3000) / 100.0f;
+        nodes[i] = lorasim_node_new(i, snr);
+    }
+    sim_run(hours * LORASIM_HOUR_MS);
+
+    const sim_stats_t *stats = sim_stats();
+    uint32_t joined = 0, sent = 0, busy = 0;
+    uint32_t drs[16] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        joined += nodes[i]->joined;
+        sent += nodes[i]->sent;
+        busy += nodes[i]->busy;
+        if (nodes[i]->dr >= 0) {
+            drs[nodes[i]->dr & 0x0F]++;
+        }
+    }
+    printf("%u devices, %u h, %u bytes every %u s: %u joined, %u uplinks requested (%u refused by the stack)\n",
+           (unsigned)count, (unsigned)hours, (unsigned)config.payload_len, (unsigned)(config.period_ms / 1000),
+           (unsigned)joined, (unsigned)sent, (unsigned)busy);
+    printf("  on air: %llu frames, %llu received, %llu collided, %llu too weak; %llu downlinks, %llu received, %llu missed\n",
+           (unsigned long long)stats->uplinks, (unsigned long long)stats->uplinks_received,
+           (unsigned long long)stats->uplinks_collided, (unsigned long long)stats->uplinks_weak,
+           (unsigned long long)stats->downlinks, (unsigned long long)stats->downlinks_received,
+           (unsigned long long)stats->downlinks_missed);
+    if (config.aggregate_ms) {
+        aggregate_stats_t ag = {0};
+        uint32_t readings = 0, latency = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            ag.payloads += nodes[i]->ag.stats.payloads;
+            ag.frames += nodes[i]->ag.stats.frames;
+            ag.frames_saved += nodes[i]->ag.stats.frames_saved;
+            ag.flush_full += nodes[i]->ag.stats.flush_full;
+            ag.flush_deadline += nodes[i]->ag.stats.flush_deadline;
+            ag.dropped += nodes[i]->ag.stats.dropped;
+            readings += nodes[i]->rx_readings;
+            latency = (nodes[i]->rx_latency_max > latency) ? nodes[i]->rx_latency_max : latency;
+        }
+        printf("  aggregated %u readings in %u frames (%u saved, %u full, %u at the deadline, %u dropped), "
+               "%u received, at most %.1f s late\n",
+               (unsigned)ag.payloads, (unsigned)ag.frames, (unsigned)ag.frames_saved, (unsigned)ag.flush_full,
+               (unsigned)ag.flush_deadline, (unsigned)ag.dropped, (unsigned)readings, latency / 1000.0);
+    }
+    printf("  data rates:");
+    for (uint32_t i = 0; i < 16; i++) {
+        if (drs[i]) {
+            printf(" DR%u %u", (unsigned)i, (unsigned)drs[i]);
+        }
+    }
+    printf("\n");
+    double uplinks = stats->uplinks ? stats->uplinks : 1;
+    printf("  MAC CPU time %.2f us per uplink (%.1f events), network server %.2f us, %u byte state swap %.2f us\n",
+           stats->mac_ns / uplinks / 1000.0, stats->events / uplinks, stats->hook_ns / uplinks / 1000.0,
+           (unsigned)sim_mac_state_size(), stats->switches ? stats->switch_ns / (double)stats->switches / 1000.0 : 0.0);
+
+    int result = (lorasim_payload_errors == 0) ? 0 : 1;
+    if (lorasim_payload_errors) {
+        printf("  %u uplinks failed to decrypt\n", (unsigned)lorasim_payload_errors);
+    }
+    lorasim_teardown(nodes, count);
+    free(nodes);
+    return result;
+}
+
+/******************************************************************************
+ REGRESSION TESTS
+ ******************************************************************************/
+static uint32_t lorasim_failures;
+
+static void lorasim_check (bool ok, const char *test, const char *what) {
+    printf("%s: %s %s\n", test, what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        lorasim_failures++;
+    }
+}
+
+// one device per region joins, its uplinks decrypt and confirmed ones are acked
+static void lorasim_test_join (LoRaMacRegion_t region, const char *test) {
+    lorasim_config_t config = lorasim_defaults(region);
+    config.confirmed = true;
+    lorasim_setup(&config, 1, false);
+    lorasim_node_t *node = lorasim_node_new(7, 0.0f);
+    sim_run(LORASIM_HOUR_MS);
+
+    lorasim_check(node->joined && node->join_attempts == 1, test, "joins at the first attempt");
+    sim_device_enter(node->dev);
+    MibRequestConfirm_t mibReq = { .Type = MIB_DEV_ADDR };
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    lorasim_check(mibReq.Param.DevAddr == node->nd->dev_addr, test, "gets the address assigned");
+    lorasim_check(node->nd->uplinks > 50 && lorasim_payload_errors == 0 && node->nd->fcnt_gaps == 0 &&
+                  node->nd->mic_errors == 0, test, "uplinks decrypt in sequence");
+    lorasim_check(node->acks > 50 && node->acks == node->confirms, test, "confirmed uplinks are acknowledged");
+    lorasim_teardown(&node, 1);
+}
+
+// a device with the wrong key keeps trying, within the join duty cycle
+static void lorasim_test_join_backoff (void) {
+    const char *test = "join backoff";
+    lorasim_config_t config = lorasim_defaults(LORAMAC_REGION_EU868);
+    config.join_retry_ms = 1;
+    lorasim_setup(&config, 1, false);
+    lorasim_node_t *node = lorasim_node_new(3, 0.0f);
+    node->nd->app_key[0] ^= 1;
+    lorasim_log_dev = node->dev;
+    sim_run(LORASIM_HOUR_MS);
+
+    uint32_t airtime = 0;
+    for (uint32_t i = 0; i < lorasim_log_count; i++) {
+        airtime += lorasim_log[i].end - lorasim_log[i].start;
+    }
+    lorasim_check(!node->joined && node->nd->mic_errors == lorasim_log_count && lorasim_log_count > 5, test, "never joins");
+    // 1% in the first hour, allowing for the request straddling the end
+    lorasim_check(airtime <= LORASIM_HOUR_MS / 100 + (lorasim_log[0].end - lorasim_log[0].start), test, "stays within 36 s an hour");
+    lorasim_teardown(&node, 1);
+}
+
+// hundreds of devices starting together all get in
+static void lorasim_test_join_crowd (void) {
+    const char *test = "join crowd";
+    const uint32_t count = 200;
+    lorasim_config_t config = lorasim_defaults(LORAMAC_REGION_EU868);
+    lorasim_setup(&config, 1, false);
+    lorasim_node_t *nodes[count];
+    for (uint32_t i = 0; i < count; i++) {
+        nodes[i] = lorasim_node_new(i, 5.0f);
+    }
+    sim_run(2 * LORASIM_HOUR_MS);
+    uint32_t joined = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        joined += nodes[i]->joined;
+    }
+    lorasim_check(joined == count && sim_stats()->uplinks_collided > 0, test, "all join despite collisions");
+    lorasim_check(lorasim_payload_errors == 0, test, "uplinks decrypt");
+    lorasim_teardown(nodes, count);
+}
+
+// weak_snr is just above the floor of DR0: SF12 in EU868, SF10 in US915
+static void lorasim_test_adr (LoRaMacRegion_t region, int8_t dr_max, float weak_snr, const char *test) {
+    lorasim_config_t config = lorasim_defaults(region);
+    config.period_ms = 30 * 1000;
+    lorasim_setup(&config, 1, true);
+    lorasim_node_t *strong = lorasim_node_new(1, 10.0f);
+    lorasim_node_t *weak = lorasim_node_new(2, weak_snr);
+    sim_run(2 * LORASIM_HOUR_MS);
+
+    lorasim_check(strong->dr == dr_max && strong->nd->adr_ans == 0x07, test, "moves a strong link to the fastest rate");
+    lorasim_check(strong->tx_power > 0, test, "then lowers its power");
+    lorasim_check(weak->dr == DR_0 && weak->tx_power == 0, test, "leaves a weak link alone");
+
+    // the network goes quiet, the device backs off to be heard again
+    simnet_config()->mute = true;
+    sim_run(sim_now() + 4 * LORASIM_HOUR_MS);
+    lorasim_check(strong->nd->uplinks_adr_ack_req > 0, test, "asks for an ADR acknowledgement");
+    lorasim_check(strong->dr == DR_0 && strong->tx_power == 0, test, "falls back to full power and the slowest rate");
+    lorasim_node_t *nodes[] = { strong, weak };
+    lorasim_teardown(nodes, 2);
+}
+
+// with the duty cycle on, each band rests 99 times the time on air of the
+// last frame; without it, the same device overshoots
+static void lorasim_test_duty_cycle (void) {
+    const char *test = "duty cycle";
+    for (int on = 1; on >= 0; on--) {
+        lorasim_config_t config = lorasim_defaults(LORAMAC_REGION_EU868);
+        config.period_ms = 1000;
+        config.duty_cycle = on;
+        lorasim_setup(&config, 1, false);
+        lorasim_node_t *node = lorasim_node_new(5, 0.0f);
+        sim_run(10 * 60 * 1000);
+        // measure once joined, from the first data frame on
+        lorasim_log_dev = node->dev;
+        lorasim_log_count = 0;
+        TimerTime_t start = sim_now();
+        sim_run(start + LORASIM_HOUR_MS);
+
+        // the default EU868 channels are all in the 868.0 - 868.6 MHz band
+        uint32_t airtime = 0;
+        bool rests = true;
+        for (uint32_t i = 0; i < lorasim_log_count; i++) {
+            airtime += lorasim_log[i].end - lorasim_log[i].start;
+            if (i > 0) {
+                const lorasim_tx_t *prev = &lorasim_log[i - 1];
+                rests &= (lorasim_log[i].start - prev->end) >= 99 * (prev->end - prev->start);
+            }
+        }
+        if (on) {
+            lorasim_check(node->joined && lorasim_log_count > 10, test, "sends");
+            lorasim_check(rests, test, "rests 99 times the time on air");
+            // allowing for the frame that rested before the hour started
+            lorasim_check(airtime <= LORASIM_HOUR_MS / 100 + (lorasim_log[0].end - lorasim_log[0].start), test, "stays within 1%");
+        } else {
+            lorasim_check(!rests && airtime > LORASIM_HOUR_MS / 100, test, "is exceeded when off");
+        }
+        lorasim_teardown(&node, 1);
+    }
+}
+
+// readings every 10 s with a minute of deadline: the frames fill up at DR0
+// and go at the deadline once ADR has sped the link up, the server gets every
+// reading in order and in time, and far fewer frames go out than readings
+static void lorasim_test_aggregate (void) {
+    const char *test = "aggregation";
+    lorasim_config_t config = lorasim_defaults(LORAMAC_REGION_EU868);
+    config.period_ms = 10 * 1000;
+    config.aggregate_ms = 60 * 1000;
+    lorasim_setup(&config, 1, true);
+    lorasim_node_t *node = lorasim_node_new(9, 10.0f);
+    sim_run(2 * LORASIM_HOUR_MS);
+
+    const aggregate_stats_t *stats = &node->ag.stats;
+    lorasim_check(node->joined && stats->payloads > 600 && stats->dropped == 0 && node->busy == 0, test, "takes every reading");
+    lorasim_check(stats->frames == node->sent && stats->frames_saved == stats->payloads - node->ag.count - stats->frames &&
+                  stats->frames_saved > 4 * stats->frames, test, "sends one frame for several readings");
+    lorasim_check(stats->flush_full > 0 && stats->flush_deadline > 0 && stats->flush_change == 0 &&
+                  stats->flush_full + stats->flush_deadline == stats->frames, test, "flushes full frames and at the deadline");
+    lorasim_check(lorasim_payload_errors == 0 && node->rx_gaps == 0 &&
+                  node->rx_readings == stats->payloads - node->ag.count, test, "readings arrive in order");
+    // on top at most: the frame in flight when the reading came, then the time on air
+    lorasim_check(node->rx_latency_max > config.aggregate_ms / 2 && node->rx_latency_max < config.aggregate_ms + 10000,
+                  test, "readings arrive within the deadline");
+    lorasim_teardown(&node, 1);
+}
+
+static int lorasim_test (void) {
+    lorasim_failures = 0;
+    lorasim_test_join(LORAMAC_REGION_EU868, "join EU868");
+    lorasim_test_join(LORAMAC_REGION_US915, "join US915");
+    lorasim_test_join_backoff();
+    lorasim_test_join_crowd();
+    lorasim_test_adr(LORAMAC_REGION_EU868, DR_5, -18.0f, "ADR EU868");
+    lorasim_test_adr(LORAMAC_REGION_US915, DR_3, -13.0f, "ADR US915");
+    lorasim_test_duty_cycle();
+    lorasim_test_aggregate();
+    free(lorasim_log);
+    lorasim_log = NULL;
+    lorasim_log_size = 0;
+    printf("%s\n", lorasim_failures ? "FAILED" : "all passed");
+    return lorasim_failures ? 1 : 0;
+}
+
+int main (int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return lorasim_bench(argc - 1, argv + 1);
+    } else if (argc == 2 && strcmp(argv[1], "test") == 0) {
+        return lorasim_test();
+    }
+    fprintf(stderr, "usage: %s bench [options] | test\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MODLORA_H_
+#define MODLORA_H_
+
+// The part of ../../mods/modlora.h that the LoRaWAN stack itself uses; the
+// simulator provides these functions in simradio.c.
+
+#include "board.h"
+#include "lora/mac/LoRaMac.h"
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_LORA_NVS_ELE_JOINED = 0,
+    E_LORA_NVS_ELE_UPLINK,
+    E_LORA_NVS_ELE_DWLINK,
+    E_LORA_NVS_ELE_DEVADDR,
+    E_LORA_NVS_ELE_NWSKEY,
+    E_LORA_NVS_ELE_APPSKEY,
+    E_LORA_NVS_ELE_NET_ID,
+    E_LORA_NVS_ELE_ADR_ACKS,
+    E_LORA_NVS_ELE_MAC_PARAMS,
+    E_LORA_NVS_ELE_CHANNELS,
+    E_LORA_NVS_ELE_ACK_REQ,
+    E_LORA_NVS_MAC_NXT_TX,
+    E_LORA_NVS_MAC_CMD_BUF_IDX,
+    E_LORA_NVS_MAC_CMD_BUF_RPT_IDX,
+    E_LORA_NVS_ELE_MAC_BUF,
+    E_LORA_NVS_ELE_MAC_RPT_BUF,
+    E_LORA_NVS_ELE_REGION,
+    E_LORA_NVS_ELE_CHANNELMASK,
+    E_LORA_NVS_ELE_CHANNELMASK_REMAINING,
+    E_LORA_NVS_NUM_KEYS
+} e_lora_nvs_key_t;
+
+typedef void ( *modlora_timerCallback )( void );
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern bool modlora_nvs_set_uint(uint32_t key_idx, uint32_t value);
+extern bool modlora_nvs_set_blob(uint32_t key_idx, const void *value, uint32_t length);
+extern bool modlora_nvs_get_uint(uint32_t key_idx, uint32_t *value);
+extern bool modlora_nvs_get_blob(uint32_t key_idx, void *value, uint32_t *length);
+extern void modlora_set_timer_callback(modlora_timerCallback cb);
+
+#endif  // MODLORA_H_
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Channel selection of the LoRaWAN regions:
+//   regiontest test
+//   regiontest bench
+// test checks RegionCommonCountNbOfEnabledChannels against the channel scan
+// the regions used to do at every uplink, on random channel plans and on the
+// default plan of each region; bench times both, plus a whole
+// RegionNextChannel call.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "simradio.h"
+#include "lora/mac/region/Region.h"
+#include "lora/mac/region/RegionCommon.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define REGIONTEST_MAX_NB_CHANNELS          (REGION_COMMON_CHANNELS_MASK_SIZE * 16)
+#define REGIONTEST_TRIALS                   (200000)
+#define REGIONTEST_BENCH_CALLS              (2000000)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    ChannelParams_t     channels[REGIONTEST_MAX_NB_CHANNELS];
+    uint8_t             nb_channels;
+    Band_t              bands[REGION_COMMON_MAX_NB_BANDS];
+    uint8_t             nb_bands;
+    uint16_t            mask[REGION_COMMON_CHANNELS_MASK_SIZE];
+} regiontest_plan_t;
+
+typedef struct {
+    const char          *name;
+    LoRaMacRegion_t     region;
+    uint8_t             nb_channels;
+    uint8_t             nb_bands;
+    int8_t              dr_max;
+    uint16_t            join_channels;      // 0 when joining uses any channel
+} regiontest_region_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static const regiontest_region_t regiontest_regions[] = {
+    { "AS923", LORAMAC_REGION_AS923, 16, 1, DR_7, LC( 1 ) | LC( 2 ) },
+    { "AU915", LORAMAC_REGION_AU915, 72, 1, DR_6, 0 },
+    { "CN470", LORAMAC_REGION_CN470, 96, 1, DR_5, 0 },
+    { "EU868", LORAMAC_REGION_EU868, 16, 5, DR_7, LC( 1 ) | LC( 2 ) | LC( 3 ) },
+    { "IN865", LORAMAC_REGION_IN865, 16, 1, DR_7, LC( 1 ) | LC( 2 ) | LC( 3 ) },
+    { "US915", LORAMAC_REGION_US915, 72, 1, DR_4, 0 },
+};
+
+static uint32_t regiontest_rng = 1;
+static uint32_t regiontest_failures;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// the scan of the channel list the regions did before, kept as the reference
+static uint8_t regiontest_reference (uint16_t join_channels, bool joined, uint8_t datarate, uint8_t nb_channels,
+                                     uint16_t *channelsMask, ChannelParams_t *channels, Band_t *bands,
+                                     uint8_t *enabledChannels, uint8_t *delayTx) {
+    uint8_t nbEnabledChannels = 0;
+    uint8_t delayTransmission = 0;
+
+    for (uint8_t i = 0, k = 0; i < nb_channels; i += 16, k++) {
+        for (uint8_t j = 0; j < 16; j++) {
+            if ((channelsMask[k] & (1 << j)) != 0) {
+                if (channels[i + j].Frequency == 0) {
+                    continue;
+                }
+                if (join_channels && joined == false) {
+                    if ((join_channels & (1 << j)) == 0) {
+                        continue;
+                    }
+                }
+                if (RegionCommonValueInRange(datarate, channels[i + j].DrRange.Fields.Min,
+                                             channels[i + j].DrRange.Fields.Max) == false) {
+                    continue;
+                }
+                if (bands[channels[i + j].Band].TimeOff > 0) {
+                    delayTransmission++;
+                    continue;
+                }
+                enabledChannels[nbEnabledChannels++] = i + j;
+            }
+        }
+    }
+
+    *delayTx = delayTransmission;
+    return nbEnabledChannels;
+}
+
+// the channel selection as the regions call it now
+static uint8_t regiontest_count (uint16_t join_channels, bool joined, uint8_t datarate, uint8_t nb_channels, uint8_t nb_bands,
+                                 uint16_t *channelsMask, ChannelParams_t *channels, Band_t *bands,
+                                 uint8_t *enabledChannels, uint8_t *delayTx) {
+    if (join_channels) {
+        uint16_t channelsMaskJoin = channelsMask[0];
+        if (joined == false) {
+            channelsMaskJoin &= join_channels;
+        }
+        return RegionCommonCountNbOfEnabledChannels(channels, nb_channels, bands, nb_bands, datarate,
+                                                    &channelsMaskJoin, enabledChannels, delayTx);
+    }
+    return RegionCommonCountNbOfEnabledChannels(channels, nb_channels, bands, nb_bands, datarate,
+                                                channelsMask, enabledChannels, delayTx);
+}
+
+static bool regiontest_compare (uint16_t join_channels, bool joined, uint8_t datarate, regiontest_plan_t *plan) {
+    uint8_t ref[REGIONTEST_MAX_NB_CHANNELS], got[REGIONTEST_MAX_NB_CHANNELS];
+    uint8_t ref_delay, got_delay;
+    uint8_t ref_count = regiontest_reference(join_channels, joined, datarate, plan->nb_channels, plan->mask,
+                                             plan->channels, plan->bands, ref, &ref_delay);
+    uint8_t got_count = regiontest_count(join_channels, joined, datarate, plan->nb_channels, plan->nb_bands, plan->mask,
+                                         plan->channels, plan->bands, got, &got_delay);
+    return ref_count == got_count && ref_delay == got_delay && memcmp(ref, got, ref_count) == 0;
+}
+
+static void regiontest_random_channel (ChannelParams_t *channel, uint8_t nb_bands) {
+    uint32_t r = sim_random(&regiontest_rng);
+    // one in four undefined, any datarate range including the inverted ones
+    channel->Frequency = (r & 3) ? 860000000 + (r % 100) * 100000 : 0;
+    channel->DrRange.Value = (r >> 8) & 0xFF;
+    channel->Band = (r >> 16) % nb_bands;
+}
+
+static void regiontest_random_plan (regiontest_plan_t *plan, uint8_t nb_channels, uint8_t nb_bands) {
+    memset(plan, 0, sizeof(*plan));
+    plan->nb_channels = nb_channels;
+    plan->nb_bands = nb_bands;
+    for (uint8_t i = 0; i < nb_channels; i++) {
+        regiontest_random_channel(&plan->channels[i], nb_bands);
+    }
+    for (uint8_t k = 0; k < (nb_channels + 15) / 16; k++) {
+        uint16_t valid = (nb_channels - k * 16 >= 16) ? 0xFFFF : (1 << (nb_channels % 16)) - 1;
+        plan->mask[k] = sim_random(&regiontest_rng) & valid;
+    }
+    RegionCommonChanSetInvalidate();
+}
+
+static void regiontest_check (bool ok, const char *test, const char *what) {
+    printf("%s: %s %s\n", test, what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        regiontest_failures++;
+    }
+}
+
+// random channel plans, band time-offs and masks, the list changing as it
+// would with NewChannelReq
+static void regiontest_test_random (void) {
+    static const uint8_t sizes[][2] = { { 16, 5 }, { 16, 1 }, { 72, 1 }, { 96, 1 }, { 40, 3 } };
+    static regiontest_plan_t plan;
+    bool ok = true;
+
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        regiontest_random_plan(&plan, sizes[s][0], sizes[s][1]);
+        for (uint32_t t = 0; t < REGIONTEST_TRIALS && ok; t++) {
+            uint32_t r = sim_random(&regiontest_rng);
+            switch (r % 8) {
+            case 0:
+                regiontest_random_channel(&plan.channels[(r >> 8) % plan.nb_channels], plan.nb_bands);
+                RegionCommonChanSetInvalidate();
+                break;
+            case 1:
+                plan.mask[(r >> 8) % ((plan.nb_channels + 15) / 16)] ^= 1 << ((r >> 16) % 16);
+                plan.mask[(plan.nb_channels - 1) / 16] &= (plan.nb_channels % 16) ? (1 << (plan.nb_channels % 16)) - 1 : 0xFFFF;
+                break;
+            case 2:
+                plan.bands[(r >> 8) % plan.nb_bands].TimeOff = (r >> 16) & 1 ? (r >> 17) : 0;
+                break;
+            default:
+                break;
+            }
+            uint16_t join_channels = (plan.nb_channels == 16 && (r & 0x100)) ? LC( 1 ) | LC( 2 ) | LC( 3 ) : 0;
+            ok = regiontest_compare(join_channels, (r >> 10) & 1, (r >> 12) % 17, &plan);
+        }
+        if (ok) {
+            // the first call after a change of list rebuilds the sets
+            regiontest_random_plan(&plan, sizes[s][0], sizes[s][1]);
+            ok = regiontest_compare(0, true, DR_0, &plan);
+        }
+    }
+    regiontest_check(ok, "random plans", "match the channel scan");
+}
+
+// the default plan of every region, joined or not, every datarate and band state
+static void regiontest_test_regions (void) {
+    for (uint32_t r = 0; r < sizeof(regiontest_regions) / sizeof(regiontest_regions[0]); r++) {
+        const regiontest_region_t *region = &regiontest_regions[r];
+        regiontest_plan_t plan = { .nb_channels = region->nb_channels, .nb_bands = region->nb_bands };
+        ChannelParams_t *channels;
+        uint16_t *mask;
+        uint32_t size;
+        bool ok = true;
+
+        RegionInitDefaults(region->region, INIT_TYPE_INIT);
+        ok &= RegionGetChannels(region->region, &channels, &size) || region->region == LORAMAC_REGION_CN470;
+        if (region->region != LORAMAC_REGION_CN470) {
+            memcpy(plan.channels, channels, region->nb_channels * sizeof(ChannelParams_t));
+        } else {
+            // CN470 does not hand its channels out, this is its default plan
+            for (uint8_t i = 0; i < region->nb_channels; i++) {
+                plan.channels[i] = (ChannelParams_t){ 470300000 + i * 200000, 0, { ( DR_5 << 4 ) | DR_0 }, 0 };
+            }
+        }
+        if (RegionGetChannelMask(region->region, &mask, &size)) {
+            memcpy(plan.mask, mask, size);
+        } else {
+            memset(plan.mask, 0xFF, sizeof(plan.mask));
+        }
+        RegionCommonChanSetInvalidate();
+
+        for (uint32_t state = 0; state < (1 << region->nb_bands) && ok; state++) {
+            for (uint8_t b = 0; b < region->nb_bands; b++) {
+                plan.bands[b].TimeOff = (state & (1 << b)) ? 1000 : 0;
+            }
+            for (int8_t dr = DR_0; dr <= region->dr_max + 1 && ok; dr++) {
+                ok &= regiontest_compare(region->join_channels, false, dr, &plan);
+                ok &= regiontest_compare(region->join_channels, true, dr, &plan);
+            }
+        }
+        regiontest_check(ok, region->name, "default plan matches the channel scan");
+    }
+}
+
+static uint64_t regiontest_ns (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void regiontest_bench_region (const regiontest_region_t *region) {
+    static regiontest_plan_t plan;
+    ChannelParams_t *channels;
+    uint8_t enabled[REGIONTEST_MAX_NB_CHANNELS];
+    uint8_t delay;
+    uint32_t size, sum = 0;
+
+    RegionInitDefaults(region->region, INIT_TYPE_INIT);
+    memset(&plan, 0, sizeof(plan));
+    plan.nb_channels = region->nb_channels;
+    plan.nb_bands = region->nb_bands;
+    if (RegionGetChannels(region->region, &channels, &size)) {
+        memcpy(plan.channels, channels, region->nb_channels * sizeof(ChannelParams_t));
+    }
+    memset(plan.mask, 0xFF, sizeof(plan.mask));
+    RegionCommonChanSetInvalidate();
+
+    uint64_t start = regiontest_ns();
+    for (uint32_t i = 0; i < REGIONTEST_BENCH_CALLS; i++) {
+        sum += regiontest_reference(region->join_channels, true, i % (region->dr_max + 1), plan.nb_channels, plan.mask,
+                                    plan.channels, plan.bands, enabled, &delay);
+    }
+    uint64_t scan = regiontest_ns() - start;
+    start = regiontest_ns();
+    for (uint32_t i = 0; i < REGIONTEST_BENCH_CALLS; i++) {
+        sum -= regiontest_count(region->join_channels, true, i % (region->dr_max + 1), plan.nb_channels, plan.nb_bands,
+                                plan.mask, plan.channels, plan.bands, enabled, &delay);
+    }
+    uint64_t sets = regiontest_ns() - start;
+
+    // a whole channel selection, band time-offs included
+    NextChanParams_t params = { .Joined = true, .DutyCycleEnabled = false };
+    TimerTime_t time, aggregated;
+    uint8_t channel;
+    RegionInitDefaults(region->region, INIT_TYPE_INIT);
+    start = regiontest_ns();
+    for (uint32_t i = 0; i < REGIONTEST_BENCH_CALLS; i++) {
+        params.Datarate = i % (region->dr_max + 1);
+        RegionNextChannel(region->region, &params, &channel, &time, &aggregated);
+    }
+    uint64_t next = regiontest_ns() - start;
+
+    printf("%s: channel scan %.1f ns, channel sets %.1f ns, RegionNextChannel %.1f ns%s\n", region->name,
+           scan / (double)REGIONTEST_BENCH_CALLS, sets / (double)REGIONTEST_BENCH_CALLS,
+           next / (double)REGIONTEST_BENCH_CALLS, sum ? " (mismatch!)" : "");
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+int main (int argc, char **argv) {
+    bool test = (argc == 2 && strcmp(argv[1], "test") == 0);
+    bool bench = (argc == 2 && strcmp(argv[1], "bench") == 0);
+    if (!test && !bench) {
+        fprintf(stderr, "usage: %s test | bench\n", argv[0]);
+        return 2;
+    }
+
+    // the regions use the timer of a device
+    sim_init(1, NULL);
+    sim_device_t *dev = sim_device_new(0, 0.0f, NULL);
+    sim_device_enter(dev);
+
+    if (test) {
+        regiontest_test_random();
+        regiontest_test_regions();
+        printf("%s\n", regiontest_failures ? "FAILED" : "all passed");
+    } else {
+        for (uint32_t r = 0; r < sizeof(regiontest_regions) / sizeof(regiontest_regions[0]); r++) {
+            regiontest_bench_region(&regiontest_regions[r]);
+        }
+    }
+
+    sim_deinit();
+    return regiontest_failures ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Checks of the packet ring the lora module receives into:
+//   rxringtest test
+//   rxringtest bench
+// test runs the single threaded checks (wrapping, partial reads, drops,
+// flushes), then a producer and a consumer thread hammering the ring, once
+// with a producer that waits for room (every packet must come out intact and
+// in order) and once with one that drops like the radio does (what comes out
+// must still be intact and in order, and the counters must add up). bench
+// measures a put and a read.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "rxring.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define RXRINGTEST_SIZE                     (2048)
+#define RXRINGTEST_PACKETS                  (2000000)
+#define RXRINGTEST_LEN_MAX                  (255)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    rxring_t            ring;
+    bool                lossless;
+    bool                done;
+    uint32_t            received;           // by the consumer
+    uint32_t            errors;
+    uint32_t            last_seq;
+} rxringtest_run_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static uint8_t rxringtest_buf[RXRINGTEST_SIZE];
+static uint32_t rxringtest_failures;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static void rxringtest_check (bool ok, const char *test, const char *what) {
+    printf("%s: %s %s\n", test, what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        rxringtest_failures++;
+    }
+}
+
+static uint32_t rxringtest_random (uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// the sequence number, then bytes the consumer can tell apart
+static uint32_t rxringtest_packet (uint8_t *data, uint32_t seq) {
+    uint32_t len = 4 + (seq * 37) % (RXRINGTEST_LEN_MAX - 3);
+    memcpy(data, &seq, 4);
+    for (uint32_t i = 4; i < len; i++) {
+        data[i] = seq + i;
+    }
+    return len;
+}
+
+static bool rxringtest_verify (const uint8_t *data, uint32_t len, uint8_t port, uint32_t *seq) {
+    uint8_t expected[RXRINGTEST_LEN_MAX];
+    if (len < 4) {
+        return false;
+    }
+    memcpy(seq, data, 4);
+    return len == rxringtest_packet(expected, *seq) && memcmp(data, expected, len) == 0 && port == (uint8_t)*seq;
+}
+
+// reads one whole packet in pieces of random size; the first piece tells the
+// sequence number and from it the length, so that the next packet is not
+// started by mistake. Returns the length, with the port in bits 16 to 23
+static int rxringtest_read (rxring_t *ring, uint8_t *data, uint32_t *rng) {
+    uint8_t expected[RXRINGTEST_LEN_MAX];
+    uint8_t port = 0, piece_port;
+    uint32_t seq;
+    int n = rxring_read(ring, data, 4 + rxringtest_random(rng) % 8, &port);
+    if (n < 4) {
+        return (n < 0) ? -1 : -2;
+    }
+    memcpy(&seq, data, 4);
+    uint32_t len = rxringtest_packet(expected, seq);
+    for (uint32_t got = n; got < len; got += n) {
+        uint32_t chunk = 1 + rxringtest_random(rng) % (len - got);
+        n = rxring_read(ring, &data[got], chunk, &piece_port);
+        if (n != (int)chunk || piece_port != port) {
+            // the rest of a packet is there already
+            return -2;
+        }
+    }
+    return len | (port << 16);
+}
+
+static void rxringtest_single (void) {
+    const char *test = "single";
+    rxring_t ring;
+    uint8_t data[RXRINGTEST_LEN_MAX];
+    uint8_t out[RXRINGTEST_LEN_MAX];
+    uint8_t port;
+
+    rxring_init(&ring, rxringtest_buf, 256);
+    rxringtest_check(rxring_empty(&ring) && rxring_read(&ring, out, sizeof(out), &port) == -1, test, "starts empty");
+
+    // 100 + 4 twice, then 60 + 4 has to wrap: 208 used and 48 left at the end
+    memset(data, 0x11, sizeof(data));
+    bool ok = rxring_put(&ring, data, 100, 1) && rxring_put(&ring, data, 100, 2);
+    ok &= !rxring_put(&ring, data, 60, 3) && ring.stats.dropped == 1;
+    rxringtest_check(ok && rxring_used(&ring) == 208 && ring.stats.high_water == 208, test, "drops what does not fit");
+
+    ok = rxring_read(&ring, out, 30, &port) == 30 && port == 1;
+    ok &= rxring_read(&ring, out, 255, &port) == 70 && port == 1;
+    rxringtest_check(ok && rxring_used(&ring) == 104, test, "reads a packet in pieces");
+
+    memset(data, 0x22, sizeof(data));
+    ok = rxring_put(&ring, data, 60, 3);
+    ok &= rxring_read(&ring, out, 255, &port) == 100 && port == 2;
+    ok &= rxring_read(&ring, out, 255, &port) == 60 && port == 3 && out[0] == 0x22 && out[59] == 0x22;
+    rxringtest_check(ok && rxring_empty(&ring), test, "wraps a packet around as a whole");
+
+    ok = rxring_put(&ring, data, 0, 4) && rxring_read(&ring, out, 255, &port) == 0 && port == 4 && rxring_empty(&ring);
+    rxringtest_check(ok, test, "keeps empty packets");
+
+    rxringtest_check(!rxring_put(&ring, data, 253, 5) && ring.stats.dropped == 2, test, "refuses a packet larger than the ring");
+
+    rxring_put(&ring, data, 10, 6);
+    rxring_put(&ring, data, 10, 7);
+    rxring_read(&ring, out, 4, &port);
+    rxring_flush(&ring);
+    rxring_put(&ring, data, 20, 8);
+    ok = rxring_read(&ring, out, 255, &port) == 20 && port == 8 && rxring_empty(&ring);
+    rxringtest_check(ok, test, "flushes what came before, partly read or not");
+}
+
+static void *rxringtest_producer (void *arg) {
+    rxringtest_run_t *run = arg;
+    uint8_t data[RXRINGTEST_LEN_MAX];
+    for (uint32_t seq = 1; seq <= RXRINGTEST_PACKETS; seq++) {
+        uint32_t len = rxringtest_packet(data, seq);
+        while (!rxring_put(&run->ring, data, len, seq) && run->lossless) {
+            // the drop is not counted against a producer that waits
+            run->ring.stats.dropped--;
+            sched_yield();
+        }
+        if (!run->lossless && (seq & 31) == 0) {
+            // packets come in bursts, leaving the consumer some time
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&run->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *rxringtest_consumer (void *arg) {
+    rxringtest_run_t *run = arg;
+    uint8_t data[RXRINGTEST_LEN_MAX];
+    uint32_t rng = 0x12345678;
+    for ( ; ; ) {
+        bool done = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+        int n = rxringtest_read(&run->ring, data, &rng);
+        if (n == -1) {
+            if (done) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        uint32_t seq;
+        if (n < 0 || !rxringtest_verify(data, n & 0xFFFF, n >> 16, &seq)) {
+            run->errors++;
+            continue;
+        }
+        if (seq <= run->last_seq || (run->lossless && seq != run->last_seq + 1)) {
+            run->errors++;
+        }
+        run->last_seq = seq;
+        run->received++;
+    }
+    return NULL;
+}
+
+static void rxringtest_threads (bool lossless) {
+    const char *test = lossless ? "threads, waiting producer" : "threads, dropping producer";
+    static rxringtest_run_t run;
+    pthread_t producer, consumer;
+
+    memset(&run, 0, sizeof(run));
+    rxring_init(&run.ring, rxringtest_buf, RXRINGTEST_SIZE);
+    run.lossless = lossless;
+    pthread_create(&consumer, NULL, rxringtest_consumer, &run);
+    pthread_create(&producer, NULL, rxringtest_producer, &run);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    const rxring_stats_t *stats = &run.ring.stats;
+    printf("%s: %u received, %u dropped, high water %u bytes\n", test,
+           (unsigned)stats->received, (unsigned)stats->dropped, (unsigned)stats->high_water);
+    rxringtest_check(run.errors == 0, test, "packets come out intact and in order");
+    rxringtest_check(stats->received + stats->dropped == RXRINGTEST_PACKETS && run.received == stats->received,
+                     test, "counters add up");
+    if (lossless) {
+        rxringtest_check(stats->dropped == 0 && run.last_seq == RXRINGTEST_PACKETS, test, "nothing is lost");
+    }
+    rxringtest_check(stats->high_water <= RXRINGTEST_SIZE && rxring_empty(&run.ring), test, "stays within the ring");
+}
+
+static int rxringtest_test (void) {
+    rxringtest_failures = 0;
+    rxringtest_single();
+    rxringtest_threads(true);
+    rxringtest_threads(false);
+    printf("%s\n", rxringtest_failures ? "FAILED" : "all passed");
+    return rxringtest_failures ? 1 : 0;
+}
+
+static double rxringtest_ns (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int rxringtest_bench (void) {
+    rxring_t ring;
+    uint8_t data[RXRINGTEST_LEN_MAX];
+    uint8_t out[RXRINGTEST_LEN_MAX];
+    uint8_t port;
+    const uint32_t rounds = 10000000;
+    static const uint32_t lens[] = { 12, 51, 242 };
+
+    memset(data, 0x5A, sizeof(data));
+    rxring_init(&ring, rxringtest_buf, RXRINGTEST_SIZE);
+    for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        double start = rxringtest_ns();
+        for (uint32_t r = 0; r < rounds; r++) {
+            rxring_put(&ring, data, lens[i], 1);
+            rxring_read(&ring, out, sizeof(out), &port);
+        }
+        printf("%3u bytes: %.1f ns a put and a read\n", (unsigned)lens[i], (rxringtest_ns() - start) / rounds);
+    }
+    return 0;
+}
+
+int main (int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "test") == 0) {
+        return rxringtest_test();
+    } else if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+        return rxringtest_bench();
+    }
+    fprintf(stderr, "usage: %s test | bench\n", argv[0]);
+    return 2;
+}
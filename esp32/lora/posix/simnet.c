@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+
+#include "simnet.h"
+#include "lora/mac/region/Region.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define SIMNET_MTYPE_JOIN_REQUEST           (0)
+#define SIMNET_MTYPE_JOIN_ACCEPT            (1)
+#define SIMNET_MTYPE_UNCONFIRMED_UP         (2)
+#define SIMNET_MTYPE_UNCONFIRMED_DOWN       (3)
+#define SIMNET_MTYPE_CONFIRMED_UP           (4)
+
+#define SIMNET_FCTRL_ADR                    (0x80)
+#define SIMNET_FCTRL_ADR_ACK_REQ            (0x40)
+#define SIMNET_FCTRL_ACK                    (0x20)
+
+#define SIMNET_CID_LINK_CHECK               (0x02)
+#define SIMNET_CID_LINK_ADR                 (0x03)
+
+#define SIMNET_JOIN_ACCEPT_DELAY1           (5000)
+#define SIMNET_RECEIVE_DELAY1               (1000)
+#define SIMNET_FOPTS_MAX                    (15)
+#define SIMNET_DEVICES_MAX                  (65536)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    LoRaMacRegion_t     region;
+    int8_t              dr_max;             // highest data rate ADR moves to
+    uint8_t             power_max;          // highest TX power index (the lowest power)
+    uint8_t             rx2_dr;
+    uint8_t             ch_mask_cntl;       // the channel mask sent with LinkADRReq
+    uint16_t            ch_mask;
+    uint8_t             sf_dr0;             // DR0 and up are 125 kHz down to sf_min
+    uint8_t             sf_min;
+    uint8_t             wide_sf;            // plus one wide band data rate
+    uint8_t             wide_bw;
+    uint8_t             wide_dr;
+} simnet_region_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static const simnet_region_t simnet_regions[] = {
+    { LORAMAC_REGION_EU868, DR_5, TX_POWER_7, DR_0, 0, 0x0007, 12, 7, 7, 1, DR_6 },
+    { LORAMAC_REGION_US915, DR_3, TX_POWER_10, DR_8, 6, 0x00FF, 10, 7, 8, 2, DR_4 },
+    { LORAMAC_REGION_AU915, DR_5, TX_POWER_10, DR_8, 6, 0x00FF, 12, 7, 8, 2, DR_6 },
+};
+
+static simnet_config_t simnet_cfg;
+static const simnet_region_t *simnet_region;
+static simnet_device_t **simnet_devices;
+static uint32_t simnet_devices_size;
+static uint32_t simnet_rng = 0x5eed;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static uint32_t simnet_get_le (const uint8_t *buf, uint8_t len) {
+    uint32_t value = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+static void simnet_put_le (uint8_t *buf, uint32_t value, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        buf[i] = value >> (8 * i);
+    }
+}
+
+// The server does its cryptography with OpenSSL rather than with the code of
+// the stack, so that it checks the device instead of agreeing with it.
+static void simnet_aes (const uint8_t *key, const uint8_t *in, uint8_t *out, bool encrypt) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int len;
+    EVP_CipherInit_ex(ctx, EVP_aes_128_ecb(), NULL, key, NULL, encrypt);
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+    EVP_CipherUpdate(ctx, out, &len, in, 16);
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+// the first 4 bytes of the AES-CMAC of b0 (if any) followed by the data
+static uint32_t simnet_mic (const uint8_t *key, const uint8_t *b0, const uint8_t *data, uint32_t len) {
+    EVP_MAC *mac = EVP_MAC_fetch(NULL, "CMAC", NULL);
+    EVP_MAC_CTX *ctx = EVP_MAC_CTX_new(mac);
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_CIPHER, "AES-128-CBC", 0),
+        OSSL_PARAM_construct_end(),
+    };
+    uint8_t cmac[16];
+    size_t cmac_len;
+    EVP_MAC_init(ctx, key, 16, params);
+    if (b0) {
+        EVP_MAC_update(ctx, b0, 16);
+    }
+    EVP_MAC_update(ctx, data, len);
+    EVP_MAC_final(ctx, cmac, &cmac_len, sizeof(cmac));
+    EVP_MAC_CTX_free(ctx);
+    EVP_MAC_free(mac);
+    return simnet_get_le(cmac, 4);
+}
+
+// the B0 (MIC) and Ai (encryption) blocks of data frames
+static void simnet_block (uint8_t *block, uint8_t first, uint8_t dir, uint32_t dev_addr, uint32_t fcnt, uint8_t last) {
+    memset(block, 0, 16);
+    block[0] = first;
+    block[5] = dir;
+    simnet_put_le(block + 6, dev_addr, 4);
+    simnet_put_le(block + 10, fcnt, 4);
+    block[15] = last;
+}
+
+static uint32_t simnet_data_mic (const uint8_t *key, const uint8_t *data, uint32_t len, uint8_t dir, uint32_t dev_addr, uint32_t fcnt) {
+    uint8_t b0[16];
+    simnet_block(b0, 0x49, dir, dev_addr, fcnt, len);
+    return simnet_mic(key, b0, data, len);
+}
+
+static void simnet_crypt (const uint8_t *key, const uint8_t *in, uint8_t *out, uint32_t len, uint8_t dir, uint32_t dev_addr, uint32_t fcnt) {
+    uint8_t a[16], s[16];
+    for (uint32_t i = 0; i < len; i++) {
+        if ((i % 16) == 0) {
+            simnet_block(a, 0x01, dir, dev_addr, fcnt, i / 16 + 1);
+            simnet_aes(key, a, s, true);
+        }
+        out[i] = in[i] ^ s[i % 16];
+    }
+}
+
+static void simnet_session_keys (simnet_device_t *nd, const uint8_t *app_nonce_net_id, uint16_t dev_nonce) {
+    uint8_t nonce[16] = {0};
+    memcpy(nonce + 1, app_nonce_net_id, 6);
+    simnet_put_le(nonce + 7, dev_nonce, 2);
+    nonce[0] = 0x01;
+    simnet_aes(nd->app_key, nonce, nd->nwk_skey, true);
+    nonce[0] = 0x02;
+    simnet_aes(nd->app_key, nonce, nd->app_skey, true);
+}
+
+// compares an EUI sent LSB first with one kept MSB first
+static bool simnet_eui_equal (const uint8_t *lsb_first, const uint8_t *msb_first) {
+    for (int i = 0; i < 8; i++) {
+        if (lsb_first[i] != msb_first[7 - i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void simnet_join (sim_device_t *dev, const sim_frame_t *frame) {
+    const uint8_t *buf = frame->data;
+    if (frame->len != 23) {
+        return;
+    }
+    simnet_device_t *nd = NULL;
+    uint32_t index;
+    for (index = 0; index < simnet_devices_size; index++) {
+        if (simnet_devices[index] && simnet_eui_equal(buf + 9, simnet_devices[index]->dev_eui) &&
+            simnet_eui_equal(buf + 1, simnet_devices[index]->app_eui)) {
+            nd = simnet_devices[index];
+            break;
+        }
+    }
+    if (!nd) {
+        return;
+    }
+    nd->join_requests++;
+    if (simnet_mic(nd->app_key, NULL, buf, 19) != simnet_get_le(buf + 19, 4)) {
+        nd->mic_errors++;
+        return;
+    }
+    uint16_t dev_nonce = simnet_get_le(buf + 17, 2);
+
+    // MHDR | AppNonce | NetID | DevAddr | DLSettings | RxDelay | MIC
+    uint8_t accept[17];
+    accept[0] = SIMNET_MTYPE_JOIN_ACCEPT << 5;
+    simnet_put_le(accept + 1, sim_random(&simnet_rng), 3);
+    simnet_put_le(accept + 4, SIMNET_NET_ID, 3);
+    simnet_put_le(accept + 7, SIMNET_DEVADDR_BASE + index, 4);
+    accept[11] = simnet_region ? simnet_region->rx2_dr : 0;
+    accept[12] = SIMNET_RECEIVE_DELAY1 / 1000;
+    simnet_put_le(accept + 13, simnet_mic(nd->app_key, NULL, accept, 13), 4);
+
+    nd->joined = true;
+    nd->dev_addr = SIMNET_DEVADDR_BASE + index;
+    simnet_session_keys(nd, accept + 1, dev_nonce);
+    nd->fcnt_up = 0;
+    nd->fcnt_down = 0;
+    nd->snr_count = 0;
+    nd->tx_power = 0;
+    nd->adr_sent = false;
+    nd->adr_ans = 0;
+    nd->joins++;
+
+    // the device decrypts with the cipher, so the server encrypts with the inverse
+    uint8_t plain[16];
+    memcpy(plain, accept + 1, 16);
+    simnet_aes(nd->app_key, plain, accept + 1, false);
+
+    if (!simnet_cfg.mute) {
+        nd->downlinks++;
+        sim_downlink(dev, 1, frame->end + SIMNET_JOIN_ACCEPT_DELAY1, accept, sizeof(accept));
+    }
+}
+
+// the usual ADR algorithm, adds a LinkADRReq when the settings should change
+static uint8_t simnet_adr (simnet_device_t *nd, const sim_frame_t *frame, uint8_t *fopts) {
+    if (!simnet_region || nd->snr_count < SIMNET_ADR_HISTORY) {
+        return 0;
+    }
+    float snr_max = nd->snr_history[0];
+    for (uint32_t i = 1; i < SIMNET_ADR_HISTORY; i++) {
+        snr_max = (nd->snr_history[i] > snr_max) ? nd->snr_history[i] : snr_max;
+    }
+    int steps = (int)floorf((snr_max - sim_required_snr(frame->sf) - SIMNET_ADR_MARGIN) / 3);
+    int8_t dr = nd->dr;
+    uint8_t power = nd->tx_power;
+    while (steps > 0 && dr < simnet_region->dr_max) {
+        dr++;
+        steps--;
+    }
+    while (steps > 0 && power < simnet_region->power_max) {
+        power++;
+        steps--;
+    }
+    while (steps < 0 && power > 0) {
+        power--;
+        steps++;
+    }
+    nd->snr_count = 0;
+    if (dr == nd->dr && power == nd->tx_power) {
+        return 0;
+    }
+    fopts[0] = SIMNET_CID_LINK_ADR;
+    fopts[1] = (dr << 4) | power;
+    simnet_put_le(fopts + 2, simnet_region->ch_mask, 2);
+    fopts[4] = (simnet_region->ch_mask_cntl << 4) | 1;
+    nd->adr_sent = true;
+    nd->adr_power = power;
+    return 5;
+}
+
+// returns false on unknown commands, which end the parsing
+static bool simnet_mac_command (simnet_device_t *nd, const sim_frame_t *frame, const uint8_t **cmd, const uint8_t *end,
+                                uint8_t *fopts, uint8_t *fopts_len) {
+    const uint8_t *p = *cmd;
+    switch (*p++) {
+    case SIMNET_CID_LINK_CHECK:
+        if (*fopts_len + 3 <= SIMNET_FOPTS_MAX) {
+            float margin = frame->snr - sim_required_snr(frame->sf);
+            fopts[(*fopts_len)++] = SIMNET_CID_LINK_CHECK;
+            fopts[(*fopts_len)++] = (margin > 0) ? (uint8_t)margin : 0;
+            fopts[(*fopts_len)++] = 1;
+        }
+        break;
+    case SIMNET_CID_LINK_ADR:
+        if (p < end) {
+            nd->adr_ans = *p++;
+            if (nd->adr_sent && nd->adr_ans == 0x07) {
+                nd->tx_power = nd->adr_power;
+            }
+            nd->adr_sent = false;
+        }
+        break;
+    case 0x04: // DutyCycleAns
+    case 0x08: // RXTimingSetupAns
+    case 0x09: // TxParamSetupAns
+        break;
+    case 0x05: // RXParamSetupAns
+    case 0x07: // NewChannelAns
+    case 0x0A: // DlChannelAns
+        p += 1;
+        break;
+    case 0x06: // DevStatusAns
+        p += 2;
+        break;
+    default:
+        return false;
+    }
+    *cmd = p;
+    return p <= end;
+}
+
+static void simnet_data (sim_device_t *dev, const sim_frame_t *frame, bool confirmed) {
+    const uint8_t *buf = frame->data;
+    if (frame->len < 12) {
+        return;
+    }
+    uint32_t dev_addr = simnet_get_le(buf + 1, 4);
+    simnet_device_t *nd = simnet_device_get(dev_addr - SIMNET_DEVADDR_BASE);
+    if (!nd || !nd->joined || nd->dev_addr != dev_addr) {
+        return;
+    }
+    uint8_t fctrl = buf[5];
+    uint8_t fopts_len = fctrl & 0x0F;
+    if (8 + fopts_len + 4 > frame->len) {
+        return;
+    }
+
+    // recover the 32 bit counter
+    uint32_t fcnt = (nd->fcnt_up & 0xFFFF0000) | simnet_get_le(buf + 6, 2);
+    if (fcnt < nd->fcnt_up) {
+        fcnt += 0x10000;
+    }
+    if (simnet_data_mic(nd->nwk_skey, buf, frame->len - 4, 0, dev_addr, fcnt) != simnet_get_le(buf + frame->len - 4, 4)) {
+        nd->mic_errors++;
+        return;
+    }
+    if (fcnt < nd->fcnt_up) {
+        nd->replays++;
+        return;
+    }
+    if (fcnt > nd->fcnt_up && nd->uplinks > 0) {
+        nd->fcnt_gaps++;
+    }
+    nd->fcnt_up = fcnt + 1;
+    nd->uplinks++;
+
+    // the reply
+    uint8_t fopts[SIMNET_FOPTS_MAX];
+    uint8_t reply_len = 0;
+    bool reply = confirmed;
+
+    // the MAC commands, in the header or on port 0
+    const uint8_t *cmd = buf + 8;
+    const uint8_t *end = buf + 8 + fopts_len;
+    uint8_t plain[SIM_FRAME_SIZE_MAX];
+    uint32_t payload_at = 8 + fopts_len;
+    nd->payload_len = 0;
+    if (payload_at + 4 < frame->len) {
+        uint8_t len = frame->len - 4 - payload_at - 1;
+        nd->port = buf[payload_at];
+        simnet_crypt((nd->port == 0) ? nd->nwk_skey : nd->app_skey, buf + payload_at + 1, plain, len, 0, dev_addr, fcnt);
+        if (nd->port == 0) {
+            cmd = plain;
+            end = plain + len;
+        } else {
+            memcpy(nd->payload, plain, len);
+            nd->payload_len = len;
+        }
+    }
+    while (cmd < end && simnet_mac_command(nd, frame, &cmd, end, fopts, &reply_len)) {
+    }
+    reply |= (reply_len > 0);
+
+    if (fctrl & SIMNET_FCTRL_ADR_ACK_REQ) {
+        nd->uplinks_adr_ack_req++;
+        reply = true;
+    }
+    int8_t dr = simnet_datarate(frame->sf, frame->bw);
+    if ((fctrl & SIMNET_FCTRL_ADR) && dr >= 0) {
+        nd->dr = dr;
+        if (nd->snr_count == SIMNET_ADR_HISTORY) {
+            // no answer to the last LinkADRReq in all that time, try again
+            nd->adr_sent = false;
+            memmove(nd->snr_history, nd->snr_history + 1, sizeof(float) * (SIMNET_ADR_HISTORY - 1));
+            nd->snr_count--;
+        }
+        nd->snr_history[nd->snr_count++] = frame->snr;
+        if (simnet_cfg.adr && !nd->adr_sent && reply_len + 5 <= SIMNET_FOPTS_MAX) {
+            uint8_t len = simnet_adr(nd, frame, fopts + reply_len);
+            reply_len += len;
+            reply |= (len > 0);
+        }
+    }
+    if (!reply || simnet_cfg.mute) {
+        return;
+    }
+
+    // MHDR | DevAddr | FCtrl | FCnt | FOpts | MIC
+    uint8_t down[8 + SIMNET_FOPTS_MAX + 4];
+    down[0] = SIMNET_MTYPE_UNCONFIRMED_DOWN << 5;
+    simnet_put_le(down + 1, dev_addr, 4);
+    down[5] = (simnet_cfg.adr ? SIMNET_FCTRL_ADR : 0) | (confirmed ? SIMNET_FCTRL_ACK : 0) | reply_len;
+    simnet_put_le(down + 6, nd->fcnt_down, 2);
+    memcpy(down + 8, fopts, reply_len);
+    simnet_put_le(down + 8 + reply_len, simnet_data_mic(nd->nwk_skey, down, 8 + reply_len, 1, dev_addr, nd->fcnt_down), 4);
+    nd->fcnt_down++;
+    nd->downlinks++;
+    sim_downlink(dev, 1, frame->end + SIMNET_RECEIVE_DELAY1, down, 8 + reply_len + 4);
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void simnet_init (const simnet_config_t *config) {
+    simnet_cfg = *config;
+    simnet_region = NULL;
+    for (uint32_t i = 0; i < sizeof(simnet_regions) / sizeof(simnet_regions[0]); i++) {
+        if (simnet_regions[i].region == config->region) {
+            simnet_region = &simnet_regions[i];
+        }
+    }
+    if (!simnet_region) {
+        // ADR needs the data rate table of the region
+        simnet_cfg.adr = false;
+    }
+    simnet_devices_size = 0;
+    simnet_devices = NULL;
+}
+
+void simnet_deinit (void) {
+    for (uint32_t i = 0; i < simnet_devices_size; i++) {
+        free(simnet_devices[i]);
+    }
+    free(simnet_devices);
+    simnet_devices = NULL;
+    simnet_devices_size = 0;
+}
+
+simnet_config_t *simnet_config (void) {
+    return &simnet_cfg;
+}
+
+simnet_device_t *simnet_device_add (uint32_t index, const uint8_t *dev_eui, const uint8_t *app_eui, const uint8_t *app_key) {
+    if (index >= SIMNET_DEVICES_MAX) {
+        return NULL;
+    }
+    if (index >= simnet_devices_size) {
+        uint32_t size = (index + 1) * 2;
+        simnet_devices = realloc(simnet_devices, size * sizeof(simnet_device_t *));
+        memset(simnet_devices + simnet_devices_size, 0, (size - simnet_devices_size) * sizeof(simnet_device_t *));
+        simnet_devices_size = size;
+    }
+    simnet_device_t *nd = simnet_devices[index];
+    if (!nd) {
+        nd = simnet_devices[index] = calloc(1, sizeof(simnet_device_t));
+    }
+    memcpy(nd->dev_eui, dev_eui, 8);
+    memcpy(nd->app_eui, app_eui, 8);
+    memcpy(nd->app_key, app_key, 16);
+    return nd;
+}
+
+simnet_device_t *simnet_device_get (uint32_t index) {
+    return (index < simnet_devices_size) ? simnet_devices[index] : NULL;
+}
+
+void simnet_uplink (sim_device_t *dev, const sim_frame_t *frame) {
+    if (!frame->received || frame->len < 1) {
+        return;
+    }
+    switch (frame->data[0] >> 5) {
+    case SIMNET_MTYPE_JOIN_REQUEST:
+        simnet_join(dev, frame);
+        break;
+    case SIMNET_MTYPE_UNCONFIRMED_UP:
+        simnet_data(dev, frame, false);
+        break;
+    case SIMNET_MTYPE_CONFIRMED_UP:
+        simnet_data(dev, frame, true);
+        break;
+    default:
+        break;
+    }
+}
+
+int8_t simnet_datarate (uint8_t sf, uint8_t bw) {
+    if (!simnet_region) {
+        return -1;
+    }
+    if (bw == 0 && sf >= simnet_region->sf_min && sf <= simnet_region->sf_dr0) {
+        return simnet_region->sf_dr0 - sf;
+    }
+    if (bw == simnet_region->wide_bw && sf == simnet_region->wide_sf) {
+        return simnet_region->wide_dr;
+    }
+    return -1;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef SIMNET_H_
+#define SIMNET_H_
+
+// A minimal LoRaWAN 1.0.2 network server for the simulator, behind a single
+// gateway: OTAA joins, frame counter and MIC checks, payload decryption,
+// acknowledgements, LinkCheckAns and the usual ADR algorithm (the best SNR of
+// the last SIMNET_ADR_HISTORY uplinks against the demodulation floor of the
+// data rate, with a SIMNET_ADR_MARGIN dB installation margin). All the
+// downlinks go out in the RX1 window.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "simradio.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define SIMNET_ADR_HISTORY                  (20)
+#define SIMNET_ADR_MARGIN                   (10.0f)
+#define SIMNET_NET_ID                       (0x000013)
+#define SIMNET_DEVADDR_BASE                 (0x26000000)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    LoRaMacRegion_t     region;
+    bool                adr;                // send LinkADRReq
+    bool                mute;               // no downlinks at all
+} simnet_config_t;
+
+typedef struct {
+    uint8_t             dev_eui[8];
+    uint8_t             app_eui[8];
+    uint8_t             app_key[16];
+
+    // session
+    bool                joined;
+    uint32_t            dev_addr;
+    uint8_t             nwk_skey[16];
+    uint8_t             app_skey[16];
+    uint32_t            fcnt_up;
+    uint32_t            fcnt_down;
+
+    // ADR
+    float               snr_history[SIMNET_ADR_HISTORY];
+    uint8_t             snr_count;
+    uint8_t             dr;
+    uint8_t             tx_power;           // as last acknowledged
+    uint8_t             adr_power;          // as last requested
+    bool                adr_sent;
+    uint8_t             adr_ans;            // status of the last LinkADRAns, 0 when none
+
+    // counters
+    uint32_t            join_requests;
+    uint32_t            joins;
+    uint32_t            uplinks;
+    uint32_t            uplinks_adr_ack_req;
+    uint32_t            mic_errors;
+    uint32_t            replays;
+    uint32_t            fcnt_gaps;
+    uint32_t            downlinks;
+
+    // the last application payload received
+    uint8_t             port;
+    uint8_t             payload[SIM_FRAME_SIZE_MAX];
+    uint8_t             payload_len;
+} simnet_device_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern void simnet_init (const simnet_config_t *config);
+extern void simnet_deinit (void);
+extern simnet_config_t *simnet_config (void);
+
+// registers a device that may join, with its EUIs and key MSB first (as the
+// lora module takes them)
+extern simnet_device_t *simnet_device_add (uint32_t index, const uint8_t *dev_eui, const uint8_t *app_eui, const uint8_t *app_key);
+extern simnet_device_t *simnet_device_get (uint32_t index);
+
+// called for every frame the gateway hears, schedules the reply
+extern void simnet_uplink (sim_device_t *dev, const sim_frame_t *frame);
+
+// the data rate of an uplink with the given modulation, -1 when unknown
+extern int8_t simnet_datarate (uint8_t sf, uint8_t bw);
+
+#endif /* SIMNET_H_ */
@@ -0,0 +1,634 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// The virtual radio, timer-board and board support of the simulator, plus
+// the event loop driving them (see simradio.h).
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "simradio.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define SIM_EVENT_TX_DONE                   (1)
+#define SIM_EVENT_RX_DONE                   (2)
+#define SIM_EVENT_RX_TIMEOUT                (3)
+
+#define SIM_DEVICES_INIT                    (64)
+
+// as in timer-board.c
+#define HW_TIMER_TIME_BASE                  (1)
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// the MAC state section, see the Makefile
+extern uint8_t __start_loramac_state[];
+extern uint8_t __stop_loramac_state[];
+
+static uint8_t *sim_pristine;
+static sim_device_t **sim_devices;
+static uint32_t sim_devices_count;
+static uint32_t sim_devices_size;
+static sim_device_t *sim_current;
+static TimerTime_t sim_time = 1;
+static uint32_t sim_rng;
+static sim_uplink_hook_t sim_uplink;
+static sim_stats_t sim_stat;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static uint64_t sim_clock_ns (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t sim_symbol_us (const sim_radio_config_t *config) {
+    return ((uint32_t)1000000 << config->sf) / (125000 << config->bw);
+}
+
+static void sim_radio_schedule (sim_device_t *dev, uint8_t event, TimerTime_t at) {
+    dev->radio_event = event;
+    dev->radio_at = at;
+}
+
+static void sim_radio_cancel (sim_device_t *dev) {
+    dev->radio_at = 0;
+    dev->radio_event = 0;
+}
+
+// the frames of other devices overlapping this one at the gateway
+static bool sim_collides (sim_device_t *dev) {
+    for (uint32_t i = 0; i < sim_devices_count; i++) {
+        sim_device_t *other = sim_devices[i];
+        if (other != dev && other->tx_len > 0 && other->tx_freq == dev->tx_freq && other->tx_sf == dev->tx_sf &&
+            other->tx_start < dev->tx_end && other->tx_end > dev->tx_start) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sim_tx_done (sim_device_t *dev) {
+    sim_frame_t frame = {
+        .data = dev->tx_buf, .len = dev->tx_len, .freq = dev->tx_freq, .sf = dev->tx_sf, .bw = dev->tx.bw,
+        .power = dev->tx.power, .start = dev->tx_start, .end = dev->tx_end,
+    };
+    // the SNR at the gateway follows the TX power
+    if (dev->tx.power > dev->power_max) {
+        dev->power_max = dev->tx.power;
+    }
+    frame.snr = dev->snr - (dev->power_max - dev->tx.power);
+    frame.rssi = -120 + frame.snr;
+    frame.collided = sim_collides(dev);
+    frame.received = !frame.collided && (dev->tx.modem == MODEM_FSK || frame.snr >= sim_required_snr(frame.sf));
+
+    sim_stat.uplinks++;
+    if (frame.collided) {
+        sim_stat.uplinks_collided++;
+    } else if (!frame.received) {
+        sim_stat.uplinks_weak++;
+    } else {
+        sim_stat.uplinks_received++;
+    }
+    dev->rx_window = 0;
+    dev->dl_window = 0;
+    if (sim_uplink) {
+        uint64_t start = sim_clock_ns();
+        sim_uplink(dev, &frame);
+        sim_stat.hook_ns += sim_clock_ns() - start;
+    }
+}
+
+static void sim_timer_irq (sim_device_t *dev) {
+    TimerIrqHandler();
+    // like the LoRa timer task does
+    for (uint32_t i = 0; i < dev->cb_count; i++) {
+        dev->cb_queue[i]();
+    }
+    dev->cb_count = 0;
+}
+
+static void sim_radio_event (sim_device_t *dev) {
+    uint8_t event = dev->radio_event;
+    sim_radio_cancel(dev);
+    dev->state = RF_IDLE;
+    switch (event) {
+    case SIM_EVENT_TX_DONE:
+        if (dev->events && dev->events->TxDone) {
+            dev->events->TxDone();
+        }
+        break;
+    case SIM_EVENT_RX_DONE:
+        sim_stat.downlinks_received++;
+        if (dev->events && dev->events->RxDone) {
+            int8_t snr = (int8_t)dev->snr;
+            dev->events->RxDone(dev->dl_buf, sim_time * 1000, dev->dl_len, -120 + snr, snr, dev->rx.sf);
+        }
+        break;
+    case SIM_EVENT_RX_TIMEOUT:
+        if (dev->events && dev->events->RxTimeout) {
+            dev->events->RxTimeout();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void sim_init (uint32_t seed, sim_uplink_hook_t uplink) {
+    if (!sim_pristine) {
+        // the image every device starts from
+        uint32_t size = sim_mac_state_size();
+        sim_pristine = malloc(size);
+        memcpy(sim_pristine, __start_loramac_state, size);
+    }
+    sim_devices_size = SIM_DEVICES_INIT;
+    sim_devices = malloc(sim_devices_size * sizeof(sim_device_t *));
+    sim_devices_count = 0;
+    sim_current = NULL;
+    sim_time = 1;
+    sim_rng = seed ? seed : 1;
+    sim_uplink = uplink;
+    memset(&sim_stat, 0, sizeof(sim_stat));
+}
+
+void sim_deinit (void) {
+    while (sim_devices_count > 0) {
+        sim_device_free(sim_devices[0]);
+    }
+    free(sim_devices);
+    sim_devices = NULL;
+    sim_devices_size = 0;
+}
+
+sim_device_t *sim_device_new (uint32_t index, float snr, void *user) {
+    sim_device_t *dev = calloc(1, sizeof(sim_device_t));
+    dev->index = index;
+    dev->user = user;
+    dev->snr = snr;
+    dev->power_max = INT8_MIN;
+    dev->rng = sim_random(&sim_rng) | 1;
+    dev->mac_state = malloc(sim_mac_state_size());
+    memcpy(dev->mac_state, sim_pristine, sim_mac_state_size());
+    if (sim_devices_count == sim_devices_size) {
+        sim_devices_size *= 2;
+        sim_devices = realloc(sim_devices, sim_devices_size * sizeof(sim_device_t *));
+    }
+    sim_devices[sim_devices_count++] = dev;
+    return dev;
+}
+
+void sim_device_free (sim_device_t *dev) {
+    if (sim_current == dev) {
+        sim_current = NULL;
+    }
+    for (uint32_t i = 0; i < sim_devices_count; i++) {
+        if (sim_devices[i] == dev) {
+            sim_devices[i] = sim_devices[--sim_devices_count];
+            break;
+        }
+    }
+    free(dev->mac_state);
+    free(dev);
+}
+
+void sim_device_enter (sim_device_t *dev) {
+    if (dev != sim_current) {
+        uint64_t start = sim_clock_ns();
+        uint32_t size = sim_mac_state_size();
+        if (sim_current) {
+            memcpy(sim_current->mac_state, __start_loramac_state, size);
+        }
+        memcpy(__start_loramac_state, dev->mac_state, size);
+        sim_current = dev;
+        sim_stat.switches++;
+        sim_stat.switch_ns += sim_clock_ns() - start;
+    }
+}
+
+sim_device_t *sim_device_current (void) {
+    return sim_current;
+}
+
+void sim_device_call (sim_device_t *dev, void (*fn) (void *arg), void *arg) {
+    sim_device_enter(dev);
+    uint64_t start = sim_clock_ns();
+    uint64_t hook_ns = sim_stat.hook_ns;
+    fn(arg);
+    sim_stat.mac_ns += sim_clock_ns() - start - (sim_stat.hook_ns - hook_ns);
+}
+
+void sim_downlink (sim_device_t *dev, uint8_t window, TimerTime_t start, const uint8_t *data, uint8_t len) {
+    memcpy(dev->dl_buf, data, len);
+    dev->dl_len = len;
+    dev->dl_window = window;
+    dev->dl_start = start;
+    sim_stat.downlinks++;
+}
+
+void sim_run (TimerTime_t until) {
+    for ( ; ; ) {
+        // the device with the earliest event, radio events first
+        sim_device_t *next = NULL;
+        TimerTime_t at = 0;
+        bool radio = false;
+        for (uint32_t i = 0; i < sim_devices_count; i++) {
+            sim_device_t *dev = sim_devices[i];
+            if (dev->radio_at && (!next || dev->radio_at < at || (dev->radio_at == at && !radio))) {
+                next = dev;
+                at = dev->radio_at;
+                radio = true;
+            }
+            if (dev->alarm && (!next || dev->alarm < at)) {
+                next = dev;
+                at = dev->alarm;
+                radio = false;
+            }
+        }
+        if (!next || at > until) {
+            sim_time = until;
+            return;
+        }
+        if (at > sim_time) {
+            sim_time = at;
+        }
+        sim_stat.events++;
+        sim_device_enter(next);
+
+        uint64_t start = sim_clock_ns();
+        uint64_t hook_ns = sim_stat.hook_ns;
+        if (radio) {
+            if (next->radio_event == SIM_EVENT_TX_DONE) {
+                sim_tx_done(next);
+            }
+            sim_radio_event(next);
+        } else {
+            next->alarm = 0;
+            sim_timer_irq(next);
+        }
+        sim_stat.mac_ns += sim_clock_ns() - start - (sim_stat.hook_ns - hook_ns);
+    }
+}
+
+TimerTime_t sim_now (void) {
+    return sim_time;
+}
+
+const sim_stats_t *sim_stats (void) {
+    return &sim_stat;
+}
+
+uint32_t sim_mac_state_size (void) {
+    return __stop_loramac_state - __start_loramac_state;
+}
+
+uint32_t sim_time_on_air (const sim_radio_config_t *config, uint8_t len) {
+    if (config->modem == MODEM_FSK) {
+        // preamble, sync word, length, payload and CRC
+        return ((config->preamble + 3 + 1 + len + (config->crc ? 2 : 0)) * 8 * 1000 + config->fsk_datarate - 1) / config->fsk_datarate;
+    }
+    double ts = (double)(1 << config->sf) / (125000 << config->bw);
+    bool ldro = (config->bw == 0 && config->sf >= 11) || (config->bw == 1 && config->sf == 12);
+    double t_preamble = (config->preamble + 4.25) * ts;
+    double tmp = ceil((8 * len - 4 * config->sf + 28 + 16 * config->crc - (config->fix_len ? 20 : 0)) /
+                      (double)(4 * (config->sf - (ldro ? 2 : 0)))) * (config->cr + 4);
+    double n_payload = 8 + ((tmp > 0) ? tmp : 0);
+    return floor((t_preamble + n_payload * ts) * 1000 + 0.999);
+}
+
+float sim_required_snr (uint8_t sf) {
+    // demodulator floor of the SX127x
+    static const float snr[] = { -5.0, -7.5, -10.0, -12.5, -15.0, -17.5, -20.0 };
+    return (sf >= 6 && sf <= 12) ? snr[sf - 6] : 0;
+}
+
+uint32_t sim_random (uint32_t *state) {
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/******************************************************************************
+ THE VIRTUAL RADIO
+ ******************************************************************************/
+static void SimRadioInit (RadioEvents_t *events) {
+    sim_current->events = events;
+    sim_current->state = RF_IDLE;
+}
+
+static RadioState_t SimRadioGetStatus (void) {
+    return sim_current->state;
+}
+
+static void SimRadioSetModem (RadioModems_t modem) {
+    sim_current->tx.modem = modem;
+    sim_current->rx.modem = modem;
+}
+
+static void SimRadioSetChannel (uint32_t freq) {
+    sim_current->freq = freq;
+}
+
+static uint32_t SimRadioGetChannel (void) {
+    return sim_current->freq;
+}
+
+static bool SimRadioIsChannelFree (RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime) {
+    return true;
+}
+
+static uint32_t SimRadioRandom (void) {
+    return sim_random(&sim_current->rng);
+}
+
+static void SimRadioSetRxConfig (RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                 uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                 uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, bool rxContinuous) {
+    sim_radio_config_t *rx = &sim_current->rx;
+    rx->modem = modem;
+    if (modem == MODEM_FSK) {
+        rx->sf = 0;
+        rx->fsk_datarate = datarate;
+    } else {
+        rx->sf = datarate;
+        rx->bw = bandwidth;
+    }
+    rx->cr = coderate;
+    rx->preamble = preambleLen;
+    rx->symb_timeout = symbTimeout;
+    rx->fix_len = fixLen;
+    rx->crc = crcOn;
+    rx->continuous = rxContinuous;
+}
+
+static void SimRadioSetTxConfig (RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout) {
+    sim_radio_config_t *tx = &sim_current->tx;
+    tx->modem = modem;
+    tx->power = power;
+    if (modem == MODEM_FSK) {
+        tx->sf = 0;
+        tx->fsk_datarate = datarate;
+    } else {
+        tx->sf = datarate;
+        tx->bw = bandwidth;
+    }
+    tx->cr = coderate;
+    tx->preamble = preambleLen;
+    tx->fix_len = fixLen;
+    tx->crc = crcOn;
+}
+
+static bool SimRadioCheckRfFrequency (uint32_t frequency) {
+    return true;
+}
+
+static uint32_t SimRadioTimeOnAir (RadioModems_t modem, uint8_t pktLen) {
+    return sim_time_on_air(&sim_current->tx, pktLen);
+}
+
+static void SimRadioSend (uint8_t *buffer, uint8_t size) {
+    sim_device_t *dev = sim_current;
+    memcpy(dev->tx_buf, buffer, size);
+    dev->tx_len = size;
+    dev->tx_freq = dev->freq;
+    dev->tx_sf = dev->tx.sf;
+    dev->tx_start = sim_time;
+    dev->tx_end = sim_time + sim_time_on_air(&dev->tx, size);
+    dev->state = RF_TX_RUNNING;
+    sim_radio_schedule(dev, SIM_EVENT_TX_DONE, dev->tx_end);
+}
+
+static void SimRadioSleep (void) {
+    sim_radio_cancel(sim_current);
+    sim_current->state = RF_IDLE;
+}
+
+static void SimRadioStandby (void) {
+    sim_radio_cancel(sim_current);
+    sim_current->state = RF_IDLE;
+}
+
+// A downlink is received when the receiver is on for part of its preamble and
+// early enough to still catch SIM_PREAMBLE_DETECT_SYMBOLS symbols of it;
+// otherwise a single reception times out after the configured symbols.
+static void SimRadioRx (uint32_t timeout) {
+    sim_device_t *dev = sim_current;
+    dev->state = RF_RX_RUNNING;
+    dev->rx_window++;
+    if (dev->dl_window > 0 && dev->dl_window < dev->rx_window) {
+        // the window it was meant for did not hear it
+        dev->dl_window = 0;
+        sim_stat.downlinks_missed++;
+    }
+
+    uint32_t symbol_us = sim_symbol_us(&dev->rx);
+    uint64_t open_us = (uint64_t)sim_time * 1000;
+    uint64_t close_us = open_us + (uint64_t)dev->rx.symb_timeout * symbol_us;
+    if (dev->dl_window == dev->rx_window) {
+        uint64_t dl_us = (uint64_t)dev->dl_start * 1000;
+        uint32_t preamble = (dev->rx.preamble > SIM_PREAMBLE_DETECT_SYMBOLS) ? dev->rx.preamble : SIM_PREAMBLE_DETECT_SYMBOLS;
+        if (open_us <= dl_us + (uint64_t)(preamble - SIM_PREAMBLE_DETECT_SYMBOLS) * symbol_us &&
+            (dev->rx.continuous || close_us >= dl_us + symbol_us)) {
+            sim_radio_schedule(dev, SIM_EVENT_RX_DONE, dev->dl_start + sim_time_on_air(&dev->rx, dev->dl_len));
+            dev->dl_window = 0;
+            return;
+        }
+        dev->dl_window = 0;
+        sim_stat.downlinks_missed++;
+    }
+    if (!dev->rx.continuous) {
+        TimerTime_t at = (close_us + 999) / 1000;
+        sim_radio_schedule(dev, SIM_EVENT_RX_TIMEOUT, (at > sim_time) ? at : sim_time + 1);
+    }
+}
+
+static void SimRadioStartCad (void) {
+}
+
+static void SimRadioSetTxContinuousWave (uint32_t freq, int8_t power, uint16_t time) {
+}
+
+static int16_t SimRadioRssi (RadioModems_t modem) {
+    return -120;
+}
+
+static void SimRadioWrite (uint8_t addr, uint8_t data) {
+}
+
+static uint8_t SimRadioRead (uint8_t addr) {
+    return 0;
+}
+
+static void SimRadioWriteBuffer (uint8_t addr, uint8_t *buffer, uint8_t size) {
+}
+
+static void SimRadioReadBuffer (uint8_t addr, uint8_t *buffer, uint8_t size) {
+}
+
+static void SimRadioSetMaxPayloadLength (RadioModems_t modem, uint8_t max) {
+}
+
+static void SimRadioSetPublicNetwork (bool enable) {
+}
+
+static void SimRadioReset (void) {
+}
+
+const struct Radio_s Radio = {
+    SimRadioInit,
+    SimRadioGetStatus,
+    SimRadioSetModem,
+    SimRadioSetChannel,
+    SimRadioGetChannel,
+    SimRadioIsChannelFree,
+    SimRadioRandom,
+    SimRadioSetRxConfig,
+    SimRadioSetTxConfig,
+    SimRadioCheckRfFrequency,
+    SimRadioTimeOnAir,
+    SimRadioSend,
+    SimRadioSleep,
+    SimRadioStandby,
+    SimRadioRx,
+    SimRadioStartCad,
+    SimRadioSetTxContinuousWave,
+    SimRadioRssi,
+    SimRadioWrite,
+    SimRadioRead,
+    SimRadioWriteBuffer,
+    SimRadioReadBuffer,
+    SimRadioSetMaxPayloadLength,
+    SimRadioSetPublicNetwork,
+    SimRadioReset,
+};
+
+/******************************************************************************
+ THE VIRTUAL TIMER, same behaviour as timer-board.c on the simulated tick
+ ******************************************************************************/
+void TimerHwInit (void) {
+}
+
+void TimerHwDeInit (void) {
+}
+
+uint32_t TimerHwGetMinimumTimeout (void) {
+    return HW_TIMER_TIME_BASE;
+}
+
+void TimerHwStart (uint32_t val) {
+    sim_device_t *dev = sim_current;
+    dev->timer_context = sim_time;
+    if (val <= HW_TIMER_TIME_BASE) {
+        dev->alarm = dev->timer_context + (HW_TIMER_TIME_BASE * 2);
+    } else {
+        dev->alarm = dev->timer_context + val;
+    }
+}
+
+void TimerHwStop (void) {
+}
+
+void TimerHwDelayMs (uint32_t delay) {
+}
+
+TimerTime_t TimerHwGetTimerValue (void) {
+    return sim_time;
+}
+
+TimerTime_t TimerHwGetTime (void) {
+    return TimerHwGetTimerValue() * HW_TIMER_TIME_BASE;
+}
+
+TimerTime_t TimerHwGetElapsedTime (void) {
+    return ((TimerHwGetTimerValue() - sim_current->timer_context) + 1) * HW_TIMER_TIME_BASE;
+}
+
+TimerTime_t TimerHwComputeTimeDifference (TimerTime_t eventInTime) {
+    TimerTime_t currTime = TimerHwGetTime();
+    if (eventInTime <= currTime) {
+        return currTime - eventInTime;
+    } else {
+        // roll over of the counter
+        return currTime + (0xFFFFFFFF - eventInTime);
+    }
+}
+
+void TimerHwEnterLowPowerStopMode (void) {
+}
+
+/******************************************************************************
+ BOARD AND MODLORA SUPPORT
+ ******************************************************************************/
+void BoardInitPeriph (void) {
+}
+
+void BoardInitMcu (void) {
+}
+
+void BoardDeInitMcu (void) {
+}
+
+uint32_t BoardGetRandomSeed (void) {
+    return sim_random(&sim_current->rng);
+}
+
+void BoardGetUniqueId (uint8_t *id) {
+    memset(id, 0, 8);
+    id[6] = sim_current->index >> 8;
+    id[7] = sim_current->index;
+}
+
+uint8_t BoardGetBatteryLevel (void) {
+    // external power
+    return 0;
+}
+
+void BoardSetBatteryLevel (uint8_t level) {
+}
+
+void modlora_set_timer_callback (modlora_timerCallback cb) {
+    sim_device_t *dev = sim_current;
+    if (cb != NULL && dev->cb_count < SIM_CB_QUEUE_SIZE_MAX) {
+        dev->cb_queue[dev->cb_count++] = cb;
+    }
+}
+
+// there is no NVRAM, LoRaMacNvsSave() is never called by the simulator
+bool modlora_nvs_set_uint (uint32_t key_idx, uint32_t value) {
+    return false;
+}
+
+bool modlora_nvs_set_blob (uint32_t key_idx, const void *value, uint32_t length) {
+    return false;
+}
+
+bool modlora_nvs_get_uint (uint32_t key_idx, uint32_t *value) {
+    return false;
+}
+
+bool modlora_nvs_get_blob (uint32_t key_idx, void *value, uint32_t *length) {
+    return false;
+}
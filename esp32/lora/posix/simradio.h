@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef SIMRADIO_H_
+#define SIMRADIO_H_
+
+// Discrete event simulation of LoRa end devices running the real LoRaWAN
+// stack of lib/lora. Time is virtual (milliseconds, like the device timer),
+// the SX127x is replaced by a virtual radio, and a simple channel model
+// decides which uplinks reach the gateway: a frame is lost when it overlaps
+// another one on the same frequency and spreading factor, or when the SNR of
+// the device link is below the demodulation floor of the spreading factor.
+//
+// The stack keeps all of its state in static variables, so the MAC objects
+// are linked with their .data and .bss gathered in a single section
+// (see the Makefile); each simulated device owns a copy of that section,
+// which is swapped in before the device runs.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "board.h"
+#include "modlora.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define SIM_CB_QUEUE_SIZE_MAX               (16)
+#define SIM_FRAME_SIZE_MAX                  (255)
+
+// the preamble symbols a receiver needs to lock on a frame
+#define SIM_PREAMBLE_DETECT_SYMBOLS         (4)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint8_t             modem;              // RadioModems_t
+    uint8_t             sf;                 // spreading factor, 0 for FSK
+    uint8_t             bw;                 // 0: 125 kHz, 1: 250 kHz, 2: 500 kHz
+    uint8_t             cr;                 // 1: 4/5 ... 4: 4/8
+    uint16_t            preamble;
+    uint16_t            symb_timeout;       // RX only
+    uint32_t            fsk_datarate;
+    int8_t              power;              // TX only, dBm
+    bool                crc;
+    bool                fix_len;
+    bool                continuous;         // RX only
+} sim_radio_config_t;
+
+typedef struct {
+    const uint8_t       *data;
+    uint8_t             len;
+    uint32_t            freq;
+    uint8_t             sf;
+    uint8_t             bw;
+    int8_t              power;
+    TimerTime_t         start;
+    TimerTime_t         end;
+    float               snr;
+    int16_t             rssi;
+    bool                collided;
+    bool                received;           // reached the gateway
+} sim_frame_t;
+
+typedef struct sim_device_s sim_device_t;
+
+typedef void (*sim_uplink_hook_t) (sim_device_t *dev, const sim_frame_t *frame);
+
+struct sim_device_s {
+    uint32_t            index;
+    void                *user;
+    uint8_t             *mac_state;         // the MAC image while switched out
+
+    // link to the gateway, the SNR at the highest TX power used so far
+    float               snr;
+    int8_t              power_max;
+
+    // timer-board
+    TimerTime_t         alarm;              // 0 when not armed
+    TimerTime_t         timer_context;
+    modlora_timerCallback cb_queue[SIM_CB_QUEUE_SIZE_MAX];
+    uint8_t             cb_count;
+
+    // radio
+    RadioEvents_t       *events;
+    RadioState_t        state;
+    uint32_t            freq;
+    sim_radio_config_t  tx;
+    sim_radio_config_t  rx;
+    TimerTime_t         radio_at;           // 0 when nothing is pending
+    uint8_t             radio_event;
+    uint8_t             rx_window;          // RX windows opened since the last TX done
+    uint32_t            rng;
+
+    // the frame on air, kept after TX done for the collision checks
+    uint8_t             tx_buf[SIM_FRAME_SIZE_MAX];
+    uint8_t             tx_len;
+    uint32_t            tx_freq;
+    uint8_t             tx_sf;
+    TimerTime_t         tx_start;
+    TimerTime_t         tx_end;
+
+    // downlink from the gateway
+    uint8_t             dl_buf[SIM_FRAME_SIZE_MAX];
+    uint8_t             dl_len;
+    uint8_t             dl_window;          // 0 when nothing is scheduled
+    TimerTime_t         dl_start;
+};
+
+typedef struct {
+    uint64_t            uplinks;
+    uint64_t            uplinks_received;
+    uint64_t            uplinks_collided;
+    uint64_t            uplinks_weak;
+    uint64_t            downlinks;
+    uint64_t            downlinks_received;
+    uint64_t            downlinks_missed;
+    uint64_t            events;
+    uint64_t            switches;
+    // CPU time spent in the stack (timer interrupts and callbacks, radio
+    // events, and whatever the users call through sim_device_call), in the
+    // uplink hook, and swapping MAC images
+    uint64_t            mac_ns;
+    uint64_t            hook_ns;
+    uint64_t            switch_ns;
+} sim_stats_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+// sim_init must be called before any of the stack code runs, sim_deinit frees
+// all the devices
+extern void sim_init (uint32_t seed, sim_uplink_hook_t uplink);
+extern void sim_deinit (void);
+extern sim_device_t *sim_device_new (uint32_t index, float snr, void *user);
+extern void sim_device_free (sim_device_t *dev);
+
+// loads the MAC image of the device, the stack then acts on its behalf
+extern void sim_device_enter (sim_device_t *dev);
+extern sim_device_t *sim_device_current (void);
+
+// runs fn on behalf of the device, accounting its time to the stack
+extern void sim_device_call (sim_device_t *dev, void (*fn) (void *arg), void *arg);
+
+// queues a frame for the device, on air from start on, to be received in its
+// n-th RX window after the uplink (1 or 2)
+extern void sim_downlink (sim_device_t *dev, uint8_t window, TimerTime_t start, const uint8_t *data, uint8_t len);
+
+// processes all events up to the given time
+extern void sim_run (TimerTime_t until);
+extern TimerTime_t sim_now (void);
+extern const sim_stats_t *sim_stats (void);
+extern uint32_t sim_mac_state_size (void);
+
+// time on air of a frame with the given configuration, as the SX127x driver
+// computes it
+extern uint32_t sim_time_on_air (const sim_radio_config_t *config, uint8_t len);
+extern float sim_required_snr (uint8_t sf);
+extern uint32_t sim_random (uint32_t *state);
+
+#endif /* SIMRADIO_H_ */
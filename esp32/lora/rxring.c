@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "rxring.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define RXRING_ALIGN(n)                         (((n) + 3) & ~3)
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// the head and the tail are published with release semantics, so that the
+// other core sees the packet (or the free space) before the index moving; the
+// producer side runs from the radio interrupt, hence in IRAM
+static inline IRAM_ATTR uint32_t rxring_load (const uint32_t *index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static inline IRAM_ATTR void rxring_store (uint32_t *index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+static IRAM_ATTR void rxring_header (rxring_t *ring, uint32_t pos, uint32_t len, uint8_t port) {
+    ring->buf[pos] = len;
+    ring->buf[pos + 1] = len >> 8;
+    ring->buf[pos + 2] = port;
+    ring->buf[pos + 3] = 0;
+}
+
+// honours the flushes the producer asked for, never moving the tail back
+static void rxring_sync (rxring_t *ring) {
+    uint32_t seq = rxring_load(&ring->flush_seq);
+    if (seq != ring->flush_seen) {
+        uint32_t flush_head = __atomic_load_n(&ring->flush_head, __ATOMIC_RELAXED);
+        ring->flush_seen = seq;
+        if ((int32_t)(flush_head - ring->tail) > 0) {
+            ring->offset = 0;
+            rxring_store(&ring->tail, flush_head);
+        }
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void rxring_init (rxring_t *ring, uint8_t *buf, uint32_t size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->buf = buf;
+    ring->size = size;
+}
+
+IRAM_ATTR bool rxring_put (rxring_t *ring, const uint8_t *data, uint32_t len, uint8_t port) {
+    uint32_t head = ring->head;
+    uint32_t tail = rxring_load(&ring->tail);
+    uint32_t need = RXRING_ALIGN(RXRING_HEADER_SIZE + len);
+    uint32_t pos = head & (ring->size - 1);
+    // the packet is kept in one piece
+    uint32_t skip = (ring->size - pos < need) ? ring->size - pos : 0;
+
+    if (len >= RXRING_WRAP || (head - tail) + skip + need > ring->size) {
+        ring->stats.dropped++;
+        return false;
+    }
+    if (skip) {
+        rxring_header(ring, pos, RXRING_WRAP, 0);
+        head += skip;
+        pos = 0;
+    }
+    rxring_header(ring, pos, len, port);
+    memcpy(&ring->buf[pos + RXRING_HEADER_SIZE], data, len);
+    head += need;
+    rxring_store(&ring->head, head);
+
+    ring->stats.received++;
+    if (head - tail > ring->stats.high_water) {
+        ring->stats.high_water = head - tail;
+    }
+    return true;
+}
+
+IRAM_ATTR void rxring_flush (rxring_t *ring) {
+    __atomic_store_n(&ring->flush_head, ring->head, __ATOMIC_RELAXED);
+    rxring_store(&ring->flush_seq, ring->flush_seq + 1);
+}
+
+int rxring_read (rxring_t *ring, uint8_t *buf, uint32_t len, uint8_t *port) {
+    uint32_t tail, pos, plen;
+
+    rxring_sync(ring);
+    for ( ; ; ) {
+        tail = ring->tail;
+        if (tail == rxring_load(&ring->head)) {
+            return -1;
+        }
+        pos = tail & (ring->size - 1);
+        plen = ring->buf[pos] | (ring->buf[pos + 1] << 8);
+        if (plen != RXRING_WRAP) {
+            break;
+        }
+        rxring_store(&ring->tail, tail + ring->size - pos);
+    }
+
+    uint32_t n = plen - ring->offset;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, &ring->buf[pos + RXRING_HEADER_SIZE + ring->offset], n);
+    if (port != NULL) {
+        *port = ring->buf[pos + 2];
+    }
+    if (ring->offset + n == plen) {
+        ring->offset = 0;
+        rxring_store(&ring->tail, tail + RXRING_ALIGN(RXRING_HEADER_SIZE + plen));
+    } else {
+        ring->offset += n;
+    }
+    return n;
+}
+
+bool rxring_empty (const rxring_t *ring) {
+    uint32_t tail = rxring_load(&ring->tail);
+    // as if a pending flush had been honoured already, without moving the tail
+    if (rxring_load(&ring->flush_seq) != ring->flush_seen) {
+        uint32_t flush_head = __atomic_load_n(&ring->flush_head, __ATOMIC_RELAXED);
+        if ((int32_t)(flush_head - tail) > 0) {
+            tail = flush_head;
+        }
+    }
+    return tail == rxring_load(&ring->head);
+}
+
+uint32_t rxring_used (const rxring_t *ring) {
+    return rxring_load(&ring->head) - rxring_load(&ring->tail);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef RXRING_H_
+#define RXRING_H_
+
+// A ring of received packets, each one taking its length and a 4 byte header
+// rounded up to 4 bytes, shared without locks by one producer (the radio
+// callbacks) and one consumer (the socket). The producer only moves the head
+// and the consumer only moves the tail; a packet that would straddle the end
+// of the buffer starts over at the beginning, behind a wrap marker. The
+// consumer may take a packet in several reads.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define RXRING_HEADER_SIZE                      (4)
+#define RXRING_WRAP                             (0xFFFF)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint32_t                received;           // packets
+    uint32_t                dropped;            // packets that found the ring full
+    uint32_t                high_water;         // most bytes ever in use
+} rxring_stats_t;
+
+typedef struct {
+    uint8_t                 *buf;
+    uint32_t                size;               // a power of 2
+    uint32_t                head;               // free running, written by the producer
+    uint32_t                tail;               // free running, written by the consumer
+    uint32_t                offset;             // consumer, into the packet at the tail
+    uint32_t                flush_head;         // where the last flush asked the tail to go
+    uint32_t                flush_seq;
+    uint32_t                flush_seen;         // consumer
+    rxring_stats_t          stats;              // producer
+} rxring_t;
+
+/******************************************************************************
+ DECLARE EXPORTED FUNCTIONS
+ ******************************************************************************/
+extern void rxring_init (rxring_t *ring, uint8_t *buf, uint32_t size);
+
+// producer side; false when the packet did not fit and was dropped
+extern bool rxring_put (rxring_t *ring, const uint8_t *data, uint32_t len, uint8_t port);
+
+// producer side; the consumer skips everything put so far on its next call
+extern void rxring_flush (rxring_t *ring);
+
+// consumer side; copies up to len bytes of the next packet, the rest of it
+// is left for the next read; returns the number of bytes or -1 when empty
+extern int rxring_read (rxring_t *ring, uint8_t *buf, uint32_t len, uint8_t *port);
+
+// either side, as a poll would ask
+extern bool rxring_empty (const rxring_t *ring);
+extern uint32_t rxring_used (const rxring_t *ring);         // bytes
+
+#endif /* RXRING_H_ */
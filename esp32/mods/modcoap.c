@@ -17,6 +17,7 @@
 #include "coap_list.h"
 
 #include "modcoap.h"
+#include "coap/coapres.h"
 #include "modnetwork.h"
 #include "modusocket.h"
 #include "lwipsocket.h"
@@ -35,6 +36,10 @@
 #define MODCOAP_REQUEST_PUT     (0x02)
 #define MODCOAP_REQUEST_POST    (0x04)
 #define MODCOAP_REQUEST_DELETE  (0x08)
+#define MODCOAP_NO_MEDIATYPE    ((uint8_t)-1)
+#define MODCOAP_NO_MAX_AGE      ((uint32_t)-1)
+#define MODCOAP_OBSERVE_REGISTER    (0)
+#define MODCOAP_OBSERVE_DEREGISTER  (1)
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -42,12 +47,12 @@
 typedef struct mod_coap_resource_obj_s {
     mp_obj_base_t base;
     coap_resource_t* coap_resource;
-    struct mod_coap_resource_obj_s* next;
     uint8_t* value;
     unsigned char* uri;
+    uint32_t value_len;
     uint32_t max_age;
+    coapres_opts_t opts;
     uint16_t etag_value;
-    uint16_t value_len;
     uint8_t mediatype;
     bool etag;
 }mod_coap_resource_obj_t;
@@ -56,7 +61,7 @@ typedef struct mod_coap_obj_s {
     mp_obj_base_t base;
     coap_context_t* context;
     mod_network_socket_obj_t* socket;
-    mod_coap_resource_obj_t* resources;
+    coapres_index_t resources;
     SemaphoreHandle_t semphr;
     mp_obj_t callback;
     coap_list_t *optlist;
@@ -69,10 +74,17 @@ typedef struct mod_coap_obj_s {
  ******************************************************************************/
 STATIC mod_coap_resource_obj_t* find_resource(coap_resource_t* resource);
 STATIC mod_coap_resource_obj_t* find_resource_by_key(coap_key_t key);
-STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag);
+STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint32_t max_age, mp_obj_t value, bool etag, bool observable);
 STATIC void remove_resource_by_key(coap_key_t key);
 STATIC void remove_resource(const char* uri);
+STATIC void resource_check_value(mp_obj_t value);
 STATIC void resource_update_value(mod_coap_resource_obj_t* resource, mp_obj_t new_value);
+STATIC void resource_update_opts(mod_coap_resource_obj_t* resource);
+STATIC bool resource_observe(mod_coap_resource_obj_t* resource_obj,
+                             const coap_endpoint_t * endpoint,
+                             coap_address_t * address,
+                             coap_pdu_t * request,
+                             str * token);
 
 STATIC void coap_resource_callback_get(coap_context_t * context,
                                        struct coap_resource_t * resource,
@@ -142,37 +154,18 @@ STATIC bool initialized = false;
  ******************************************************************************/
 // Get the resource if exists
 STATIC mod_coap_resource_obj_t* find_resource(coap_resource_t* resource) {
-
-    if(coap_obj_ptr->resources != NULL) {
-        mod_coap_resource_obj_t* current = coap_obj_ptr->resources;
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, resource->key, sizeof(current->coap_resource->key)) == 0) {
-                return current;
-            }
-        }
-    }
-    return NULL;
+    // The hash key is generated from Uri
+    return coapres_find(&coap_obj_ptr->resources, resource->key);
 }
 
 // Get the resource if exists by its key
 STATIC mod_coap_resource_obj_t* find_resource_by_key(coap_key_t key) {
-
-    if(coap_obj_ptr->resources != NULL) {
-        mod_coap_resource_obj_t* current = coap_obj_ptr->resources;
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, key, sizeof(current->coap_resource->key)) == 0) {
-                return current;
-            }
-        }
-    }
-    return mp_const_none;
+    return coapres_find(&coap_obj_ptr->resources, key);
 }
 
 
 // Create a new resource in the scope of the only context
-STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag) {
+STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint32_t max_age, mp_obj_t value, bool etag, bool observable) {
 
     // Currently only 1 context is supported
     mod_coap_obj_t* context = coap_obj_ptr;
@@ -180,17 +173,10 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
     coap_key_t key;
     (void)coap_hash_path((const unsigned char*)uri, strlen(uri), key);
 
-    // Check if there is at least 1 resource
-    if(context->resources != NULL) {
-        mod_coap_resource_obj_t* current = context->resources;
-        // Iterate through the resources and check whether the new one exists
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(key, current->coap_resource->key, sizeof(key)) == 0) {
-                // Resource already exists
-                return NULL;
-            }
-        }
+    // Check whether the new one exists
+    if(coapres_find(&context->resources, key) != NULL) {
+        // Resource already exists
+        return NULL;
     }
 
     // Resource does not exist, create a new resource object
@@ -198,43 +184,35 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
     resource->base.type = &mod_coap_resource_type;
 
     // Get media type
-    resource->mediatype = mediatype; // -1 means no media type is specified
+    resource->mediatype = mediatype; // MODCOAP_NO_MEDIATYPE means no media type is specified
     // Get max age
-    resource->max_age = max_age; // -1 means no max_age is specified
+    resource->max_age = max_age; // MODCOAP_NO_MAX_AGE means no max_age is specified
     // Get ETAG
     resource->etag = etag; // by default it is false
     resource->etag_value = 0; // start with 0, resource_update_value() will update it (0 is incorrect for E-Tag value)
-
-    // No next elem
-    resource->next = NULL;
+    resource->value = NULL;
+    resource->value_len = 0;
 
     // uri parameter pointer will be destroyed, pass a pointer to a permanent location
     resource->uri = m_malloc(strlen(uri));
     memcpy(resource->uri, uri, strlen(uri));
     resource->coap_resource = coap_resource_init((const unsigned char* )resource->uri, strlen(uri), 0);
     if(resource->coap_resource != NULL) {
-        // Add the resource to the Coap context
-        coap_add_resource(context->context, resource->coap_resource);
+        // Notifications are sent from coap_check_notify() once the value changes
+        resource->coap_resource->observable = observable;
 
         // If no default value is given set it to 0
         if(value == MP_OBJ_NULL) {
             value = mp_obj_new_int(0);
         }
-        // Initialize default value
+        // Initialize default value, this may raise so do it before the resource is registered anywhere
         resource_update_value(resource, value);
 
-        // Add the resource to our context
-        if(context->resources == NULL) {
-            // No resource exists, add as first element
-            context->resources = resource;
-        }
-        else {
-            mod_coap_resource_obj_t* current = context->resources;
-            // Find the last resource
-            for(; current->next != NULL; current = current->next) {}
-            // Append the new resource to the end of the list
-            current->next = resource;
-        }
+        // Add the resource to our context, the key is unique as checked above
+        coapres_insert(&context->resources, resource->coap_resource->key, resource);
+
+        // Add the resource to the Coap context
+        coap_add_resource(context->context, resource->coap_resource);
 
         return resource;
     }
@@ -244,9 +222,6 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
         // Resource cannot be created
         return NULL;
     }
-
-    // Just for the compiler
-    return mp_const_none;
 }
 
 // Remove the resource in the scope of the only context by its key
@@ -255,45 +230,17 @@ STATIC void remove_resource_by_key(coap_key_t key) {
     // Currently only 1 context is supported
     mod_coap_obj_t* context = coap_obj_ptr;
 
-    if(context->resources != NULL) {
-        mod_coap_resource_obj_t* current = context->resources;
-        mod_coap_resource_obj_t* previous = context->resources;
-        for(; current != NULL; current = current->next) {
-
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, key, sizeof(coap_key_t)) == 0) {
-                // Resource found, remove from the list
-                // Check if it is the first element in the list
-                if(context->resources == current) {
-                    // If no more element in the list then invalidate the list
-                    if(current->next == NULL) {
-                        context->resources = NULL;
-                    }
-                    // Other elements are in the list
-                    else {
-                        context->resources = current->next;
-                    }
-                }
-                else {
-                    // It is not the first element
-                    previous->next = current->next;
-                }
-
-                // Free the URI
-                m_free(current->uri);
-                // Free the resource in coap's scope
-                coap_delete_resource(context->context, key);
-                // Free the element in MP scope
-                m_free(current->value);
-                // Free the resource itself
-                m_free(current);
-
-                return;
-            }
-
-            // Mark the current element as previous, needed when removing the actual current element from the list
-            previous = current;
-        }
+    mod_coap_resource_obj_t* current = coapres_remove(&context->resources, key);
+    if(current != NULL) {
+        // Free the URI
+        m_free(current->uri);
+        // Free the resource in coap's scope, this drops its observers too
+        coap_delete_resource(context->context, key);
+        // Free the element in MP scope
+        m_free(current->value);
+        current->value = NULL;
+        // Free the resource itself
+        m_free(current);
     }
 }
 
@@ -307,9 +254,43 @@ STATIC void remove_resource(const char* uri) {
     remove_resource_by_key(key);
 }
 
+// Raise if the value cannot be stored, called before taking the semaphore as it would not be given back
+STATIC void resource_check_value(mp_obj_t value) {
+
+    if (value != MP_OBJ_NULL && !mp_obj_is_integer(value)) {
+        mp_buffer_info_t value_bufinfo;
+        mp_get_buffer_raise(value, &value_bufinfo, MP_BUFFER_READ);
+    }
+}
+
 // Update the value of a resource
 STATIC void resource_update_value(mod_coap_resource_obj_t* resource, mp_obj_t new_value) {
 
+    uint8_t int_buf[COAPRES_UINT_MAX_LEN];
+    const uint8_t* data;
+    size_t len;
+
+    // Get the new data first, mp_get_buffer_raise() must not leave the resource half updated
+    if (mp_obj_is_integer(new_value)) {
+        // Integers are stored in network byte order on as few bytes as possible, but at least 1
+        uint32_t value = mp_obj_get_int_truncated(new_value);
+        len = coapres_encode_uint(int_buf, value);
+        if (len == 0) {
+            int_buf[0] = 0;
+            len = 1;
+        }
+        data = int_buf;
+    } else {
+        mp_buffer_info_t value_bufinfo;
+        mp_get_buffer_raise(new_value, &value_bufinfo, MP_BUFFER_READ);
+        data = value_bufinfo.buf;
+        len = value_bufinfo.len;
+    }
+
+    // Allocate memory for the new data
+    uint8_t* value = m_malloc(len);
+    memcpy(value, data, len);
+
     // If ETAG value is needed then update it
     if(resource->etag == true) {
         resource->etag_value += 1;
@@ -319,39 +300,77 @@ STATIC void resource_update_value(mod_coap_resource_obj_t* resource, mp_obj_t ne
         }
     }
 
-    // Invalidate current data first
-    resource->value_len = 0;
     m_free(resource->value);
+    resource->value = value;
+    resource->value_len = len;
 
-    if (mp_obj_is_integer(new_value)) {
+    // The options sent with the value only change together with it
+    resource_update_opts(resource);
 
-        uint32_t value = mp_obj_get_int_truncated(new_value);
-        if (value > 0xFF) {
-            resource->value_len = 2;
-        } else if (value > 0xFFFF) {
-            resource->value_len = 4;
-        } else {
-            resource->value_len = 1;
-        }
+    // Let coap_check_notify() send the new value to the observers
+    if(resource->coap_resource->observable) {
+        resource->coap_resource->dirty = 1;
+    }
+}
 
-        // Allocate memory for the new data
-        resource->value = m_malloc(resource->value_len);
-        memcpy(resource->value, &value, sizeof(value));
+// Encode the options of the GET responses once, rather than for every request
+STATIC void resource_update_opts(mod_coap_resource_obj_t* resource) {
 
-    } else {
+    coapres_opts_t* opts = &resource->opts;
 
-        mp_buffer_info_t value_bufinfo;
-        mp_get_buffer_raise(new_value, &value_bufinfo, MP_BUFFER_READ);
-        resource->value_len = value_bufinfo.len;
+    opts->etag_len = 0;
+    if(resource->etag == true) {
+        opts->etag_len = coapres_encode_uint(opts->etag, resource->etag_value);
+    }
+
+    opts->content_format_len = 0;
+    if(resource->mediatype != MODCOAP_NO_MEDIATYPE) {
+        opts->content_format_len = coapres_encode_uint(opts->content_format, resource->mediatype);
+    }
 
-        // Allocate memory for the new data
-        resource->value = m_malloc(resource->value_len);
-        memcpy(resource->value, value_bufinfo.buf, resource->value_len);
+    opts->max_age_len = 0;
+    if(resource->max_age != MODCOAP_NO_MAX_AGE) {
+        opts->max_age_len = coapres_encode_uint(opts->max_age, resource->max_age);
+    }
+}
+
+// Handle the Observe option of a GET request, returns true if the requester is (still) observing the resource
+STATIC bool resource_observe(mod_coap_resource_obj_t* resource_obj,
+                             const coap_endpoint_t * endpoint,
+                             coap_address_t * address,
+                             coap_pdu_t * request,
+                             str * token)
+{
+    coap_resource_t* resource = resource_obj->coap_resource;
+
+    if(resource->observable == 0) {
+        return false;
+    }
+
+    // Notifications are generated by coap_check_notify() without a request
+    if(request == NULL) {
+        return coap_find_observer(resource, address, token) != NULL;
+    }
+
+    coap_opt_iterator_t opt_it;
+    coap_opt_t *opt = coap_check_option(request, COAP_OPTION_OBSERVE, &opt_it);
+    if(opt == NULL) {
+        return false;
+    }
+
+    uint32_t observe = coapres_decode_uint(coap_opt_value(opt), coap_opt_length(opt));
+    if(observe == MODCOAP_OBSERVE_REGISTER) {
+        // An existing registration is just refreshed
+        return coap_add_observer(resource, endpoint, address, token) != NULL;
+    }
+    else if(observe == MODCOAP_OBSERVE_DEREGISTER) {
+        coap_delete_observer(resource, address, token);
     }
+    return false;
 }
 
 
-// Callback function when GET method is received
+// Callback function when GET method is received, also called by coap_check_notify() with request == NULL to build notifications
 STATIC void coap_resource_callback_get(coap_context_t * context,
                                        struct coap_resource_t * resource,
                                        const coap_endpoint_t * endpoint,
@@ -367,7 +386,7 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
     if(resource_obj != NULL) {
 
         // Check if media type of the resource is given
-        if(resource_obj->mediatype != -1) {
+        if(request != NULL && resource_obj->mediatype != MODCOAP_NO_MEDIATYPE) {
             coap_opt_iterator_t opt_it;
             // Need to check if ACCEPT option is specified and we can serve it
             coap_opt_t *opt = coap_check_option(request, COAP_OPTION_ACCEPT, &opt_it);
@@ -395,7 +414,7 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
         response->hdr->code = COAP_RESPONSE_CODE(205);
 
         // Check if ETAG value is maintained for the resource
-        if(resource_obj->etag == true) {
+        if(request != NULL && resource_obj->etag == true) {
 
             coap_opt_iterator_t opt_it;
             // Need to check if E-TAG option is specified and we can serve it
@@ -418,24 +437,60 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
             }
         }
 
-        // Add the options if configured
-        unsigned char buf[3];
+        // Values longer than a block are sent block-wise (RFC 7959), starting with block 0 if the request does not ask for one
+        uint32_t offset = 0;
+        uint32_t chunk = resource_obj->value_len;
+        int64_t block2 = -1;
+        coap_block_t block = { .num = 0, .m = 0, .szx = COAPRES_BLOCK_SZX };
+        if(request != NULL && coap_get_block(request, COAP_OPTION_BLOCK2, &block)) {
+            if(block.szx > COAPRES_BLOCK_SZX) {
+                block.szx = COAPRES_BLOCK_SZX;
+            }
+        }
+        else {
+            block.num = 0;
+            block.szx = COAPRES_BLOCK_SZX;
+        }
+        if(block.num != 0 || resource_obj->value_len > COAPRES_BLOCK_SIZE(block.szx)) {
+            block2 = coapres_block(resource_obj->value_len, block.num, block.szx, &offset, &chunk);
+            if(block2 < 0) {
+                // 4.02 Bad Option: the block is past the end of the value
+                response->hdr->code = COAP_RESPONSE_CODE(402);
+                const char* error_message = coap_response_phrase(response->hdr->code);
+                coap_add_data(response, strlen(error_message), (unsigned char *)error_message);
+                return;
+            }
+        }
+
+        bool observing = resource_observe(resource_obj, endpoint, address, request, token);
+
+        // Add the options if configured, in the order of their numbers, they are encoded when the value changes
+        const coapres_opts_t* opts = &resource_obj->opts;
+        unsigned char buf[COAPRES_UINT_MAX_LEN];
 
         if(resource_obj->etag == true) {
-            coap_add_option(response, COAP_OPTION_ETAG, coap_encode_var_bytes(buf, resource_obj->etag_value), buf);
+            coap_add_option(response, COAP_OPTION_ETAG, opts->etag_len, opts->etag);
         }
 
-        if(resource_obj->mediatype != -1) {
-            coap_add_option(response, COAP_OPTION_CONTENT_TYPE, coap_encode_var_bytes(buf, resource_obj->mediatype), buf);
+        if(observing) {
+            coap_add_option(response, COAP_OPTION_OBSERVE, coapres_encode_uint(buf, context->observe), buf);
         }
 
-        if(resource_obj->max_age != -1) {
-            coap_add_option(response, COAP_OPTION_MAXAGE, coap_encode_var_bytes(buf, resource_obj->max_age), buf);
+        if(resource_obj->mediatype != MODCOAP_NO_MEDIATYPE) {
+            coap_add_option(response, COAP_OPTION_CONTENT_TYPE, opts->content_format_len, opts->content_format);
+        }
+
+        if(resource_obj->max_age != MODCOAP_NO_MAX_AGE) {
+            coap_add_option(response, COAP_OPTION_MAXAGE, opts->max_age_len, opts->max_age);
+        }
+
+        if(block2 >= 0) {
+            coap_add_option(response, COAP_OPTION_BLOCK2, coapres_encode_uint(buf, block2), buf);
         }
 
         // Add the data itself if updated
         if(response->hdr->code == COAP_RESPONSE_CODE(205)) {
-            coap_add_data(response, resource_obj->value_len, (unsigned char *)resource_obj->value);
+            coap_add_data(response, chunk, (unsigned char *)resource_obj->value + offset);
         }
     }
     else {
@@ -518,7 +573,7 @@ STATIC void coap_resource_callback_put(coap_context_t * context,
             }
             // If no CONTENT-FORMAT is specified set the media type to unknown
             else {
-                resource_obj->mediatype = -1;
+                resource_obj->mediatype = MODCOAP_NO_MEDIATYPE;
             }
 
             // Update the data and set response code and add E-Tag option if needed
@@ -600,7 +655,7 @@ STATIC void coap_resource_callback_post(coap_context_t * context,
         }
         // If no CONTENT-FORMAT is specified set the media type to unknown
         else {
-            resource_obj->mediatype = -1;
+            resource_obj->mediatype = MODCOAP_NO_MEDIATYPE;
         }
 
         // Update the data and set response code and add E-Tag option if needed
@@ -798,6 +853,10 @@ STATIC mp_obj_t mod_coap_resource_value(mp_uint_t n_args, const mp_obj_t *args)
     mod_coap_resource_obj_t* self = (mod_coap_resource_obj_t*)args[0];
     mp_obj_t ret = mp_const_none;
 
+    if (n_args > 1) {
+        resource_check_value(args[1]);
+    }
+
     xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
     // If the value exists, e.g.: not deleted from another task before we got the semaphore
     if(self->value != NULL) {
@@ -807,6 +866,8 @@ STATIC mp_obj_t mod_coap_resource_value(mp_uint_t n_args, const mp_obj_t *args)
         } else {
             // set
             resource_update_value(self, (mp_obj_t)args[1]);
+            // Notify the observers right away
+            coap_check_notify(coap_obj_ptr->context);
         }
     }
     xSemaphoreGive(coap_obj_ptr->semphr);
@@ -941,7 +1002,7 @@ STATIC mp_obj_t mod_coap_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
         MP_STATE_PORT(coap_ptr) = m_malloc(sizeof(mod_coap_obj_t));
         coap_obj_ptr = MP_STATE_PORT(coap_ptr);
         coap_obj_ptr->context = NULL;
-        coap_obj_ptr->resources = NULL;
+        coap_obj_ptr->resources = (coapres_index_t){ .slots = NULL, .size = 0, .count = 0 };
         coap_obj_ptr->socket = NULL;
         coap_obj_ptr->semphr = NULL;
 
@@ -994,6 +1055,7 @@ STATIC const mp_arg_t mod_coap_add_resource_args[] = {
         { MP_QSTR_max_age,                  MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = -1}},
         { MP_QSTR_value,                    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL}},
         { MP_QSTR_etag,                     MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
+        { MP_QSTR_observable,               MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
 };
 
 // Add a new resource to the context if not exists
@@ -1002,12 +1064,18 @@ STATIC mp_obj_t mod_coap_add_resource(mp_uint_t n_args, const mp_obj_t *pos_args
     // The Coap module should have been already initialized
     if(initialized == true) {
 
-        xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
-
         mp_arg_val_t args[MP_ARRAY_SIZE(mod_coap_add_resource_args)];
         mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), mod_coap_add_resource_args, args);
+        const char* uri = mp_obj_str_get_str(args[0].u_obj);
+        resource_check_value(args[3].u_obj);
+
+        // -1 (the default) means no media type / max age
+        uint8_t mediatype = args[1].u_int < 0 ? MODCOAP_NO_MEDIATYPE : args[1].u_int;
+        uint32_t max_age = args[2].u_int < 0 ? MODCOAP_NO_MAX_AGE : args[2].u_int;
 
-        mod_coap_resource_obj_t* res = add_resource(mp_obj_str_get_str(args[0].u_obj), args[1].u_int, args[2].u_int, args[3].u_obj, args[4].u_bool);
+        xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
+
+        mod_coap_resource_obj_t* res = add_resource(uri, mediatype, max_age, args[3].u_obj, args[4].u_bool, args[5].u_bool);
 
         xSemaphoreGive(coap_obj_ptr->semphr);
 
@@ -1055,7 +1123,10 @@ STATIC mp_obj_t mod_coap_get_resource(mp_obj_t uri_in) {
         const char* uri = mp_obj_str_get_str(uri_in);
         coap_key_t key;
         (void)coap_hash_path((const unsigned char*)uri, strlen(uri), key);
-        res = find_resource_by_key(key);
+        mod_coap_resource_obj_t* resource = find_resource_by_key(key);
+        if(resource != NULL) {
+            res = resource;
+        }
         xSemaphoreGive(coap_obj_ptr->semphr);
     }
     else {
@@ -1075,6 +1146,8 @@ STATIC mp_obj_t mod_coap_read(void) {
         // Take the context's semaphore to avoid concurrent access, this will guard the handler functions too
         xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
         coap_read(coap_obj_ptr->context);
+        // Notify the observers of the resources changed by the requests just handled
+        coap_check_notify(coap_obj_ptr->context);
         xSemaphoreGive(coap_obj_ptr->semphr);
     }
     else {
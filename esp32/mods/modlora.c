@@ -53,6 +53,8 @@
 #include "lora/mac/region/RegionEU868.h"
 #include "lora/mac/region/RegionCN470.h"
 #include "lora/mac/region/RegionIN865.h"
+#include "lora/aggregate.h"
+#include "lora/rxring.h"
 
 // openThread includes
 #ifdef LORA_OPENTHREAD_ENABLED
@@ -228,20 +230,15 @@ typedef struct {
     uint8_t           events;
     uint8_t           trigger;
     uint8_t           tx_trials;
+    uint32_t          aggregate_ms;         // flush deadline of aggregated uplinks, 0 when off
 } lora_obj_t;
 
-typedef struct {
-    uint32_t    index;
-    uint32_t    size;
-    uint8_t     data[LORA_PAYLOAD_SIZE_MAX];
-    uint8_t     port;
-} lora_partial_rx_packet_t;
-
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
 static QueueHandle_t xCmdQueue;
-static QueueHandle_t xRxQueue;
+static SemaphoreHandle_t xRxSem;            // given for every packet put in the ring
+static SemaphoreHandle_t xRxMutex;          // one reader of the ring at a time
 static QueueHandle_t xCbQueue;
 static EventGroupHandle_t LoRaEvents;
 
@@ -251,8 +248,11 @@ static LoRaMacPrimitives_t LoRaMacPrimitives;
 static LoRaMacCallback_t LoRaMacCallbacks;
 
 static lora_obj_t lora_obj;
-static lora_partial_rx_packet_t lora_partial_rx_packet;
-static lora_rx_data_t rx_data_isr;
+static aggregate_t lora_aggregate;          // only the LoRa task touches the frame
+static lora_cmd_data_t lora_aggregate_held; // payload that didn't fit the flushed frame
+static bool lora_aggregate_holding;
+static rxring_t lora_rx_ring;
+static uint8_t lora_rx_ring_buf[LORA_RX_RING_SIZE];
 
 static TimerEvent_t TxNextActReqTimer;
 
@@ -320,7 +320,9 @@ SemaphoreHandle_t xLoRaSigfoxSem;
  ******************************************************************************/
 void modlora_init0(void) {
     xCmdQueue = xQueueCreate(LORA_CMD_QUEUE_SIZE_MAX, sizeof(lora_cmd_data_t));
-    xRxQueue = xQueueCreate(LORA_DATA_QUEUE_SIZE_MAX, sizeof(lora_rx_data_t));
+    rxring_init(&lora_rx_ring, lora_rx_ring_buf, LORA_RX_RING_SIZE);
+    xRxSem = xSemaphoreCreateBinary();
+    xRxMutex = xSemaphoreCreateMutex();
     xCbQueue = xQueueCreate(LORA_CB_QUEUE_SIZE_MAX, sizeof(modlora_timerCallback));
     LoRaEvents = xEventGroupCreate();
 #if defined(FIPY) || defined(LOPY4)
@@ -335,6 +337,8 @@ void modlora_init0(void) {
     BoardInitMcu();
     BoardInitPeriph();
 
+    aggregate_init(&lora_aggregate);
+
     xTaskCreatePinnedToCore(TASK_LoRa, "LoRa", LORA_STACK_SIZE / sizeof(StackType_t), NULL, LORA_TASK_PRIORITY, &xLoRaTaskHndl, 1);
     xTaskCreatePinnedToCore(TASK_LoRa_Timer, "LoRa_Timer_callback", LORA_TIMER_STACK_SIZE / sizeof(StackType_t), NULL, LORA_TIMER_TASK_PRIORITY, &xLoRaTimerTaskHndl, 1);
 }
@@ -464,6 +468,7 @@ static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms,
     cmd_data.info.tx.len = len;
     cmd_data.info.tx.dr = dr;
     if (lora_obj.ComplianceTest.Enabled && lora_obj.ComplianceTest.Running) {
+        cmd_data.info.tx.aggregate_ms = 0;
         cmd_data.info.tx.port = 224;  // MAC commands port
         if (lora_obj.ComplianceTest.IsTxConfirmed) {
             cmd_data.info.tx.confirmed = true;
@@ -473,6 +478,7 @@ static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms,
     } else {
         cmd_data.info.tx.confirmed = confirmed;
         cmd_data.info.tx.port = port;    // data port
+        cmd_data.info.tx.aggregate_ms = lora_obj.aggregate_ms;
     }
 
     if (timeout_ms < 0) {
@@ -480,6 +486,18 @@ static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms,
         timeout_ms = portMAX_DELAY;
     }
 
+    if (cmd_data.info.tx.aggregate_ms > 0) {
+        // the payload is gathered with others by the LoRa task, so there's no
+        // frame to wait for; it takes its length byte on top
+        if (false == ValidatePayloadLength(len + 1, dr, 0)) {
+            return -1;
+        }
+        if (!xQueueSend(xCmdQueue, (void *)&cmd_data, (TickType_t)(timeout_ms / portTICK_PERIOD_MS))) {
+            return 0;
+        }
+        return len;
+    }
+
     xEventGroupClearBits(LoRaEvents, LORA_STATUS_COMPLETED | LORA_STATUS_ERROR | LORA_STATUS_MSG_SIZE);
 
     // just pass to the LoRa queue
@@ -621,10 +639,9 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
     if (mcpsIndication->RxData && mcpsIndication->BufferSize > 0) {
         if (mcpsIndication->Port > 0 && mcpsIndication->Port < 224) {
             if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX) {
-                memcpy((void *)rx_data_isr.data, mcpsIndication->Buffer, mcpsIndication->BufferSize);
-                rx_data_isr.len = mcpsIndication->BufferSize;
-                rx_data_isr.port = mcpsIndication->Port;
-                xQueueSend(xRxQueue, (void *)&rx_data_isr, 0);
+                if (rxring_put(&lora_rx_ring, mcpsIndication->Buffer, mcpsIndication->BufferSize, mcpsIndication->Port)) {
+                    xSemaphoreGive(xRxSem);
+                }
                 lora_obj.events |= MODLORA_RX_EVENT;
                 if (lora_obj.trigger & MODLORA_RX_EVENT) {
                     mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
@@ -650,8 +667,8 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
                         lora_obj.ComplianceTest.Running = true;
                         lora_obj.ComplianceTest.State = 1;
 
-                        // flush the rx queue
-                        xQueueReset(xRxQueue);
+                        // flush the rx ring
+                        rxring_flush(&lora_rx_ring);
 
                         // enable ADR during test mode
                         MibRequestConfirm_t mibReq;
@@ -697,10 +714,9 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
                     case 4: // (vii)
                         // return the payload
                         if (bDoEcho) {
-                            if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX) {
-                                memcpy((void *)rx_data_isr.data, mcpsIndication->Buffer, mcpsIndication->BufferSize);
-                                rx_data_isr.len = mcpsIndication->BufferSize;
-                                xQueueSend(xRxQueue, (void *)&rx_data_isr, 0);
+                            if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX &&
+                                rxring_put(&lora_rx_ring, mcpsIndication->Buffer, mcpsIndication->BufferSize, 0)) {
+                                xSemaphoreGive(xRxSem);
                             }
                         } else {
                             // set the state back to 1
@@ -791,10 +807,141 @@ static void MlmeIndication( MlmeIndication_t *mlmeIndication )
     }
 }
 
+// hands a frame to the MAC; when the MAC refuses it the status bits are set
+// right away if report is true, otherwise the TX done sets them
+static uint32_t lorawan_tx (uint8_t *data, uint8_t len, uint8_t port, uint8_t dr, bool confirmed, bool report) {
+    MibRequestConfirm_t mibReq;
+    McpsReq_t mcpsReq;
+    LoRaMacTxInfo_t txInfo;
+    EventBits_t status = 0;
+    bool empty_frame = false;
+    int8_t mac_datarate = 0;
+
+    // set the new data rate before checking if Tx is possible, but store the current one
+    if (!lora_obj.adr) {
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        mac_datarate = mibReq.Param.ChannelsDatarate;
+        mibReq.Param.ChannelsDatarate = dr;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    if (LoRaMacQueryTxPossible (len, &txInfo) != LORAMAC_STATUS_OK) {
+        // send an empty frame in order to flush MAC commands
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+        mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+        mcpsReq.Req.Unconfirmed.Datarate = dr;
+        empty_frame = true;
+        status |= LORA_STATUS_MSG_SIZE;
+    } else {
+        if (confirmed) {
+            mcpsReq.Type = MCPS_CONFIRMED;
+            mcpsReq.Req.Confirmed.fPort = port;
+            mcpsReq.Req.Confirmed.fBuffer = data;
+            mcpsReq.Req.Confirmed.fBufferSize = len;
+            mcpsReq.Req.Confirmed.NbTrials = lora_obj.tx_retries + 1;
+            mcpsReq.Req.Confirmed.Datarate = dr;
+        } else {
+            mcpsReq.Type = MCPS_UNCONFIRMED;
+            mcpsReq.Req.Unconfirmed.fPort = port;
+            mcpsReq.Req.Unconfirmed.fBuffer = data;
+            mcpsReq.Req.Unconfirmed.fBufferSize = len;
+            mcpsReq.Req.Unconfirmed.Datarate = dr;
+        }
+    }
+#if defined(FIPY) || defined(LOPY4)
+    xSemaphoreTake(xLoRaSigfoxSem, portMAX_DELAY);
+#endif
+
+    // set back the original datarate
+    if (!lora_obj.adr) {
+        mibReq.Param.ChannelsDatarate = mac_datarate;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK || empty_frame) {
+        // the command has failed, send the response now
+        lora_obj.state = E_LORA_STATE_IDLE;
+        status |= LORA_STATUS_ERROR;
+        if (report) {
+            xEventGroupSetBits(LoRaEvents, status);
+        }
+    #if defined(FIPY) || defined(LOPY4)
+        xSemaphoreGive(xLoRaSigfoxSem);
+    #endif
+    } else {
+        lora_obj.state = E_LORA_STATE_TX;
+    }
+    return status;
+}
+
+// the largest application payload of a frame sent now at the data rate,
+// after the MAC commands waiting to go
+static uint8_t lorawan_max_payload (uint8_t dr) {
+    MibRequestConfirm_t mibReq;
+    LoRaMacTxInfo_t txInfo;
+    int8_t mac_datarate = 0;
+
+    if (!lora_obj.adr) {
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        mac_datarate = mibReq.Param.ChannelsDatarate;
+        mibReq.Param.ChannelsDatarate = dr;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+    LoRaMacQueryTxPossible (0, &txInfo);
+    if (!lora_obj.adr) {
+        mibReq.Param.ChannelsDatarate = mac_datarate;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+    return txInfo.MaxPossiblePayload;
+}
+
+static void lorawan_aggregate_flush (aggregate_flush_t reason) {
+    // the MAC copies the payload, the frame can be reused right after
+    uint32_t status = lorawan_tx(lora_aggregate.buf, lora_aggregate.len, lora_aggregate.port,
+                                 lora_aggregate.dr, lora_aggregate.confirmed, false);
+    aggregate_flushed(&lora_aggregate, reason, status == 0);
+}
+
+static void lorawan_aggregate (lora_cmd_data_t *cmd_data) {
+    lora_tx_cmd_data_t *tx = &cmd_data->info.tx;
+    uint8_t max_payload = lorawan_max_payload(tx->dr);
+
+    if (aggregate_pending(&lora_aggregate) &&
+        !aggregate_fits(&lora_aggregate, tx->len, tx->port, tx->dr, tx->confirmed, max_payload)) {
+        bool change = (tx->port != lora_aggregate.port || tx->dr != lora_aggregate.dr ||
+                       tx->confirmed != lora_aggregate.confirmed);
+        // the pending frame goes first, the payload is taken again before the
+        // queue once the radio is done (the task must never block on its own queue)
+        lora_aggregate_held = *cmd_data;
+        lora_aggregate_holding = true;
+        lorawan_aggregate_flush(change ? E_AGGREGATE_FLUSH_CHANGE : E_AGGREGATE_FLUSH_FULL);
+        return;
+    }
+    if (!aggregate_add(&lora_aggregate, tx->data, tx->len, tx->port, tx->dr, tx->confirmed,
+                       max_payload, mp_hal_ticks_ms(), tx->aggregate_ms)) {
+        // larger than a frame at the data rate the frame would go at now
+        lora_aggregate.stats.dropped++;
+    } else if (lora_aggregate.len + 1 > max_payload) {
+        // not even an empty payload fits anymore
+        lorawan_aggregate_flush(E_AGGREGATE_FLUSH_FULL);
+    }
+}
+
+static bool lorawan_aggregate_take_held (lora_cmd_data_t *cmd_data) {
+    if (!lora_aggregate_holding) {
+        return false;
+    }
+    *cmd_data = lora_aggregate_held;
+    lora_aggregate_holding = false;
+    return true;
+}
+
 static void TASK_LoRa (void *pvParameters) {
     MibRequestConfirm_t mibReq;
     MlmeReq_t mlmeReq;
-    McpsReq_t mcpsReq;
     bool isReset;
 
     lora_obj.state = E_LORA_STATE_NOINIT;
@@ -816,7 +963,7 @@ static void TASK_LoRa (void *pvParameters) {
         case E_LORA_STATE_SLEEP:
         case E_LORA_STATE_RESET:
             // receive from the command queue and act accordingly
-            if (xQueueReceive(xCmdQueue, &task_cmd_data, 0)) {
+            if (lorawan_aggregate_take_held(&task_cmd_data) || xQueueReceive(xCmdQueue, &task_cmd_data, 0)) {
                 switch (task_cmd_data.cmd) {
                 case E_LORA_CMD_INIT:
                     isReset = lora_obj.state == E_LORA_STATE_RESET? true:false;
@@ -1005,66 +1152,12 @@ static void TASK_LoRa (void *pvParameters) {
                     }
                     xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
                     break;
-                case E_LORA_CMD_LORAWAN_TX: {
-                        LoRaMacTxInfo_t txInfo;
-                        EventBits_t status = 0;
-                        bool empty_frame = false;
-                        int8_t mac_datarate = 0;
-
-                        // set the new data rate before checking if Tx is possible, but store the current one
-                        if (!lora_obj.adr) {
-                            mibReq.Type = MIB_CHANNELS_DATARATE;
-                            LoRaMacMibGetRequestConfirm( &mibReq );
-                            mac_datarate = mibReq.Param.ChannelsDatarate;
-                            mibReq.Param.ChannelsDatarate = task_cmd_data.info.tx.dr;
-                            LoRaMacMibSetRequestConfirm( &mibReq );
-                        }
-
-                        if (LoRaMacQueryTxPossible (task_cmd_data.info.tx.len, &txInfo) != LORAMAC_STATUS_OK) {
-                            // send an empty frame in order to flush MAC commands
-                            mcpsReq.Type = MCPS_UNCONFIRMED;
-                            mcpsReq.Req.Unconfirmed.fBuffer = NULL;
-                            mcpsReq.Req.Unconfirmed.fBufferSize = 0;
-                            mcpsReq.Req.Unconfirmed.Datarate = task_cmd_data.info.tx.dr;
-                            empty_frame = true;
-                            status |= LORA_STATUS_MSG_SIZE;
-                        } else {
-                            if (task_cmd_data.info.tx.confirmed) {
-                                mcpsReq.Type = MCPS_CONFIRMED;
-                                mcpsReq.Req.Confirmed.fPort = task_cmd_data.info.tx.port;
-                                mcpsReq.Req.Confirmed.fBuffer = task_cmd_data.info.tx.data;
-                                mcpsReq.Req.Confirmed.fBufferSize = task_cmd_data.info.tx.len;
-                                mcpsReq.Req.Confirmed.NbTrials = lora_obj.tx_retries + 1;
-                                mcpsReq.Req.Confirmed.Datarate = task_cmd_data.info.tx.dr;
-                            } else {
-                                mcpsReq.Type = MCPS_UNCONFIRMED;
-                                mcpsReq.Req.Unconfirmed.fPort = task_cmd_data.info.tx.port;
-                                mcpsReq.Req.Unconfirmed.fBuffer = task_cmd_data.info.tx.data;
-                                mcpsReq.Req.Unconfirmed.fBufferSize = task_cmd_data.info.tx.len;
-                                mcpsReq.Req.Unconfirmed.Datarate = task_cmd_data.info.tx.dr;
-                            }
-                        }
-                    #if defined(FIPY) || defined(LOPY4)
-                        xSemaphoreTake(xLoRaSigfoxSem, portMAX_DELAY);
-                    #endif
-
-                        // set back the original datarate
-                        if (!lora_obj.adr) {
-                            mibReq.Param.ChannelsDatarate = mac_datarate;
-                            LoRaMacMibSetRequestConfirm( &mibReq );
-                        }
-
-                        if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK || empty_frame) {
-                            // the command has failed, send the response now
-                            lora_obj.state = E_LORA_STATE_IDLE;
-                            status |= LORA_STATUS_ERROR;
-                            xEventGroupSetBits(LoRaEvents, status);
-                        #if defined(FIPY) || defined(LOPY4)
-                            xSemaphoreGive(xLoRaSigfoxSem);
-                        #endif
-                        } else {
-                            lora_obj.state = E_LORA_STATE_TX;
-                        }
+                case E_LORA_CMD_LORAWAN_TX:
+                    if (task_cmd_data.info.tx.aggregate_ms > 0) {
+                        lorawan_aggregate(&task_cmd_data);
+                    } else {
+                        lorawan_tx(task_cmd_data.info.tx.data, task_cmd_data.info.tx.len, task_cmd_data.info.tx.port,
+                                   task_cmd_data.info.tx.dr, task_cmd_data.info.tx.confirmed, true);
                     }
                     break;
                 case E_LORA_CMD_SLEEP:
@@ -1087,6 +1180,9 @@ static void TASK_LoRa (void *pvParameters) {
                 default:
                     break;
                 }
+            } else if (lora_obj.state == E_LORA_STATE_IDLE && aggregate_pending(&lora_aggregate) &&
+                       (lora_obj.aggregate_ms == 0 || aggregate_due(&lora_aggregate, mp_hal_ticks_ms()))) {
+                lorawan_aggregate_flush(E_AGGREGATE_FLUSH_DEADLINE);
 //            } else if (lora_obj.state == E_LORA_STATE_IDLE && lora_obj.stack_mode == E_LORA_STACK_MODE_LORA) {
 //                Radio.Rx(LORA_RX_TIMEOUT);
 //                lora_obj.state = E_LORA_STATE_RX;
@@ -1258,10 +1354,8 @@ static IRAM_ATTR void OnRxDone (uint8_t *payload, uint32_t timestamp, uint16_t s
     lora_obj.rssi = rssi;
     lora_obj.snr = snr;
     lora_obj.sfrx = sf;
-    if (size <= LORA_PAYLOAD_SIZE_MAX) {
-        memcpy((void *)rx_data_isr.data, payload, size);
-        rx_data_isr.len = size;
-        xQueueSendFromISR(xRxQueue, (void *)&rx_data_isr, NULL);
+    if (size <= LORA_PAYLOAD_SIZE_MAX && rxring_put(&lora_rx_ring, payload, size, 0)) {
+        xSemaphoreGiveFromISR(xRxSem, NULL);
     }
 
     lora_obj.events |= MODLORA_RX_EVENT;
@@ -1596,58 +1690,30 @@ static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
     return len;
 }
 
+// copies the next packet straight from the ring into buf; what does not fit
+// is left for the next call, like a datagram socket that keeps the rest
 static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t *port) {
-    lora_rx_data_t rx_data;
-
-    if (timeout_ms < 0) {
-        // blocking mode
-        timeout_ms = portMAX_DELAY;
-    }
-
-    // if there's a partial packet pending
-    if (lora_partial_rx_packet.size > 0) {
-        // adjust the len
-        uint32_t available_len = lora_partial_rx_packet.size - lora_partial_rx_packet.index;
-        if (available_len < len) {
-            len = available_len;
-        }
-
-        // get the available data
-        memcpy(buf, (void *)&lora_partial_rx_packet.data[lora_partial_rx_packet.index], len);
-        if (port != NULL) {
-            *port = rx_data.port;
-        }
-
-        // update the index and size values
-        lora_partial_rx_packet.index += len;
-        if (lora_partial_rx_packet.index == lora_partial_rx_packet.size) {
-            // there's no more data left
-            lora_partial_rx_packet.size = 0;
-        }
-        // return the number of bytes received
-        return len;
-    } else if (xQueueReceive(xRxQueue, &rx_data, (TickType_t)(timeout_ms / portTICK_PERIOD_MS))) {
-        // adjust the len
-        if (rx_data.len < len) {
-            len = rx_data.len;
+    TickType_t ticks = (timeout_ms < 0) ? portMAX_DELAY : (TickType_t)(timeout_ms / portTICK_PERIOD_MS);
+    TimeOut_t timeout;
+    uint8_t rx_port = 0;
+    int32_t ret;
+
+    vTaskSetTimeOutState(&timeout);
+    xSemaphoreTake(xRxMutex, portMAX_DELAY);
+    while ((ret = rxring_read(&lora_rx_ring, buf, len, &rx_port)) < 0) {
+        // the semaphore may have been given for a packet already read, hence the loop
+        if (xTaskCheckForTimeOut(&timeout, &ticks) != pdFALSE || xSemaphoreTake(xRxSem, ticks) != pdTRUE) {
+            break;
         }
+    }
+    xSemaphoreGive(xRxMutex);
 
-        // get the available data
-        memcpy(buf, rx_data.data, len);
+    if (ret >= 0) {
         if (port != NULL) {
-            *port = rx_data.port;
-        }
-
-        // copy the remainder to the partial data buffer
-        int32_t r_len = rx_data.len - len;
-        if (r_len > 0) {
-            memcpy((void *)lora_partial_rx_packet.data, &rx_data.data[len], r_len);
-            lora_partial_rx_packet.size = r_len;
-            lora_partial_rx_packet.index = 0;
-            lora_partial_rx_packet.port = rx_data.port;
+            *port = rx_port;
         }
         // return the number of bytes received
-        return len;
+        return ret;
     }
     // non-blocking sockects do not thrown timeout errors
     if (timeout_ms == 0) {
@@ -1658,13 +1724,7 @@ static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t
 }
 
 static bool lora_rx_any (void) {
-    lora_rx_data_t rx_data;
-    if (lora_partial_rx_packet.size > 0) {
-        return true;
-    } else if (xQueuePeek(xRxQueue, &rx_data, (TickType_t)0)) {
-        return true;
-    }
-    return false;
+    return !rxring_empty(&lora_rx_ring);
 }
 
 static bool lora_tx_space (void) {
@@ -2217,6 +2277,45 @@ STATIC mp_obj_t lora_stats(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_stats_obj, lora_stats);
 
+STATIC mp_obj_t lora_aggregation_stats(mp_obj_t self_in) {
+    static const qstr lora_aggregation_stats_fields[] = {
+        MP_QSTR_payloads, MP_QSTR_frames, MP_QSTR_frames_saved, MP_QSTR_flush_full,
+        MP_QSTR_flush_deadline, MP_QSTR_flush_change, MP_QSTR_dropped, MP_QSTR_pending
+    };
+
+    // a snapshot, the LoRa task may be updating the counters
+    aggregate_stats_t stats = lora_aggregate.stats;
+    mp_obj_t stats_tuple[8];
+    stats_tuple[0] = mp_obj_new_int_from_uint(stats.payloads);
+    stats_tuple[1] = mp_obj_new_int_from_uint(stats.frames);
+    stats_tuple[2] = mp_obj_new_int_from_uint(stats.frames_saved);
+    stats_tuple[3] = mp_obj_new_int_from_uint(stats.flush_full);
+    stats_tuple[4] = mp_obj_new_int_from_uint(stats.flush_deadline);
+    stats_tuple[5] = mp_obj_new_int_from_uint(stats.flush_change);
+    stats_tuple[6] = mp_obj_new_int_from_uint(stats.dropped);
+    stats_tuple[7] = mp_obj_new_int(lora_aggregate.count);
+
+    return mp_obj_new_attrtuple(lora_aggregation_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_aggregation_stats_obj, lora_aggregation_stats);
+
+STATIC mp_obj_t lora_rx_stats(mp_obj_t self_in) {
+    static const qstr lora_rx_stats_fields[] = {
+        MP_QSTR_received, MP_QSTR_dropped, MP_QSTR_high_water, MP_QSTR_pending
+    };
+
+    // a snapshot, the radio may be putting packets in the ring
+    rxring_stats_t stats = lora_rx_ring.stats;
+    mp_obj_t stats_tuple[4];
+    stats_tuple[0] = mp_obj_new_int_from_uint(stats.received);
+    stats_tuple[1] = mp_obj_new_int_from_uint(stats.dropped);
+    stats_tuple[2] = mp_obj_new_int_from_uint(stats.high_water);
+    stats_tuple[3] = mp_obj_new_int_from_uint(rxring_used(&lora_rx_ring));
+
+    return mp_obj_new_attrtuple(lora_rx_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_rx_stats_obj, lora_rx_stats);
+
 STATIC mp_obj_t lora_has_joined(mp_obj_t self_in) {
     lora_obj_t *self = self_in;
     return self->joined ? mp_const_true : mp_const_false;
@@ -2451,6 +2550,8 @@ STATIC const mp_map_elem_t lora_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_sf),                    (mp_obj_t)&lora_sf_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_power_mode),            (mp_obj_t)&lora_power_mode_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_stats),                 (mp_obj_t)&lora_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_aggregation_stats),     (mp_obj_t)&lora_aggregation_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rx_stats),              (mp_obj_t)&lora_rx_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_has_joined),            (mp_obj_t)&lora_has_joined_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_add_channel),           (mp_obj_t)&lora_add_channel_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_remove_channel),        (mp_obj_t)&lora_remove_channel_obj },
@@ -2682,6 +2783,14 @@ static int lora_socket_setsockopt(mod_network_socket_obj_t *s, mp_uint_t level,
             return -1;
         }
         LORAWAN_SOCKET_SET_DR(s->sock_base.u.sd, *(uint8_t *)optval);
+    } else if (opt == SO_LORAWAN_AGGREGATE) {
+        // the flush deadline in ms, 0 sends each payload in a frame of its own
+        // again (what is pending goes right away)
+        if (lora_obj.stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+            *_errno = MP_EOPNOTSUPP;
+            return -1;
+        }
+        lora_obj.aggregate_ms = *(uint32_t *)optval;
     } else {
         *_errno = MP_EOPNOTSUPP;
         return -1;
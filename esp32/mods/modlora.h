@@ -18,7 +18,7 @@
  ******************************************************************************/
 #define LORA_PAYLOAD_SIZE_MAX                                   (255)
 #define LORA_CMD_QUEUE_SIZE_MAX                                 (7)
-#define LORA_DATA_QUEUE_SIZE_MAX                                (7)
+#define LORA_RX_RING_SIZE                                       (2048)      // bytes, a power of 2
 #define LORA_CB_QUEUE_SIZE_MAX                                  (7)
 #define LORA_STACK_SIZE                                         (4096)
 #define LORA_TIMER_STACK_SIZE                                   (3072)
@@ -110,6 +110,7 @@ typedef struct {
     uint8_t     port;
     uint8_t     dr;
     bool        confirmed;
+    uint32_t    aggregate_ms;       // 0 unless the payload joins an aggregated frame
 } lora_tx_cmd_data_t;
 
 typedef struct {
@@ -132,14 +133,6 @@ typedef struct {
     lora_cmd_info_u_t           info;
 } lora_cmd_data_t;
 
-///////////////////////////////////////////
-
-typedef struct {
-    uint8_t data[LORA_PAYLOAD_SIZE_MAX + 1];
-    uint8_t len;
-    uint8_t port;
-} lora_rx_data_t;
-
 typedef void ( *modlora_timerCallback )( void );
 /******************************************************************************
  EXPORTED DATA
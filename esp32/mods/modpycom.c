@@ -173,13 +173,26 @@ STATIC mp_obj_t mod_pycom_rgb_led (mp_obj_t o_color) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_pycom_rgb_led_obj, mod_pycom_rgb_led);
 
-STATIC mp_obj_t mod_pycom_ota_start (void) {
-    if (!updater_start()) {
+STATIC mp_obj_t mod_pycom_ota_start (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_offset, ARG_compressed, ARG_delta };
+    STATIC const mp_arg_t allowed_args[] = {
+            { MP_QSTR_offset,           MP_ARG_INT,  {.u_int = 0} },
+            { MP_QSTR_compressed,       MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+            { MP_QSTR_delta,            MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_offset].u_int < 0) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+    if (!updater_start_at(args[ARG_offset].u_int, args[ARG_compressed].u_bool, args[ARG_delta].u_bool)) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_ota_start_obj, mod_pycom_ota_start);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_pycom_ota_start_obj, 0, mod_pycom_ota_start);
 
 STATIC mp_obj_t mod_pycom_ota_write (mp_obj_t data) {
     mp_buffer_info_t bufinfo;
@@ -192,6 +205,11 @@ STATIC mp_obj_t mod_pycom_ota_write (mp_obj_t data) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_pycom_ota_write_obj, mod_pycom_ota_write);
 
+STATIC mp_obj_t mod_pycom_ota_offset (void) {
+    return mp_obj_new_int_from_uint(updater_get_offset());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_ota_offset_obj, mod_pycom_ota_offset);
+
 STATIC mp_obj_t mod_pycom_ota_finish (void) {
     if (!updater_finish()) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
@@ -1004,6 +1022,7 @@ STATIC const mp_map_elem_t pycom_module_globals_table[] = {
         { MP_OBJ_NEW_QSTR(MP_QSTR_rgbled),                          (mp_obj_t)&mod_pycom_rgb_led_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_start),                       (mp_obj_t)&mod_pycom_ota_start_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_write),                       (mp_obj_t)&mod_pycom_ota_write_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_ota_offset),                      (mp_obj_t)&mod_pycom_ota_offset_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_finish),                      (mp_obj_t)&mod_pycom_ota_finish_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_verify),                      (mp_obj_t)&mod_pycom_ota_verify_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_slot),                        (mp_obj_t)&mod_pycom_ota_slot_obj },
@@ -56,6 +56,7 @@
 #include "mptask.h"
 #include "pycom_config.h"
 #include "pycom_general_util.h"
+#include "sniffer/sniffer.h"
 
 /******************************************************************************
  DEFINE TYPES
@@ -74,6 +75,8 @@
 
 #define MAX_WIFI_PKT_PARAMS                    18
 
+#define WLAN_CAPTURE_SIZE_DEFAULT               (16384)
+
 #define SMART_CONF_TASK_STACK_SIZE              4096
 
 #define SMART_CONF_TASK_PRIORITY                5
@@ -117,6 +120,11 @@ static wlan_internal_prom_t wlan_prom_packet[2];
 
 static uint8_t token = 0;
 
+// the capture ring, in place of the ping-pong buffers while it is set up;
+// wlan_obj.mutex guards the buffer against wlan.capture() changing it
+static sniffer_t wlan_capture_ring;
+static uint8_t *wlan_capture_buf = NULL;
+
 // Event bits
 const int CONNECTED_BIT = BIT0;
 
@@ -861,6 +869,31 @@ STATIC void wlan_callback_handler(void* arg)
     }
 }
 
+// returns true when the frame was the first one in the ring, the handler takes
+// everything that follows in the same go
+STATIC bool wlan_capture_frame (const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type) {
+    sniffer_meta_t meta = {
+        .orig_len = pkt->rx_ctrl.sig_len,
+        .timestamp = pkt->rx_ctrl.timestamp,
+        .type = type,
+        .rssi = pkt->rx_ctrl.rssi,
+        .noise_floor = pkt->rx_ctrl.noise_floor,
+        .channel = pkt->rx_ctrl.channel,
+        .rate = pkt->rx_ctrl.sig_mode ? pkt->rx_ctrl.mcs : pkt->rx_ctrl.rate,
+        .sig_mode = pkt->rx_ctrl.sig_mode,
+    };
+    bool first = false;
+
+    xSemaphoreTake(wlan_obj.mutex, portMAX_DELAY);
+    if (wlan_capture_buf != NULL) {
+        bool empty = sniffer_empty(&wlan_capture_ring);
+        // the payload of control frames is not passed on
+        first = sniffer_put(&wlan_capture_ring, &meta, (type != WIFI_PKT_CTRL) ? pkt->payload : NULL) && empty;
+    }
+    xSemaphoreGive(wlan_obj.mutex);
+    return first;
+}
+
 STATIC void promiscuous_callback(void *buf, wifi_promiscuous_pkt_type_t type)
 {
 
@@ -907,6 +940,15 @@ STATIC void promiscuous_callback(void *buf, wifi_promiscuous_pkt_type_t type)
         break;
     }
 
+    if (wlan_capture_buf != NULL)
+    {
+        if (wlan_capture_frame((wifi_promiscuous_pkt_t *)buf, type) && trigger)
+        {
+            mp_irq_queue_interrupt(wlan_callback_handler, &wlan_obj);
+        }
+        return;
+    }
+
     if (trigger && (token != old_token))
     {
         xSemaphoreTake(wlan_obj.mutex, portMAX_DELAY);
@@ -1281,6 +1323,10 @@ mp_obj_t wlan_deinit(mp_obj_t self_in) {
 
         /* stop and free wifi resource */
         esp_wifi_deinit();
+        if (wlan_capture_buf != NULL) {
+            heap_caps_free(wlan_capture_buf);
+            wlan_capture_buf = NULL;
+        }
         mod_wlan_is_deinit = true;
         wlan_obj.started = false;
         mod_network_deregister_nic(&wlan_obj);
@@ -2607,6 +2653,115 @@ STATIC mp_obj_t wlan_packet(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_packet_obj, wlan_packet);
 
+STATIC mp_obj_t wlan_capture(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_size,         MP_ARG_INT,                     {.u_int = WLAN_CAPTURE_SIZE_DEFAULT} },
+        { MP_QSTR_types,        MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = MOD_WLAN_TRIGGER_PKT_ANY} },
+        { MP_QSTR_macs,         MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_rssi,         MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = -128} },
+        { MP_QSTR_snaplen,      MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 0} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    wlan_obj_t *self = pos_args[0];
+
+    mp_int_t size = args[0].u_int;
+    if (size < 0 || (size & (size - 1)) || (size > 0 && size < SNIFFER_RECORD_SIZE(MAX_WIFI_PROM_PKT_SIZE))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "size must be 0 or a power of 2 of at least 8192"));
+    }
+
+    // the EVENT_PKT_* constants are 1 << type
+    sniffer_filter_t filter = {
+        .types = args[1].u_int & SNIFFER_TYPES_ALL,
+        .rssi_min = MAX(-128, MIN(127, args[3].u_int)),
+        .snaplen = MAX(0, MIN(MAX_WIFI_PROM_PKT_SIZE, args[4].u_int)),
+        .mac_count = 0,
+    };
+    if (args[2].u_obj != mp_const_none) {
+        mp_obj_t *macs;
+        size_t mac_count;
+        mp_obj_get_array(args[2].u_obj, &mac_count, &macs);
+        if (mac_count > SNIFFER_MACS_MAX) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "at most %d MAC addresses", SNIFFER_MACS_MAX));
+        }
+        for (size_t m = 0; m < mac_count; m++) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(macs[m], &bufinfo, MP_BUFFER_READ);
+            if (bufinfo.len != 6) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid MAC address"));
+            }
+            memcpy(filter.macs[m], bufinfo.buf, 6);
+        }
+        filter.mac_count = mac_count;
+    }
+
+    uint8_t *buf = NULL;
+    if (size > 0) {
+        buf = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buf == NULL) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "no memory for the capture ring"));
+        }
+    }
+
+    // the WiFi task may be in the middle of a frame
+    xSemaphoreTake(self->mutex, portMAX_DELAY);
+    uint8_t *old_buf = wlan_capture_buf;
+    if (buf != NULL) {
+        sniffer_init(&wlan_capture_ring, buf, size, &filter);
+    }
+    wlan_capture_buf = buf;
+    xSemaphoreGive(self->mutex);
+
+    if (old_buf != NULL) {
+        heap_caps_free(old_buf);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_capture_obj, 1, wlan_capture);
+
+STATIC mp_obj_t wlan_packets_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+
+    if (wlan_capture_buf == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "capture is not enabled"));
+    }
+    // a frame at the snap length must always fit, or it would block the ring
+    uint32_t snaplen = wlan_capture_ring.filter.snaplen ? wlan_capture_ring.filter.snaplen : MAX_WIFI_PROM_PKT_SIZE;
+    if (bufinfo.len < SNIFFER_RECORD_SIZE(snaplen)) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "buffer must hold at least %d bytes", (int)SNIFFER_RECORD_SIZE(snaplen)));
+    }
+
+    // wlan.capture() runs under the GIL as well, the ring stays put without the mutex
+    uint32_t count;
+    return mp_obj_new_int_from_uint(sniffer_read(&wlan_capture_ring, bufinfo.buf, bufinfo.len, &count));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(wlan_packets_into_obj, wlan_packets_into);
+
+STATIC mp_obj_t wlan_capture_stats(mp_obj_t self_in) {
+    static const qstr wlan_capture_stats_fields[] = {
+        MP_QSTR_captured, MP_QSTR_filtered, MP_QSTR_dropped, MP_QSTR_truncated, MP_QSTR_high_water, MP_QSTR_pending
+    };
+
+    if (wlan_capture_buf == NULL) {
+        return mp_const_none;
+    }
+    // a snapshot, the WiFi task may be putting frames in the ring
+    sniffer_stats_t stats = wlan_capture_ring.stats;
+    mp_obj_t stats_tuple[6];
+    stats_tuple[0] = mp_obj_new_int_from_uint(stats.captured);
+    stats_tuple[1] = mp_obj_new_int_from_uint(stats.filtered);
+    stats_tuple[2] = mp_obj_new_int_from_uint(stats.dropped);
+    stats_tuple[3] = mp_obj_new_int_from_uint(stats.truncated);
+    stats_tuple[4] = mp_obj_new_int_from_uint(stats.high_water);
+    stats_tuple[5] = mp_obj_new_int_from_uint(sniffer_used(&wlan_capture_ring));
+
+    return mp_obj_new_attrtuple(wlan_capture_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_capture_stats_obj, wlan_capture_stats);
+
 STATIC mp_obj_t wlan_ctrl_pkt_filter(mp_uint_t n_args, const mp_obj_t *args) {
 
     wifi_promiscuous_filter_t  filter_ctrl_mask;
@@ -2663,6 +2818,9 @@ STATIC const mp_map_elem_t wlan_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_callback),            (mp_obj_t)&wlan_callback_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&wlan_events_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_packet),         (mp_obj_t)&wlan_packet_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture),             (mp_obj_t)&wlan_capture_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_packets_into),        (mp_obj_t)&wlan_packets_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_stats),       (mp_obj_t)&wlan_capture_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ctrl_pkt_filter),     (mp_obj_t)&wlan_ctrl_pkt_filter_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_smartConfig),         (mp_obj_t)&wlan_smartConfig_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Connected_ap_pwd),    (mp_obj_t)&wlan_smartConfkey_obj },
@@ -81,6 +81,7 @@
 #define MICROPY_PY_IO                               (1)
 #define MICROPY_PY_IO_FILEIO                        (1)
 #define MICROPY_PY_STRUCT                           (1)
+#define MICROPY_PY_STRUCT_COMPILED                  (1)
 #define MICROPY_PY_SYS                              (1)
 #define MICROPY_PY_THREAD                           (1)
 #define MICROPY_PY_THREAD_GIL                       (1)
@@ -105,10 +106,13 @@
 #define MICROPY_ERROR_REPORTING                     (MICROPY_ERROR_REPORTING_NORMAL)
 #define MICROPY_OPT_COMPUTED_GOTO                   (1)
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE    (0)
+#define MICROPY_OPT_FLOAT_TEMP_REUSE                (1)
 #define MICROPY_REPL_AUTO_INDENT                    (1)
 #define MICROPY_COMP_MODULE_CONST                   (1)
 #define MICROPY_ENABLE_FINALISER                    (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN            (1)
+#define MICROPY_COMP_SINGLE_PASS_BC                 (1)
+#define MICROPY_COMP_FREE_PARSE_TREE                (1)
 #define MICROPY_USE_INTERNAL_PRINTF                 (0)
 #define MICROPY_PY_SYS_EXC_INFO                     (1)
 #define MICROPY_MODULE_FROZEN_STR                   (0)
@@ -116,6 +120,7 @@
 #define MICROPY_PERSISTENT_CODE_LOAD                (1)
 #define MICROPY_QSTR_EXTRA_POOL                     mp_qstr_frozen_const_pool
 #define MICROPY_PY_FRAMEBUF                         (1)
+#define MICROPY_PY_ARRAYOPS                         (1)
 #define MICROPY_PY_UZLIB                            (1)
 
 #define MICROPY_STREAMS_NON_BLOCK                   (1)
@@ -144,6 +149,7 @@
 #define MICROPY_VFS_FAT                             (1)
 
 #define MICROPY_READER_VFS                          (1)
+#define MICROPY_MODULE_IMPORT_CACHE                 (1)
 #define MICROPY_PY_BUILTINS_INPUT                   (1)
 
 // TODO these should be generic, not bound to fatfs
@@ -152,6 +158,8 @@
 
 // use vfs's functions for import stat and builtin open
 #define mp_import_stat mp_vfs_import_stat
+#define mp_import_listdir mp_vfs_import_listdir
+#define mp_import_dir_stamp mp_vfs_import_dir_stamp
 #define mp_builtin_open mp_vfs_open
 #define mp_builtin_open_obj mp_vfs_open_obj
 
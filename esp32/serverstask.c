@@ -61,8 +61,6 @@ extern TaskHandle_t svTaskHandle;
  DECLARE PUBLIC FUNCTIONS
  ******************************************************************************/
 void TASK_Servers (void *pvParameters) {
-    bool cycle = false;
-
     strcpy (servers_user, SERVERS_DEF_USER);
     strcpy (servers_pass, SERVERS_DEF_PASS);
 
@@ -99,11 +97,8 @@ void TASK_Servers (void *pvParameters) {
             modusocket_close_all_user_sockets();
         }
 
-        if (cycle) {
-            telnet_run();
-        } else {
-            ftp_run();
-        }
+        telnet_run();
+        ftp_run();
 
         if (sleep_sockets) {
 //            pybwdt_srv_sleeping(true);  //  FIXME
@@ -124,9 +119,11 @@ void TASK_Servers (void *pvParameters) {
             mp_hal_reset_safe_and_boot(true);
         }
 
-        // move to the next cycle
-        cycle = cycle ? false : true;
-        vTaskDelay (SERVERS_CYCLE_TIME_MS / portTICK_PERIOD_MS);
+        // sleep until one of the ftp sockets needs attention, but no longer
+        // than a cycle so that telnet keeps being serviced
+        if (!ftp_wait(SERVERS_CYCLE_TIME_MS)) {
+            vTaskDelay (SERVERS_CYCLE_TIME_MS / portTICK_PERIOD_MS);
+        }
     }
 }
 
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Checks of the WLAN capture ring with synthetic 802.11 frames:
+//   sniffertest test
+//   sniffertest bench
+// test runs the filter, snap length, wrapping and batch reading checks, then
+// the WiFi task and a reader in two threads; bench measures what a frame
+// costs the WiFi task and the reader, read one by one or in batches.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "sniffer.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define SNIFFERTEST_RING_SIZE               (16384)
+#define SNIFFERTEST_FRAMES                  (1000000)
+#define SNIFFERTEST_FRAME_MAX               (1600)
+#define SNIFFERTEST_OUT_SIZE                (4096)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    sniffer_t           sn;
+    bool                done;
+    uint32_t            read;
+    uint32_t            gaps;               // frames missing between the ones read
+    uint32_t            errors;
+} sniffertest_run_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static const uint8_t sniffertest_ap[6] = { 0x70, 0xB3, 0xD5, 0x00, 0x00, 0x01 };
+static const uint8_t sniffertest_sta[6] = { 0x70, 0xB3, 0xD5, 0x00, 0x00, 0x02 };
+static const uint8_t sniffertest_other[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 };
+static const uint8_t sniffertest_bcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static uint8_t sniffertest_ring[SNIFFERTEST_RING_SIZE];
+static uint32_t sniffertest_failures;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static void sniffertest_check (bool ok, const char *test, const char *what) {
+    printf("%s: %s %s\n", test, what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        sniffertest_failures++;
+    }
+}
+
+static uint32_t sniffertest_random (uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// a MAC header with the three addresses, then a body the reader can check
+static uint32_t sniffertest_frame (uint8_t *frame, uint32_t len, uint8_t type, const uint8_t *a1,
+                                   const uint8_t *a2, const uint8_t *a3, uint8_t fill) {
+    memset(frame, fill, len);
+    frame[0] = type << 2;
+    frame[1] = 0;
+    memcpy(&frame[4], a1, 6);
+    memcpy(&frame[10], a2, 6);
+    memcpy(&frame[16], a3, 6);
+    return len;
+}
+
+static sniffer_meta_t sniffertest_meta (uint8_t type, int8_t rssi, uint32_t len) {
+    sniffer_meta_t meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.type = type;
+    meta.rssi = rssi;
+    meta.noise_floor = -95;
+    meta.channel = 6;
+    meta.orig_len = len;
+    return meta;
+}
+
+static sniffer_filter_t sniffertest_any (void) {
+    sniffer_filter_t filter = { .types = SNIFFER_TYPES_ALL, .rssi_min = -128, .snaplen = 0, .mac_count = 0 };
+    return filter;
+}
+
+static void sniffertest_filters (void) {
+    const char *test = "filter";
+    uint8_t frame[64];
+    sniffer_filter_t filter = sniffertest_any();
+    sniffer_meta_t beacon = sniffertest_meta(SNIFFER_TYPE_MGMT, -60, 64);
+    sniffer_meta_t data = sniffertest_meta(SNIFFER_TYPE_DATA, -80, 64);
+    sniffer_meta_t ctrl = sniffertest_meta(SNIFFER_TYPE_CTRL, -50, 14);
+
+    sniffertest_frame(frame, 64, 0, sniffertest_bcast, sniffertest_ap, sniffertest_ap, 0);
+    bool ok = sniffer_match(&filter, &beacon, frame) && sniffer_match(&filter, &ctrl, NULL);
+    sniffertest_check(ok, test, "lets everything through by default");
+
+    filter.types = (1 << SNIFFER_TYPE_DATA) | (1 << SNIFFER_TYPE_CTRL);
+    ok = !sniffer_match(&filter, &beacon, frame) && sniffer_match(&filter, &data, frame);
+    sniffertest_check(ok, test, "selects the types");
+
+    filter = sniffertest_any();
+    filter.rssi_min = -70;
+    ok = sniffer_match(&filter, &beacon, frame) && !sniffer_match(&filter, &data, frame);
+    sniffertest_check(ok, test, "rejects weak frames");
+
+    filter = sniffertest_any();
+    filter.mac_count = 2;
+    memcpy(filter.macs[0], sniffertest_other, 6);
+    memcpy(filter.macs[1], sniffertest_sta, 6);
+    ok = !sniffer_match(&filter, &beacon, frame);
+    sniffertest_frame(frame, 64, 2, sniffertest_sta, sniffertest_ap, sniffertest_ap, 0);
+    ok &= sniffer_match(&filter, &data, frame);
+    sniffertest_frame(frame, 64, 2, sniffertest_ap, sniffertest_sta, sniffertest_ap, 0);
+    ok &= sniffer_match(&filter, &data, frame);
+    sniffertest_frame(frame, 64, 2, sniffertest_ap, sniffertest_ap, sniffertest_sta, 0);
+    ok &= sniffer_match(&filter, &data, frame);
+    sniffertest_check(ok, test, "matches any of the addresses");
+
+    // addr3 of an 18 byte frame is not there
+    data.orig_len = 18;
+    ok = !sniffer_match(&filter, &data, frame) && !sniffer_match(&filter, &ctrl, NULL);
+    sniffertest_check(ok, test, "ignores addresses beyond the frame");
+}
+
+// parses what sniffer_read returned and checks the frames against their seq
+static bool sniffertest_parse (const uint8_t *out, uint32_t bytes, uint32_t count, uint16_t *seq, uint32_t *frames, uint32_t *gaps) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sniffer_meta_t meta;
+        if (offset + SNIFFER_META_SIZE > bytes) {
+            return false;
+        }
+        memcpy(&meta, &out[offset], SNIFFER_META_SIZE);
+        const uint8_t *frame = &out[offset + SNIFFER_META_SIZE];
+        if (meta.len > meta.orig_len || offset + SNIFFER_RECORD_SIZE(meta.len) > bytes) {
+            return false;
+        }
+        for (uint32_t b = 22; b < meta.len; b++) {
+            if (frame[b] != (uint8_t)meta.seq) {
+                return false;
+            }
+        }
+        if (gaps) {
+            *gaps += (uint16_t)(meta.seq - *seq);
+        } else if (meta.seq != *seq) {
+            return false;
+        }
+        *seq = meta.seq + 1;
+        (*frames)++;
+        offset += SNIFFER_RECORD_SIZE(meta.len);
+    }
+    return offset == bytes;
+}
+
+static void sniffertest_ring_checks (void) {
+    const char *test = "ring";
+    sniffer_t sn;
+    uint8_t frame[SNIFFERTEST_FRAME_MAX];
+    uint8_t out[SNIFFERTEST_OUT_SIZE];
+    uint32_t count, frames = 0;
+    uint16_t seq = 0;
+    sniffer_filter_t filter = sniffertest_any();
+    filter.snaplen = 200;
+    sniffer_init(&sn, sniffertest_ring, 1024, &filter);
+
+    // 16 + 100, 16 + 300 cut to 200, ctrl with nothing kept: 116 + 216 + 16
+    sniffer_meta_t meta = sniffertest_meta(SNIFFER_TYPE_DATA, -40, 100);
+    sniffertest_frame(frame, 100, 2, sniffertest_sta, sniffertest_ap, sniffertest_ap, 0);
+    bool ok = sniffer_put(&sn, &meta, frame) && meta.seq == 0 && meta.len == 100;
+    meta = sniffertest_meta(SNIFFER_TYPE_MGMT, -40, 300);
+    sniffertest_frame(frame, 300, 0, sniffertest_bcast, sniffertest_ap, sniffertest_ap, 1);
+    ok &= sniffer_put(&sn, &meta, frame) && meta.len == 200 && sn.stats.truncated == 1;
+    meta = sniffertest_meta(SNIFFER_TYPE_CTRL, -40, 14);
+    ok &= sniffer_put(&sn, &meta, NULL) && meta.len == 0;
+    sniffertest_check(ok && sniffer_used(&sn) == 116 + 216 + 16, test, "stores frames cut to the snap length");
+
+    // a buffer for the first one only, then the rest
+    uint32_t bytes = sniffer_read(&sn, out, 200, &count);
+    ok = bytes == 116 && count == 1 && sniffertest_parse(out, bytes, count, &seq, &frames, NULL);
+    bytes = sniffer_read(&sn, out, sizeof(out), &count);
+    ok &= bytes == 232 && count == 2 && sniffertest_parse(out, bytes, count, &seq, &frames, NULL);
+    sniffertest_check(ok && sniffer_empty(&sn), test, "reads whole records while they fit");
+
+    // fill up: 348 bytes in, the ring holds 1024
+    meta = sniffertest_meta(SNIFFER_TYPE_DATA, -40, 300);
+    uint32_t put = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        meta = sniffertest_meta(SNIFFER_TYPE_DATA, -40, 300);
+        sniffertest_frame(frame, 300, 2, sniffertest_sta, sniffertest_ap, sniffertest_ap, 3 + put);
+        put += sniffer_put(&sn, &meta, frame);
+    }
+    ok = put == 4 && sn.stats.dropped == 4 && sn.stats.high_water <= 1024;
+    sniffertest_check(ok, test, "drops frames that find the ring full");
+
+    // what comes out wraps around and shows the drops as a gap
+    uint32_t gaps = 0;
+    bytes = sniffer_read(&sn, out, sizeof(out), &count);
+    ok = count == 4 && sniffertest_parse(out, bytes, count, &seq, &frames, &gaps) && gaps == 0;
+    meta = sniffertest_meta(SNIFFER_TYPE_DATA, -40, 300);
+    sniffertest_frame(frame, 300, 2, sniffertest_sta, sniffertest_ap, sniffertest_ap, 11);
+    ok &= sniffer_put(&sn, &meta, frame);
+    bytes = sniffer_read(&sn, out, sizeof(out), &count);
+    ok &= count == 1 && sniffertest_parse(out, bytes, count, &seq, &frames, &gaps) && gaps == 4;
+    sniffertest_check(ok && sniffer_empty(&sn), test, "wraps records around whole, seq shows the drops");
+
+    filter = sniffertest_any();
+    filter.types = 1 << SNIFFER_TYPE_MGMT;
+    sniffer_init(&sn, sniffertest_ring, 1024, &filter);
+    meta = sniffertest_meta(SNIFFER_TYPE_DATA, -40, 100);
+    ok = !sniffer_put(&sn, &meta, frame) && sn.stats.filtered == 1 && sn.stats.dropped == 0 && sn.seq == 0;
+    sniffertest_check(ok && sniffer_empty(&sn), test, "counts the frames filtered out apart");
+}
+
+static void *sniffertest_wifi_task (void *arg) {
+    sniffertest_run_t *run = arg;
+    uint8_t frame[SNIFFERTEST_FRAME_MAX];
+    uint32_t rng = 0xC0FFEE;
+    uint16_t seq = 0;
+    for (uint32_t i = 0; i < SNIFFERTEST_FRAMES; i++) {
+        uint32_t len = 24 + sniffertest_random(&rng) % (SNIFFERTEST_FRAME_MAX - 24);
+        uint8_t type = sniffertest_random(&rng) % 3;
+        sniffer_meta_t meta = sniffertest_meta(type, -30 - (int)(sniffertest_random(&rng) % 70), len);
+        // the body carries the seq the frame will get if it passes the filter
+        sniffertest_frame(frame, len, type, sniffertest_sta, sniffertest_ap, sniffertest_ap, seq);
+        if (sniffer_match(&run->sn.filter, &meta, frame)) {
+            seq++;
+        }
+        sniffer_put(&run->sn, &meta, (type == SNIFFER_TYPE_CTRL) ? NULL : frame);
+        if ((i & 15) == 0) {
+            // frames come in bursts, leaving the reader some time
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&run->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *sniffertest_reader (void *arg) {
+    sniffertest_run_t *run = arg;
+    static uint8_t out[SNIFFERTEST_OUT_SIZE];
+    uint16_t seq = 0;
+    for ( ; ; ) {
+        bool done = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+        uint32_t count;
+        uint32_t bytes = sniffer_read(&run->sn, out, sizeof(out), &count);
+        if (count == 0) {
+            if (done && sniffer_empty(&run->sn)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if (!sniffertest_parse(out, bytes, count, &seq, &run->read, &run->gaps)) {
+            run->errors++;
+        }
+    }
+    return NULL;
+}
+
+static void sniffertest_threads (void) {
+    const char *test = "threads";
+    static sniffertest_run_t run;
+    pthread_t wifi, reader;
+    sniffer_filter_t filter = sniffertest_any();
+    filter.rssi_min = -90;
+    filter.snaplen = 512;
+
+    memset(&run, 0, sizeof(run));
+    sniffer_init(&run.sn, sniffertest_ring, SNIFFERTEST_RING_SIZE, &filter);
+    pthread_create(&reader, NULL, sniffertest_reader, &run);
+    pthread_create(&wifi, NULL, sniffertest_wifi_task, &run);
+    pthread_join(wifi, NULL);
+    pthread_join(reader, NULL);
+
+    const sniffer_stats_t *stats = &run.sn.stats;
+    printf("%s: %u captured, %u filtered, %u dropped, %u truncated, high water %u bytes\n", test,
+           (unsigned)stats->captured, (unsigned)stats->filtered, (unsigned)stats->dropped,
+           (unsigned)stats->truncated, (unsigned)stats->high_water);
+    sniffertest_check(run.errors == 0, test, "frames come out intact and in order");
+    sniffertest_check(run.read == stats->captured && run.gaps == stats->dropped &&
+                      stats->captured + stats->filtered + stats->dropped == SNIFFERTEST_FRAMES, test, "counters add up");
+    sniffertest_check(stats->filtered > 0 && stats->truncated > 0, test, "filters and cuts");
+}
+
+static int sniffertest_test (void) {
+    sniffertest_failures = 0;
+    sniffertest_filters();
+    sniffertest_ring_checks();
+    sniffertest_threads();
+    printf("%s\n", sniffertest_failures ? "FAILED" : "all passed");
+    return sniffertest_failures ? 1 : 0;
+}
+
+static double sniffertest_ns (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int sniffertest_bench (void) {
+    sniffer_t sn;
+    static uint8_t frame[SNIFFERTEST_FRAME_MAX];
+    static uint8_t out[SNIFFERTEST_RING_SIZE];
+    static const uint32_t batches[] = { 1, 8, 64 };
+    const uint32_t rounds = 2000000;
+    sniffer_filter_t filter = sniffertest_any();
+    filter.snaplen = 256;
+    uint32_t count;
+
+    // a typical capture: beacons and short data frames, cut to 256 bytes
+    sniffertest_frame(frame, 300, 0, sniffertest_bcast, sniffertest_ap, sniffertest_ap, 0);
+    for (uint32_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        sniffer_init(&sn, sniffertest_ring, SNIFFERTEST_RING_SIZE, &filter);
+        double start = sniffertest_ns();
+        for (uint32_t r = 0; r < rounds; r += batches[b]) {
+            for (uint32_t i = 0; i < batches[b]; i++) {
+                sniffer_meta_t meta = sniffertest_meta(SNIFFER_TYPE_MGMT, -50, 100 + (i & 1) * 200);
+                sniffer_put(&sn, &meta, frame);
+            }
+            sniffer_read(&sn, out, sizeof(out), &count);
+        }
+        printf("batches of %2u: %.1f ns a frame (%u dropped)\n", (unsigned)batches[b],
+               (sniffertest_ns() - start) / rounds, (unsigned)sn.stats.dropped);
+    }
+
+    filter.mac_count = SNIFFER_MACS_MAX;
+    for (uint32_t m = 0; m < SNIFFER_MACS_MAX; m++) {
+        memcpy(filter.macs[m], sniffertest_other, 6);
+        filter.macs[m][5] += m;
+    }
+    sniffer_meta_t meta = sniffertest_meta(SNIFFER_TYPE_MGMT, -50, 300);
+    double start = sniffertest_ns();
+    uint32_t matched = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        matched += sniffer_match(&filter, &meta, frame);
+    }
+    printf("filter of %u addresses: %.1f ns a frame that fails it (%u matched)\n", (unsigned)SNIFFER_MACS_MAX,
+           (sniffertest_ns() - start) / rounds, (unsigned)matched);
+    return 0;
+}
+
+int main (int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "test") == 0) {
+        return sniffertest_test();
+    } else if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+        return sniffertest_bench();
+    }
+    fprintf(stderr, "usage: %s test | bench\n", argv[0]);
+    return 2;
+}
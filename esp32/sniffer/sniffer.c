@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <string.h>
+
+#include "sniffer.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+// where addr1, addr2 and addr3 sit in an 802.11 MAC header
+static const uint8_t sniffer_addr_offsets[] = { 4, 10, 16 };
+
+typedef char sniffer_meta_size_check[(sizeof(sniffer_meta_t) == SNIFFER_META_SIZE) ? 1 : -1];
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// the head and the tail are published with release semantics, so that the
+// other side sees the record (or the free space) before the index moving
+static inline uint32_t sniffer_load (const uint32_t *index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static inline void sniffer_store (uint32_t *index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void sniffer_init (sniffer_t *sn, uint8_t *buf, uint32_t size, const sniffer_filter_t *filter) {
+    memset(sn, 0, sizeof(*sn));
+    sn->buf = buf;
+    sn->size = size;
+    sn->filter = *filter;
+}
+
+bool sniffer_match (const sniffer_filter_t *filter, const sniffer_meta_t *meta, const uint8_t *frame) {
+    if (!(filter->types & (1 << meta->type)) || meta->rssi < filter->rssi_min) {
+        return false;
+    }
+    if (filter->mac_count == 0) {
+        return true;
+    }
+    if (frame == NULL) {
+        return false;
+    }
+    for (uint32_t a = 0; a < sizeof(sniffer_addr_offsets); a++) {
+        uint32_t offset = sniffer_addr_offsets[a];
+        if (offset + 6 > meta->orig_len) {
+            break;
+        }
+        for (uint32_t m = 0; m < filter->mac_count; m++) {
+            if (memcmp(&frame[offset], filter->macs[m], 6) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool sniffer_put (sniffer_t *sn, sniffer_meta_t *meta, const uint8_t *frame) {
+    if (!sniffer_match(&sn->filter, meta, frame)) {
+        sn->stats.filtered++;
+        return false;
+    }
+    meta->seq = sn->seq++;
+    meta->len = (frame != NULL) ? meta->orig_len : 0;
+    if (sn->filter.snaplen && meta->len > sn->filter.snaplen) {
+        meta->len = sn->filter.snaplen;
+        sn->stats.truncated++;
+    }
+
+    uint32_t head = sn->head;
+    uint32_t tail = sniffer_load(&sn->tail);
+    uint32_t need = SNIFFER_RECORD_SIZE(meta->len);
+    uint32_t pos = head & (sn->size - 1);
+    // a record is kept in one piece, so that the reader copies it in one go
+    uint32_t skip = (sn->size - pos < need) ? sn->size - pos : 0;
+    if ((head - tail) + skip + need > sn->size) {
+        sn->stats.dropped++;
+        return false;
+    }
+    if (skip) {
+        uint16_t wrap = SNIFFER_WRAP;
+        memcpy(&sn->buf[pos], &wrap, sizeof(wrap));
+        head += skip;
+        pos = 0;
+    }
+    memcpy(&sn->buf[pos], meta, SNIFFER_META_SIZE);
+    if (meta->len) {
+        memcpy(&sn->buf[pos + SNIFFER_META_SIZE], frame, meta->len);
+    }
+    head += need;
+    sniffer_store(&sn->head, head);
+
+    sn->stats.captured++;
+    if (head - tail > sn->stats.high_water) {
+        sn->stats.high_water = head - tail;
+    }
+    return true;
+}
+
+uint32_t sniffer_read (sniffer_t *sn, uint8_t *out, uint32_t size, uint32_t *count) {
+    uint32_t tail = sn->tail;
+    uint32_t head = sniffer_load(&sn->head);
+    uint32_t done = 0;
+
+    *count = 0;
+    while (tail != head) {
+        uint32_t pos = tail & (sn->size - 1);
+        uint16_t len;
+        memcpy(&len, &sn->buf[pos], sizeof(len));
+        if (len == SNIFFER_WRAP) {
+            tail += sn->size - pos;
+            continue;
+        }
+        uint32_t record = SNIFFER_RECORD_SIZE(len);
+        if (done + record > size) {
+            break;
+        }
+        memcpy(&out[done], &sn->buf[pos], record);
+        done += record;
+        tail += record;
+        (*count)++;
+    }
+    sniffer_store(&sn->tail, tail);
+    return done;
+}
+
+bool sniffer_empty (const sniffer_t *sn) {
+    return sniffer_load(&sn->tail) == sniffer_load(&sn->head);
+}
+
+uint32_t sniffer_used (const sniffer_t *sn) {
+    return sniffer_load(&sn->head) - sniffer_load(&sn->tail);
+}
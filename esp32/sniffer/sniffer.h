@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef SNIFFER_H_
+#define SNIFFER_H_
+
+// Capture ring of the WLAN promiscuous mode. The frames that pass the filter
+// (type, RSSI, any of the addresses) are stored with their metadata, cut to
+// the snap length, by the WiFi task; the application takes as many as fit in
+// its buffer at once, in the same layout as in the ring:
+//   sniffer_meta_t (16 bytes) | frame (meta.len bytes) | padding to 4 bytes
+// The WiFi task only moves the head and the reader only moves the tail.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// frame types, as wifi_promiscuous_pkt_type_t; the filter takes 1 << type
+#define SNIFFER_TYPE_MGMT                       (0)
+#define SNIFFER_TYPE_CTRL                       (1)
+#define SNIFFER_TYPE_DATA                       (2)
+#define SNIFFER_TYPE_MISC                       (3)
+#define SNIFFER_TYPES_ALL                       (0x0F)
+
+#define SNIFFER_MACS_MAX                        (4)
+#define SNIFFER_META_SIZE                       (16)
+#define SNIFFER_WRAP                            (0xFFFF)
+#define SNIFFER_RECORD_SIZE(len)                ((SNIFFER_META_SIZE + (len) + 3) & ~3)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// little endian on the device and the host alike; ustruct format '<HHIBbbBBBH'
+typedef struct {
+    uint16_t                len;                // bytes of the frame kept
+    uint16_t                orig_len;           // bytes of the frame on air
+    uint32_t                timestamp;          // us
+    uint8_t                 type;
+    int8_t                  rssi;
+    int8_t                  noise_floor;
+    uint8_t                 channel;
+    uint8_t                 rate;               // the MCS for HT frames
+    uint8_t                 sig_mode;           // 0 for 11bg, 1 for HT (11n)
+    uint16_t                seq;                // of the capture, gaps show the frames dropped
+} sniffer_meta_t;
+
+typedef struct {
+    uint8_t                 types;              // bit mask of 1 << type
+    int8_t                  rssi_min;
+    uint16_t                snaplen;            // 0 keeps whole frames
+    uint8_t                 mac_count;          // 0 matches any frame
+    uint8_t                 macs[SNIFFER_MACS_MAX][6];
+} sniffer_filter_t;
+
+typedef struct {
+    uint32_t                captured;
+    uint32_t                filtered;           // rejected by the filter
+    uint32_t                dropped;            // found the ring full
+    uint32_t                truncated;          // cut to the snap length
+    uint32_t                high_water;         // most bytes ever in use
+} sniffer_stats_t;
+
+typedef struct {
+    uint8_t                 *buf;
+    uint32_t                size;               // a power of 2
+    uint32_t                head;               // free running, written by the WiFi task
+    uint32_t                tail;               // free running, written by the reader
+    uint16_t                seq;
+    sniffer_filter_t        filter;
+    sniffer_stats_t         stats;
+} sniffer_t;
+
+/******************************************************************************
+ DECLARE EXPORTED FUNCTIONS
+ ******************************************************************************/
+extern void sniffer_init (sniffer_t *sn, uint8_t *buf, uint32_t size, const sniffer_filter_t *filter);
+
+// whether the frame passes the filter; frames without the addresses
+// (control frames, whose payload is not kept) fail an address filter
+extern bool sniffer_match (const sniffer_filter_t *filter, const sniffer_meta_t *meta, const uint8_t *frame);
+
+// WiFi task side; meta->orig_len is the length of the frame, meta->len and
+// meta->seq are filled in. Returns true if the frame was stored
+extern bool sniffer_put (sniffer_t *sn, sniffer_meta_t *meta, const uint8_t *frame);
+
+// reader side; copies whole records into out while they fit, returns the
+// number of bytes and the number of frames in *count
+extern uint32_t sniffer_read (sniffer_t *sn, uint8_t *out, uint32_t size, uint32_t *count);
+
+extern bool sniffer_empty (const sniffer_t *sn);
+extern uint32_t sniffer_used (const sniffer_t *sn);
+
+#endif /* SNIFFER_H_ */
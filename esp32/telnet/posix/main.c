@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Loopback throughput test of the telnet core:
+//   telnetbench [-c clients] [-b bytes] [-w write size]
+// The server runs in its own thread cycling like the servers task does, the
+// clients log in over TCP (the first one gets the REPL, the others follow
+// it), and the main thread prints like the interpreter does, measuring how
+// long each telnet_tx_strn() call holds it up.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+#include "telnet.h"
+#include "telnetport.h"
+
+#define BENCH_CYCLE_US                      2000        // SERVERS_CYCLE_TIME_MS
+#define BENCH_CLIENTS_MAX                   8
+#define BENCH_END                           "#END#\r\n"
+
+typedef struct {
+    pthread_t           thread;
+    uint64_t            received;
+    bool                ready;
+    bool                done;
+} bench_client_t;
+
+extern void telnet_posix_set_server_thread (pthread_t thread);
+
+static volatile bool bench_stop;
+static bench_client_t bench_clients[BENCH_CLIENTS_MAX];
+
+static uint64_t bench_now_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *bench_server (void *arg) {
+    (void)arg;
+    while (!bench_stop) {
+        telnet_run();
+        usleep(BENCH_CYCLE_US);
+    }
+    return NULL;
+}
+
+// reads until the text is seen, false on errors
+static bool bench_expect (int sd, const char *text) {
+    char buf[512];
+    uint32_t len = 0;
+    while (len < sizeof(buf) - 1) {
+        ssize_t n = recv(sd, buf + len, 1, 0);
+        if (n <= 0) {
+            return false;
+        }
+        len += n;
+        buf[len] = '\0';
+        if (strstr(buf, text)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *bench_client (void *arg) {
+    bench_client_t *c = arg;
+    int sd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(TELNET_PORT), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    struct timeval tv = { .tv_sec = 5 };
+    setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (connect(sd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        usleep(10000);
+        if (bench_stop) {
+            return NULL;
+        }
+    }
+    if (!bench_expect(sd, "Login as: ") || send(sd, "micro\r", 6, 0) != 6 ||
+        // the server drops what is typed before it sends the password options
+        !bench_expect(sd, "Password: ") || !bench_expect(sd, "\xff\xfb\x01") || send(sd, "python\r", 7, 0) != 7 ||
+        !bench_expect(sd, "Login succeeded!\r\n")) {
+        printf("client %d: login failed\n", (int)(c - bench_clients));
+        close(sd);
+        c->done = true;
+        return NULL;
+    }
+    c->ready = true;
+
+    // count everything up to the end marker
+    char buf[4096];
+    char tail[sizeof(BENCH_END)] = {0};
+    for ( ; ; ) {
+        ssize_t n = recv(sd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            break;
+        }
+        c->received += n;
+        for (ssize_t i = 0; i < n; i++) {
+            memmove(tail, tail + 1, sizeof(tail) - 2);
+            tail[sizeof(tail) - 2] = buf[i];
+        }
+        if (memcmp(tail, BENCH_END, sizeof(BENCH_END) - 1) == 0) {
+            break;
+        }
+    }
+    close(sd);
+    c->done = true;
+    return NULL;
+}
+
+int main (int argc, char **argv) {
+    uint32_t clients = 2;
+    uint64_t total = 4 * 1024 * 1024;
+    uint32_t write_size = 40;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:b:w:")) != -1) {
+        switch (opt) {
+        case 'c': clients = atoi(optarg); break;
+        case 'b': total = strtoull(optarg, NULL, 0); break;
+        case 'w': write_size = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-c clients] [-b bytes] [-w write size]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (clients < 1 || clients > BENCH_CLIENTS_MAX || clients > TELNET_SESSIONS_MAX || write_size < 1) {
+        fprintf(stderr, "1 to %d clients, and a write size of at least 1\n", TELNET_SESSIONS_MAX);
+        return 2;
+    }
+    // a client going away in the middle of a send must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_t server;
+    telnet_init();
+    telnet_enable();
+    pthread_create(&server, NULL, bench_server, NULL);
+    telnet_posix_set_server_thread(server);
+
+    // the REPL goes to the first client logged in
+    for (uint32_t i = 0; i < clients; i++) {
+        pthread_create(&bench_clients[i].thread, NULL, bench_client, &bench_clients[i]);
+        while (!bench_clients[i].ready && !bench_clients[i].done) {
+            usleep(1000);
+        }
+        if (bench_clients[i].done) {
+            bench_stop = true;
+            return 1;
+        }
+    }
+    // let the prompt go out first
+    usleep(50000);
+    for (uint32_t i = 0; i < clients; i++) {
+        bench_clients[i].received = 0;
+    }
+
+    char *line = malloc(write_size);
+    for (uint32_t i = 0; i < write_size; i++) {
+        line[i] = (i == write_size - 1) ? '\n' : 'a' + i % 26;
+    }
+    uint64_t writes = 0, worst = 0;
+    uint64_t start = bench_now_us();
+    for (uint64_t sent = 0; sent < total; sent += write_size) {
+        uint64_t t = bench_now_us();
+        telnet_tx_strn(line, write_size);
+        t = bench_now_us() - t;
+        worst = (t > worst) ? t : worst;
+        writes++;
+    }
+    uint64_t written = bench_now_us() - start;
+    telnet_tx_strn(BENCH_END, strlen(BENCH_END));
+    for (uint32_t i = 0; i < clients; i++) {
+        pthread_join(bench_clients[i].thread, NULL);
+    }
+    uint64_t elapsed = bench_now_us() - start;
+
+    printf("%llu bytes in %u byte writes: %.1f MB/s to the REPL, %.2f us per write (worst %llu us)\n",
+           (unsigned long long)total, (unsigned)write_size, bench_clients[0].received / (double)elapsed,
+           written / (double)writes, (unsigned long long)worst);
+    for (uint32_t i = 1; i < clients; i++) {
+        printf("  follower %u received %.1f%%\n", (unsigned)i, 100.0 * bench_clients[i].received / bench_clients[0].received);
+    }
+
+    bench_stop = true;
+    pthread_join(server, NULL);
+    free(line);
+    return (bench_clients[0].received >= total) ? 0 : 1;
+}
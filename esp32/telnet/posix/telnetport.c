@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+// Port of the telnet server core to POSIX sockets and threads, so that it can
+// be run and benchmarked on a PC. The thread calling telnet_run() must be
+// registered with telnet_posix_set_server_thread().
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "telnet.h"
+#include "telnetport.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static pthread_mutex_t telnet_posix_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t telnet_posix_server_thread;
+static const char *telnet_posix_user = "micro";
+static const char *telnet_posix_pass = "python";
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void telnet_posix_set_server_thread (pthread_t thread) {
+    telnet_posix_server_thread = thread;
+}
+
+/******************************************************************************
+ DEFINE PORT FUNCTIONS
+ ******************************************************************************/
+void telnet_port_init (void) {
+}
+
+void *telnet_port_malloc (uint32_t size) {
+    return malloc(size);
+}
+
+void telnet_port_free (void *ptr) {
+    free(ptr);
+}
+
+uint32_t telnet_port_ticks_ms (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void telnet_port_delay_ms (uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+void telnet_port_lock (void) {
+    pthread_mutex_lock(&telnet_posix_mutex);
+}
+
+void telnet_port_unlock (void) {
+    pthread_mutex_unlock(&telnet_posix_mutex);
+}
+
+bool telnet_port_can_wait (void) {
+    return !pthread_equal(pthread_self(), telnet_posix_server_thread);
+}
+
+const char *telnet_port_user (void) {
+    return telnet_posix_user;
+}
+
+const char *telnet_port_pass (void) {
+    return telnet_posix_pass;
+}
+
+uint32_t telnet_port_timeout_ms (void) {
+    return 300000;
+}
+
+const char *telnet_port_welcome (void) {
+    return "MicroPython telnet core on POSIX\r\n";
+}
+
+void telnet_port_socket_add (int32_t sd) {
+    (void)sd;
+}
+
+void telnet_port_socket_close (int32_t *sd) {
+    if (*sd > 0) {
+        close(*sd);
+        *sd = -1;
+    }
+}
+
+int telnet_port_interrupt_char (void) {
+    return 3;
+}
+
+void telnet_port_keyboard_interrupt (void) {
+}
+
+void telnet_port_safe_boot (void) {
+}
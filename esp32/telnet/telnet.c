@@ -10,44 +10,25 @@
 #include <stdint.h>
 #include <string.h>
 
-#include "py/mpconfig.h"
-#include "py/obj.h"
-#include "py/mphal.h"
-#include "readline.h"
 #include "telnet.h"
-#include "serverstask.h"
-
-#include "esp_heap_caps.h"
-#include "sdkconfig.h"
-#include "esp_system.h"
-#include "esp_spi_flash.h"
-#include "nvs_flash.h"
-
-#include "modnetwork.h"
-//#include "modwlan.h"
-#include "modusocket.h"
-//#include "debug.h"
-#include "utils/interrupt_char.h"
-#include "genhdr/mpversion.h"
-
-#include "lwip/sockets.h"
-#include "lwip/dns.h"
-#include "lwip/netdb.h"
-
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "telnetport.h"
 
 /******************************************************************************
  DEFINE PRIVATE CONSTANTS
  ******************************************************************************/
-#define TELNET_PORT                         23
 // rxRindex and rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256
 #define TELNET_RX_BUFFER_SIZE               256
-#define TELNET_MAX_CLIENTS                  1
+// login input, and the input of the read-only sessions which is discarded
+#define TELNET_SESSION_RX_SIZE              64
+#define TELNET_LOGIN_LEN_MAX                32
 #define TELNET_TX_RETRIES_MAX               50
 #define TELNET_WAIT_TIME_MS                 2
 #define TELNET_LOGIN_RETRIES_MAX            3
-#define TELNET_CYCLE_TIME_MS                (SERVERS_CYCLE_TIME_MS * 2)
+
+#define TELNET_TX_RING_MASK                 (TELNET_TX_RING_SIZE - 1)
+
+#define TELNET_CHAR_CTRL_D                  4
+#define TELNET_CHAR_CTRL_F                  6
 
 #define SE 240
 #define AYT 246
@@ -76,11 +57,15 @@ typedef enum {
 typedef enum {
     E_TELNET_STE_DISABLED = 0,
     E_TELNET_STE_START,
-    E_TELNET_STE_LISTEN,
-    E_TELNET_STE_CONNECTED,
-    E_TELNET_STE_LOGGED_IN
+    E_TELNET_STE_READY
 } telnet_state_t;
 
+typedef enum {
+    E_TELNET_STE_SESSION_FREE = 0,
+    E_TELNET_STE_SESSION_CONNECTED,
+    E_TELNET_STE_SESSION_LOGGED_IN
+} telnet_session_state_t;
+
 typedef enum {
     E_TELNET_STE_SUB_WELCOME,
     E_TELNET_STE_SUB_SND_USER_OPTIONS,
@@ -94,42 +79,56 @@ typedef enum {
     E_TELNET_STE_SUB_LOGIN_SUCCESS
 } telnet_connected_substate_t;
 
-typedef union {
-    telnet_connected_substate_t connected;
-} telnet_substate_t;
+typedef struct {
+    int32_t                     sd;
+    telnet_session_state_t      state;
+    telnet_connected_substate_t substate;
+    uint32_t                    activity;       // ticks of the last data received or sent
+    uint32_t                    txTail;         // position in the output ring sent up to
+    uint32_t                    txSince;        // ticks since output is waiting
+    bool                        txWaiting;
+
+    uint8_t                     rx[TELNET_SESSION_RX_SIZE];
+    uint8_t                     rxWindex;
+
+    // the start of an IAC sequence split between two receptions
+    uint8_t                     iac[2];
+    uint8_t                     iacLen;
+
+    uint8_t                     txRetries;
+    uint8_t                     loginRetries;
+    bool                        credentialsValid;
+    bool                        binary_mode;
+} telnet_session_t;
 
 typedef struct {
+    // input of the REPL session
     uint8_t             *rxBuffer;
-    uint32_t            timeout;
-    telnet_state_t      state;
-    telnet_substate_t   substate;
-    int32_t             sd;
-    int32_t             n_sd;
-
     // rxRindex and rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256
     uint8_t             rxWindex;
     uint8_t             rxRindex;
 
-    // used to store incoming chars in cases the reception needs to be
-    // completed later
-    uint8_t             rxIncompleteLen;
+    // REPL output, every session sends it from its own txTail up to txHead
+    uint8_t             *txRing;
+    uint32_t            txHead;
 
-    uint8_t             txRetries;
-    uint8_t             loginRetries;
+    telnet_session_t    sessions[TELNET_SESSIONS_MAX];
+    telnet_session_t    *repl;              // the session that owns the REPL, if any
+    telnet_state_t      state;
+    int32_t             sd;
     bool                enabled;
-    bool                credentialsValid;
-    bool                binary_mode;
 } telnet_data_t;
 
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
 static telnet_data_t telnet_data;
-static const char* telnet_welcome_msg       = "MicroPython " MICROPY_GIT_TAG " on " MICROPY_BUILD_DATE "; " MICROPY_HW_BOARD_NAME " with " MICROPY_HW_MCU_NAME "\r\n";
 static const char* telnet_request_user      = "Login as: ";
 static const char* telnet_request_password  = "Password: ";
 static const char* telnet_invalid_login    = "\r\nInvalid credentials, try again.\r\n";
 static const char* telnet_login_success    = "\r\nLogin succeeded!\r\nType \"help()\" for more information.\r\n";
+static const char* telnet_login_follower   = "\r\nLogin succeeded!\r\nThe REPL is in use, this session only shows its output.\r\n";
+static const char* telnet_repl_handover    = "\r\nThis session has the REPL now.\r\n";
 static const uint8_t telnet_options_user[]  = { IAC, WONT, ECHO, IAC, WONT, SUPPRESS_GO_AHEAD, IAC, WILL, LINEMODE };
 static const uint8_t telnet_options_pass[]  = { IAC, WILL, ECHO, IAC, WONT, SUPPRESS_GO_AHEAD, IAC, WILL, LINEMODE };
 static const uint8_t telnet_options_repl[]  = { IAC, WILL, ECHO, IAC, WILL, SUPPRESS_GO_AHEAD, IAC, WONT, LINEMODE };
@@ -139,133 +138,100 @@ static const uint8_t telnet_options_repl[]  = { IAC, WILL, ECHO, IAC, WILL, SUPP
  ******************************************************************************/
 static void telnet_wait_for_enabled (void);
 static bool telnet_create_socket (void);
-static void telnet_wait_for_connection (void);
-static void telnet_send_and_proceed (void *data, int32_t Len, telnet_connected_substate_t next_state);
-static telnet_result_t telnet_send_non_blocking (void *data, int32_t Len);
-static telnet_result_t telnet_recv_text_non_blocking (void *buff, int32_t Maxlen, int32_t *rxLen);
-static void telnet_process (void);
-static int telnet_process_credential (char *credential, int32_t rxLen);
-static void telnet_parse_input (uint8_t *str, int32_t *len);
-static bool telnet_send_with_retries (int32_t sd, const void *pBuf, int32_t len);
+static void telnet_accept_session (void);
+static void telnet_session_run (telnet_session_t *s, uint32_t now);
+static void telnet_session_login (telnet_session_t *s);
+static void telnet_session_logged_in (telnet_session_t *s);
+static void telnet_session_close (telnet_session_t *s);
+static void telnet_send_and_proceed (telnet_session_t *s, const void *data, int32_t Len, telnet_connected_substate_t next_state);
+static telnet_result_t telnet_send_non_blocking (telnet_session_t *s, const void *data, int32_t Len);
+static telnet_result_t telnet_recv_text_non_blocking (telnet_session_t *s, uint8_t *buff, int32_t Maxlen, int32_t *rxLen);
+static void telnet_process (telnet_session_t *s);
+static void telnet_flush (telnet_session_t *s, uint32_t now);
+static int telnet_process_credential (telnet_session_t *s, const char *credential, int32_t rxLen);
+static void telnet_parse_input (telnet_session_t *s, uint8_t *str, int32_t *len);
 static void telnet_reset_buffer (void);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
 void telnet_init (void) {
-    // allocate memory for the receive buffer (from the RTOS heap)
-    telnet_data.rxBuffer = heap_caps_malloc(TELNET_RX_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    telnet_port_init();
+    // allocate memory for the receive buffer and the output ring
+    telnet_data.rxBuffer = telnet_port_malloc(TELNET_RX_BUFFER_SIZE);
+    telnet_data.txRing = telnet_port_malloc(TELNET_TX_RING_SIZE);
+    telnet_data.sd = -1;
+    for (uint32_t i = 0; i < TELNET_SESSIONS_MAX; i++) {
+        telnet_data.sessions[i].sd = -1;
+        telnet_data.sessions[i].state = E_TELNET_STE_SESSION_FREE;
+    }
     telnet_data.state = E_TELNET_STE_DISABLED;
 }
 
 void telnet_run (void) {
-    int32_t rxLen;
     switch (telnet_data.state) {
         case E_TELNET_STE_DISABLED:
             telnet_wait_for_enabled();
-            break;
+            return;
         case E_TELNET_STE_START:
-            if (/*wlan_is_connected() && */ telnet_create_socket()) {
-                telnet_data.state = E_TELNET_STE_LISTEN;
+            if (telnet_create_socket()) {
+                telnet_data.state = E_TELNET_STE_READY;
             }
-            break;
-        case E_TELNET_STE_LISTEN:
-            telnet_wait_for_connection();
-            break;
-        case E_TELNET_STE_CONNECTED:
-            switch (telnet_data.substate.connected) {
-            case E_TELNET_STE_SUB_WELCOME:
-                telnet_send_and_proceed((void *)telnet_welcome_msg, strlen(telnet_welcome_msg), E_TELNET_STE_SUB_SND_USER_OPTIONS);
-                break;
-            case E_TELNET_STE_SUB_SND_USER_OPTIONS:
-                telnet_send_and_proceed((void *)telnet_options_user, sizeof(telnet_options_user), E_TELNET_STE_SUB_REQ_USER);
-                break;
-            case E_TELNET_STE_SUB_REQ_USER:
-                // to catch any left over characters from the previous actions
-                telnet_recv_text_non_blocking(telnet_data.rxBuffer, TELNET_RX_BUFFER_SIZE, &rxLen);
-                telnet_send_and_proceed((void *)telnet_request_user, strlen(telnet_request_user), E_TELNET_STE_SUB_GET_USER);
-                break;
-            case E_TELNET_STE_SUB_GET_USER:
-                if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(telnet_data.rxBuffer + telnet_data.rxWindex,
-                                                                        TELNET_RX_BUFFER_SIZE - telnet_data.rxWindex,
-                                                                        &rxLen)) {
-                    int result;
-                    if ((result = telnet_process_credential (servers_user, rxLen))) {
-                        telnet_data.credentialsValid = result > 0 ? true : false;
-                        telnet_data.substate.connected = E_TELNET_STE_SUB_REQ_PASSWORD;
-                    }
-                }
-                break;
-            case E_TELNET_STE_SUB_REQ_PASSWORD:
-                telnet_send_and_proceed((void *)telnet_request_password, strlen(telnet_request_password), E_TELNET_STE_SUB_SND_PASSWORD_OPTIONS);
-                break;
-            case E_TELNET_STE_SUB_SND_PASSWORD_OPTIONS:
-                // to catch any left over characters from the previous actions
-                telnet_recv_text_non_blocking(telnet_data.rxBuffer, TELNET_RX_BUFFER_SIZE, &rxLen);
-                telnet_send_and_proceed((void *)telnet_options_pass, sizeof(telnet_options_pass), E_TELNET_STE_SUB_GET_PASSWORD);
-                break;
-            case E_TELNET_STE_SUB_GET_PASSWORD:
-                if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(telnet_data.rxBuffer + telnet_data.rxWindex,
-                                                                        TELNET_RX_BUFFER_SIZE - telnet_data.rxWindex,
-                                                                        &rxLen)) {
-                    int result;
-                    if ((result = telnet_process_credential (servers_pass, rxLen))) {
-                        if ((telnet_data.credentialsValid = telnet_data.credentialsValid && (result > 0 ? true : false))) {
-                            telnet_data.substate.connected = E_TELNET_STE_SUB_SND_REPL_OPTIONS;
-                        }
-                        else {
-                            telnet_data.substate.connected = E_TELNET_STE_SUB_INVALID_LOGIN;
-                        }
-                    }
-                }
-                break;
-            case E_TELNET_STE_SUB_INVALID_LOGIN:
-                if (E_TELNET_RESULT_OK == telnet_send_non_blocking((void *)telnet_invalid_login, strlen(telnet_invalid_login))) {
-                    telnet_data.credentialsValid = true;
-                    if (++telnet_data.loginRetries >= TELNET_LOGIN_RETRIES_MAX) {
-                        telnet_reset();
-                    }
-                    else {
-                        telnet_data.substate.connected = E_TELNET_STE_SUB_SND_USER_OPTIONS;
-                    }
-                }
-                break;
-            case E_TELNET_STE_SUB_SND_REPL_OPTIONS:
-                telnet_send_and_proceed((void *)telnet_options_repl, sizeof(telnet_options_repl), E_TELNET_STE_SUB_LOGIN_SUCCESS);
-                break;
-            case E_TELNET_STE_SUB_LOGIN_SUCCESS:
-                if (E_TELNET_RESULT_OK == telnet_send_non_blocking((void *)telnet_login_success, strlen(telnet_login_success))) {
-                    // clear the current line and force the prompt
-                    telnet_reset_buffer();
-                    telnet_data.state= E_TELNET_STE_LOGGED_IN;
-                }
-            default:
-                break;
-            }
-            break;
-        case E_TELNET_STE_LOGGED_IN:
-            telnet_process();
-            break;
+            return;
         default:
             break;
     }
 
-    if (telnet_data.state >= E_TELNET_STE_CONNECTED) {
-        if (telnet_data.timeout++ > (servers_get_timeout() / TELNET_CYCLE_TIME_MS)) {
-            telnet_reset();
+    telnet_accept_session();
+    uint32_t now = telnet_port_ticks_ms();
+    for (uint32_t i = 0; i < TELNET_SESSIONS_MAX; i++) {
+        if (telnet_data.sessions[i].state != E_TELNET_STE_SESSION_FREE) {
+            telnet_session_run(&telnet_data.sessions[i], now);
         }
     }
 }
 
 void telnet_tx_strn (const char *str, int len) {
-    if (telnet_data.n_sd > 0 && telnet_data.state == E_TELNET_STE_LOGGED_IN && len > 0) {
-        telnet_send_with_retries(telnet_data.n_sd, str, len);
+    if (len <= 0 || telnet_data.txRing == NULL || telnet_data.repl == NULL) {
+        return;
+    }
+
+    // the output is only queued here, telnet_run() sends it
+    bool can_wait = telnet_port_can_wait();
+    uint32_t retries = 0;
+    telnet_port_lock();
+    while (len > 0 && telnet_data.repl != NULL) {
+        uint32_t used = telnet_data.txHead - telnet_data.repl->txTail;
+        uint32_t free = (used >= TELNET_TX_RING_SIZE) ? 0 : (TELNET_TX_RING_SIZE - used);
+        if (free == 0) {
+            if (can_wait && retries++ < TELNET_TX_RETRIES_MAX) {
+                // give the REPL session time to drain the ring
+                telnet_port_unlock();
+                telnet_port_delay_ms(TELNET_WAIT_TIME_MS);
+                telnet_port_lock();
+                continue;
+            }
+            // it doesn't read anymore, overwrite its oldest output
+            free = TELNET_TX_RING_SIZE;
+        }
+        uint32_t pos = telnet_data.txHead & TELNET_TX_RING_MASK;
+        uint32_t chunk = TELNET_TX_RING_SIZE - pos;
+        if (chunk > free) {
+            chunk = free;
+        }
+        if (chunk > (uint32_t)len) {
+            chunk = len;
+        }
+        memcpy(telnet_data.txRing + pos, str, chunk);
+        telnet_data.txHead += chunk;
+        str += chunk;
+        len -= chunk;
     }
+    telnet_port_unlock();
 }
 
 bool telnet_rx_any (void) {
-    return (telnet_data.n_sd > 0) ? (telnet_data.rxRindex != telnet_data.rxWindex &&
-            telnet_data.state == E_TELNET_STE_LOGGED_IN) : false;
+    return (telnet_data.repl != NULL) ? (telnet_data.rxRindex != telnet_data.rxWindex) : false;
 }
 
 int telnet_rx_char (void) {
@@ -288,9 +254,16 @@ void telnet_disable (void) {
 }
 
 void telnet_reset (void) {
-    // close the connection and start all over again
-    servers_close_socket(&telnet_data.n_sd);
-    servers_close_socket(&telnet_data.sd);
+    // close all the connections and start all over again, nobody gets the REPL handed over
+    telnet_port_lock();
+    telnet_data.repl = NULL;
+    telnet_port_unlock();
+    for (uint32_t i = 0; i < TELNET_SESSIONS_MAX; i++) {
+        if (telnet_data.sessions[i].state != E_TELNET_STE_SESSION_FREE) {
+            telnet_session_close(&telnet_data.sessions[i]);
+        }
+    }
+    telnet_port_socket_close(&telnet_data.sd);
     telnet_data.state = E_TELNET_STE_START;
 }
 
@@ -298,12 +271,8 @@ void telnet_reset (void) {
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 static void telnet_wait_for_enabled (void) {
-    // Init telnet's data
-    telnet_data.n_sd = -1;
-    telnet_data.sd   = -1;
-
     // Check if the telnet service has been enabled
-    if (telnet_data.enabled) {
+    if (telnet_data.enabled && telnet_data.rxBuffer != NULL && telnet_data.txRing != NULL) {
         telnet_data.state = E_TELNET_STE_START;
     }
 }
@@ -316,7 +285,7 @@ static bool telnet_create_socket (void) {
     telnet_data.sd = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
     if (telnet_data.sd > 0) {
         // add the socket to the network administration
-        modusocket_socket_add(telnet_data.sd, false);
+        telnet_port_socket_add(telnet_data.sd);
 
         // enable non-blocking mode
         uint32_t option = fcntl(telnet_data.sd, F_GETFL, 0);
@@ -328,130 +297,344 @@ static bool telnet_create_socket (void) {
         result = setsockopt(telnet_data.sd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
 
         // bind the socket to a port number
+        memset(&sServerAddress, 0, sizeof(sServerAddress));
         sServerAddress.sin_family = AF_INET;
         sServerAddress.sin_addr.s_addr = INADDR_ANY;
-        sServerAddress.sin_len = sizeof(sServerAddress);
         sServerAddress.sin_port = htons(TELNET_PORT);
 
         result = bind(telnet_data.sd, (const struct sockaddr *)&sServerAddress, sizeof(sServerAddress));
 
-        // start listening
-        result |= listen (telnet_data.sd, TELNET_MAX_CLIENTS - 1);
+        // start listening, the socket stays open to accept more sessions
+        result |= listen (telnet_data.sd, TELNET_SESSIONS_MAX);
 
         if (!result) {
             return true;
         }
-        servers_close_socket(&telnet_data.sd);
+        telnet_port_socket_close(&telnet_data.sd);
     }
 
     return false;
 }
 
-static void telnet_wait_for_connection (void) {
-    socklen_t  in_addrSize;
-    struct sockaddr_in  sClientAddress;
+static void telnet_accept_session (void) {
+    telnet_session_t *s = NULL;
+    for (uint32_t i = 0; i < TELNET_SESSIONS_MAX; i++) {
+        if (telnet_data.sessions[i].state == E_TELNET_STE_SESSION_FREE) {
+            s = &telnet_data.sessions[i];
+            break;
+        }
+    }
+    if (s == NULL) {
+        // all taken, new clients wait in the backlog
+        return;
+    }
 
+    struct sockaddr_in sClientAddress;
+    socklen_t in_addrSize = sizeof(sClientAddress);
     // accepts a connection from a TCP client, if there is any, otherwise returns EAGAIN
-    telnet_data.n_sd = accept(telnet_data.sd, (struct sockaddr *)&sClientAddress, (socklen_t *)&in_addrSize);
-    if (telnet_data.n_sd < 0 && errno == EAGAIN) {
-        return;
-    } else {
-        if (telnet_data.n_sd <= 0) {
+    int32_t sd = accept(telnet_data.sd, (struct sockaddr *)&sClientAddress, &in_addrSize);
+    if (sd < 0) {
+        if (errno != EAGAIN) {
             // error
             telnet_reset();
-            return;
         }
+        return;
+    }
 
-        // close the listening socket, we don't need it anymore
-        servers_close_socket(&telnet_data.sd);
+    // add the new socket to the network administration
+    telnet_port_socket_add(sd);
+
+    // enable non-blocking mode
+    uint32_t option = fcntl(sd, F_GETFL, 0);
+    option |= O_NONBLOCK;
+    fcntl(sd, F_SETFL, option);
+
+    // the output is coalesced here already, don't let TCP hold it back again
+    option = 1;
+    setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+
+    // client connected, so go on
+    memset(s, 0, sizeof(*s));
+    s->sd = sd;
+    s->state = E_TELNET_STE_SESSION_CONNECTED;
+    s->substate = E_TELNET_STE_SUB_WELCOME;
+    s->credentialsValid = true;
+    s->activity = telnet_port_ticks_ms();
+}
 
-        // add the new socket to the network administration
-        modusocket_socket_add(telnet_data.n_sd, false);
+static void telnet_session_run (telnet_session_t *s, uint32_t now) {
+    if (s->state == E_TELNET_STE_SESSION_CONNECTED) {
+        telnet_session_login(s);
+    } else {
+        telnet_process(s);
+        if (s->state == E_TELNET_STE_SESSION_LOGGED_IN) {
+            telnet_flush(s, now);
+        }
+    }
 
-        // enable non-blocking mode
-        uint32_t option = fcntl(telnet_data.n_sd, F_GETFL, 0);
-        option |= O_NONBLOCK;
-        fcntl(telnet_data.n_sd, F_SETFL, option);
+    if (s->state != E_TELNET_STE_SESSION_FREE && (now - s->activity) > telnet_port_timeout_ms()) {
+        telnet_session_close(s);
+    }
+}
+
+static void telnet_session_login (telnet_session_t *s) {
+    int32_t rxLen;
+    switch (s->substate) {
+    case E_TELNET_STE_SUB_WELCOME:
+        telnet_send_and_proceed(s, telnet_port_welcome(), strlen(telnet_port_welcome()), E_TELNET_STE_SUB_SND_USER_OPTIONS);
+        break;
+    case E_TELNET_STE_SUB_SND_USER_OPTIONS:
+        telnet_send_and_proceed(s, telnet_options_user, sizeof(telnet_options_user), E_TELNET_STE_SUB_REQ_USER);
+        break;
+    case E_TELNET_STE_SUB_REQ_USER:
+        // to catch any left over characters from the previous actions
+        telnet_recv_text_non_blocking(s, s->rx, TELNET_SESSION_RX_SIZE, &rxLen);
+        s->rxWindex = 0;
+        telnet_send_and_proceed(s, telnet_request_user, strlen(telnet_request_user), E_TELNET_STE_SUB_GET_USER);
+        break;
+    case E_TELNET_STE_SUB_GET_USER:
+        if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(s, s->rx + s->rxWindex,
+                                                                TELNET_SESSION_RX_SIZE - s->rxWindex,
+                                                                &rxLen)) {
+            int result;
+            if ((result = telnet_process_credential(s, telnet_port_user(), rxLen))) {
+                s->credentialsValid = result > 0 ? true : false;
+                s->substate = E_TELNET_STE_SUB_REQ_PASSWORD;
+            }
+        }
+        break;
+    case E_TELNET_STE_SUB_REQ_PASSWORD:
+        telnet_send_and_proceed(s, telnet_request_password, strlen(telnet_request_password), E_TELNET_STE_SUB_SND_PASSWORD_OPTIONS);
+        break;
+    case E_TELNET_STE_SUB_SND_PASSWORD_OPTIONS:
+        // to catch any left over characters from the previous actions
+        telnet_recv_text_non_blocking(s, s->rx, TELNET_SESSION_RX_SIZE, &rxLen);
+        s->rxWindex = 0;
+        telnet_send_and_proceed(s, telnet_options_pass, sizeof(telnet_options_pass), E_TELNET_STE_SUB_GET_PASSWORD);
+        break;
+    case E_TELNET_STE_SUB_GET_PASSWORD:
+        if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(s, s->rx + s->rxWindex,
+                                                                TELNET_SESSION_RX_SIZE - s->rxWindex,
+                                                                &rxLen)) {
+            int result;
+            if ((result = telnet_process_credential(s, telnet_port_pass(), rxLen))) {
+                if ((s->credentialsValid = s->credentialsValid && (result > 0 ? true : false))) {
+                    s->substate = E_TELNET_STE_SUB_SND_REPL_OPTIONS;
+                }
+                else {
+                    s->substate = E_TELNET_STE_SUB_INVALID_LOGIN;
+                }
+            }
+        }
+        break;
+    case E_TELNET_STE_SUB_INVALID_LOGIN:
+        if (E_TELNET_RESULT_OK == telnet_send_non_blocking(s, telnet_invalid_login, strlen(telnet_invalid_login))) {
+            s->credentialsValid = true;
+            if (++s->loginRetries >= TELNET_LOGIN_RETRIES_MAX) {
+                telnet_session_close(s);
+            }
+            else {
+                s->substate = E_TELNET_STE_SUB_SND_USER_OPTIONS;
+            }
+        }
+        break;
+    case E_TELNET_STE_SUB_SND_REPL_OPTIONS:
+        telnet_send_and_proceed(s, telnet_options_repl, sizeof(telnet_options_repl), E_TELNET_STE_SUB_LOGIN_SUCCESS);
+        break;
+    case E_TELNET_STE_SUB_LOGIN_SUCCESS:
+        if (E_TELNET_RESULT_OK == telnet_send_non_blocking(s, (telnet_data.repl == NULL) ? telnet_login_success : telnet_login_follower,
+                                                           strlen((telnet_data.repl == NULL) ? telnet_login_success : telnet_login_follower))) {
+            telnet_session_logged_in(s);
+        }
+        break;
+    default:
+        break;
+    }
+}
 
-        // client connected, so go on
-        telnet_data.rxWindex = 0;
-        telnet_data.rxRindex = 0;
-        telnet_data.txRetries = 0;
-        telnet_data.rxIncompleteLen = 0;
+static void telnet_session_logged_in (telnet_session_t *s) {
+    telnet_port_lock();
+    // only the output from now on is sent to this session
+    s->txTail = telnet_data.txHead;
+    s->txWaiting = false;
+    s->state = E_TELNET_STE_SESSION_LOGGED_IN;
+    bool repl = (telnet_data.repl == NULL);
+    if (repl) {
+        telnet_data.repl = s;
+    }
+    telnet_port_unlock();
 
-        telnet_data.state = E_TELNET_STE_CONNECTED;
-        telnet_data.substate.connected = E_TELNET_STE_SUB_WELCOME;
-        telnet_data.credentialsValid = true;
-        telnet_data.loginRetries = 0;
-        telnet_data.timeout = 0;
-        telnet_data.binary_mode = false;
+    if (repl) {
+        // clear the current line and force the prompt
+        telnet_reset_buffer();
+    }
+}
+
+static void telnet_session_close (telnet_session_t *s) {
+    telnet_port_socket_close(&s->sd);
+    s->state = E_TELNET_STE_SESSION_FREE;
+
+    if (telnet_data.repl == s) {
+        // hand the REPL over to another session which is logged in
+        telnet_session_t *next = NULL;
+        for (uint32_t i = 0; i < TELNET_SESSIONS_MAX; i++) {
+            if (telnet_data.sessions[i].state == E_TELNET_STE_SESSION_LOGGED_IN) {
+                next = &telnet_data.sessions[i];
+                break;
+            }
+        }
+        telnet_port_lock();
+        telnet_data.repl = next;
+        telnet_port_unlock();
+        telnet_data.rxRindex = telnet_data.rxWindex;
+        if (next != NULL) {
+            next->iacLen = 0;
+            telnet_send_non_blocking(next, telnet_repl_handover, strlen(telnet_repl_handover));
+            telnet_reset_buffer();
+        }
     }
 }
 
-static void telnet_send_and_proceed (void *data, int32_t Len, telnet_connected_substate_t next_state) {
-    if (E_TELNET_RESULT_OK == telnet_send_non_blocking(data, Len)) {
-        telnet_data.substate.connected = next_state;
+static void telnet_send_and_proceed (telnet_session_t *s, const void *data, int32_t Len, telnet_connected_substate_t next_state) {
+    if (E_TELNET_RESULT_OK == telnet_send_non_blocking(s, data, Len)) {
+        s->substate = next_state;
     }
 }
 
-static telnet_result_t telnet_send_non_blocking (void *data, int32_t Len) {
-    if (send(telnet_data.n_sd, data, Len, 0) > 0) {
-        telnet_data.txRetries = 0;
+static telnet_result_t telnet_send_non_blocking (telnet_session_t *s, const void *data, int32_t Len) {
+    if (s->sd < 0) {
+        return E_TELNET_RESULT_FAILED;
+    }
+    if (send(s->sd, data, Len, 0) > 0) {
+        s->txRetries = 0;
         return E_TELNET_RESULT_OK;
-    } else if ((TELNET_TX_RETRIES_MAX >= ++telnet_data.txRetries) && (errno == EAGAIN)) {
+    } else if ((TELNET_TX_RETRIES_MAX >= ++s->txRetries) && (errno == EAGAIN)) {
         return E_TELNET_RESULT_AGAIN;
     } else {
         // error
-        telnet_reset();
+        telnet_session_close(s);
         return E_TELNET_RESULT_FAILED;
     }
 }
 
-static telnet_result_t telnet_recv_text_non_blocking (void *buff, int32_t Maxlen, int32_t *rxLen) {
-    *rxLen = recv(telnet_data.n_sd, buff, Maxlen, 0);
+static telnet_result_t telnet_recv_text_non_blocking (telnet_session_t *s, uint8_t *buff, int32_t Maxlen, int32_t *rxLen) {
+    // an IAC sequence cut short by the previous reception is completed first
+    int32_t pending = s->iacLen;
+    *rxLen = 0;
+    if (s->sd < 0 || Maxlen <= pending) {
+        return E_TELNET_RESULT_AGAIN;
+    }
+    memcpy(buff, s->iac, pending);
+    int32_t len = recv(s->sd, buff + pending, Maxlen - pending, 0);
     // if there's data received, parse it
-    if (*rxLen > 0) {
-        telnet_data.timeout = 0;
-        telnet_parse_input (buff, rxLen);
+    if (len > 0) {
+        s->iacLen = 0;
+        s->activity = telnet_port_ticks_ms();
+        *rxLen = len + pending;
+        telnet_parse_input(s, buff, rxLen);
+        if (s->sd < 0) {
+            return E_TELNET_RESULT_FAILED;
+        }
         if (*rxLen > 0) {
             return E_TELNET_RESULT_OK;
         }
-    } else if (errno != EAGAIN) {
-        // error
-        telnet_reset();
+    } else if (len == 0 || errno != EAGAIN) {
+        // closed by the client, or error
+        *rxLen = 0;
+        telnet_session_close(s);
         return E_TELNET_RESULT_FAILED;
     }
+    *rxLen = 0;
     return E_TELNET_RESULT_AGAIN;
 }
 
-static void telnet_process (void) {
+static void telnet_process (telnet_session_t *s) {
     int32_t rxLen;
+
+    if (telnet_data.repl != s) {
+        // the other sessions are read-only, their input is only parsed for
+        // the option negotiation
+        telnet_recv_text_non_blocking(s, s->rx, TELNET_SESSION_RX_SIZE, &rxLen);
+        return;
+    }
+
     int32_t maxLen = (telnet_data.rxWindex >= telnet_data.rxRindex) ? (TELNET_RX_BUFFER_SIZE - telnet_data.rxWindex) :
                                                                    ((telnet_data.rxRindex - telnet_data.rxWindex) - 1);
     // to avoid an overrrun
     maxLen = (telnet_data.rxRindex == 0) ? (maxLen - 1) : maxLen;
 
     if (maxLen > 0) {
-        if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(&telnet_data.rxBuffer[telnet_data.rxWindex], maxLen, &rxLen)) {
+        if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(s, &telnet_data.rxBuffer[telnet_data.rxWindex], maxLen, &rxLen)) {
             // rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256 so that it wraps around automatically
             telnet_data.rxWindex = telnet_data.rxWindex + rxLen;
         }
     }
 }
 
-static int telnet_process_credential (char *credential, int32_t rxLen) {
-    telnet_data.rxWindex += rxLen;
-    if (telnet_data.rxWindex >= SERVERS_USER_PASS_LEN_MAX) {
-        telnet_data.rxWindex = SERVERS_USER_PASS_LEN_MAX;
+static void telnet_flush (telnet_session_t *s, uint32_t now) {
+    telnet_port_lock();
+    uint32_t pending = telnet_data.txHead - s->txTail;
+    if (pending > TELNET_TX_RING_SIZE) {
+        // the client didn't keep up and its output was overwritten, skip it
+        s->txTail = telnet_data.txHead - TELNET_TX_RING_SIZE;
+        pending = TELNET_TX_RING_SIZE;
+    }
+    if (pending == 0) {
+        s->txWaiting = false;
+        telnet_port_unlock();
+        return;
+    }
+    if (!s->txWaiting) {
+        s->txWaiting = true;
+        s->txSince = now;
+    }
+    // let small writes accumulate for a while, like Nagle's algorithm does
+    if (pending < TELNET_TX_COALESCE && (now - s->txSince) < TELNET_TX_DELAY_MS) {
+        telnet_port_unlock();
+        return;
     }
 
-    uint8_t *p = telnet_data.rxBuffer + SERVERS_USER_PASS_LEN_MAX;
+    bool failed = false;
+    while (pending > 0) {
+        uint32_t pos = s->txTail & TELNET_TX_RING_MASK;
+        uint32_t chunk = TELNET_TX_RING_SIZE - pos;
+        if (chunk > pending) {
+            chunk = pending;
+        }
+        int32_t sent = send(s->sd, telnet_data.txRing + pos, chunk, 0);
+        if (sent > 0) {
+            s->txTail += sent;
+            pending -= sent;
+            s->activity = now;
+        } else {
+            // try again in the next cycle when the socket buffer is full
+            failed = (errno != EAGAIN);
+            break;
+        }
+    }
+    if (pending == 0) {
+        s->txWaiting = false;
+    }
+    telnet_port_unlock();
+
+    if (failed) {
+        telnet_session_close(s);
+    }
+}
+
+static int telnet_process_credential (telnet_session_t *s, const char *credential, int32_t rxLen) {
+    s->rxWindex += rxLen;
+    if (s->rxWindex >= TELNET_LOGIN_LEN_MAX) {
+        s->rxWindex = TELNET_LOGIN_LEN_MAX;
+    }
+
+    uint8_t *p;
     // if a '\r' is found, or the length exceeds the max username length
-    if ((p = memchr(telnet_data.rxBuffer, '\r', telnet_data.rxWindex)) || (telnet_data.rxWindex >= SERVERS_USER_PASS_LEN_MAX)) {
-        uint8_t len = p - telnet_data.rxBuffer;
+    if ((p = memchr(s->rx, '\r', s->rxWindex)) || (s->rxWindex >= TELNET_LOGIN_LEN_MAX)) {
+        uint8_t len = p ? (p - s->rx) : s->rxWindex;
 
-        telnet_data.rxWindex = 0;
-        if ((len > 0) && (memcmp(credential, telnet_data.rxBuffer, MAX(len, strlen(credential))) == 0)) {
+        s->rxWindex = 0;
+        if ((len > 0) && (len == strlen(credential)) && (memcmp(credential, s->rx, len) == 0)) {
             return 1;
         }
         return -1;
@@ -469,120 +652,74 @@ static uint8_t telnet_get_reply_verb(uint8_t verb) {
     }
 }
 
-static int telnet_process_IAC (uint8_t **strR, uint8_t **strW, int32_t *len, uint32_t remaining) {
-    if (remaining >= 2)  {
-        switch (*((*strR) + 1)) {
-            case IAC:
-                // double IAC char (0xFF) means escaped 0xFF
-                **strW = 0xFF;
-                (*strW)++;
-                (*strR) += 2;
-                (*len)--;
-                return 0;
-
-            case AYT:
-                // reply to the AYT with an echo of the IAC AYT
-                telnet_tx_strn((char *) *strR, 2);
-                (*strR) += 2;
-                (*len) -= 2;
-                return 0;
-        }
-    }
+static void telnet_parse_input (telnet_session_t *s, uint8_t *str, int32_t *len) {
+    bool repl = (telnet_data.repl == s);
+    uint8_t *w = str;
+    uint8_t *end = str + *len;
 
-    if (remaining >= 3) {
-        if (*((*strR) + 2) == TRANSMIT_BINARY) {
-            uint8_t option = *((*strR) + 1);
-            if (option == WILL) telnet_data.binary_mode = true;
-            if (option == WONT) telnet_data.binary_mode = false;
-            *((*strR) + 1) = telnet_get_reply_verb(option);
-            telnet_tx_strn((char *) *strR, 3);
-        }
-        (*strR) += 3;
-        (*len) -= 3;
-        return 0;
-    } else {
-        // not enough characters to continue
-        *len -= remaining;
-        return remaining;
-    }
-    return 0;
-}
-
-static void telnet_parse_input (uint8_t *str, int32_t *len) {
-    int32_t b_len = *len;
-    uint8_t *b_str = str - telnet_data.rxIncompleteLen;
-
-    *len += telnet_data.rxIncompleteLen;
-    b_len = *len;
-
-    for (uint8_t *_str = b_str; _str < b_str + b_len; ) {
-        uint8_t ch = *_str;
+    for (uint8_t *r = str; r < end; ) {
+        uint8_t ch = *r;
         if (ch == IAC) {
-            uint32_t remaining = b_len - (_str - b_str);
-            telnet_data.rxIncompleteLen = telnet_process_IAC(&_str, &str, len, remaining);
-            if (telnet_data.rxIncompleteLen > 0) {
-                break;
+            uint32_t remaining = end - r;
+            if (remaining >= 2) {
+                if (r[1] == IAC) {
+                    // double IAC char (0xFF) means escaped 0xFF
+                    *w++ = 0xFF;
+                    r += 2;
+                    continue;
+                } else if (r[1] == AYT) {
+                    // reply to the AYT with an echo of the IAC AYT
+                    telnet_send_non_blocking(s, r, 2);
+                    r += 2;
+                    continue;
+                }
             }
-            continue;
+            if (remaining >= 3) {
+                if (r[2] == TRANSMIT_BINARY) {
+                    uint8_t option = r[1];
+                    if (option == WILL) s->binary_mode = true;
+                    if (option == WONT) s->binary_mode = false;
+                    uint8_t reply[3] = { IAC, telnet_get_reply_verb(option), TRANSMIT_BINARY };
+                    telnet_send_non_blocking(s, reply, sizeof(reply));
+                }
+                r += 3;
+                continue;
+            }
+            // not enough characters to continue, keep them for the next reception
+            memcpy(s->iac, r, remaining);
+            s->iacLen = remaining;
+            break;
         }
 
-        if (telnet_data.binary_mode == true) {
-            *str++ = *_str++;
+        if (s->binary_mode == true) {
+            *w++ = *r++;
             continue;
         }
 
         // in this case the server is not operating in binary mode
-        if (ch > 127 || ch == 0 || (telnet_data.state == E_TELNET_STE_LOGGED_IN &&
-            (ch == mp_interrupt_char || ch == CHAR_CTRL_F))) {
-            if (ch == mp_interrupt_char) {
-                mp_keyboard_interrupt();
-            } else if (ch == CHAR_CTRL_F) {
-                *str++ = CHAR_CTRL_D;
-                mp_hal_reset_safe_and_boot(false);
-                _str++;
+        if (ch > 127 || ch == 0 || (repl && (ch == telnet_port_interrupt_char() || ch == TELNET_CHAR_CTRL_F))) {
+            if (repl && ch == telnet_port_interrupt_char()) {
+                telnet_port_keyboard_interrupt();
+            } else if (repl && ch == TELNET_CHAR_CTRL_F) {
+                *w++ = TELNET_CHAR_CTRL_D;
+                telnet_port_safe_boot();
+                r++;
                 continue;
             }
             // skip this char
-            (*len)--;
-            _str++;
+            r++;
         } else {
-            *str++ = *_str++;
+            *w++ = *r++;
         }
     }
-}
-
-static bool telnet_send_with_retries (int32_t sd, const void *pBuf, int32_t len) {
-    int32_t retries = 0;
-    uint32_t delay = TELNET_WAIT_TIME_MS;
-
-    do {
-        // make it blocking
-        uint32_t option = fcntl(sd, F_GETFL, 0);
-        option &= ~O_NONBLOCK;
-        fcntl(sd, F_SETFL, option);
-        if (send(sd, pBuf, len, 0) > 0) {
-            // make it non-blocking again
-            option |= O_NONBLOCK;
-            fcntl(sd, F_SETFL, option);
-            return true;
-        } else if (EAGAIN != errno) {
-            // make it non-blocking again
-            option |= O_NONBLOCK;
-            fcntl(sd, F_SETFL, option);
-            return false;
-        }
-        // start with the default delay and increment it on each retry
-        mp_hal_delay_ms(delay++);
-    } while (++retries <= TELNET_TX_RETRIES_MAX);
-
-    return false;
+    *len = w - str;
 }
 
 static void telnet_reset_buffer (void) {
     // erase any characters present in the current line
     memset (telnet_data.rxBuffer, '\b', TELNET_RX_BUFFER_SIZE / 2);
+    telnet_data.rxRindex = 0;
     telnet_data.rxWindex = TELNET_RX_BUFFER_SIZE / 2;
     // fake an "enter" key pressed to display the prompt
     telnet_data.rxBuffer[telnet_data.rxWindex++] = '\r';
 }
-
@@ -10,6 +10,32 @@
 #ifndef TELNET_H_
 #define TELNET_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// number of clients that can be logged in at the same time; the first one
+// gets the REPL, the others follow its output read-only until it leaves
+#ifndef TELNET_SESSIONS_MAX
+#define TELNET_SESSIONS_MAX                 3
+#endif
+
+// REPL output is queued in a ring shared by all the sessions (power of 2)
+#ifndef TELNET_TX_RING_SIZE
+#define TELNET_TX_RING_SIZE                 4096
+#endif
+
+// queued output is sent once this much is pending, or once the oldest
+// pending byte has waited TELNET_TX_DELAY_MS, so that small writes coalesce
+#ifndef TELNET_TX_COALESCE
+#define TELNET_TX_COALESCE                  1024
+#endif
+#ifndef TELNET_TX_DELAY_MS
+#define TELNET_TX_DELAY_MS                  4
+#endif
+
 /******************************************************************************
  DECLARE EXPORTED FUNCTIONS
  ******************************************************************************/
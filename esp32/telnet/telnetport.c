@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/obj.h"
+#include "py/mphal.h"
+#include "telnetport.h"
+#include "serverstask.h"
+#include "modusocket.h"
+#include "utils/interrupt_char.h"
+#include "genhdr/mpversion.h"
+
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static SemaphoreHandle_t telnet_port_mutex;
+static const char* telnet_port_welcome_msg = "MicroPython " MICROPY_GIT_TAG " on " MICROPY_BUILD_DATE "; " MICROPY_HW_BOARD_NAME " with " MICROPY_HW_MCU_NAME "\r\n";
+
+extern TaskHandle_t svTaskHandle;
+
+/******************************************************************************
+ DEFINE PORT FUNCTIONS
+ ******************************************************************************/
+void telnet_port_init (void) {
+    telnet_port_mutex = xSemaphoreCreateMutex();
+}
+
+void *telnet_port_malloc (uint32_t size) {
+    // from the RTOS heap
+    return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void telnet_port_free (void *ptr) {
+    heap_caps_free(ptr);
+}
+
+uint32_t telnet_port_ticks_ms (void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+void telnet_port_delay_ms (uint32_t ms) {
+    mp_hal_delay_ms(ms);
+}
+
+void telnet_port_lock (void) {
+    xSemaphoreTake(telnet_port_mutex, portMAX_DELAY);
+}
+
+void telnet_port_unlock (void) {
+    xSemaphoreGive(telnet_port_mutex);
+}
+
+bool telnet_port_can_wait (void) {
+    // the servers task is the one draining the output
+    return xTaskGetCurrentTaskHandle() != svTaskHandle;
+}
+
+const char *telnet_port_user (void) {
+    return servers_user;
+}
+
+const char *telnet_port_pass (void) {
+    return servers_pass;
+}
+
+uint32_t telnet_port_timeout_ms (void) {
+    return servers_get_timeout();
+}
+
+const char *telnet_port_welcome (void) {
+    return telnet_port_welcome_msg;
+}
+
+void telnet_port_socket_add (int32_t sd) {
+    modusocket_socket_add(sd, false);
+}
+
+void telnet_port_socket_close (int32_t *sd) {
+    servers_close_socket(sd);
+}
+
+int telnet_port_interrupt_char (void) {
+    return mp_interrupt_char;
+}
+
+void telnet_port_keyboard_interrupt (void) {
+    mp_keyboard_interrupt();
+}
+
+void telnet_port_safe_boot (void) {
+    mp_hal_reset_safe_and_boot(false);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef TELNETPORT_H_
+#define TELNETPORT_H_
+
+// The telnet server core (telnet.c) only talks BSD sockets plus the hooks
+// below, so that it can be built both for the device (telnetport.c) and
+// against POSIX sockets (posix/telnetport.c) for benchmarking.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#if defined(TELNET_PORT_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#else
+#include "lwip/sockets.h"
+#endif
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#ifndef TELNET_PORT
+#define TELNET_PORT                         23
+#endif
+
+/******************************************************************************
+ DECLARE PORT FUNCTIONS
+ ******************************************************************************/
+// called once before anything else
+extern void telnet_port_init (void);
+
+// memory for the receive buffer and the output ring
+extern void *telnet_port_malloc (uint32_t size);
+extern void telnet_port_free (void *ptr);
+
+// a free running millisecond tick, and a delay for the tasks writing output
+extern uint32_t telnet_port_ticks_ms (void);
+extern void telnet_port_delay_ms (uint32_t ms);
+
+// guards the output ring against the tasks writing to it; can_wait is false
+// in the task running the server, which must never wait for itself
+extern void telnet_port_lock (void);
+extern void telnet_port_unlock (void);
+extern bool telnet_port_can_wait (void);
+
+// login credentials, the inactivity timeout and the welcome message
+extern const char *telnet_port_user (void);
+extern const char *telnet_port_pass (void);
+extern uint32_t telnet_port_timeout_ms (void);
+extern const char *telnet_port_welcome (void);
+
+// register a new socket with the network stack, and close one (sets *sd to -1)
+extern void telnet_port_socket_add (int32_t sd);
+extern void telnet_port_socket_close (int32_t *sd);
+
+// special characters typed in the REPL session
+extern int telnet_port_interrupt_char (void);
+extern void telnet_port_keyboard_interrupt (void);
+extern void telnet_port_safe_boot (void);
+
+#endif /* TELNETPORT_H_ */
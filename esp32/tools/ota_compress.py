@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2020, Pycom Limited.
+#
+# This software is licensed under the GNU GPL version 3 or any
+# later version, with permitted additional terms. For more information
+# see the Pycom Licence v1.0 document supplied with this file, or
+# available at https://www.pycom.io/opensource/licensing
+#
+
+"""
+Compress an application image for pycom.ota_start(compressed=True).
+
+The image is zlib compressed with a full flush every --interval bytes, so that
+an interrupted update can be resumed from any of those points. They are
+listed in <output>.idx, one per line as "<compressed offset> <image offset>".
+
+To resume, ask the device how much it has written with pycom.ota_offset(),
+pick the last point whose image offset is not larger, then call
+pycom.ota_start(<image offset>, compressed=True) and send the first
+<header> bytes of the compressed file (2 for zlib, 10 for gzip) followed by
+everything from <compressed offset> on.
+
+The window size is also the RAM the device needs to inflate the image.
+"""
+
+import sys
+import zlib
+import argparse
+
+
+def compress(image, wbits, interval):
+    z = zlib.compressobj(9, zlib.DEFLATED, wbits)
+    out = []
+    points = []
+    total = 0
+    for pos in range(0, len(image), interval):
+        last = pos + interval >= len(image)
+        chunk = z.compress(image[pos:pos + interval])
+        chunk += z.flush(zlib.Z_FINISH if last else zlib.Z_FULL_FLUSH)
+        out.append(chunk)
+        total += len(chunk)
+        if not last:
+            points.append((total, pos + interval))
+    return b''.join(out), points
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('image', help='application image (appimg.bin)')
+    parser.add_argument('output', help='compressed image')
+    parser.add_argument('--window', type=int, default=12, choices=range(9, 16),
+                        help='log2 of the window size (default: 12, i.e. 4KB)')
+    parser.add_argument('--interval', type=int, default=64 * 1024,
+                        help='image bytes between resume points (default: 65536)')
+    parser.add_argument('--gzip', action='store_true', help='write gzip instead of zlib')
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        image = f.read()
+
+    wbits = args.window + 16 if args.gzip else args.window
+    data, points = compress(image, wbits, args.interval)
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    with open(args.output + '.idx', 'w') as f:
+        for p in points:
+            f.write('%d %d\n' % p)
+
+    print('%s: %d -> %d bytes (%.1f%%), %d resume points' %
+          (args.output, len(image), len(data), 100.0 * len(data) / len(image), len(points)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,210 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2020, Pycom Limited.
+#
+# This software is licensed under the GNU GPL version 3 or any
+# later version, with permitted additional terms. For more information
+# see the Pycom Licence v1.0 document supplied with this file, or
+# available at https://www.pycom.io/opensource/licensing
+#
+
+"""
+Make a delta patch for pycom.ota_start(delta=True, compressed=True).
+
+The patch turns the image the device is running (old) into the new one, like
+bsdiff: regions of the new image that roughly match the old one are sent as
+bytewise differences, which are mostly zeros because only addresses moved,
+everything else is sent as it is. The patch is then zlib compressed.
+
+Patch format (before compression):
+  "PYDP", old size (u32 LE), new size (u32 LE), the SHA256 appended to old
+  records: <add> <copy> <seek> as varints, seek zigzag encoded, followed by
+           <add> bytes to add to old (from the current position on) and
+           <copy> bytes of new; then seek moves the position in old
+
+Both images must have their SHA256 appended (esptool does it by default): the
+device checks the one of the image it is running against the patch header.
+"""
+
+import sys
+import zlib
+import struct
+import argparse
+
+MAGIC = b'PYDP'
+HASH_LEN = 32
+KEY_LEN = 8          # bytes hashed to look up matches
+KEY_STEP = 4         # only every KEY_STEP-th old position is indexed
+MIN_MATCH = 12       # shortest exact match worth a record
+CANDIDATES = 8       # old positions tried per key
+GIVE_UP = 64         # mismatch surplus that ends a fuzzy match
+
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(v):
+    return (v << 1) if v >= 0 else ((-v << 1) - 1)
+
+
+def index(old):
+    table = {}
+    for i in range(0, len(old) - KEY_LEN + 1, KEY_STEP):
+        lst = table.setdefault(old[i:i + KEY_LEN], [])
+        if len(lst) < CANDIDATES:
+            lst.append(i)
+    return table
+
+
+def exact_len(old, o, new, n):
+    ln = 0
+    lim = min(len(old) - o, len(new) - n)
+    # compare in blocks first, bytewise at the end
+    while ln + 64 <= lim and old[o + ln:o + ln + 64] == new[n + ln:n + ln + 64]:
+        ln += 64
+    while ln < lim and old[o + ln] == new[n + ln]:
+        ln += 1
+    return ln
+
+
+def fuzzy_len(old, o, new, n, ln):
+    # keep going while there are more equal bytes than different ones, the
+    # changed ones are usually relocated addresses
+    lim = min(len(old) - o, len(new) - n)
+    best, score, best_score = ln, 0, 0
+    i = ln
+    while i < lim and score > best_score - GIVE_UP:
+        if old[o + i] == new[n + i]:
+            score += 1
+            if score > best_score:
+                best_score, best = score, i + 1
+        else:
+            score -= 1
+        i += 1
+    return best
+
+
+def diff(old, new):
+    table = index(old)
+    matches = []        # (new pos, old pos, length)
+    n = 0
+    last_o = 0
+    while n + KEY_LEN <= len(new):
+        best_o, best_len = -1, 0
+        # continuing where the last match left off is the most likely
+        for o in [last_o] + table.get(new[n:n + KEY_LEN], []):
+            if 0 <= o < len(old):
+                ln = exact_len(old, o, new, n)
+                if ln > best_len:
+                    best_o, best_len = o, ln
+        if best_len < MIN_MATCH:
+            n += 1
+            last_o += 1
+            continue
+        o = best_o
+        # grow it back into the bytes that weren't matched yet
+        start = matches[-1][0] + matches[-1][2] if matches else 0
+        while n > start and o > 0 and old[o - 1] == new[n - 1]:
+            n -= 1
+            o -= 1
+            best_len += 1
+        ln = fuzzy_len(old, o, new, n, best_len)
+        matches.append((n, o, ln))
+        n += ln
+        last_o = o + ln
+    return matches
+
+
+def make_patch(old, new):
+    matches = diff(old, new)
+    out = bytearray(MAGIC)
+    out += struct.pack('<II', len(old), len(new))
+    out += old[-HASH_LEN:]
+    n, o = 0, 0
+    # the first record has no add part, the ones after start with a match
+    pending = (0, 0)
+    for (mn, mo, ln) in matches + [(len(new), None, 0)]:
+        add_len, add_old = pending
+        copy = new[n + add_len:mn]
+        seek = (mo - (add_old + add_len)) if mo is not None else 0
+        out += varint(add_len) + varint(len(copy)) + varint(zigzag(seek))
+        out += bytes((new[n + i] - old[add_old + i]) & 0xFF for i in range(add_len))
+        out += copy
+        n = mn
+        pending = (ln, mo)
+    return bytes(out)
+
+
+def apply_patch(old, patch):
+    # mirrors updater_stream.c, to check the patch before it is shipped
+    assert patch[:4] == MAGIC
+    old_size, new_size = struct.unpack('<II', patch[4:12])
+    assert old_size == len(old) and patch[12:12 + HASH_LEN] == old[-HASH_LEN:]
+    pos, o, new = 12 + HASH_LEN, 0, bytearray()
+
+    def read_varint():
+        nonlocal pos
+        v, shift = 0, 0
+        while True:
+            b = patch[pos]
+            pos += 1
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v
+
+    while len(new) < new_size:
+        add_len, copy_len, seek = read_varint(), read_varint(), read_varint()
+        seek = (seek >> 1) ^ -(seek & 1)
+        new += bytes((old[o + i] + patch[pos + i]) & 0xFF for i in range(add_len))
+        pos += add_len
+        o += add_len
+        new += patch[pos:pos + copy_len]
+        pos += copy_len
+        o += seek
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('old', help='image running on the device')
+    parser.add_argument('new', help='image to update to')
+    parser.add_argument('patch', help='output patch')
+    parser.add_argument('--window', type=int, default=12, choices=range(9, 16),
+                        help='log2 of the zlib window size (default: 12, i.e. 4KB)')
+    parser.add_argument('--raw', action='store_true', help="don't compress the patch")
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+
+    patch = make_patch(old, new)
+    if apply_patch(old, patch) != new:
+        print('internal error: the patch does not rebuild the new image')
+        return 1
+    data = patch
+    if not args.raw:
+        z = zlib.compressobj(9, zlib.DEFLATED, args.window)
+        data = z.compress(patch) + z.flush()
+
+    with open(args.patch, 'wb') as f:
+        f.write(data)
+
+    print('%s: %d bytes, %.1f%% of the new image (%d bytes zlib compressed)' %
+          (args.patch, len(data), 100.0 * len(data) / len(new), len(zlib.compress(new, 9))))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,758 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "py/objint.h"
+#include "py/smallint.h"
+
+#if MICROPY_PY_ARRAYOPS
+
+// Arithmetic and reductions over whole arrays: array.array, bytearray,
+// memoryview or anything else exposing a typed buffer.  Each kernel is a
+// plain loop over the items written once per element type, which the
+// compiler can unroll and vectorise (this file is built with CSUPEROPT).
+//
+// Elementwise functions write into out, which may be one of the operands,
+// or else into a new array with the typecode of the first array operand.
+// Operands of another element type than out are converted to it a chunk at
+// a time, and scalars are broadcast.  Integer results wrap around as in C.
+
+// Element types; the unsigned variant of each integer size follows the
+// signed one, so typecodes map onto them by size and case.
+enum {
+    ARRAYOPS_I8, ARRAYOPS_U8,
+    ARRAYOPS_I16, ARRAYOPS_U16,
+    ARRAYOPS_I32, ARRAYOPS_U32,
+    ARRAYOPS_I64, ARRAYOPS_U64,
+    #if MICROPY_PY_BUILTINS_FLOAT
+    ARRAYOPS_F32, ARRAYOPS_F64,
+    #endif
+    ARRAYOPS_NUM_KINDS
+};
+
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+#define ARRAYOPS_FLOAT ARRAYOPS_F64
+#else
+#define ARRAYOPS_FLOAT ARRAYOPS_F32
+#endif
+
+#define ARRAYOPS_IS_FLOAT(kind) ((kind) > ARRAYOPS_U64)
+
+enum { ARRAYOPS_ADD, ARRAYOPS_SUB, ARRAYOPS_MUL };
+
+// Number of items converted or broadcast at a time, on the C stack.
+#define ARRAYOPS_CHUNK (32)
+
+typedef union _arrayops_acc_t {
+    unsigned long long i; // integer sums wrap modulo 2**64
+    #if MICROPY_PY_BUILTINS_FLOAT
+    float f;
+    double d;
+    #endif
+} arrayops_acc_t;
+
+typedef struct _arrayops_kernels_t {
+    void (*binop)(int op, void *o, const void *a, const void *b, size_t n);
+    void (*scale)(void *o, const void *a, const void *k, const void *c, size_t n);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    void (*scale_float)(void *o, const void *a, mp_float_t k, mp_float_t c, size_t n);
+    #endif
+    void (*clip)(void *o, const void *a, const void *lo, const void *hi, size_t n);
+    void (*cumsum)(void *o, const void *a, void *acc, size_t n);
+    void (*sum)(arrayops_acc_t *acc, const void *a, size_t n);
+    void (*dot)(arrayops_acc_t *acc, const void *a, const void *b, size_t n);
+    void (*minmax)(void *lo, void *hi, const void *a, size_t n);
+} arrayops_kernels_t;
+
+/******************************************************************************/
+// kernels
+
+// Kernels common to integer and float types.  Integer arithmetic is done in
+// UT, an unsigned type at least as wide as int, so that it wraps instead of
+// overflowing.
+#define ARRAYOPS_KERNELS_COMMON(name, T, UT) \
+    STATIC void arrayops_binop_##name(int op, void *o_in, const void *a_in, const void *b_in, size_t n) { \
+        T *o = o_in; \
+        const T *a = a_in, *b = b_in; \
+        if (op == ARRAYOPS_ADD) { \
+            for (size_t i = 0; i < n; i++) { \
+                o[i] = (UT)a[i] + (UT)b[i]; \
+            } \
+        } else if (op == ARRAYOPS_SUB) { \
+            for (size_t i = 0; i < n; i++) { \
+                o[i] = (UT)a[i] - (UT)b[i]; \
+            } \
+        } else { \
+            for (size_t i = 0; i < n; i++) { \
+                o[i] = (UT)a[i] * (UT)b[i]; \
+            } \
+        } \
+    } \
+    STATIC void arrayops_scale_##name(void *o_in, const void *a_in, const void *k_in, const void *c_in, size_t n) { \
+        T *o = o_in; \
+        const T *a = a_in; \
+        UT k = *(const T*)k_in, c = *(const T*)c_in; \
+        for (size_t i = 0; i < n; i++) { \
+            o[i] = (UT)a[i] * k + c; \
+        } \
+    } \
+    STATIC void arrayops_clip_##name(void *o_in, const void *a_in, const void *lo_in, const void *hi_in, size_t n) { \
+        T *o = o_in; \
+        const T *a = a_in; \
+        T lo = *(const T*)lo_in, hi = *(const T*)hi_in; \
+        for (size_t i = 0; i < n; i++) { \
+            T v = a[i]; \
+            v = v < lo ? lo : v; \
+            o[i] = v > hi ? hi : v; \
+        } \
+    } \
+    STATIC void arrayops_cumsum_##name(void *o_in, const void *a_in, void *acc, size_t n) { \
+        T *o = o_in; \
+        const T *a = a_in; \
+        T s = *(T*)acc; \
+        for (size_t i = 0; i < n; i++) { \
+            s = (UT)s + (UT)a[i]; \
+            o[i] = s; \
+        } \
+        *(T*)acc = s; \
+    } \
+    STATIC void arrayops_minmax_##name(void *lo_in, void *hi_in, const void *a_in, size_t n) { \
+        const T *a = a_in; \
+        T lo = *(T*)lo_in, hi = *(T*)hi_in; \
+        for (size_t i = 0; i < n; i++) { \
+            T v = a[i]; \
+            lo = v < lo ? v : lo; \
+            hi = v > hi ? v : hi; \
+        } \
+        *(T*)lo_in = lo; \
+        *(T*)hi_in = hi; \
+    }
+
+// Scaling an integer type by a float factor rounds the results towards zero
+// and saturates them at the limits of T.
+#if MICROPY_PY_BUILTINS_FLOAT
+#define ARRAYOPS_KERNEL_SCALE_FLOAT(name, T, TMIN, TMAX) \
+    STATIC void arrayops_scale_float_##name(void *o_in, const void *a_in, mp_float_t k, mp_float_t c, size_t n) { \
+        T *o = o_in; \
+        const T *a = a_in; \
+        for (size_t i = 0; i < n; i++) { \
+            mp_float_t v = (mp_float_t)a[i] * k + c; \
+            o[i] = v <= (mp_float_t)TMIN ? TMIN : v >= (mp_float_t)TMAX ? TMAX : (T)v; \
+        } \
+    }
+#define ARRAYOPS_SCALE_FLOAT(name) arrayops_scale_float_##name,
+#define ARRAYOPS_SCALE_FLOAT_NONE NULL,
+#else
+#define ARRAYOPS_KERNEL_SCALE_FLOAT(name, T, TMIN, TMAX)
+#define ARRAYOPS_SCALE_FLOAT(name)
+#endif
+
+// Integer sums are taken modulo 2**64, with ACC sign-extending the items of
+// the signed types.
+#define ARRAYOPS_KERNELS_INT(name, T, UT, ACC, TMIN, TMAX) \
+    ARRAYOPS_KERNELS_COMMON(name, T, UT) \
+    ARRAYOPS_KERNEL_SCALE_FLOAT(name, T, TMIN, TMAX) \
+    STATIC void arrayops_sum_##name(arrayops_acc_t *acc, const void *a_in, size_t n) { \
+        const T *a = a_in; \
+        unsigned long long s = acc->i; \
+        for (size_t i = 0; i < n; i++) { \
+            s += (unsigned long long)(ACC)a[i]; \
+        } \
+        acc->i = s; \
+    } \
+    STATIC void arrayops_dot_##name(arrayops_acc_t *acc, const void *a_in, const void *b_in, size_t n) { \
+        const T *a = a_in, *b = b_in; \
+        unsigned long long s = acc->i; \
+        for (size_t i = 0; i < n; i++) { \
+            s += (unsigned long long)(ACC)a[i] * (unsigned long long)(ACC)b[i]; \
+        } \
+        acc->i = s; \
+    }
+
+// Float sums are kept in four partial sums, which the compiler may not
+// reorder by itself, so that they can go in parallel.
+#define ARRAYOPS_KERNELS_FLOAT(name, T, FIELD) \
+    ARRAYOPS_KERNELS_COMMON(name, T, T) \
+    STATIC void arrayops_sum_##name(arrayops_acc_t *acc, const void *a_in, size_t n) { \
+        const T *a = a_in; \
+        T s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) { \
+            s0 += a[i]; \
+            s1 += a[i + 1]; \
+            s2 += a[i + 2]; \
+            s3 += a[i + 3]; \
+        } \
+        for (; i < n; i++) { \
+            s0 += a[i]; \
+        } \
+        acc->FIELD += (s0 + s1) + (s2 + s3); \
+    } \
+    STATIC void arrayops_dot_##name(arrayops_acc_t *acc, const void *a_in, const void *b_in, size_t n) { \
+        const T *a = a_in, *b = b_in; \
+        T s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) { \
+            s0 += a[i] * b[i]; \
+            s1 += a[i + 1] * b[i + 1]; \
+            s2 += a[i + 2] * b[i + 2]; \
+            s3 += a[i + 3] * b[i + 3]; \
+        } \
+        for (; i < n; i++) { \
+            s0 += a[i] * b[i]; \
+        } \
+        acc->FIELD += (s0 + s1) + (s2 + s3); \
+    }
+
+ARRAYOPS_KERNELS_INT(i8, int8_t, unsigned int, long long, INT8_MIN, INT8_MAX)
+ARRAYOPS_KERNELS_INT(u8, uint8_t, unsigned int, unsigned long long, 0, UINT8_MAX)
+ARRAYOPS_KERNELS_INT(i16, int16_t, unsigned int, long long, INT16_MIN, INT16_MAX)
+ARRAYOPS_KERNELS_INT(u16, uint16_t, unsigned int, unsigned long long, 0, UINT16_MAX)
+ARRAYOPS_KERNELS_INT(i32, int32_t, uint32_t, long long, INT32_MIN, INT32_MAX)
+ARRAYOPS_KERNELS_INT(u32, uint32_t, uint32_t, unsigned long long, 0, UINT32_MAX)
+ARRAYOPS_KERNELS_INT(i64, int64_t, uint64_t, long long, INT64_MIN, INT64_MAX)
+ARRAYOPS_KERNELS_INT(u64, uint64_t, uint64_t, unsigned long long, 0, UINT64_MAX)
+#if MICROPY_PY_BUILTINS_FLOAT
+ARRAYOPS_KERNELS_FLOAT(f32, float, f)
+ARRAYOPS_KERNELS_FLOAT(f64, double, d)
+#endif
+
+#define ARRAYOPS_KERNELS(name, scale_float) { \
+    arrayops_binop_##name, \
+    arrayops_scale_##name, \
+    scale_float \
+    arrayops_clip_##name, \
+    arrayops_cumsum_##name, \
+    arrayops_sum_##name, \
+    arrayops_dot_##name, \
+    arrayops_minmax_##name, \
+}
+
+STATIC const arrayops_kernels_t arrayops_kernels[ARRAYOPS_NUM_KINDS] = {
+    ARRAYOPS_KERNELS(i8, ARRAYOPS_SCALE_FLOAT(i8)),
+    ARRAYOPS_KERNELS(u8, ARRAYOPS_SCALE_FLOAT(u8)),
+    ARRAYOPS_KERNELS(i16, ARRAYOPS_SCALE_FLOAT(i16)),
+    ARRAYOPS_KERNELS(u16, ARRAYOPS_SCALE_FLOAT(u16)),
+    ARRAYOPS_KERNELS(i32, ARRAYOPS_SCALE_FLOAT(i32)),
+    ARRAYOPS_KERNELS(u32, ARRAYOPS_SCALE_FLOAT(u32)),
+    ARRAYOPS_KERNELS(i64, ARRAYOPS_SCALE_FLOAT(i64)),
+    ARRAYOPS_KERNELS(u64, ARRAYOPS_SCALE_FLOAT(u64)),
+    #if MICROPY_PY_BUILTINS_FLOAT
+    // floats are scaled by the plain kernel, with k and c converted to T
+    ARRAYOPS_KERNELS(f32, ARRAYOPS_SCALE_FLOAT_NONE),
+    ARRAYOPS_KERNELS(f64, ARRAYOPS_SCALE_FLOAT_NONE),
+    #endif
+};
+
+STATIC const uint8_t arrayops_item_size[ARRAYOPS_NUM_KINDS] = {
+    1, 1, 2, 2, 4, 4, 8, 8,
+    #if MICROPY_PY_BUILTINS_FLOAT
+    4, 8,
+    #endif
+};
+
+/******************************************************************************/
+// operands
+
+typedef struct _arrayops_arg_t {
+    byte *items; // NULL for a scalar
+    size_t len;
+    char typecode;
+    uint8_t kind;
+} arrayops_arg_t;
+
+STATIC int arrayops_kind(char typecode) {
+    switch (typecode) {
+        case BYTEARRAY_TYPECODE:
+            return ARRAYOPS_U8;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case 'f':
+            return ARRAYOPS_F32;
+        case 'd':
+            return ARRAYOPS_F64;
+        #endif
+        case 'b': case 'B': case 'h': case 'H': case 'i': case 'I':
+        case 'l': case 'L': case 'q': case 'Q': {
+            size_t sz = mp_binary_get_size('@', typecode, NULL);
+            int kind = sz == 1 ? ARRAYOPS_I8 : sz == 2 ? ARRAYOPS_I16 : sz == 4 ? ARRAYOPS_I32 : ARRAYOPS_I64;
+            return kind + (typecode <= 'Z');
+        }
+    }
+    mp_raise_ValueError("bad typecode");
+}
+
+STATIC void arrayops_get_array(mp_obj_t obj, arrayops_arg_t *arg, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, flags);
+    arg->typecode = bufinfo.typecode;
+    arg->kind = arrayops_kind(bufinfo.typecode);
+    arg->items = bufinfo.buf;
+    arg->len = bufinfo.len / arrayops_item_size[arg->kind];
+}
+
+// Returns false for a scalar, an int or a float.
+STATIC bool arrayops_get_arg(mp_obj_t obj, arrayops_arg_t *arg) {
+    if (mp_obj_is_int(obj)
+        #if MICROPY_PY_BUILTINS_FLOAT
+        || mp_obj_is_float(obj)
+        #endif
+        ) {
+        arg->items = NULL;
+        return false;
+    }
+    arrayops_get_array(obj, arg, MP_BUFFER_READ);
+    return true;
+}
+
+// Returns out, or if it is None a new array like the operand.
+STATIC mp_obj_t arrayops_get_out(mp_obj_t out_in, const arrayops_arg_t *like, arrayops_arg_t *out) {
+    if (out_in == mp_const_none) {
+        out_in = mp_obj_new_array(like->typecode, like->len);
+    }
+    arrayops_get_array(out_in, out, MP_BUFFER_WRITE);
+    if (out->len != like->len) {
+        mp_raise_ValueError("length mismatch");
+    }
+    return out_in;
+}
+
+STATIC long long arrayops_load_int(int kind, const void *p, size_t i) {
+    switch (kind) {
+        case ARRAYOPS_I8: return ((const int8_t*)p)[i];
+        case ARRAYOPS_U8: return ((const uint8_t*)p)[i];
+        case ARRAYOPS_I16: return ((const int16_t*)p)[i];
+        case ARRAYOPS_U16: return ((const uint16_t*)p)[i];
+        case ARRAYOPS_I32: return ((const int32_t*)p)[i];
+        case ARRAYOPS_U32: return ((const uint32_t*)p)[i];
+        default: return ((const int64_t*)p)[i];
+    }
+}
+
+STATIC void arrayops_store_int(int kind, void *p, size_t i, long long val) {
+    switch (kind) {
+        case ARRAYOPS_I8: case ARRAYOPS_U8: ((uint8_t*)p)[i] = val; break;
+        case ARRAYOPS_I16: case ARRAYOPS_U16: ((uint16_t*)p)[i] = val; break;
+        case ARRAYOPS_I32: case ARRAYOPS_U32: ((uint32_t*)p)[i] = val; break;
+        case ARRAYOPS_I64: case ARRAYOPS_U64: ((uint64_t*)p)[i] = val; break;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case ARRAYOPS_F32: ((float*)p)[i] = val; break;
+        case ARRAYOPS_F64: ((double*)p)[i] = val; break;
+        #endif
+    }
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_float_t arrayops_load_float(int kind, const void *p, size_t i) {
+    if (kind == ARRAYOPS_F32) {
+        return ((const float*)p)[i];
+    } else if (kind == ARRAYOPS_F64) {
+        return ((const double*)p)[i];
+    } else if (kind == ARRAYOPS_U64) {
+        return ((const uint64_t*)p)[i];
+    }
+    return arrayops_load_int(kind, p, i);
+}
+
+// Integer types get the value rounded towards zero and saturated, as from
+// scale() with a float factor.
+STATIC void arrayops_store_float(int kind, void *p, size_t i, mp_float_t val) {
+    if (!ARRAYOPS_IS_FLOAT(kind)) {
+        // computed as 0 * 0 + val by the kernel, which saturates
+        uint64_t zero = 0;
+        void *q = (byte*)p + i * arrayops_item_size[kind];
+        arrayops_kernels[kind].scale_float(q, &zero, 0, val == val ? val : 0, 1);
+    } else if (kind == ARRAYOPS_F32) {
+        ((float*)p)[i] = val;
+    } else {
+        ((double*)p)[i] = val;
+    }
+}
+#endif
+
+// Converts n items of src to items of the other kind at dst.
+STATIC void arrayops_convert(int dst_kind, void *dst, int src_kind, const void *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (ARRAYOPS_IS_FLOAT(src_kind) || (ARRAYOPS_IS_FLOAT(dst_kind) && src_kind == ARRAYOPS_U64)) {
+            arrayops_store_float(dst_kind, dst, i, arrayops_load_float(src_kind, src, i));
+            continue;
+        }
+        #endif
+        arrayops_store_int(dst_kind, dst, i, arrayops_load_int(src_kind, src, i));
+    }
+}
+
+// Stores the int or float obj as an item of kind at p.
+STATIC void arrayops_set_scalar(int kind, void *p, mp_obj_t obj) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (ARRAYOPS_IS_FLOAT(kind)) {
+        arrayops_store_float(kind, p, 0, mp_obj_get_float(obj));
+        return;
+    }
+    #endif
+    #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+    if (mp_obj_is_type(obj, &mp_type_int)) {
+        mp_obj_int_to_bytes_impl(obj, MP_ENDIANNESS_BIG, arrayops_item_size[kind], p);
+        return;
+    }
+    #endif
+    // raises TypeError for a float
+    arrayops_store_int(kind, p, 0, mp_obj_get_int(obj));
+}
+
+// Fills a chunk with the scalar obj, converted to kind.
+STATIC void arrayops_broadcast(int kind, void *p, mp_obj_t obj) {
+    size_t sz = arrayops_item_size[kind];
+    arrayops_set_scalar(kind, p, obj);
+    for (size_t i = 1; i < ARRAYOPS_CHUNK; i++) {
+        memcpy((byte*)p + i * sz, p, sz);
+    }
+}
+
+// Returns items i to i + n of the operand as items of kind, converted into
+// tmp if needed.  A scalar is in tmp already.
+STATIC const void *arrayops_chunk(const arrayops_arg_t *arg, int kind, size_t i, size_t n, void *tmp) {
+    if (arg->items == NULL) {
+        return tmp;
+    }
+    const byte *p = arg->items + i * arrayops_item_size[arg->kind];
+    if (arg->kind == kind) {
+        return p;
+    }
+    arrayops_convert(kind, tmp, arg->kind, p, n);
+    return tmp;
+}
+
+// The operands can be handled in one go if none needs converting.
+STATIC size_t arrayops_step(const arrayops_arg_t *arg, const arrayops_arg_t *out) {
+    return (arg->items != NULL && arg->kind == out->kind) ? out->len : ARRAYOPS_CHUNK;
+}
+
+STATIC mp_obj_t arrayops_new_int(int kind, unsigned long long val) {
+    if (kind & 1) {
+        // unsigned
+        if (val <= MP_SMALL_INT_MAX) {
+            return MP_OBJ_NEW_SMALL_INT(val);
+        }
+        return mp_obj_new_int_from_ull(val);
+    }
+    if ((long long)val >= MP_SMALL_INT_MIN && (long long)val <= MP_SMALL_INT_MAX) {
+        return MP_OBJ_NEW_SMALL_INT((mp_int_t)(long long)val);
+    }
+    return mp_obj_new_int_from_ll(val);
+}
+
+STATIC mp_obj_t arrayops_acc_obj(int kind, const arrayops_acc_t *acc) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (kind == ARRAYOPS_F32) {
+        return mp_obj_new_float(acc->f);
+    } else if (kind == ARRAYOPS_F64) {
+        return mp_obj_new_float(acc->d);
+    }
+    #endif
+    return arrayops_new_int(kind, acc->i);
+}
+
+/******************************************************************************/
+// elementwise functions
+
+STATIC mp_obj_t arrayops_binop(int op, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_a, ARG_b, ARG_out };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_a, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_b, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_out, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    arrayops_arg_t a, b, out;
+    bool a_is_array = arrayops_get_arg(args[ARG_a].u_obj, &a);
+    bool b_is_array = arrayops_get_arg(args[ARG_b].u_obj, &b);
+    if (!a_is_array && !b_is_array) {
+        mp_raise_TypeError("array required");
+    }
+    if (a_is_array && b_is_array && a.len != b.len) {
+        mp_raise_ValueError("length mismatch");
+    }
+    mp_obj_t out_obj = arrayops_get_out(args[ARG_out].u_obj, a_is_array ? &a : &b, &out);
+
+    uint64_t tmp_a[ARRAYOPS_CHUNK], tmp_b[ARRAYOPS_CHUNK];
+    if (!a_is_array) {
+        arrayops_broadcast(out.kind, tmp_a, args[ARG_a].u_obj);
+    }
+    if (!b_is_array) {
+        arrayops_broadcast(out.kind, tmp_b, args[ARG_b].u_obj);
+    }
+    const arrayops_kernels_t *k = &arrayops_kernels[out.kind];
+    size_t sz = arrayops_item_size[out.kind];
+    size_t step = MIN(arrayops_step(&a, &out), arrayops_step(&b, &out));
+    for (size_t i = 0; i < out.len; i += step) {
+        size_t n = MIN(step, out.len - i);
+        k->binop(op, out.items + i * sz,
+            arrayops_chunk(&a, out.kind, i, n, tmp_a), arrayops_chunk(&b, out.kind, i, n, tmp_b), n);
+    }
+    return out_obj;
+}
+
+STATIC mp_obj_t arrayops_add(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return arrayops_binop(ARRAYOPS_ADD, n_args, pos_args, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_add_obj, 2, arrayops_add);
+
+STATIC mp_obj_t arrayops_sub(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return arrayops_binop(ARRAYOPS_SUB, n_args, pos_args, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_sub_obj, 2, arrayops_sub);
+
+STATIC mp_obj_t arrayops_mul(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return arrayops_binop(ARRAYOPS_MUL, n_args, pos_args, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_mul_obj, 2, arrayops_mul);
+
+// scale(a, k, offset=0, out=None): a * k + offset
+STATIC mp_obj_t arrayops_scale(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_a, ARG_k, ARG_offset, ARG_out };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_a, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_k, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_offset, MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(0)} },
+        { MP_QSTR_out, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    arrayops_arg_t a, out;
+    arrayops_get_array(args[ARG_a].u_obj, &a, MP_BUFFER_READ);
+    mp_obj_t out_obj = arrayops_get_out(args[ARG_out].u_obj, &a, &out);
+
+    uint64_t tmp[ARRAYOPS_CHUNK];
+    const arrayops_kernels_t *k = &arrayops_kernels[out.kind];
+    size_t sz = arrayops_item_size[out.kind];
+    size_t step = arrayops_step(&a, &out);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (!ARRAYOPS_IS_FLOAT(out.kind)
+        && (mp_obj_is_float(args[ARG_k].u_obj) || mp_obj_is_float(args[ARG_offset].u_obj))) {
+        mp_float_t kf = mp_obj_get_float(args[ARG_k].u_obj);
+        mp_float_t cf = mp_obj_get_float(args[ARG_offset].u_obj);
+        for (size_t i = 0; i < out.len; i += step) {
+            size_t n = MIN(step, out.len - i);
+            k->scale_float(out.items + i * sz, arrayops_chunk(&a, out.kind, i, n, tmp), kf, cf, n);
+        }
+        return out_obj;
+    }
+    #endif
+    uint64_t kc[2];
+    arrayops_set_scalar(out.kind, &kc[0], args[ARG_k].u_obj);
+    arrayops_set_scalar(out.kind, &kc[1], args[ARG_offset].u_obj);
+    for (size_t i = 0; i < out.len; i += step) {
+        size_t n = MIN(step, out.len - i);
+        k->scale(out.items + i * sz, arrayops_chunk(&a, out.kind, i, n, tmp), &kc[0], &kc[1], n);
+    }
+    return out_obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_scale_obj, 2, arrayops_scale);
+
+// clip(a, lo, hi, out=None)
+STATIC mp_obj_t arrayops_clip(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_a, ARG_lo, ARG_hi, ARG_out };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_a, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_lo, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_hi, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_out, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    arrayops_arg_t a, out;
+    arrayops_get_array(args[ARG_a].u_obj, &a, MP_BUFFER_READ);
+    mp_obj_t out_obj = arrayops_get_out(args[ARG_out].u_obj, &a, &out);
+
+    uint64_t tmp[ARRAYOPS_CHUNK], lohi[2];
+    arrayops_set_scalar(out.kind, &lohi[0], args[ARG_lo].u_obj);
+    arrayops_set_scalar(out.kind, &lohi[1], args[ARG_hi].u_obj);
+    const arrayops_kernels_t *k = &arrayops_kernels[out.kind];
+    size_t sz = arrayops_item_size[out.kind];
+    size_t step = arrayops_step(&a, &out);
+    for (size_t i = 0; i < out.len; i += step) {
+        size_t n = MIN(step, out.len - i);
+        k->clip(out.items + i * sz, arrayops_chunk(&a, out.kind, i, n, tmp), &lohi[0], &lohi[1], n);
+    }
+    return out_obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_clip_obj, 3, arrayops_clip);
+
+// cumsum(a, out=None)
+STATIC mp_obj_t arrayops_cumsum(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_a, ARG_out };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_a, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_out, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    arrayops_arg_t a, out;
+    arrayops_get_array(args[ARG_a].u_obj, &a, MP_BUFFER_READ);
+    mp_obj_t out_obj = arrayops_get_out(args[ARG_out].u_obj, &a, &out);
+
+    uint64_t tmp[ARRAYOPS_CHUNK], acc = 0;
+    const arrayops_kernels_t *k = &arrayops_kernels[out.kind];
+    size_t sz = arrayops_item_size[out.kind];
+    size_t step = arrayops_step(&a, &out);
+    for (size_t i = 0; i < out.len; i += step) {
+        size_t n = MIN(step, out.len - i);
+        k->cumsum(out.items + i * sz, arrayops_chunk(&a, out.kind, i, n, tmp), &acc, n);
+    }
+    return out_obj;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(arrayops_cumsum_obj, 1, arrayops_cumsum);
+
+/******************************************************************************/
+// reductions
+
+STATIC mp_obj_t arrayops_sum(mp_obj_t a_in) {
+    arrayops_arg_t a;
+    arrayops_get_array(a_in, &a, MP_BUFFER_READ);
+    arrayops_acc_t acc = {0};
+    arrayops_kernels[a.kind].sum(&acc, a.items, a.len);
+    return arrayops_acc_obj(a.kind, &acc);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(arrayops_sum_obj, arrayops_sum);
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_obj_t arrayops_mean(mp_obj_t a_in) {
+    arrayops_arg_t a;
+    arrayops_get_array(a_in, &a, MP_BUFFER_READ);
+    if (a.len == 0) {
+        mp_raise_ValueError("empty array");
+    }
+    arrayops_acc_t acc = {0};
+    arrayops_kernels[a.kind].sum(&acc, a.items, a.len);
+    mp_float_t sum;
+    if (a.kind == ARRAYOPS_F32) {
+        sum = acc.f;
+    } else if (a.kind == ARRAYOPS_F64) {
+        sum = acc.d;
+    } else if (a.kind & 1) {
+        sum = acc.i;
+    } else {
+        sum = (long long)acc.i;
+    }
+    return mp_obj_new_float(sum / a.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(arrayops_mean_obj, arrayops_mean);
+#endif
+
+STATIC mp_obj_t arrayops_minmax(mp_obj_t a_in, bool want_max) {
+    arrayops_arg_t a;
+    arrayops_get_array(a_in, &a, MP_BUFFER_READ);
+    if (a.len == 0) {
+        mp_raise_ValueError("empty array");
+    }
+    uint64_t lo, hi;
+    memcpy(&lo, a.items, arrayops_item_size[a.kind]);
+    memcpy(&hi, a.items, arrayops_item_size[a.kind]);
+    arrayops_kernels[a.kind].minmax(&lo, &hi, a.items, a.len);
+    const void *p = want_max ? &hi : &lo;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (ARRAYOPS_IS_FLOAT(a.kind)) {
+        return mp_obj_new_float(arrayops_load_float(a.kind, p, 0));
+    }
+    #endif
+    return arrayops_new_int(a.kind, arrayops_load_int(a.kind, p, 0));
+}
+
+STATIC mp_obj_t arrayops_min(mp_obj_t a_in) {
+    return arrayops_minmax(a_in, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(arrayops_min_obj, arrayops_min);
+
+STATIC mp_obj_t arrayops_max(mp_obj_t a_in) {
+    return arrayops_minmax(a_in, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(arrayops_max_obj, arrayops_max);
+
+// Arrays of different types are both converted to float, or to 64-bit
+// integers if neither is a float.
+STATIC mp_obj_t arrayops_dot(mp_obj_t a_in, mp_obj_t b_in) {
+    arrayops_arg_t a, b;
+    arrayops_get_array(a_in, &a, MP_BUFFER_READ);
+    arrayops_get_array(b_in, &b, MP_BUFFER_READ);
+    if (a.len != b.len) {
+        mp_raise_ValueError("length mismatch");
+    }
+    arrayops_acc_t acc = {0};
+    if (a.kind == b.kind) {
+        arrayops_kernels[a.kind].dot(&acc, a.items, b.items, a.len);
+        return arrayops_acc_obj(a.kind, &acc);
+    }
+    int kind = ARRAYOPS_I64;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (ARRAYOPS_IS_FLOAT(a.kind) || ARRAYOPS_IS_FLOAT(b.kind)) {
+        kind = ARRAYOPS_FLOAT;
+    }
+    #endif
+    uint64_t tmp_a[ARRAYOPS_CHUNK], tmp_b[ARRAYOPS_CHUNK];
+    for (size_t i = 0; i < a.len; i += ARRAYOPS_CHUNK) {
+        size_t n = MIN(ARRAYOPS_CHUNK, a.len - i);
+        arrayops_kernels[kind].dot(&acc,
+            arrayops_chunk(&a, kind, i, n, tmp_a), arrayops_chunk(&b, kind, i, n, tmp_b), n);
+    }
+    return arrayops_acc_obj(kind, &acc);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(arrayops_dot_obj, arrayops_dot);
+
+STATIC const mp_rom_map_elem_t arrayops_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_arrayops) },
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&arrayops_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&arrayops_sub_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mul), MP_ROM_PTR(&arrayops_mul_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scale), MP_ROM_PTR(&arrayops_scale_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clip), MP_ROM_PTR(&arrayops_clip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_cumsum), MP_ROM_PTR(&arrayops_cumsum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sum), MP_ROM_PTR(&arrayops_sum_obj) },
+    #if MICROPY_PY_BUILTINS_FLOAT
+    { MP_ROM_QSTR(MP_QSTR_mean), MP_ROM_PTR(&arrayops_mean_obj) },
+    #endif
+    { MP_ROM_QSTR(MP_QSTR_min), MP_ROM_PTR(&arrayops_min_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max), MP_ROM_PTR(&arrayops_max_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dot), MP_ROM_PTR(&arrayops_dot_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(arrayops_module_globals, arrayops_module_globals_table);
+
+const mp_obj_module_t mp_module_arrayops = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&arrayops_module_globals,
+};
+
+#endif // MICROPY_PY_ARRAYOPS
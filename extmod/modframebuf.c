@@ -39,6 +39,8 @@ typedef struct _mp_obj_framebuf_t {
     void *buf;
     uint16_t width, height, stride;
     uint8_t format;
+    // bounding box of what was drawn since dirty() was last called, empty if x0 >= x1
+    uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
 } mp_obj_framebuf_t;
 
 typedef void (*setpixel_t)(const mp_obj_framebuf_t*, int, int, uint32_t);
@@ -49,6 +51,7 @@ typedef struct _mp_framebuf_p_t {
     setpixel_t setpixel;
     getpixel_t getpixel;
     fill_rect_t fill_rect;
+    uint8_t bpp; // bits per pixel
 } mp_framebuf_p_t;
 
 // constants for formats
@@ -60,6 +63,28 @@ typedef struct _mp_framebuf_p_t {
 #define FRAMEBUF_MHLSB    (3)
 #define FRAMEBUF_MHMSB    (4)
 
+// Fill a rectangle of a horizontally packed format a row at a time: the
+// pixels that share a byte with the edges of the rectangle are set one by
+// one and the whole bytes in between with memset.
+STATIC void packed_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col,
+    setpixel_t set, int bpp, uint8_t pattern) {
+    int ppb = 8 / bpp; // pixels per byte
+    int head = MIN(w, -x & (ppb - 1));
+    int nbytes = (w - head) / ppb;
+    int tail = w - head - nbytes * ppb;
+    for (; h--; ++y) {
+        int xx = x;
+        for (int i = head; i; --i) {
+            set(fb, xx++, y, col);
+        }
+        memset(&((uint8_t*)fb->buf)[(xx + y * fb->stride) / ppb], pattern, nbytes);
+        xx += nbytes * ppb;
+        for (int i = tail; i; --i) {
+            set(fb, xx++, y, col);
+        }
+    }
+}
+
 // Functions for MHLSB and MHMSB
 
 STATIC void mono_horiz_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -75,17 +100,7 @@ STATIC uint32_t mono_horiz_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 }
 
 STATIC void mono_horiz_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
-    int reverse = fb->format == FRAMEBUF_MHMSB;
-    int advance = fb->stride >> 3;
-    while (w--) {
-        uint8_t *b = &((uint8_t*)fb->buf)[(x >> 3) + y * advance];
-        int offset = reverse ?  x & 7 : 7 - (x & 7);
-        for (int hh = h; hh; --hh) {
-            *b = (*b & ~(0x01 << offset)) | ((col != 0) << offset);
-            b += advance;
-        }
-        ++x;
-    }
+    packed_fill_rect(fb, x, y, w, h, col, mono_horiz_setpixel, 1, col ? 0xff : 0x00);
 }
 
 // Functions for MVLSB format
@@ -101,14 +116,22 @@ STATIC uint32_t mvlsb_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 }
 
 STATIC void mvlsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
-    while (h--) {
+    // fill a page of 8 rows at a time, setting all the rows inside the rectangle at once
+    int yend = y + h;
+    while (y < yend) {
+        int n = MIN(8 - (y & 0x07), yend - y);
+        uint8_t mask = ((1 << n) - 1) << (y & 0x07);
         uint8_t *b = &((uint8_t*)fb->buf)[(y >> 3) * fb->stride + x];
-        uint8_t offset = y & 0x07;
-        for (int ww = w; ww; --ww) {
-            *b = (*b & ~(0x01 << offset)) | ((col != 0) << offset);
-            ++b;
+        if (mask == 0xff) {
+            memset(b, col ? 0xff : 0x00, w);
+        } else {
+            uint8_t bits = col ? mask : 0;
+            for (int ww = w; ww; --ww) {
+                *b = (*b & ~mask) | bits;
+                ++b;
+            }
         }
-        ++y;
+        y += n;
     }
 }
 
@@ -149,11 +172,7 @@ STATIC uint32_t gs2_hmsb_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 }
 
 STATIC void gs2_hmsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
-    for (int xx=x; xx < x+w; xx++) {
-        for (int yy=y; yy < y+h; yy++) {
-            gs2_hmsb_setpixel(fb, xx, yy, col);
-        }
-    }
+    packed_fill_rect(fb, x, y, w, h, col, gs2_hmsb_setpixel, 2, (col & 0x3) * 0x55);
 }
 
 // Functions for GS4_HMSB format
@@ -227,13 +246,13 @@ STATIC void gs8_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int
 }
 
 STATIC mp_framebuf_p_t formats[] = {
-    [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect},
-    [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect},
-    [FRAMEBUF_GS2_HMSB] = {gs2_hmsb_setpixel, gs2_hmsb_getpixel, gs2_hmsb_fill_rect},
-    [FRAMEBUF_GS4_HMSB] = {gs4_hmsb_setpixel, gs4_hmsb_getpixel, gs4_hmsb_fill_rect},
-    [FRAMEBUF_GS8] = {gs8_setpixel, gs8_getpixel, gs8_fill_rect},
-    [FRAMEBUF_MHLSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
-    [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
+    [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect, 1},
+    [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect, 16},
+    [FRAMEBUF_GS2_HMSB] = {gs2_hmsb_setpixel, gs2_hmsb_getpixel, gs2_hmsb_fill_rect, 2},
+    [FRAMEBUF_GS4_HMSB] = {gs4_hmsb_setpixel, gs4_hmsb_getpixel, gs4_hmsb_fill_rect, 4},
+    [FRAMEBUF_GS8] = {gs8_setpixel, gs8_getpixel, gs8_fill_rect, 8},
+    [FRAMEBUF_MHLSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect, 1},
+    [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect, 1},
 };
 
 static inline void setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -244,7 +263,141 @@ static inline uint32_t getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
     return formats[fb->format].getpixel(fb, x, y);
 }
 
-STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+// Add a rectangle, clipped to the framebuffer, to the region reported by dirty().
+STATIC void mark_dirty(mp_obj_framebuf_t *fb, int x, int y, int w, int h) {
+    int xend = MIN(fb->width, x + w);
+    int yend = MIN(fb->height, y + h);
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    if (x >= xend || y >= yend) {
+        return;
+    }
+    if (fb->dirty_x0 >= fb->dirty_x1) {
+        fb->dirty_x0 = x;
+        fb->dirty_y0 = y;
+        fb->dirty_x1 = xend;
+        fb->dirty_y1 = yend;
+    } else {
+        fb->dirty_x0 = MIN(fb->dirty_x0, x);
+        fb->dirty_y0 = MIN(fb->dirty_y0, y);
+        fb->dirty_x1 = MAX(fb->dirty_x1, xend);
+        fb->dirty_y1 = MAX(fb->dirty_y1, yend);
+    }
+}
+
+// Copy h rows of w pixels one pixel at a time, going up and to the left if
+// backwards so that an overlapping block in the same buffer stays intact.
+STATIC void copy_pixels(const mp_obj_framebuf_t *dst, int dx, int dy,
+    const mp_obj_framebuf_t *src, int sx, int sy, int w, int h, bool backwards) {
+    getpixel_t get = formats[src->format].getpixel;
+    setpixel_t set = formats[dst->format].setpixel;
+    if (backwards) {
+        for (int j = h - 1; j >= 0; --j) {
+            for (int i = w - 1; i >= 0; --i) {
+                set(dst, dx + i, dy + j, get(src, sx + i, sy + j));
+            }
+        }
+    } else {
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                set(dst, dx + i, dy + j, get(src, sx + i, sy + j));
+            }
+        }
+    }
+}
+
+// Store n bytes of pixels to d, made from the bytes at s which hold the same
+// pixels starting k (1 to 7) bits further on; the bits following s[i] are in
+// s[i + next].  Pixels are ordered from the most significant bit if msb_first.
+STATIC void shift_bytes(uint8_t *d, const uint8_t *s, size_t next, size_t n, int k, bool msb_first, bool backwards) {
+    for (size_t j = 0; j < n; ++j) {
+        size_t i = backwards ? n - 1 - j : j;
+        if (msb_first) {
+            d[i] = (s[i] << k) | (s[i + next] >> (8 - k));
+        } else {
+            d[i] = (s[i] >> k) | (s[i + next] << (8 - k));
+        }
+    }
+}
+
+// Copy a w by h block of pixels between framebuffers of the same format and
+// stride, with the semantics of memmove if they share a buffer.  The block is
+// moved a byte at a time, a row (a page of 8 rows for MVLSB) at a time, with
+// memmove when the source and destination pixels line up within their bytes
+// and by shifting pairs of bytes when they don't.  Only the pixels sharing a
+// byte with the edges of the block are copied one by one.
+STATIC void copy_rect(const mp_obj_framebuf_t *dst, int dx, int dy,
+    const mp_obj_framebuf_t *src, int sx, int sy, int w, int h) {
+    bool same_buf = dst->buf == src->buf;
+    bool backwards = same_buf && (dy > sy || (dy == sy && dx > sx));
+    uint8_t *dbuf = dst->buf;
+    const uint8_t *sbuf = src->buf;
+
+    if (dst->format == FRAMEBUF_MVLSB) {
+        // rows are bits within a byte, so split the block vertically
+        int head = MIN(h, -dy & 0x07);
+        int npages = (h - head) >> 3;
+        int tail = h - head - (npages << 3);
+        int dpage = (dy + head) >> 3;
+        int spage = (sy + head) >> 3;
+        int k = (sy + head) & 0x07;
+        if (backwards) {
+            copy_pixels(dst, dx, dy + h - tail, src, sx, sy + h - tail, w, tail, true);
+        } else {
+            copy_pixels(dst, dx, dy, src, sx, sy, w, head, false);
+        }
+        for (int j = 0; j < npages; ++j) {
+            int p = backwards ? npages - 1 - j : j;
+            uint8_t *d = &dbuf[(dpage + p) * dst->stride + dx];
+            const uint8_t *s = &sbuf[(spage + p) * src->stride + sx];
+            if (k == 0) {
+                memmove(d, s, w);
+            } else {
+                // a page may be read and written at once, so go right to left if moving right
+                shift_bytes(d, s, src->stride, w, k, false, same_buf && dx > sx);
+            }
+        }
+        if (backwards) {
+            copy_pixels(dst, dx, dy, src, sx, sy, w, head, true);
+        } else {
+            copy_pixels(dst, dx, dy + h - tail, src, sx, sy + h - tail, w, tail, false);
+        }
+        return;
+    }
+
+    // pixels are packed along rows, split the block horizontally
+    int bpp = formats[dst->format].bpp;
+    int ppb = 8 / MIN(bpp, 8); // pixels per byte
+    int head = MIN(w, -dx & (ppb - 1));
+    int nmid = (w - head) & ~(ppb - 1);
+    int tail = w - head - nmid;
+    size_t nbytes = (size_t)nmid * bpp >> 3;
+    bool msb_first = dst->format == FRAMEBUF_MHLSB || dst->format == FRAMEBUF_GS4_HMSB;
+    for (int j = 0; j < h; ++j) {
+        int y = backwards ? h - 1 - j : j;
+        uint8_t *d = &dbuf[(size_t)(dx + head + (dy + y) * dst->stride) * bpp >> 3];
+        size_t soff = (size_t)(sx + head + (sy + y) * src->stride) * bpp;
+        const uint8_t *s = &sbuf[soff >> 3];
+        int k = soff & 0x07;
+        if (backwards) {
+            copy_pixels(dst, dx + w - tail, dy + y, src, sx + w - tail, sy + y, tail, 1, true);
+        } else {
+            copy_pixels(dst, dx, dy + y, src, sx, sy + y, head, 1, false);
+        }
+        if (k == 0) {
+            memmove(d, s, nbytes);
+        } else {
+            shift_bytes(d, s, 1, nbytes, k, msb_first, backwards);
+        }
+        if (backwards) {
+            copy_pixels(dst, dx, dy + y, src, sx, sy + y, head, 1, true);
+        } else {
+            copy_pixels(dst, dx + w - tail, dy + y, src, sx + w - tail, sy + y, tail, 1, false);
+        }
+    }
+}
+
+STATIC void fill_rect(mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
         // No operation needed.
         return;
@@ -257,6 +410,7 @@ STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, u
     y = MAX(y, 0);
 
     formats[fb->format].fill_rect(fb, x, y, xend - x, yend - y, col);
+    mark_dirty(fb, x, y, xend - x, yend - y);
 }
 
 STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -278,6 +432,7 @@ STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size
     } else {
         o->stride = o->width;
     }
+    o->dirty_x0 = o->dirty_y0 = o->dirty_x1 = o->dirty_y1 = 0;
 
     switch (o->format) {
         case FRAMEBUF_MVLSB:
@@ -315,6 +470,7 @@ STATIC mp_obj_t framebuf_fill(mp_obj_t self_in, mp_obj_t col_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t col = mp_obj_get_int(col_in);
     formats[self->format].fill_rect(self, 0, 0, self->width, self->height, col);
+    mark_dirty(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_fill_obj, framebuf_fill);
@@ -346,6 +502,7 @@ STATIC mp_obj_t framebuf_pixel(size_t n_args, const mp_obj_t *args) {
         } else {
             // set
             setpixel(self, x, y, mp_obj_get_int(args[3]));
+            mark_dirty(self, x, y, 1, 1);
         }
     }
     return mp_const_none;
@@ -411,6 +568,8 @@ STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
     mp_int_t y2 = mp_obj_get_int(args[4]);
     mp_int_t col = mp_obj_get_int(args[5]);
 
+    mark_dirty(self, MIN(x1, x2), MIN(y1, y2), MAX(x1, x2) - MIN(x1, x2) + 1, MAX(y1, y2) - MIN(y1, y2) + 1);
+
     mp_int_t dx = x2 - x1;
     mp_int_t sx;
     if (dx > 0) {
@@ -476,6 +635,10 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     if (n_args > 4) {
         key = mp_obj_get_int(args[4]);
     }
+    mp_obj_framebuf_t *palette = NULL;
+    if (n_args > 5 && args[5] != mp_const_none) {
+        palette = MP_OBJ_TO_PTR(args[5]);
+    }
 
     if (
         (x >= self->width) ||
@@ -494,50 +657,91 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     int y1 = MAX(0, -y);
     int x0end = MIN(self->width, x + source->width);
     int y0end = MIN(self->height, y + source->height);
+    int w = x0end - x0;
+    int h = y0end - y0;
+
+    mark_dirty(self, x0, y0, w, h);
 
-    for (; y0 < y0end; ++y0) {
+    if (palette == NULL && source->format == self->format) {
+        if (key == -1 && (source->buf != self->buf || source->stride == self->stride)) {
+            // Plain copy, done a span of whole bytes at a time.
+            copy_rect(self, x0, y0, source, x1, y1, w, h);
+            return mp_const_none;
+        }
+        if (self->format == FRAMEBUF_RGB565) {
+            for (; y0 < y0end; ++y0, ++y1) {
+                uint16_t *d = &((uint16_t*)self->buf)[x0 + y0 * self->stride];
+                const uint16_t *s = &((const uint16_t*)source->buf)[x1 + y1 * source->stride];
+                for (int ww = w; ww; --ww, ++d, ++s) {
+                    if (*s != (uint32_t)key) {
+                        *d = *s;
+                    }
+                }
+            }
+            return mp_const_none;
+        }
+        if (self->format == FRAMEBUF_GS8) {
+            for (; y0 < y0end; ++y0, ++y1) {
+                uint8_t *d = &((uint8_t*)self->buf)[x0 + y0 * self->stride];
+                const uint8_t *s = &((const uint8_t*)source->buf)[x1 + y1 * source->stride];
+                for (int ww = w; ww; --ww, ++d, ++s) {
+                    if (*s != (uint32_t)key) {
+                        *d = *s;
+                    }
+                }
+            }
+            return mp_const_none;
+        }
+    }
+
+    // A source with at most 8 bits per pixel has its colours looked up in the
+    // palette once, up front.  Colours past the end of the palette are kept.
+    uint32_t lut[256];
+    int bpp = formats[source->format].bpp;
+    if (palette != NULL && bpp <= 8) {
+        for (int c = 0; c < (1 << bpp); ++c) {
+            lut[c] = c < palette->width ? getpixel(palette, c, 0) : (uint32_t)c;
+        }
+    }
+
+    getpixel_t get = formats[source->format].getpixel;
+    setpixel_t set = formats[self->format].setpixel;
+    for (; y0 < y0end; ++y0, ++y1) {
         int cx1 = x1;
         for (int cx0 = x0; cx0 < x0end; ++cx0) {
-            uint32_t col = getpixel(source, cx1, y1);
+            uint32_t col = get(source, cx1, y1);
+            if (palette != NULL) {
+                if (bpp <= 8) {
+                    col = lut[col];
+                } else if (col < palette->width) {
+                    col = getpixel(palette, col, 0);
+                }
+            }
             if (col != (uint32_t)key) {
-                setpixel(self, cx0, y0, col);
+                set(self, cx0, y0, col);
             }
             ++cx1;
         }
-        ++y1;
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 5, framebuf_blit);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 6, framebuf_blit);
 
 STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ystep_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t xstep = mp_obj_get_int(xstep_in);
     mp_int_t ystep = mp_obj_get_int(ystep_in);
-    int sx, y, xend, yend, dx, dy;
-    if (xstep < 0) {
-        sx = 0;
-        xend = self->width + xstep;
-        dx = 1;
-    } else {
-        sx = self->width - 1;
-        xend = xstep - 1;
-        dx = -1;
-    }
-    if (ystep < 0) {
-        y = 0;
-        yend = self->height + ystep;
-        dy = 1;
-    } else {
-        y = self->height - 1;
-        yend = ystep - 1;
-        dy = -1;
-    }
-    for (; y != yend; y += dy) {
-        for (int x = sx; x != xend; x += dx) {
-            setpixel(self, x, y, getpixel(self, x - xstep, y - ystep));
-        }
+    if (xstep <= -self->width || xstep >= self->width || ystep <= -self->height || ystep >= self->height) {
+        // Everything is scrolled out, nothing to move.
+        return mp_const_none;
     }
+    // Move the part that stays visible, the uncovered strips keep their contents.
+    int x = MAX(0, xstep);
+    int y = MAX(0, ystep);
+    int w = self->width - (xstep < 0 ? -xstep : xstep);
+    int h = self->height - (ystep < 0 ? -ystep : ystep);
+    copy_rect(self, x, y, self, x - xstep, y - ystep, w, h);
+    mark_dirty(self, x, y, w, h);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(framebuf_scroll_obj, framebuf_scroll);
@@ -553,6 +757,8 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
         col = mp_obj_get_int(args[4]);
     }
 
+    mark_dirty(self, x0, y0, 8 * strlen(str), 8);
+
     // loop over chars
     for (; *str; ++str) {
         // get char and make sure its in range of font
@@ -580,6 +786,32 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 5, framebuf_text);
 
+STATIC mp_obj_t framebuf_dirty(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 5) {
+        // mark a region that was changed directly through the buffer
+        mark_dirty(self, mp_obj_get_int(args[1]), mp_obj_get_int(args[2]),
+            mp_obj_get_int(args[3]), mp_obj_get_int(args[4]));
+        return mp_const_none;
+    } else if (n_args != 1) {
+        mp_raise_TypeError("dirty takes no arguments or x, y, w, h");
+    }
+
+    // return the bounding box of what was drawn since the last call, and reset it
+    if (self->dirty_x0 >= self->dirty_x1) {
+        return mp_const_none;
+    }
+    mp_obj_t tuple[4] = {
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x1 - self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y1 - self->dirty_y0),
+    };
+    self->dirty_x0 = self->dirty_y0 = self->dirty_x1 = self->dirty_y1 = 0;
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_dirty_obj, 1, 5, framebuf_dirty);
+
 STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&framebuf_fill_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill_rect), MP_ROM_PTR(&framebuf_fill_rect_obj) },
@@ -591,6 +823,7 @@ STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_blit), MP_ROM_PTR(&framebuf_blit_obj) },
     { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&framebuf_scroll_obj) },
     { MP_ROM_QSTR(MP_QSTR_text), MP_ROM_PTR(&framebuf_text_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty), MP_ROM_PTR(&framebuf_dirty_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(framebuf_locals_dict, framebuf_locals_dict_table);
 
@@ -619,6 +852,7 @@ STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
     } else {
         o->stride = o->width;
     }
+    o->dirty_x0 = o->dirty_y0 = o->dirty_x1 = o->dirty_y1 = 0;
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -176,6 +176,48 @@ mp_import_stat_t mp_vfs_import_stat(const char *path) {
     }
 }
 
+#if MICROPY_MODULE_IMPORT_CACHE
+bool mp_vfs_import_listdir(const char *path, mp_obj_t dict, bool *fold_case) {
+    #if MICROPY_VFS_FAT
+    // FAT matches names case-insensitively, so lookups in the listing must too
+    const char *path_out;
+    mp_vfs_mount_t *vfs = mp_vfs_lookup_path(path, &path_out);
+    *fold_case = vfs != MP_VFS_NONE && vfs != MP_VFS_ROOT
+        && mp_obj_get_type(vfs->obj) == &mp_fat_vfs_type;
+    #endif
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t path_o = mp_obj_new_str(path, strlen(path));
+        mp_obj_t iter = mp_vfs_ilistdir(1, &path_o);
+        mp_obj_t next;
+        while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            size_t len;
+            mp_obj_t *items;
+            mp_obj_get_array(next, &len, &items);
+            mp_int_t type = mp_obj_get_int(items[1]);
+            mp_obj_t name = items[0];
+            if (*fold_case) {
+                name = mp_call_function_1(MP_OBJ_FROM_PTR(&str_lower_obj), name);
+            }
+            mp_obj_dict_store(dict, name, MP_OBJ_NEW_SMALL_INT(
+                (type & MP_S_IFDIR) ? MP_IMPORT_STAT_DIR : MP_IMPORT_STAT_FILE));
+        }
+        nlr_pop();
+        return true;
+    } else {
+        // can't list it, so let the caller fall back to stat
+        return false;
+    }
+}
+
+mp_uint_t mp_vfs_import_dir_stamp(const char *path) {
+    // only this process changes a mounted filesystem, and it invalidates the
+    // import cache when it does (FAT doesn't update directory mtimes anyway)
+    (void)path;
+    return 0;
+}
+#endif
+
 mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_readonly, ARG_mkfs };
     static const mp_arg_t allowed_args[] = {
@@ -211,6 +253,8 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
     vfs->obj = vfs_obj;
     vfs->next = NULL;
 
+    mp_import_cache_invalidate();
+
     // call the underlying object to do any mounting operation
     mp_vfs_proxy_call(vfs, MP_QSTR_mount, 2, (mp_obj_t*)&args);
 
@@ -267,6 +311,8 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
         MP_STATE_VM(vfs_cur) = MP_VFS_ROOT;
     }
 
+    mp_import_cache_invalidate();
+
     // call the underlying object to do any unmounting operation
     mp_vfs_proxy_call(vfs, MP_QSTR_umount, 0, NULL);
 
@@ -296,13 +342,20 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    mp_obj_t file = mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    if (strpbrk(mp_obj_str_get_str(args[ARG_mode].u_obj), "wax") != NULL) {
+        // the file may have been created
+        mp_import_cache_invalidate();
+    }
+    return file;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
 
 mp_obj_t mp_vfs_chdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    // relative entries in sys.path now refer to different directories
+    mp_import_cache_invalidate();
     MP_STATE_VM(vfs_cur) = vfs;
     if (vfs == MP_VFS_ROOT) {
         // If we change to the root dir and a VFS is mounted at the root then
@@ -427,6 +480,7 @@ mp_obj_t mp_vfs_mkdir(mp_obj_t path_in) {
     if (vfs == MP_VFS_ROOT || (vfs != MP_VFS_NONE && !strcmp(mp_obj_str_get_str(path_out), "/"))) {
         mp_raise_OSError(MP_EEXIST);
     }
+    mp_import_cache_invalidate();
     return mp_vfs_proxy_call(vfs, MP_QSTR_mkdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
@@ -434,6 +488,7 @@ MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
 mp_obj_t mp_vfs_remove(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    mp_import_cache_invalidate();
     return mp_vfs_proxy_call(vfs, MP_QSTR_remove, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_remove_obj, mp_vfs_remove);
@@ -446,6 +501,7 @@ mp_obj_t mp_vfs_rename(mp_obj_t old_path_in, mp_obj_t new_path_in) {
         // can't rename across filesystems
         mp_raise_OSError(MP_EPERM);
     }
+    mp_import_cache_invalidate();
     return mp_vfs_proxy_call(old_vfs, MP_QSTR_rename, 2, args);
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
@@ -453,6 +509,7 @@ MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
 mp_obj_t mp_vfs_rmdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    mp_import_cache_invalidate();
     return mp_vfs_proxy_call(vfs, MP_QSTR_rmdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_rmdir_obj, mp_vfs_rmdir);
@@ -548,6 +605,7 @@ mp_obj_t mp_vfs_fsformat(mp_obj_t path_in)
 				{
 					if(!strcmp(vfs->str, path))
 					{
+						mp_import_cache_invalidate();
 						return mp_vfs_proxy_call(vfs, MP_QSTR_fsformat, 0, NULL);
 					}
 				}
@@ -84,6 +84,8 @@ extern mp_import_stat_t littleFS_vfs_import_stat(fs_user_mount_t *vfs, const cha
 
 mp_vfs_mount_t *mp_vfs_lookup_path(const char *path, const char **path_out);
 mp_import_stat_t mp_vfs_import_stat(const char *path);
+bool mp_vfs_import_listdir(const char *path, mp_obj_t dict, bool *fold_case);
+mp_uint_t mp_vfs_import_dir_stamp(const char *path);
 mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args);
 mp_obj_t mp_vfs_umount(mp_obj_t mnt_in);
 mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args);
@@ -38,31 +38,52 @@ typedef struct _mp_reader_vfs_t {
     mp_obj_t file;
     uint16_t len;
     uint16_t pos;
-    byte buf[24];
+    byte buf[MICROPY_ALLOC_READER_BUF_SIZE];
 } mp_reader_vfs_t;
 
-STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
-    mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
+// make sure there are bytes buffered, returning false if end of stream
+STATIC bool mp_reader_vfs_fill(mp_reader_vfs_t *reader) {
     if (reader->pos >= reader->len) {
         if (reader->len < sizeof(reader->buf)) {
-            return MP_READER_EOF;
+            return false;
         } else {
             int errcode;
             reader->len = mp_stream_rw(reader->file, reader->buf, sizeof(reader->buf),
                 &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
             if (errcode != 0) {
                 // TODO handle errors properly
-                return MP_READER_EOF;
+                reader->len = 0;
+                return false;
             }
             if (reader->len == 0) {
-                return MP_READER_EOF;
+                return false;
             }
             reader->pos = 0;
         }
     }
+    return true;
+}
+
+STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
+    mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
+    if (!mp_reader_vfs_fill(reader)) {
+        return MP_READER_EOF;
+    }
     return reader->buf[reader->pos++];
 }
 
+STATIC const byte *mp_reader_vfs_readchunk(void *data, size_t *len) {
+    mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
+    if (!mp_reader_vfs_fill(reader)) {
+        *len = 0;
+        return NULL;
+    }
+    const byte *buf = reader->buf + reader->pos;
+    *len = reader->len - reader->pos;
+    reader->pos = reader->len;
+    return buf;
+}
+
 STATIC void mp_reader_vfs_close(void *data) {
     mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
     mp_stream_close(reader->file);
@@ -82,6 +103,7 @@ void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
     reader->data = rf;
     reader->readbyte = mp_reader_vfs_readbyte;
     reader->close = mp_reader_vfs_close;
+    reader->readchunk = mp_reader_vfs_readchunk;
 }
 
 #endif // MICROPY_READER_VFS
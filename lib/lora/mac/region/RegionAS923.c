@@ -116,43 +116,14 @@ static bool VerifyTxFreq( uint32_t freq )
 
 static uint8_t CountNbOfEnabledChannels( bool joined, uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
 {
-    uint8_t nbEnabledChannels = 0;
-    uint8_t delayTransmission = 0;
+    uint16_t channelsMaskJoin = channelsMask[0];
 
-    for( uint8_t i = 0, k = 0; i < AS923_MAX_NB_CHANNELS; i += 16, k++ )
+    if( joined == false )
     {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( joined == false )
-                {
-                    if( ( AS923_JOIN_CHANNELS & ( 1 << j ) ) == 0 )
-                    {
-                        continue;
-                    }
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
-        }
+        channelsMaskJoin &= AS923_JOIN_CHANNELS;
     }
-
-    *delayTx = delayTransmission;
-    return nbEnabledChannels;
+    return RegionCommonCountNbOfEnabledChannels( channels, AS923_MAX_NB_CHANNELS, bands, AS923_MAX_NB_BANDS,
+                                                 datarate, &channelsMaskJoin, enabledChannels, delayTx );
 }
 
 PhyParam_t RegionAS923GetPhyParam( GetPhyParams_t* getPhy )
@@ -355,6 +326,7 @@ void RegionAS923InitDefaults( InitType_t type )
             // Channels
             Channels[0] = ( ChannelParams_t ) AS923_LC1;
             Channels[1] = ( ChannelParams_t ) AS923_LC2;
+            RegionCommonChanSetInvalidate( );
 
             // Initialize the channels default mask
             ChannelsDefaultMask[0] = LC( 1 ) + LC( 2 );
@@ -1051,6 +1023,7 @@ LoRaMacStatus_t RegionAS923ChannelAdd( ChannelAddParams_t* channelAdd )
 
     memcpy( &(Channels[id]), channelAdd->NewChannel, sizeof( Channels[id] ) );
     Channels[id].Band = band;
+    RegionCommonChanSetInvalidate( );
     ChannelsMask[0] |= ( 1 << id );
     return LORAMAC_STATUS_OK;
 }
@@ -1121,6 +1094,7 @@ LoRaMacStatus_t RegionAS923ChannelManualAdd( ChannelAddParams_t* channelAdd )
 
     memcpy( &(Channels[id]), channelAdd->NewChannel, sizeof( Channels[id] ) );
     Channels[id].Band = band;
+    RegionCommonChanSetInvalidate( );
     ChannelsMask[0] |= ( 1 << id );
     return LORAMAC_STATUS_OK;
 }
@@ -1136,6 +1110,7 @@ bool RegionAS923ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
     // Remove the channel from the list of channels
     Channels[id] = ( ChannelParams_t ){ 0, 0, { 0 }, 0 };
+    RegionCommonChanSetInvalidate( );
 
     return RegionCommonChanDisable( ChannelsMask, id, AS923_MAX_NB_CHANNELS );
 }
@@ -1169,6 +1144,8 @@ uint8_t RegionAS923ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionAS923GetChannels( ChannelParams_t** channels, uint32_t *size )
 {
+    // The caller may write the channels
+    RegionCommonChanSetInvalidate( );
     *channels = Channels;
     *size = sizeof(Channels);
     return true;
@@ -37,18 +37,61 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 
 
 
+/*!
+ * The channels of the active region grouped by datarate and by band. Only one
+ * region is active at a time, the set is rebuilt when the region changes or
+ * writes its channels.
+ */
+typedef struct sChanSet
+{
+    /*!
+     * The channel list the set was built from, NULL when it has to be rebuilt.
+     */
+    ChannelParams_t* Channels;
+    /*!
+     * Per datarate, the channels that have a frequency and support it.
+     */
+    uint16_t DrMask[16][REGION_COMMON_CHANNELS_MASK_SIZE];
+    /*!
+     * Per band, the channels that belong to it.
+     */
+    uint16_t BandMask[REGION_COMMON_MAX_NB_BANDS][REGION_COMMON_CHANNELS_MASK_SIZE];
+}ChanSet_t;
+
+static ChanSet_t ChanSet;
+
+
+
 static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
 {
-    uint8_t nbActiveBits = 0;
+    return __builtin_popcount( mask & ( ( 1 << nbBits ) - 1 ) );
+}
+
+static void ChanSetBuild( ChannelParams_t* channels, uint8_t nbChannels )
+{
+    memset( &ChanSet, 0, sizeof( ChanSet ) );
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+    for( uint8_t i = 0; i < nbChannels; i++ )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
+        uint16_t bit = 1 << ( i % 16 );
+
+        if( channels[i].Frequency == 0 )
+        {
+            continue;
+        }
+        for( int8_t dr = 0; dr < 16; dr++ )
+        {
+            if( RegionCommonValueInRange( dr, channels[i].DrRange.Fields.Min, channels[i].DrRange.Fields.Max ) == 1 )
+            {
+                ChanSet.DrMask[dr][i / 16] |= bit;
+            }
+        }
+        if( channels[i].Band < REGION_COMMON_MAX_NB_BANDS )
         {
-            nbActiveBits++;
+            ChanSet.BandMask[channels[i].Band][i / 16] |= bit;
         }
     }
-    return nbActiveBits;
+    ChanSet.Channels = channels;
 }
 
 
@@ -138,6 +181,57 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
     return nbChannels;
 }
 
+void RegionCommonChanSetInvalidate( void )
+{
+    ChanSet.Channels = NULL;
+}
+
+uint8_t RegionCommonCountNbOfEnabledChannels( ChannelParams_t* channels, uint8_t nbChannels, Band_t* bands, uint8_t nbBands,
+                                              uint8_t datarate, uint16_t* channelsMask, uint8_t* enabledChannels, uint8_t* delayTx )
+{
+    uint16_t offMask[REGION_COMMON_CHANNELS_MASK_SIZE] = { 0 };
+    uint8_t nbEnabledChannels = 0;
+    uint8_t delayTransmission = 0;
+
+    *delayTx = 0;
+    if( datarate > 15 )
+    { // Not a datarate of any channel
+        return 0;
+    }
+    if( ChanSet.Channels != channels )
+    {
+        ChanSetBuild( channels, nbChannels );
+    }
+
+    // The channels of the bands in time-off
+    for( uint8_t b = 0; ( b < nbBands ) && ( b < REGION_COMMON_MAX_NB_BANDS ); b++ )
+    {
+        if( bands[b].TimeOff > 0 )
+        {
+            for( uint8_t k = 0; k < REGION_COMMON_CHANNELS_MASK_SIZE; k++ )
+            {
+                offMask[k] |= ChanSet.BandMask[b][k];
+            }
+        }
+    }
+
+    for( uint8_t k = 0; k < ( nbChannels + 15 ) / 16; k++ )
+    {
+        uint16_t mask = channelsMask[k] & ChanSet.DrMask[datarate][k];
+
+        delayTransmission += CountChannels( mask & offMask[k], 16 );
+        mask &= ~offMask[k];
+        while( mask != 0 )
+        {
+            enabledChannels[nbEnabledChannels++] = k * 16 + __builtin_ctz( mask );
+            mask &= mask - 1;
+        }
+    }
+
+    *delayTx = delayTransmission;
+    return nbEnabledChannels;
+}
+
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len )
 {
     if( ( channelsMaskDest != NULL ) && ( channelsMaskSrc != NULL ) )
@@ -35,6 +35,16 @@
 #ifndef __REGIONCOMMON_H__
 #define __REGIONCOMMON_H__
 
+/*!
+ * Largest channels mask of all regions, in 16 bit words ( 96 channels of CN470 ).
+ */
+#define REGION_COMMON_CHANNELS_MASK_SIZE            6
+
+/*!
+ * Largest number of bands of all regions ( EU868 ).
+ */
+#define REGION_COMMON_MAX_NB_BANDS                  5
+
 typedef struct sRegionCommonLinkAdrParams
 {
     /*!
@@ -232,6 +242,44 @@ bool RegionCommonChanDisable( uint16_t* channelsMask, uint8_t id, uint8_t maxCha
  */
 uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uint8_t stopIdx );
 
+/*!
+ * \brief Marks the channel list the channel selection works from as changed.
+ *        The regions call it whenever they write their channels, and when they
+ *        hand the channel list out to be written.
+ */
+void RegionCommonChanSetInvalidate( void );
+
+/*!
+ * \brief Lists the channels a frame can be sent on right now.
+ *        This is a generic function and valid for all regions.
+ *
+ *        The channels are grouped by datarate and by band when the channel list
+ *        changes, so that the selection at each uplink only combines masks.
+ *        The result is the one of checking every channel of the mask for a
+ *        frequency, the datarate range and the time-off of its band.
+ *
+ * \param [IN] channels The channels of the region.
+ *
+ * \param [IN] nbChannels The number of channels of the region.
+ *
+ * \param [IN] bands The bands of the region.
+ *
+ * \param [IN] nbBands The number of bands of the region.
+ *
+ * \param [IN] datarate The datarate of the frame.
+ *
+ * \param [IN] channelsMask The channels to consider.
+ *
+ * \param [OUT] enabledChannels The channels available, in ascending order.
+ *
+ * \param [OUT] delayTx The number of channels which would be available but for the
+ *                      time-off of their band.
+ *
+ * \retval Returns the number of channels available.
+ */
+uint8_t RegionCommonCountNbOfEnabledChannels( ChannelParams_t* channels, uint8_t nbChannels, Band_t* bands, uint8_t nbBands,
+                                              uint8_t datarate, uint16_t* channelsMask, uint8_t* enabledChannels, uint8_t* delayTx );
+
 /*!
  * \brief Copy a channels mask.
  *        This is a generic function and valid for all regions.
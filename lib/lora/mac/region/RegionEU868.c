@@ -145,43 +145,14 @@ static bool VerifyTxFreq( uint32_t freq, uint8_t *band )
 
 static uint8_t CountNbOfEnabledChannels( bool joined, uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
 {
-    uint8_t nbEnabledChannels = 0;
-    uint8_t delayTransmission = 0;
+    uint16_t channelsMaskJoin = channelsMask[0];
 
-    for( uint8_t i = 0, k = 0; i < EU868_MAX_NB_CHANNELS; i += 16, k++ )
+    if( joined == false )
     {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( joined == false )
-                {
-                    if( ( EU868_JOIN_CHANNELS & ( 1 << j ) ) == 0 )
-                    {
-                        continue;
-                    }
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
-        }
+        channelsMaskJoin &= EU868_JOIN_CHANNELS;
     }
-
-    *delayTx = delayTransmission;
-    return nbEnabledChannels;
+    return RegionCommonCountNbOfEnabledChannels( channels, EU868_MAX_NB_CHANNELS, bands, EU868_MAX_NB_BANDS,
+                                                 datarate, &channelsMaskJoin, enabledChannels, delayTx );
 }
 
 IRAM_ATTR PhyParam_t RegionEU868GetPhyParam( GetPhyParams_t* getPhy )
@@ -346,6 +317,7 @@ void RegionEU868InitDefaults( InitType_t type )
             Channels[0] = ( ChannelParams_t ) EU868_LC1;
             Channels[1] = ( ChannelParams_t ) EU868_LC2;
             Channels[2] = ( ChannelParams_t ) EU868_LC3;
+            RegionCommonChanSetInvalidate( );
 
             // Initialize the channels default mask
             ChannelsDefaultMask[0] = LC( 1 ) + LC( 2 ) + LC( 3 );
@@ -1035,6 +1007,7 @@ LoRaMacStatus_t RegionEU868ChannelAdd( ChannelAddParams_t* channelAdd )
 
     memcpy( &(Channels[id]), channelAdd->NewChannel, sizeof( Channels[id] ) );
     Channels[id].Band = band;
+    RegionCommonChanSetInvalidate( );
     ChannelsMask[0] |= ( 1 << id );
     return LORAMAC_STATUS_OK;
 }
@@ -1102,6 +1075,7 @@ LoRaMacStatus_t RegionEU868ChannelManualAdd( ChannelAddParams_t* channelAdd )
 
     memcpy( &(Channels[id]), channelAdd->NewChannel, sizeof( Channels[id] ) );
     Channels[id].Band = band;
+    RegionCommonChanSetInvalidate( );
     ChannelsMask[0] |= ( 1 << id );
     return LORAMAC_STATUS_OK;
 }
@@ -1117,6 +1091,7 @@ bool RegionEU868ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
     // Remove the channel from the list of channels
     Channels[id] = ( ChannelParams_t ){ 0, 0, { 0 }, 0 };
+    RegionCommonChanSetInvalidate( );
 
     return RegionCommonChanDisable( ChannelsMask, id, EU868_MAX_NB_CHANNELS );
 }
@@ -1146,6 +1121,8 @@ uint8_t RegionEU868ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionEU868GetChannels( ChannelParams_t** channels, uint32_t *size )
 {
+    // The caller may write the channels
+    RegionCommonChanSetInvalidate( );
     *channels = Channels;
     *size = sizeof(Channels);
     return true;
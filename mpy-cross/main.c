@@ -30,6 +30,7 @@
 #include <unistd.h>
 
 #include "py/compile.h"
+#include "py/scope.h"
 #include "py/persistentcode.h"
 #include "py/runtime.h"
 #include "py/gc.h"
@@ -41,8 +42,19 @@
 
 // Command line options, with their defaults
 STATIC uint emit_opt = MP_EMIT_OPT_NONE;
+STATIC const char *native_profile_file = NULL;
+STATIC unsigned long native_min_calls = 1;
 mp_uint_t mp_verbose_flag = 0;
 
+// Call counts loaded from a native profile, see native_profile_load
+typedef struct _native_profile_entry_t {
+    const char *qualname;
+    unsigned long count;
+} native_profile_entry_t;
+
+STATIC native_profile_entry_t *native_profile;
+STATIC size_t native_profile_len;
+
 // Heap size of GC heap (if enabled)
 // Make it larger on a 64 bit machine, because pointers are larger.
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
@@ -55,6 +67,89 @@ STATIC void stderr_print_strn(void *env, const char *str, mp_uint_t len) {
 
 STATIC const mp_print_t mp_stderr_print = {NULL, stderr_print_strn};
 
+// Load a profile used to choose which functions are compiled to native code.
+// Each line has the form "<qualname> <count>", where qualname is the function
+// name prefixed by the names of its enclosing classes and functions, joined
+// with dots (eg "Sensor.read" or "main.helper").  Blank lines and lines
+// starting with # are ignored.  The profile is kept for the life of the process.
+STATIC bool native_profile_load(const char *file) {
+    FILE *fp = fopen(file, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    size_t alloc = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+            continue;
+        }
+        char *name = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            p++;
+        }
+        size_t name_len = p - name;
+        unsigned long count = strtoul(p, NULL, 0);
+        if (native_profile_len == alloc) {
+            alloc = alloc * 2 + 16;
+            native_profile = realloc(native_profile, alloc * sizeof(native_profile_entry_t));
+        }
+        char *qualname = malloc(name_len + 1);
+        memcpy(qualname, name, name_len);
+        qualname[name_len] = '\0';
+        native_profile[native_profile_len].qualname = qualname;
+        native_profile[native_profile_len].count = count;
+        native_profile_len++;
+    }
+    fclose(fp);
+    return true;
+}
+
+// Write the dotted name of the given scope (excluding the module) to buf
+STATIC size_t native_profile_qualname(char *buf, size_t size, const scope_t *scope) {
+    if (scope == NULL || scope->kind == SCOPE_MODULE) {
+        return 0;
+    }
+    size_t n = native_profile_qualname(buf, size, scope->parent);
+    size_t len;
+    const char *name = (const char*)qstr_data(scope->simple_name, &len);
+    if (n + len + 1 < size) {
+        memcpy(buf + n, name, len);
+        buf[n + len] = '.';
+        n += len + 1;
+    }
+    return n;
+}
+
+// Compile a function to native code if the profile says it is hot enough
+STATIC uint native_profile_select_emit(const scope_t *parent, qstr name, uint emit_opt) {
+    (void)emit_opt;
+    char buf[256];
+    size_t n = native_profile_qualname(buf, sizeof(buf), parent);
+    size_t len;
+    const char *str = (const char*)qstr_data(name, &len);
+    if (n + len >= sizeof(buf)) {
+        return MP_EMIT_OPT_BYTECODE;
+    }
+    memcpy(buf + n, str, len);
+    buf[n + len] = '\0';
+    for (size_t i = 0; i < native_profile_len; i++) {
+        if (strcmp(native_profile[i].qualname, buf) == 0) {
+            if (native_profile[i].count >= native_min_calls) {
+                if (mp_verbose_flag) {
+                    mp_printf(&mp_stderr_print, "native: %s\n", buf);
+                }
+                return MP_EMIT_OPT_NATIVE_PYTHON;
+            }
+            break;
+        }
+    }
+    return MP_EMIT_OPT_BYTECODE;
+}
+
 STATIC int compile_and_save(const char *file, const char *output_file, const char *source_file) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
@@ -119,6 +214,11 @@ STATIC int usage(char **argv) {
 );
     impl_opts_cnt++;
     printf(
+"  native-profile=<file> -- compile functions listed in <file> to native code\n"
+"  native-min-calls=<n> -- minimum call count in the profile to compile natively (default %lu)\n"
+, native_min_calls);
+    impl_opts_cnt += 2;
+    printf(
 "  heapsize=<n> -- set the heap size for the GC (default %ld)\n"
 , heap_size);
     impl_opts_cnt++;
@@ -144,6 +244,10 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_NATIVE_PYTHON;
                 } else if (strcmp(argv[a + 1], "emit=viper") == 0) {
                     emit_opt = MP_EMIT_OPT_VIPER;
+                } else if (strncmp(argv[a + 1], "native-profile=", sizeof("native-profile=") - 1) == 0) {
+                    native_profile_file = argv[a + 1] + sizeof("native-profile=") - 1;
+                } else if (strncmp(argv[a + 1], "native-min-calls=", sizeof("native-min-calls=") - 1) == 0) {
+                    native_min_calls = strtoul(argv[a + 1] + sizeof("native-min-calls=") - 1, NULL, 0);
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
                     char *end;
                     heap_size = strtol(argv[a + 1] + sizeof("heapsize=") - 1, &end, 0);
@@ -203,6 +307,16 @@ MP_NOINLINE int main_(int argc, char **argv) {
     #else
     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_NONE;
     #endif
+    // functions the native emitter can't handle are compiled to bytecode
+    mp_dynamic_compiler.native_fallback = true;
+
+    if (native_profile_file != NULL) {
+        if (!native_profile_load(native_profile_file)) {
+            mp_printf(&mp_stderr_print, "can't open native profile %s\n", native_profile_file);
+            exit(1);
+        }
+        mp_dynamic_compiler.select_emit = native_profile_select_emit;
+    }
 
     const char *input_file = NULL;
     const char *output_file = NULL;
@@ -39,6 +39,8 @@
 #define MICROPY_EMIT_ARM            (1)
 #define MICROPY_EMIT_XTENSA         (1)
 #define MICROPY_EMIT_INLINE_XTENSA  (1)
+// viper code using "float" can only be run by ports that enable this too
+#define MICROPY_EMIT_NATIVE_FLOAT   (1)
 
 #define MICROPY_DYNAMIC_COMPILER    (1)
 #define MICROPY_COMP_CONST_FOLDING  (1)
@@ -62,7 +62,7 @@ mp_lexer_t *mp_lexer_new_from_str32(qstr src_name, const char *str, mp_uint_t le
     sb->byte_off = (uint32_t)str & 3;
     sb->src_cur = (uint32_t*)(str - sb->byte_off);
     sb->val = *sb->src_cur++ >> sb->byte_off * 8;
-    mp_reader_t reader = {sb, str32_buf_next_byte, str32_buf_free};
+    mp_reader_t reader = {sb, str32_buf_next_byte, str32_buf_free, NULL};
     return mp_lexer_new(src_name, reader);
 }
 
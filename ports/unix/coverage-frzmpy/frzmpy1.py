@@ -0,0 +1 @@
+print('frzmpy1')
@@ -0,0 +1,2 @@
+# test raising an exception in a frozen script
+1 // 0
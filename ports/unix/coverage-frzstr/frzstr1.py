@@ -0,0 +1 @@
+print('frzstr1')
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 
 #include "py/runtime.h"
+#include "py/lexer.h"
 #include "py/stream.h"
 #include "py/builtin.h"
 #include "py/mphal.h"
@@ -200,6 +201,9 @@ STATIC mp_obj_t fdfile_open(const mp_obj_type_t *type, mp_arg_val_t *args) {
     if (fd == -1) {
         mp_raise_OSError(errno);
     }
+    if (mode_x & O_CREAT) {
+        mp_import_cache_invalidate();
+    }
     o->fd = fd;
     return MP_OBJ_FROM_PTR(o);
 }
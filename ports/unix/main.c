@@ -34,6 +34,7 @@
 #include <ctype.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <dirent.h>
 #include <errno.h>
 #include <signal.h>
 
@@ -45,6 +46,7 @@
 #include "py/stackctrl.h"
 #include "py/mphal.h"
 #include "py/mpthread.h"
+#include "py/objstr.h"
 #include "extmod/misc.h"
 #include "genhdr/mpversion.h"
 #include "input.h"
@@ -52,6 +54,9 @@
 // Command line options, with their defaults
 STATIC bool compile_only = false;
 STATIC uint emit_opt = MP_EMIT_OPT_NONE;
+#if MICROPY_MODULE_COMPILE_CACHE
+STATIC const char *compile_cache_dir = NULL;
+#endif
 
 #if MICROPY_ENABLE_GC
 // Heap size of GC heap (if enabled)
@@ -313,6 +318,12 @@ STATIC int usage(char **argv) {
 "  emit={bytecode,native,viper} -- set the default code emitter\n"
 );
     impl_opts_cnt++;
+#if MICROPY_MODULE_COMPILE_CACHE
+    printf(
+"  pycache=<dir> -- save code compiled from imported .py files in <dir>\n"
+);
+    impl_opts_cnt++;
+#endif
 #if MICROPY_ENABLE_GC
     printf(
 "  heapsize=<n>[w][K|M] -- set the heap size for the GC (default %ld)\n"
@@ -344,6 +355,10 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_NATIVE_PYTHON;
                 } else if (strcmp(argv[a + 1], "emit=viper") == 0) {
                     emit_opt = MP_EMIT_OPT_VIPER;
+#if MICROPY_MODULE_COMPILE_CACHE
+                } else if (strncmp(argv[a + 1], "pycache=", sizeof("pycache=") - 1) == 0) {
+                    compile_cache_dir = argv[a + 1] + sizeof("pycache=") - 1;
+#endif
 #if MICROPY_ENABLE_GC
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
                     char *end;
@@ -447,6 +462,12 @@ MP_NOINLINE int main_(int argc, char **argv) {
 
     mp_init();
 
+    #if MICROPY_MODULE_COMPILE_CACHE
+    if (compile_cache_dir != NULL) {
+        MP_STATE_VM(compile_cache_dir) = mp_obj_new_str(compile_cache_dir, strlen(compile_cache_dir));
+    }
+    #endif
+
     char *home = getenv("HOME");
     char *path = getenv("MICROPYPATH");
     if (path == NULL) {
@@ -657,6 +678,76 @@ uint mp_import_stat(const char *path) {
     return MP_IMPORT_STAT_NO_EXIST;
 }
 
+#if MICROPY_MODULE_IMPORT_CACHE
+bool mp_import_listdir(const char *path, mp_obj_t dict, bool *fold_case) {
+    #ifdef _PC_CASE_SENSITIVE
+    // eg the default filesystem on macOS
+    if (pathconf(*path == '\0' ? "." : path, _PC_CASE_SENSITIVE) == 0) {
+        *fold_case = true;
+    }
+    #endif
+    DIR *dir = opendir(*path == '\0' ? "." : path);
+    if (dir == NULL) {
+        // a missing directory is cached as an empty listing
+        return errno == ENOENT || errno == ENOTDIR;
+    }
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        struct dirent *dirent;
+        while ((dirent = readdir(dir)) != NULL) {
+            uint stat = MP_IMPORT_STAT_NO_EXIST;
+            #ifdef _DIRENT_HAVE_D_TYPE
+            if (dirent->d_type == DT_DIR) {
+                stat = MP_IMPORT_STAT_DIR;
+            } else if (dirent->d_type == DT_REG) {
+                stat = MP_IMPORT_STAT_FILE;
+            } else if (dirent->d_type != DT_LNK && dirent->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            #endif
+            if (stat == MP_IMPORT_STAT_NO_EXIST) {
+                // follow symlinks and handle filesystems without d_type
+                char buf[PATH_MAX];
+                if (snprintf(buf, sizeof(buf), "%s/%s", *path == '\0' ? "." : path, dirent->d_name) >= (int)sizeof(buf)) {
+                    continue;
+                }
+                stat = mp_import_stat(buf);
+                if (stat == MP_IMPORT_STAT_NO_EXIST) {
+                    continue;
+                }
+            }
+            mp_obj_t name = mp_obj_new_str(dirent->d_name, strlen(dirent->d_name));
+            if (*fold_case) {
+                name = mp_call_function_1(MP_OBJ_FROM_PTR(&str_lower_obj), name);
+            }
+            mp_obj_dict_store(dict, name, MP_OBJ_NEW_SMALL_INT(stat));
+        }
+        nlr_pop();
+    } else {
+        closedir(dir);
+        nlr_jump(nlr.ret_val);
+    }
+    closedir(dir);
+    return true;
+}
+
+mp_uint_t mp_import_dir_stamp(const char *path) {
+    // other processes may change the directory, so its mtime is used
+    struct stat st;
+    if (stat(*path == '\0' ? "." : path, &st) != 0) {
+        return 1;
+    }
+    mp_uint_t stamp = st.st_mtime;
+    #if defined(__linux__)
+    stamp = stamp * 1000000000 + st.st_mtim.tv_nsec;
+    #elif defined(__APPLE__)
+    stamp = stamp * 1000000000 + st.st_mtimespec.tv_nsec;
+    #endif
+    // 0 and 1 mean no stamp and a missing directory
+    return stamp + 2;
+}
+#endif
+
 void nlr_jump_fail(void *val) {
     printf("FATAL: uncaught NLR %p\n", val);
     exit(1);
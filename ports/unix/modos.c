@@ -35,6 +35,7 @@
 #include "py/mpconfig.h"
 
 #include "py/runtime.h"
+#include "py/lexer.h"
 #include "py/objtuple.h"
 #include "py/mphal.h"
 #include "extmod/misc.h"
@@ -113,6 +114,8 @@ STATIC mp_obj_t mod_os_unlink(mp_obj_t path_in) {
 
     RAISE_ERRNO(r, errno);
 
+    mp_import_cache_invalidate();
+
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_unlink_obj, mod_os_unlink);
@@ -124,6 +127,9 @@ STATIC mp_obj_t mod_os_system(mp_obj_t cmd_in) {
 
     RAISE_ERRNO(r, errno);
 
+    // a directory changed by the command is seen by its new mtime, as for
+    // any other process (see mp_import_dir_stamp), so the cache is kept
+
     return MP_OBJ_NEW_SMALL_INT(r);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_system_obj, mod_os_system);
@@ -146,10 +152,20 @@ STATIC mp_obj_t mod_os_mkdir(mp_obj_t path_in) {
     int r = mkdir(path, 0777);
     #endif
     RAISE_ERRNO(r, errno);
+    mp_import_cache_invalidate();
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_mkdir_obj, mod_os_mkdir);
 
+STATIC mp_obj_t mod_os_rmdir(mp_obj_t path_in) {
+    const char *path = mp_obj_str_get_str(path_in);
+    int r = rmdir(path);
+    RAISE_ERRNO(r, errno);
+    mp_import_cache_invalidate();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_rmdir_obj, mod_os_rmdir);
+
 typedef struct _mp_obj_listdir_t {
     mp_obj_base_t base;
     mp_fun_1_t iternext;
@@ -220,6 +236,7 @@ STATIC const mp_rom_map_elem_t mp_module_os_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_unlink), MP_ROM_PTR(&mod_os_unlink_obj) },
     { MP_ROM_QSTR(MP_QSTR_getenv), MP_ROM_PTR(&mod_os_getenv_obj) },
     { MP_ROM_QSTR(MP_QSTR_mkdir), MP_ROM_PTR(&mod_os_mkdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rmdir), MP_ROM_PTR(&mod_os_rmdir_obj) },
     { MP_ROM_QSTR(MP_QSTR_ilistdir), MP_ROM_PTR(&mod_os_ilistdir_obj) },
     #if MICROPY_PY_OS_DUPTERM
     { MP_ROM_QSTR(MP_QSTR_dupterm), MP_ROM_PTR(&mp_uos_dupterm_obj) },
@@ -81,6 +81,36 @@ void mp_hal_set_interrupt_char(char c) {
     }
 }
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+#include "py/profile.h"
+
+STATIC void profile_sighandler(int signum) {
+    (void)signum;
+    mp_profile_sample();
+}
+
+void mp_hal_profile_timer(mp_uint_t period_us) {
+    if (period_us != 0) {
+        // the handler is left installed when the timer is stopped, because
+        // the default action of a SIGPROF that is already pending is to exit
+        struct sigaction sa;
+        sa.sa_flags = SA_RESTART;
+        sa.sa_handler = profile_sighandler;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGPROF, &sa, NULL);
+    }
+    // ITIMER_PROF counts CPU time of the process, so time spent blocked, eg
+    // in select() or sleep(), is not sampled
+    struct itimerval it;
+    it.it_interval.tv_sec = period_us / 1000000;
+    it.it_interval.tv_usec = period_us % 1000000;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+
+#endif
+
 #if MICROPY_USE_READLINE == 1
 
 #include <termios.h>
@@ -32,6 +32,7 @@
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/vmstats.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -70,6 +71,57 @@ const byte *mp_decode_uint_skip(const byte *ptr) {
     return ptr;
 }
 
+// Get the block name and source file from the code-info of the given bytecode
+// function, and the source line from its line-number table for the opcode at
+// ip.  This only reads the bytecode, so it may be called from an interrupt.
+void mp_bytecode_get_source(const byte *bytecode, const byte *ip, qstr *block_name, qstr *source_file, size_t *source_line) {
+    const byte *ci = bytecode;
+    ci = mp_decode_uint_skip(ci); // skip n_state
+    ci = mp_decode_uint_skip(ci); // skip n_exc_stack
+    ci++; // skip scope_params
+    ci++; // skip n_pos_args
+    ci++; // skip n_kwonly_args
+    ci++; // skip n_def_pos_args
+    size_t bc = ip - ci;
+    size_t code_info_size = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci); // skip code_info_size
+    bc -= code_info_size;
+    #if MICROPY_PERSISTENT_CODE
+    *block_name = ci[0] | (ci[1] << 8);
+    *source_file = ci[2] | (ci[3] << 8);
+    ci += 4;
+    #else
+    *block_name = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci);
+    *source_file = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci);
+    #endif
+    size_t line = 1;
+    size_t c;
+    while ((c = *ci)) {
+        size_t b, l;
+        if ((c & 0x80) == 0) {
+            // 0b0LLBBBBB encoding
+            b = c & 0x1f;
+            l = c >> 5;
+            ci += 1;
+        } else {
+            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+            b = c & 0xf;
+            l = ((c << 4) & 0x700) | ci[1];
+            ci += 2;
+        }
+        if (bc >= b) {
+            bc -= b;
+            line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    *source_line = line;
+}
+
 STATIC NORETURN void fun_pos_args_mismatch(mp_obj_fun_bc_t *f, size_t expected, size_t given) {
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE
     // generic message, used also for other argument issues
@@ -115,6 +167,13 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
     // ip comes in as an offset into bytecode, so turn it into a true pointer
     code_state->ip = self->bytecode + (size_t)code_state->ip;
 
+    #if MICROPY_PY_MICROPYTHON_VM_STATS
+    // native functions use this too, but only bytecode ones are counted
+    if (self->base.type == &mp_type_fun_bc || self->base.type == &mp_type_gen_wrap) {
+        mp_vm_stats_call(self->bytecode);
+    }
+    #endif
+
     #if MICROPY_STACKLESS
     code_state->prev = NULL;
     #endif
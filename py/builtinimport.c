@@ -31,6 +31,9 @@
 
 #include "py/compile.h"
 #include "py/objmodule.h"
+#include "py/objstr.h"
+#include "py/objtuple.h"
+#include "py/smallint.h"
 #include "py/persistentcode.h"
 #include "py/runtime.h"
 #include "py/builtin.h"
@@ -54,6 +57,110 @@ bool mp_obj_is_package(mp_obj_t module) {
     return dest[0] != MP_OBJ_NULL;
 }
 
+#if MICROPY_MODULE_IMPORT_CACHE
+
+void mp_import_cache_invalidate(void) {
+    MP_STATE_VM(import_cache_stale) = true;
+}
+
+// Entries of the import cache, stored in a tuple keyed by directory path
+enum {
+    IMPORT_CACHE_LISTING, // dict of name -> stat, or None if it couldn't be listed
+    IMPORT_CACHE_STAMP, // mp_import_dir_stamp when listed, 0 if it's never checked
+    IMPORT_CACHE_GEN, // import_cache_gen when the stamp was last checked
+    IMPORT_CACHE_FOLD_CASE, // whether names are stored in lower case
+    IMPORT_CACHE_N,
+};
+
+#define IMPORT_CACHE_UINT_OBJ(x) MP_OBJ_NEW_SMALL_INT((x) & MP_SMALL_INT_POSITIVE_MASK)
+
+STATIC mp_obj_t import_cache_list(mp_obj_t dir) {
+    const char *dir_str = mp_obj_str_get_str(dir);
+    // take the stamp first, so a change made while listing is seen next time
+    mp_uint_t stamp = mp_import_dir_stamp(dir_str);
+    mp_obj_tuple_t *entry = MP_OBJ_TO_PTR(mp_obj_new_tuple(IMPORT_CACHE_N, NULL));
+    bool fold_case = false;
+    entry->items[IMPORT_CACHE_LISTING] = mp_obj_new_dict(0);
+    if (!mp_import_listdir(dir_str, entry->items[IMPORT_CACHE_LISTING], &fold_case)) {
+        entry->items[IMPORT_CACHE_LISTING] = mp_const_none;
+    }
+    entry->items[IMPORT_CACHE_STAMP] = IMPORT_CACHE_UINT_OBJ(stamp);
+    entry->items[IMPORT_CACHE_GEN] = IMPORT_CACHE_UINT_OBJ(MP_STATE_VM(import_cache_gen));
+    entry->items[IMPORT_CACHE_FOLD_CASE] = mp_obj_new_bool(fold_case);
+    mp_obj_dict_store(MP_STATE_VM(import_cache), dir, MP_OBJ_FROM_PTR(entry));
+    DEBUG_printf("import cache: listed '%s'\n", dir_str);
+    return MP_OBJ_FROM_PTR(entry);
+}
+
+// Stat a path by looking its name up in a cached listing of its directory.
+// Each directory is listed once and then only checked for changes (see
+// mp_import_dir_stamp) at most once per import statement; if the port can't
+// list it then None is cached and every stat goes to the port.
+STATIC mp_import_stat_t mp_import_stat_cached(const char *path) {
+    if (MP_STATE_VM(import_cache) == MP_OBJ_NULL || MP_STATE_VM(import_cache_stale)) {
+        MP_STATE_VM(import_cache_stale) = false;
+        MP_STATE_VM(import_cache) = mp_obj_new_dict(0);
+    }
+
+    // split path into directory and name
+    const char *name = strrchr(path, PATH_SEP_CHAR);
+    size_t dir_len = 0;
+    if (name == NULL) {
+        name = path;
+    } else {
+        dir_len = name == path ? 1 : name - path;
+        ++name;
+    }
+
+    // look up the directory listing, using a temporary str to avoid allocating
+    mp_obj_str_t key = {{&mp_type_str}, qstr_compute_hash((const byte*)path, dir_len), dir_len, (const byte*)path};
+    mp_map_t *cache = mp_obj_dict_get_map(MP_STATE_VM(import_cache));
+    mp_map_elem_t *elem = mp_map_lookup(cache, MP_OBJ_FROM_PTR(&key), MP_MAP_LOOKUP);
+    mp_obj_tuple_t *entry;
+    if (elem == NULL) {
+        entry = MP_OBJ_TO_PTR(import_cache_list(mp_obj_new_str(path, dir_len)));
+    } else {
+        entry = MP_OBJ_TO_PTR(elem->value);
+        mp_obj_t gen = IMPORT_CACHE_UINT_OBJ(MP_STATE_VM(import_cache_gen));
+        if (entry->items[IMPORT_CACHE_STAMP] != MP_OBJ_NEW_SMALL_INT(0)
+            && entry->items[IMPORT_CACHE_GEN] != gen) {
+            // the directory may have been changed by another process
+            entry->items[IMPORT_CACHE_GEN] = gen;
+            mp_uint_t stamp = mp_import_dir_stamp(mp_obj_str_get_str(elem->key));
+            if (entry->items[IMPORT_CACHE_STAMP] != IMPORT_CACHE_UINT_OBJ(stamp)) {
+                entry = MP_OBJ_TO_PTR(import_cache_list(elem->key));
+            }
+        }
+    }
+    mp_obj_t listing = entry->items[IMPORT_CACHE_LISTING];
+    if (listing == mp_const_none) {
+        return mp_import_stat(path);
+    }
+
+    size_t name_len = strlen(name);
+    char lower[32];
+    if (entry->items[IMPORT_CACHE_FOLD_CASE] == mp_const_true) {
+        if (name_len > sizeof(lower)) {
+            // too long to fold here, and too rare to be worth allocating
+            return mp_import_stat(path);
+        }
+        for (size_t i = 0; i < name_len; ++i) {
+            lower[i] = unichar_tolower(name[i]);
+        }
+        name = lower;
+    }
+    key.hash = qstr_compute_hash((const byte*)name, name_len);
+    key.len = name_len;
+    key.data = (const byte*)name;
+    elem = mp_map_lookup(mp_obj_dict_get_map(listing), MP_OBJ_FROM_PTR(&key), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        return MP_IMPORT_STAT_NO_EXIST;
+    }
+    return MP_OBJ_SMALL_INT_VALUE(elem->value);
+}
+
+#endif
+
 // Stat either frozen or normal module by a given path
 // (whatever is available, if at all).
 STATIC mp_import_stat_t mp_import_stat_any(const char *path) {
@@ -63,7 +170,11 @@ STATIC mp_import_stat_t mp_import_stat_any(const char *path) {
         return st;
     }
     #endif
+    #if MICROPY_MODULE_IMPORT_CACHE
+    return mp_import_stat_cached(path);
+    #else
     return mp_import_stat(path);
+    #endif
 }
 
 STATIC mp_import_stat_t stat_file_py_or_mpy(vstr_t *path) {
@@ -181,6 +292,129 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code) {
 }
 #endif
 
+#if MICROPY_MODULE_COMPILE_CACHE
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+// The compiled code for a .py file is cached in the cache directory, in a file
+// named after the real path of the source, eg /lib/foo.py in <dir>/%lib%foo.mpy.
+// It is preceded by a key made from the size and mtime of the source and the
+// compiler settings.
+#define COMPILE_CACHE_KEY_LEN (13)
+
+STATIC bool compile_cache_make_key(const char *file_str, byte *key) {
+    struct stat st;
+    if (stat(file_str, &st) != 0) {
+        return false;
+    }
+    uint32_t mtime_ns = 0;
+    #if defined(__linux__)
+    mtime_ns = st.st_mtim.tv_nsec;
+    #elif defined(__APPLE__)
+    mtime_ns = st.st_mtimespec.tv_nsec;
+    #endif
+    for (int i = 0; i < 4; ++i) {
+        key[i] = st.st_size >> (8 * i);
+        key[4 + i] = st.st_mtime >> (8 * i);
+        key[8 + i] = mtime_ns >> (8 * i);
+    }
+    key[12] = MP_STATE_VM(mp_optimise_value);
+    return true;
+}
+
+STATIC bool compile_cache_make_path(vstr_t *path, const char *file_str) {
+    char *real = realpath(file_str, NULL);
+    if (real == NULL) {
+        return false;
+    }
+    vstr_add_str(path, mp_obj_str_get_str(MP_STATE_VM(compile_cache_dir)));
+    vstr_add_byte(path, PATH_SEP_CHAR);
+    for (const char *p = real; *p != '\0'; ++p) {
+        vstr_add_byte(path, *p == PATH_SEP_CHAR ? '%' : *p);
+    }
+    free(real);
+    vstr_cut_tail_bytes(path, 3); // without ".py"
+    vstr_add_str(path, ".mpy");
+    return true;
+}
+
+// Load the cached code if the cache file exists and matches the key.
+STATIC mp_raw_code_t *compile_cache_load(const char *cache_str, const byte *key) {
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED && MICROPY_READER_POSIX
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_raw_code_t *rc = mp_raw_code_load_file_mapped(cache_str, key, COMPILE_CACHE_KEY_LEN);
+        nlr_pop();
+        return rc;
+    } else {
+        // incompatible cache file; it is written anew
+        return NULL;
+    }
+    #else
+    mp_reader_t reader;
+    volatile bool opened = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_reader_new_file(&reader, cache_str);
+        opened = true;
+        for (size_t i = 0; i < COMPILE_CACHE_KEY_LEN; ++i) {
+            if (reader.readbyte(reader.data) != key[i]) {
+                mp_raise_ValueError(NULL); // stale
+            }
+        }
+        opened = false; // mp_raw_code_load closes the reader, even on error
+        mp_raw_code_t *rc = mp_raw_code_load(&reader);
+        nlr_pop();
+        return rc;
+    } else {
+        // missing, stale or incompatible cache file; it is written anew
+        if (opened) {
+            reader.close(reader.data);
+        }
+        return NULL;
+    }
+    #endif
+}
+
+STATIC void do_load_cached(mp_obj_t module_obj, vstr_t *file) {
+    byte key[COMPILE_CACHE_KEY_LEN];
+    vstr_t cache;
+    vstr_init(&cache, 64);
+    if (!compile_cache_make_key(vstr_str(file), key)
+        || !compile_cache_make_path(&cache, vstr_str(file))) {
+        // the lexer reports the error, if any
+        vstr_clear(&cache);
+        do_load_from_lexer(module_obj, mp_lexer_new_from_file(vstr_str(file)));
+        return;
+    }
+    const char *cache_str = vstr_null_terminated_str(&cache);
+
+    mp_raw_code_t *raw_code = compile_cache_load(cache_str, key);
+    if (raw_code != NULL) {
+        MP_STATE_VM(compile_cache_hits) += 1;
+    } else {
+        MP_STATE_VM(compile_cache_misses) += 1;
+        mp_lexer_t *lex = mp_lexer_new_from_file(vstr_str(file));
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        raw_code = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        // the directory listings of the import cache don't need invalidating
+        // because cache files aren't named like modules
+        if (mp_raw_code_save_file_prefixed(raw_code, cache_str, key, COMPILE_CACHE_KEY_LEN)) {
+            MP_STATE_VM(compile_cache_saves) += 1;
+        }
+    }
+    vstr_clear(&cache);
+
+    #if MICROPY_PY___FILE__
+    mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(qstr_from_strn(vstr_str(file), file->len)));
+    #endif
+    do_execute_raw_code(module_obj, raw_code);
+}
+
+#endif
+
 STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     #if MICROPY_MODULE_FROZEN || MICROPY_ENABLE_COMPILER || (MICROPY_PERSISTENT_CODE_LOAD && MICROPY_HAS_FILE_READER)
     char *file_str = vstr_null_terminated_str(file);
@@ -221,7 +455,14 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     }
     #endif
 
-    // If we can compile scripts then load the file and compile and execute it.
+    // If we can compile scripts then load the file and compile and execute it,
+    // going through the cache of compiled code if there is one.
+    #if MICROPY_MODULE_COMPILE_CACHE
+    if (MP_STATE_VM(compile_cache_dir) != mp_const_none) {
+        do_load_cached(module_obj, file);
+        return;
+    }
+    #endif
     #if MICROPY_ENABLE_COMPILER
     {
         mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
@@ -354,6 +595,11 @@ mp_obj_t mp_builtin___import__(size_t n_args, const mp_obj_t *args) {
     }
     DEBUG_printf("Module not yet loaded\n");
 
+    #if MICROPY_MODULE_IMPORT_CACHE
+    // let cached directory listings be checked for changes again
+    MP_STATE_VM(import_cache_gen) += 1;
+    #endif
+
     uint last = 0;
     VSTR_FIXED(path, MICROPY_ALLOC_PATH_MAX)
     module_obj = MP_OBJ_NULL;
@@ -212,7 +212,12 @@ STATIC uint comp_next_label(compiler_t *comp) {
 
 #if MICROPY_EMIT_NATIVE
 STATIC void reserve_labels_for_native(compiler_t *comp, int n) {
-    if (comp->scope_cur->emit_options != MP_EMIT_OPT_BYTECODE) {
+    if (comp->scope_cur->emit_options != MP_EMIT_OPT_BYTECODE
+        #if MICROPY_DYNAMIC_COMPILER
+        // the emitter may be chosen per function, so always reserve
+        || mp_dynamic_compiler.select_emit != NULL
+        #endif
+        ) {
         comp->next_label += n;
     }
 }
@@ -867,6 +872,21 @@ STATIC bool compile_built_in_decorator(compiler_t *comp, int name_len, mp_parse_
     return true;
 }
 
+#if MICROPY_EMIT_NATIVE && MICROPY_DYNAMIC_COMPILER
+// Let the dynamic compiler choose the emitter for a function that has no
+// built-in decorator.  This must be done when the scope is created because
+// the number of labels reserved for the native emitter depends on it.
+STATIC uint compile_select_emit(compiler_t *comp, mp_parse_node_struct_t *pns, uint emit_options) {
+    if (comp->pass == MP_PASS_SCOPE && mp_dynamic_compiler.select_emit != NULL
+        && emit_options != MP_EMIT_OPT_VIPER && emit_options != MP_EMIT_OPT_ASM) {
+        emit_options = mp_dynamic_compiler.select_emit(comp->scope_cur, MP_PARSE_NODE_LEAF_ARG(pns->nodes[0]), emit_options);
+    }
+    return emit_options;
+}
+#else
+#define compile_select_emit(comp, pns, emit_options) (emit_options)
+#endif
+
 STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
     // get the list of decorators
     mp_parse_node_t *nodes;
@@ -912,11 +932,17 @@ STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
     mp_parse_node_struct_t *pns_body = (mp_parse_node_struct_t*)pns->nodes[1];
     qstr body_name = 0;
     if (MP_PARSE_NODE_STRUCT_KIND(pns_body) == PN_funcdef) {
+        if (num_built_in_decorators == 0) {
+            emit_options = compile_select_emit(comp, pns_body, emit_options);
+        }
         body_name = compile_funcdef_helper(comp, pns_body, emit_options);
     #if MICROPY_PY_ASYNC_AWAIT
     } else if (MP_PARSE_NODE_STRUCT_KIND(pns_body) == PN_async_funcdef) {
         assert(MP_PARSE_NODE_IS_STRUCT(pns_body->nodes[0]));
         mp_parse_node_struct_t *pns0 = (mp_parse_node_struct_t*)pns_body->nodes[0];
+        if (num_built_in_decorators == 0) {
+            emit_options = compile_select_emit(comp, pns0, emit_options);
+        }
         body_name = compile_funcdef_helper(comp, pns0, emit_options);
         scope_t *fscope = (scope_t*)pns0->nodes[4];
         fscope->scope_flags |= MP_SCOPE_FLAG_GENERATOR;
@@ -936,7 +962,8 @@ STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
 }
 
 STATIC void compile_funcdef(compiler_t *comp, mp_parse_node_struct_t *pns) {
-    qstr fname = compile_funcdef_helper(comp, pns, comp->scope_cur->emit_options);
+    uint emit_options = compile_select_emit(comp, pns, comp->scope_cur->emit_options);
+    qstr fname = compile_funcdef_helper(comp, pns, emit_options);
     // store function object into function name
     compile_store_id(comp, fname);
 }
@@ -3431,6 +3458,26 @@ STATIC void scope_compute_things(scope_t *scope) {
     }
 }
 
+// Run the passes that generate the code for a scope.  In single-pass mode the
+// bytecode emitter works out the stack size and back-patches forward jumps as
+// it goes, so it only needs the final pass.
+STATIC void compile_scope_code(compiler_t *comp, scope_t *s, bool single_pass) {
+    if (!single_pass) {
+        // need a pass to compute stack size
+        compile_scope(comp, s, MP_PASS_STACK_SIZE);
+
+        // second last pass: compute code size
+        if (comp->compile_error == MP_OBJ_NULL) {
+            compile_scope(comp, s, MP_PASS_CODE_SIZE);
+        }
+    }
+
+    // final pass: emit code
+    if (comp->compile_error == MP_OBJ_NULL) {
+        compile_scope(comp, s, MP_PASS_EMIT);
+    }
+}
+
 #if !MICROPY_PERSISTENT_CODE_SAVE
 STATIC
 #endif
@@ -3488,6 +3535,15 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
     // set max number of labels now that it's calculated
     emit_bc_set_max_num_labels(emit_bc, max_num_labels);
 
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    // count the scopes still to be compiled in each region of the parse tree,
+    // so the nodes of each def and class can be freed once they're done with
+    uint16_t *region_scopes = m_new0(uint16_t, parse_tree->num_regions);
+    for (scope_t *s = comp->scope_head; s != NULL; s = s->next) {
+        region_scopes[mp_parse_tree_find_region(parse_tree, s->pn)] += 1;
+    }
+    #endif
+
     // compile pass 2 and 3
 #if MICROPY_EMIT_NATIVE
     emit_t *emit_native = NULL;
@@ -3543,21 +3599,39 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
                     break;
             }
 
-            // need a pass to compute stack size
-            compile_scope(comp, s, MP_PASS_STACK_SIZE);
+            compile_scope_code(comp, s, MICROPY_COMP_SINGLE_PASS_BC && comp->emit == emit_bc);
 
-            // second last pass: compute code size
-            if (comp->compile_error == MP_OBJ_NULL) {
-                compile_scope(comp, s, MP_PASS_CODE_SIZE);
+            #if MICROPY_EMIT_NATIVE && MICROPY_DYNAMIC_COMPILER
+            // if the native emitter couldn't handle this scope then, if allowed,
+            // throw away the error and compile the scope again as bytecode
+            if (comp->compile_error != MP_OBJ_NULL
+                && s->emit_options == MP_EMIT_OPT_NATIVE_PYTHON
+                && mp_dynamic_compiler.native_fallback
+                && mp_obj_get_type(comp->compile_error) != &mp_type_SyntaxError) {
+                comp->compile_error = MP_OBJ_NULL;
+                comp->compile_error_line = 0;
+                s->emit_options = MP_EMIT_OPT_BYTECODE;
+                comp->emit = emit_bc;
+                comp->emit_method_table = &emit_bc_method_table;
+                compile_scope_code(comp, s, MICROPY_COMP_SINGLE_PASS_BC);
             }
+            #endif
+        }
 
-            // final pass: emit code
-            if (comp->compile_error == MP_OBJ_NULL) {
-                compile_scope(comp, s, MP_PASS_EMIT);
+        #if MICROPY_COMP_FREE_PARSE_TREE
+        if (comp->compile_error == MP_OBJ_NULL) {
+            size_t region = mp_parse_tree_find_region(parse_tree, s->pn);
+            if (--region_scopes[region] == 0 && region != 0) {
+                mp_parse_tree_free_region(parse_tree, region);
             }
         }
+        #endif
     }
 
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    m_del(uint16_t, region_scopes, parse_tree->num_regions);
+    #endif
+
     if (comp->compile_error != MP_OBJ_NULL) {
         // if there is no line number for the error then use the line
         // number for the start of this scope
@@ -70,8 +70,28 @@ struct _emit_t {
     uint16_t ct_cur_raw_code;
     #endif
     mp_uint_t *const_table;
+
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    // the buffers below grow as the code is emitted
+    byte *code_info_buf; // line info, the rest of the code info is only known at the end
+    size_t code_info_alloc;
+    size_t ct_alloc;
+    #if MICROPY_PERSISTENT_CODE
+    mp_uint_t *rc_fixups; // raw code and offset of its const table index, for each raw code
+    size_t rc_fixups_alloc;
+    #endif
+    #endif
 };
 
+#if MICROPY_COMP_SINGLE_PASS_BC
+// In the single emit pass a label that isn't assigned yet holds LABEL_PENDING
+// and the offset of the last jump to it, and each such jump holds the offset
+// of the jump before it (0 for none) until the label is assigned and they are
+// patched.  Jumps are at offset 1 or more because of the prelude.
+#define LABEL_UNASSIGNED ((mp_uint_t)-1)
+#define LABEL_PENDING ((mp_uint_t)1 << (8 * sizeof(mp_uint_t) - 2))
+#endif
+
 emit_t *emit_bc_new(void) {
     emit_t *emit = m_new0(emit_t, 1);
     return emit;
@@ -83,12 +103,30 @@ void emit_bc_set_max_num_labels(emit_t *emit, mp_uint_t max_num_labels) {
 }
 
 void emit_bc_free(emit_t *emit) {
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    m_del(byte, emit->code_info_buf, emit->code_info_alloc);
+    #if MICROPY_PERSISTENT_CODE
+    m_del(mp_uint_t, emit->rc_fixups, emit->rc_fixups_alloc);
+    #endif
+    #endif
     m_del(mp_uint_t, emit->label_offsets, emit->max_num_labels);
     m_del_obj(emit_t, emit);
 }
 
 typedef byte *(*emit_allocator_t)(emit_t *emit, int nbytes);
 
+#if MICROPY_COMP_SINGLE_PASS_BC
+// Make room for n bytes at offset in a buffer that grows by half its size at a time.
+STATIC byte *emit_bc_grow(byte *buf, size_t *alloc, size_t offset, size_t n) {
+    if (offset + n > *alloc) {
+        size_t new_alloc = MAX(offset + n, *alloc + *alloc / 2 + 16);
+        buf = m_renew(byte, buf, *alloc, new_alloc);
+        *alloc = new_alloc;
+    }
+    return buf;
+}
+#endif
+
 STATIC void emit_write_uint(emit_t *emit, emit_allocator_t allocator, mp_uint_t val) {
     // We store each 7 bits in a separate byte, and that's how many bytes needed
     byte buf[BYTES_FOR_INT];
@@ -112,8 +150,14 @@ STATIC byte *emit_get_cur_to_write_code_info(emit_t *emit, int num_bytes_to_writ
         emit->code_info_offset += num_bytes_to_write;
         return emit->dummy_data;
     } else {
+        #if MICROPY_COMP_SINGLE_PASS_BC
+        emit->code_info_buf = emit_bc_grow(emit->code_info_buf, &emit->code_info_alloc,
+            emit->code_info_offset, num_bytes_to_write);
+        byte *c = emit->code_info_buf + emit->code_info_offset;
+        #else
         assert(emit->code_info_offset + num_bytes_to_write <= emit->code_info_size);
         byte *c = emit->code_base + emit->code_info_offset;
+        #endif
         emit->code_info_offset += num_bytes_to_write;
         return c;
     }
@@ -175,8 +219,15 @@ STATIC byte *emit_get_cur_to_write_bytecode(emit_t *emit, int num_bytes_to_write
         emit->bytecode_offset += num_bytes_to_write;
         return emit->dummy_data;
     } else {
+        #if MICROPY_COMP_SINGLE_PASS_BC
+        // the code info is moved in front of the bytecode by end_pass
+        emit->code_base = emit_bc_grow(emit->code_base, &emit->bytecode_size,
+            emit->bytecode_offset, num_bytes_to_write);
+        byte *c = emit->code_base + emit->bytecode_offset;
+        #else
         assert(emit->bytecode_offset + num_bytes_to_write <= emit->bytecode_size);
         byte *c = emit->code_base + emit->code_info_size + emit->bytecode_offset;
+        #endif
         emit->bytecode_offset += num_bytes_to_write;
         return c;
     }
@@ -228,6 +279,12 @@ STATIC void emit_write_bytecode_byte_uint(emit_t *emit, byte b, mp_uint_t val) {
 #if MICROPY_PERSISTENT_CODE
 STATIC void emit_write_bytecode_byte_const(emit_t *emit, byte b, mp_uint_t n, mp_uint_t c) {
     if (emit->pass == MP_PASS_EMIT) {
+        #if MICROPY_COMP_SINGLE_PASS_BC
+        if (n >= emit->ct_alloc) {
+            emit->const_table = m_renew(mp_uint_t, emit->const_table, emit->ct_alloc, n + 4);
+            emit->ct_alloc = n + 4;
+        }
+        #endif
         emit->const_table[n] = c;
     }
     emit_write_bytecode_byte_uint(emit, b, n);
@@ -263,6 +320,22 @@ STATIC void emit_write_bytecode_byte_obj(emit_t *emit, byte b, mp_obj_t obj) {
 }
 
 STATIC void emit_write_bytecode_byte_raw_code(emit_t *emit, byte b, mp_raw_code_t *rc) {
+    #if MICROPY_PERSISTENT_CODE && MICROPY_COMP_SINGLE_PASS_BC
+    if (emit->pass == MP_PASS_EMIT) {
+        // The raw codes go after the objects in the const table but the number
+        // of objects isn't known yet, so write a 2-byte index for end_pass to fill in.
+        size_t i = 2 * emit->ct_cur_raw_code++;
+        if (i + 2 > emit->rc_fixups_alloc) {
+            emit->rc_fixups = m_renew(mp_uint_t, emit->rc_fixups, emit->rc_fixups_alloc, i + 8);
+            emit->rc_fixups_alloc = i + 8;
+        }
+        emit->rc_fixups[i] = (mp_uint_t)(uintptr_t)rc;
+        emit->rc_fixups[i + 1] = emit->bytecode_offset + 1;
+        byte *c = emit_get_cur_to_write_bytecode(emit, 3);
+        c[0] = b;
+        return;
+    }
+    #endif
     #if MICROPY_PERSISTENT_CODE
     emit_write_bytecode_byte_const(emit, b,
         emit->scope->num_pos_args + emit->scope->num_kwonly_args
@@ -278,11 +351,58 @@ STATIC void emit_write_bytecode_byte_raw_code(emit_t *emit, byte b, mp_raw_code_
     #endif
 }
 
+#if MICROPY_COMP_SINGLE_PASS_BC
+// If the label isn't assigned yet then add the jump about to be written to
+// its chain, with *link being what the jump should hold for now.
+STATIC bool emit_bc_forward_label(emit_t *emit, mp_uint_t label, mp_uint_t *link) {
+    mp_uint_t offset = emit->label_offsets[label];
+    if (offset == LABEL_UNASSIGNED) {
+        *link = 0;
+    } else if (offset & LABEL_PENDING) {
+        *link = offset & ~LABEL_PENDING;
+    } else {
+        return false;
+    }
+    assert(emit->bytecode_offset <= 0xffff);
+    emit->label_offsets[label] = LABEL_PENDING | emit->bytecode_offset;
+    return true;
+}
+
+STATIC bool emit_bc_is_unsigned_label_op(byte op) {
+    return (MP_BC_SETUP_WITH <= op && op <= MP_BC_SETUP_FINALLY)
+        || op == MP_BC_FOR_ITER || op == MP_BC_POP_EXCEPT_JUMP;
+}
+
+// Point all the jumps chained to a label at the current offset.
+STATIC void emit_bc_patch_label(emit_t *emit, mp_uint_t label) {
+    mp_uint_t offset = emit->label_offsets[label];
+    if (offset == LABEL_UNASSIGNED) {
+        return;
+    }
+    assert(offset & LABEL_PENDING);
+    offset &= ~LABEL_PENDING;
+    while (offset != 0) {
+        byte *c = emit->code_base + offset;
+        mp_uint_t next = c[1] | c[2] << 8;
+        mp_uint_t rel = emit->bytecode_offset - offset - 3;
+        if (!emit_bc_is_unsigned_label_op(c[0])) {
+            rel += 0x8000;
+        }
+        c[1] = rel;
+        c[2] = rel >> 8;
+        offset = next;
+    }
+}
+#endif
+
 // unsigned labels are relative to ip following this instruction, stored as 16 bits
 STATIC void emit_write_bytecode_byte_unsigned_label(emit_t *emit, byte b1, mp_uint_t label) {
     mp_uint_t bytecode_offset;
     if (emit->pass < MP_PASS_EMIT) {
         bytecode_offset = 0;
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    } else if (emit_bc_forward_label(emit, label, &bytecode_offset)) {
+    #endif
     } else {
         bytecode_offset = emit->label_offsets[label] - emit->bytecode_offset - 3;
     }
@@ -294,9 +414,12 @@ STATIC void emit_write_bytecode_byte_unsigned_label(emit_t *emit, byte b1, mp_ui
 
 // signed labels are relative to ip following this instruction, stored as 16 bits, in excess
 STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint_t label) {
-    int bytecode_offset;
+    mp_uint_t bytecode_offset;
     if (emit->pass < MP_PASS_EMIT) {
         bytecode_offset = 0;
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    } else if (emit_bc_forward_label(emit, label, &bytecode_offset)) {
+    #endif
     } else {
         bytecode_offset = emit->label_offsets[label] - emit->bytecode_offset - 3 + 0x8000;
     }
@@ -306,6 +429,116 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+STATIC mp_uint_t emit_bc_n_state(scope_t *scope) {
+    mp_uint_t n_state = scope->num_locals + scope->stack_size;
+    if (n_state == 0) {
+        // Need at least 1 entry in the state, in the case an exception is
+        // propagated through this function, the exception is returned in
+        // the highest slot in the state (fastn[0], see vm.c).
+        n_state = 1;
+    }
+    #if MICROPY_DEBUG_VM_STACK_OVERFLOW
+    // An extra slot in the stack is needed to detect VM stack overflow
+    n_state += 1;
+    #endif
+    return n_state;
+}
+
+#if MICROPY_COMP_SINGLE_PASS_BC
+STATIC size_t emit_bc_uint_len(mp_uint_t val) {
+    size_t n = 1;
+    while (val >>= 7) {
+        ++n;
+    }
+    return n;
+}
+
+// Write val as a variable uint of exactly len bytes, padding with leading zero groups.
+STATIC byte *emit_bc_put_uint(byte *c, mp_uint_t val, size_t len) {
+    for (size_t i = len; i-- > 0;) {
+        c[i] = (val & 0x7f) | (i == len - 1 ? 0 : 0x80);
+        val >>= 7;
+    }
+    return c + len;
+}
+
+STATIC byte *emit_bc_put_qstr(byte *c, qstr qst) {
+    #if MICROPY_PERSISTENT_CODE
+    c[0] = qst;
+    c[1] = qst >> 8;
+    return c + 2;
+    #else
+    return emit_bc_put_uint(c, qst, emit_bc_uint_len(qst));
+    #endif
+}
+
+// In the single emit pass only the line info is written to code_info_buf, and
+// the bytecode to code_base.  Now that the stack size is known the code info
+// header is made and it and the line info are put in front of the bytecode.
+STATIC void emit_bc_finish_single_pass(emit_t *emit) {
+    scope_t *scope = emit->scope;
+
+    #if MICROPY_PERSISTENT_CODE
+    // append the raw codes to the const table and fill in their indices
+    size_t ct_base = scope->num_pos_args + scope->num_kwonly_args + emit->ct_cur_obj;
+    size_t ct_len = ct_base + emit->ct_cur_raw_code;
+    if (ct_len > emit->ct_alloc) {
+        emit->const_table = m_renew(mp_uint_t, emit->const_table, emit->ct_alloc, ct_len);
+        emit->ct_alloc = ct_len;
+    }
+    for (size_t i = 0; i < emit->ct_cur_raw_code; ++i) {
+        size_t idx = ct_base + i;
+        assert(idx < 0x4000);
+        emit->const_table[idx] = emit->rc_fixups[2 * i];
+        emit_bc_put_uint(emit->code_base + emit->rc_fixups[2 * i + 1], idx, 2);
+    }
+    #endif
+
+    byte head[5 * BYTES_FOR_INT + 4];
+    byte *c = head;
+    mp_uint_t n_state = emit_bc_n_state(scope);
+    c = emit_bc_put_uint(c, n_state, emit_bc_uint_len(n_state));
+    c = emit_bc_put_uint(c, scope->exc_stack_size, emit_bc_uint_len(scope->exc_stack_size));
+    *c++ = scope->scope_flags;
+    *c++ = scope->num_pos_args;
+    *c++ = scope->num_kwonly_args;
+    *c++ = scope->num_def_pos_args;
+    size_t fixed_len = c - head;
+    byte *names = c + BYTES_FOR_INT;
+    byte *names_end = emit_bc_put_qstr(names, scope->simple_name);
+    names_end = emit_bc_put_qstr(names_end, scope->source_file);
+    size_t tail_len = (names_end - names) + emit->code_info_offset;
+
+    // find the size of the field holding the size of the rest of the code info
+    // (counting the field itself and the padding)
+    size_t rest_len = 0;
+    size_t ci_size;
+    do {
+        ++rest_len;
+        ci_size = fixed_len + rest_len + tail_len;
+        #if !MICROPY_PERSISTENT_CODE
+        // so bytecode is aligned
+        ci_size = (size_t)MP_ALIGN(ci_size, sizeof(mp_uint_t));
+        #endif
+    } while (emit_bc_uint_len(ci_size - fixed_len) > rest_len);
+
+    size_t bc_size = emit->bytecode_offset;
+    emit->code_base = m_renew(byte, emit->code_base, emit->bytecode_size, ci_size + bc_size);
+    memmove(emit->code_base + ci_size, emit->code_base, bc_size);
+    c = emit->code_base;
+    memcpy(c, head, fixed_len);
+    c = emit_bc_put_uint(c + fixed_len, ci_size - fixed_len, rest_len);
+    memcpy(c, names, names_end - names);
+    c += names_end - names;
+    memcpy(c, emit->code_info_buf, emit->code_info_offset);
+    c += emit->code_info_offset;
+    memset(c, 0, emit->code_base + ci_size - c);
+
+    emit->code_info_size = ci_size;
+    emit->bytecode_size = bc_size;
+}
+#endif
+
 void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->pass = pass;
     emit->stack_size = 0;
@@ -313,6 +546,12 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->scope = scope;
     emit->last_source_line_offset = 0;
     emit->last_source_line = 1;
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    // labels not yet assigned are recognised by being unset
+    if (pass == MP_PASS_EMIT) {
+        memset(emit->label_offsets, -1, emit->max_num_labels * sizeof(mp_uint_t));
+    }
+    #endif
     #ifndef NDEBUG
     // With debugging enabled labels are checked for unique assignment
     if (pass < MP_PASS_EMIT && emit->label_offsets != NULL) {
@@ -322,22 +561,21 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->bytecode_offset = 0;
     emit->code_info_offset = 0;
 
-    // Write local state size and exception stack size.
-    {
-        mp_uint_t n_state = scope->num_locals + scope->stack_size;
-        if (n_state == 0) {
-            // Need at least 1 entry in the state, in the case an exception is
-            // propagated through this function, the exception is returned in
-            // the highest slot in the state (fastn[0], see vm.c).
-            n_state = 1;
-        }
-        #if MICROPY_DEBUG_VM_STACK_OVERFLOW
-        // An extra slot in the stack is needed to detect VM stack overflow
-        n_state += 1;
-        #endif
-        emit_write_code_info_uint(emit, n_state);
-        emit_write_code_info_uint(emit, scope->exc_stack_size);
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    if (pass == MP_PASS_EMIT) {
+        // the code info header is written by end_pass, and the buffers
+        // for the bytecode and const table grow as needed
+        emit->code_base = NULL;
+        emit->bytecode_size = 0;
+        emit->ct_alloc = scope->num_pos_args + scope->num_kwonly_args;
+        emit->const_table = m_new0(mp_uint_t, emit->ct_alloc);
+        goto write_prelude;
     }
+    #endif
+
+    // Write local state size and exception stack size.
+    emit_write_code_info_uint(emit, emit_bc_n_state(scope));
+    emit_write_code_info_uint(emit, scope->exc_stack_size);
 
     // Write scope flags and number of arguments.
     // TODO check that num args all fit in a byte
@@ -359,6 +597,9 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit_write_code_info_qstr(emit, scope->simple_name);
     emit_write_code_info_qstr(emit, scope->source_file);
 
+    #if MICROPY_COMP_SINGLE_PASS_BC
+write_prelude:
+    #endif
     // bytecode prelude: initialise closed over variables
     for (int i = 0; i < scope->id_info_len; i++) {
         id_info_t *id = &scope->id_info[i];
@@ -415,10 +656,17 @@ void mp_emit_bc_end_pass(emit_t *emit) {
     emit_write_code_info_byte(emit, 0); // end of line number info
 
     #if MICROPY_PERSISTENT_CODE
-    assert(emit->pass <= MP_PASS_STACK_SIZE || (emit->ct_num_obj == emit->ct_cur_obj));
+    assert(emit->pass <= MP_PASS_STACK_SIZE || MICROPY_COMP_SINGLE_PASS_BC
+        || (emit->ct_num_obj == emit->ct_cur_obj));
     emit->ct_num_obj = emit->ct_cur_obj;
     #endif
 
+    #if MICROPY_COMP_SINGLE_PASS_BC
+    if (emit->pass == MP_PASS_EMIT) {
+        emit_bc_finish_single_pass(emit);
+    }
+    #endif
+
     if (emit->pass == MP_PASS_CODE_SIZE) {
         #if !MICROPY_PERSISTENT_CODE
         // so bytecode is aligned
@@ -503,8 +751,13 @@ void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
         emit->label_offsets[l] = emit->bytecode_offset;
     } else {
+        #if MICROPY_COMP_SINGLE_PASS_BC
+        emit_bc_patch_label(emit, l);
+        emit->label_offsets[l] = emit->bytecode_offset;
+        #else
         // ensure label offset has not changed from MP_PASS_CODE_SIZE to MP_PASS_EMIT
         assert(emit->label_offsets[l] == emit->bytecode_offset);
+        #endif
     }
 }
 
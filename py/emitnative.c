@@ -78,7 +78,7 @@
 //  emit->code_state_start:     fun_obj, old_globals [optional]
 //  emit->stack_start:          Python object stack             | emit->n_state
 //                              locals (reversed, L0 at end)    |
-//                              (L0-L2 may be in regs instead)
+//                              (locals may be in regs instead)
 
 // Word index of nlr_buf_t.ret_val
 #define NLR_BUF_IDX_RET_VAL (1)
@@ -129,6 +129,9 @@ typedef enum {
     VTYPE_PTR8 = 0x00 | MP_NATIVE_TYPE_PTR8,
     VTYPE_PTR16 = 0x00 | MP_NATIVE_TYPE_PTR16,
     VTYPE_PTR32 = 0x00 | MP_NATIVE_TYPE_PTR32,
+    #if MICROPY_EMIT_NATIVE_FLOAT
+    VTYPE_FLOAT = 0x00 | MP_NATIVE_TYPE_FLOAT,
+    #endif
 
     VTYPE_PTR_NONE = 0x50 | MP_NATIVE_TYPE_PTR,
 
@@ -146,10 +149,36 @@ STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
         case VTYPE_PTR8: return MP_QSTR_ptr8;
         case VTYPE_PTR16: return MP_QSTR_ptr16;
         case VTYPE_PTR32: return MP_QSTR_ptr32;
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case VTYPE_FLOAT: return MP_QSTR_float;
+        #endif
         case VTYPE_PTR_NONE: default: return MP_QSTR_None;
     }
 }
 
+// Register allocation for locals.  During the first pass (MP_PASS_STACK_SIZE)
+// each access to a local, each label and each jump is given a position, and
+// from these the live range and loop-weighted use count of each local is
+// computed.  Before the next pass a linear scan over the live ranges assigns
+// the REG_LOCAL_x registers, with the most heavily used locals winning when
+// there are not enough registers.  The assignment is then fixed for the
+// remaining passes so that the code size does not change.
+#define REG_LOCAL_NONE (0xff)
+#define LOCAL_POS_MAX (0xfffe)
+
+typedef struct _local_info_t {
+    uint16_t first; // position of first access, or 0 if live on entry
+    uint16_t last; // position of last access
+    uint32_t weight; // number of accesses, weighted by loop depth
+    uint8_t reg; // register holding this local, or REG_LOCAL_NONE
+    bool live_in; // first access is a load, so value comes from function entry
+} local_info_t;
+
+typedef struct _local_event_t {
+    uint16_t pos;
+    uint16_t arg; // local number for accesses, label for jumps
+} local_event_t;
+
 typedef struct _stack_info_t {
     vtype_kind_t vtype;
     stack_info_kind_t kind;
@@ -179,6 +208,18 @@ struct _emit_t {
 
     mp_uint_t local_vtype_alloc;
     vtype_kind_t *local_vtype;
+    local_info_t *local_info;
+
+    // used to compute the register allocation for locals, see local_info_t
+    uint16_t local_pos;
+    uint16_t *label_pos;
+    size_t max_num_labels;
+    size_t access_alloc;
+    size_t access_len;
+    local_event_t *access;
+    size_t jump_alloc;
+    size_t jump_len;
+    local_event_t *jump;
 
     mp_uint_t stack_info_alloc;
     stack_info_t *stack_info;
@@ -212,7 +253,12 @@ struct _emit_t {
     ASM_T *as;
 };
 
-STATIC const uint8_t reg_local_table[REG_LOCAL_NUM] = {REG_LOCAL_1, REG_LOCAL_2, REG_LOCAL_3};
+STATIC const uint8_t reg_local_table[REG_LOCAL_NUM] = {
+    REG_LOCAL_1, REG_LOCAL_2, REG_LOCAL_3,
+    #if REG_LOCAL_NUM > 3
+    REG_LOCAL_4, REG_LOCAL_5,
+    #endif
+};
 
 STATIC void emit_native_global_exc_entry(emit_t *emit);
 STATIC void emit_native_global_exc_exit(emit_t *emit);
@@ -226,6 +272,12 @@ emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, uint *label_slot, mp_uint_t max_nu
     emit->stack_info = m_new(stack_info_t, emit->stack_info_alloc);
     emit->exc_stack_alloc = 8;
     emit->exc_stack = m_new(exc_stack_entry_t, emit->exc_stack_alloc);
+    emit->max_num_labels = max_num_labels;
+    emit->label_pos = m_new(uint16_t, max_num_labels);
+    emit->access_alloc = 16;
+    emit->access = m_new(local_event_t, emit->access_alloc);
+    emit->jump_alloc = 8;
+    emit->jump = m_new(local_event_t, emit->jump_alloc);
     emit->as = m_new0(ASM_T, 1);
     mp_asm_base_init(&emit->as->base, max_num_labels);
     return emit;
@@ -235,6 +287,10 @@ void EXPORT_FUN(free)(emit_t *emit) {
     mp_asm_base_deinit(&emit->as->base, false);
     m_del_obj(ASM_T, emit->as);
     m_del(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc);
+    m_del(local_event_t, emit->jump, emit->jump_alloc);
+    m_del(local_event_t, emit->access, emit->access_alloc);
+    m_del(uint16_t, emit->label_pos, emit->max_num_labels);
+    m_del(local_info_t, emit->local_info, emit->local_vtype_alloc);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
     m_del_obj(emit_t, emit);
@@ -297,11 +353,163 @@ STATIC void emit_native_mov_reg_qstr_obj(emit_t *emit, int reg_dest, qstr qst) {
     #endif
 }
 
-#define emit_native_mov_state_imm_via(emit, local_num, imm, reg_temp) \
-    do { \
-        ASM_MOV_REG_IMM((emit)->as, (reg_temp), (imm)); \
-        emit_native_mov_state_reg((emit), (local_num), (reg_temp)); \
-    } while (false)
+STATIC void emit_native_note_event(emit_t *emit, local_event_t **events, size_t *alloc, size_t *len, mp_uint_t arg) {
+    if (*len >= *alloc) {
+        *events = m_renew(local_event_t, *events, *alloc, *alloc * 2);
+        *alloc *= 2;
+    }
+    (*events)[*len].pos = emit->local_pos;
+    (*events)[*len].arg = arg;
+    *len += 1;
+}
+
+// Record an access to a local, for the register allocator
+STATIC void emit_native_note_local(emit_t *emit, mp_uint_t local_num, bool is_load) {
+    if (emit->pass != MP_PASS_STACK_SIZE || emit->local_pos >= LOCAL_POS_MAX) {
+        return;
+    }
+    local_info_t *li = &emit->local_info[local_num];
+    ++emit->local_pos;
+    if (li->weight == 0) {
+        li->first = emit->local_pos;
+        li->live_in = is_load;
+    }
+    li->last = emit->local_pos;
+    li->weight = 1;
+    emit_native_note_event(emit, &emit->access, &emit->access_alloc, &emit->access_len, local_num);
+}
+
+// Record a label assignment, for the register allocator
+STATIC void emit_native_note_label(emit_t *emit, mp_uint_t label) {
+    if (emit->pass != MP_PASS_STACK_SIZE || emit->local_pos >= LOCAL_POS_MAX) {
+        return;
+    }
+    emit->label_pos[label] = ++emit->local_pos;
+}
+
+// Record a jump, for the register allocator; backward jumps delimit loops
+STATIC void emit_native_note_jump(emit_t *emit, mp_uint_t label) {
+    if (emit->pass != MP_PASS_STACK_SIZE || emit->local_pos >= LOCAL_POS_MAX) {
+        return;
+    }
+    ++emit->local_pos;
+    if (emit->label_pos[label] != 0) {
+        emit_native_note_event(emit, &emit->jump, &emit->jump_alloc, &emit->jump_len, label);
+    }
+}
+
+// Assign registers to locals using the information gathered in the first pass
+STATIC void emit_native_alloc_regs(emit_t *emit) {
+    scope_t *scope = emit->scope;
+    local_info_t *info = emit->local_info;
+
+    if (!CAN_USE_REGS_FOR_LOCALS(emit) || emit->local_pos >= LOCAL_POS_MAX) {
+        return;
+    }
+
+    // Locals that are read before being written get their value on entry
+    for (mp_uint_t i = 0; i < scope->num_locals; ++i) {
+        if (info[i].live_in) {
+            info[i].first = 0;
+        }
+    }
+
+    // A local accessed within a loop must keep its register for the whole
+    // loop; extending one range can make it overlap an outer loop, so repeat
+    // until nothing changes
+    bool changed;
+    do {
+        changed = false;
+        for (size_t j = 0; j < emit->jump_len; ++j) {
+            uint16_t top = emit->label_pos[emit->jump[j].arg];
+            uint16_t bottom = emit->jump[j].pos;
+            for (mp_uint_t i = 0; i < scope->num_locals; ++i) {
+                local_info_t *li = &info[i];
+                if (li->weight != 0 && li->first <= bottom && li->last >= top) {
+                    if (li->first > top) {
+                        li->first = top;
+                        changed = true;
+                    }
+                    if (li->last < bottom) {
+                        li->last = bottom;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    } while (changed);
+
+    // Weight each access by 8 to the power of its loop depth
+    for (size_t a = 0; a < emit->access_len; ++a) {
+        uint16_t pos = emit->access[a].pos;
+        uint depth = 0;
+        for (size_t j = 0; j < emit->jump_len; ++j) {
+            if (emit->label_pos[emit->jump[j].arg] <= pos && pos <= emit->jump[j].pos) {
+                ++depth;
+            }
+        }
+        info[emit->access[a].arg].weight += 1 << (3 * MIN(depth, 6));
+    }
+
+    // Linear scan over the live ranges in order of their start
+    mp_uint_t active[REG_LOCAL_NUM];
+    size_t num_active = 0;
+    for (;;) {
+        // find the next unallocated range with the earliest start
+        mp_uint_t cur = scope->num_locals;
+        for (mp_uint_t i = 0; i < scope->num_locals; ++i) {
+            if (info[i].weight != 0 && info[i].reg == REG_LOCAL_NONE
+                && (cur == scope->num_locals || info[i].first < info[cur].first)) {
+                cur = i;
+            }
+        }
+        if (cur == scope->num_locals) {
+            break;
+        }
+        local_info_t *li = &info[cur];
+
+        // expire ranges that end before this one starts
+        for (size_t k = 0; k < num_active;) {
+            if (info[active[k]].last < li->first) {
+                active[k] = active[--num_active];
+            } else {
+                ++k;
+            }
+        }
+
+        if (num_active < REG_LOCAL_NUM) {
+            // take a free register
+            for (size_t r = 0; r < REG_LOCAL_NUM; ++r) {
+                size_t k = 0;
+                while (k < num_active && info[active[k]].reg != reg_local_table[r]) {
+                    ++k;
+                }
+                if (k == num_active) {
+                    li->reg = reg_local_table[r];
+                    break;
+                }
+            }
+            active[num_active++] = cur;
+        } else {
+            // all registers in use, so the least used of the active ranges
+            // and this one is spilled to the stack for the whole function
+            size_t victim = 0;
+            for (size_t k = 1; k < num_active; ++k) {
+                if (info[active[k]].weight < info[active[victim]].weight) {
+                    victim = k;
+                }
+            }
+            if (info[active[victim]].weight < li->weight) {
+                li->reg = info[active[victim]].reg;
+                info[active[victim]].reg = REG_LOCAL_NONE;
+                info[active[victim]].weight = 0;
+                active[victim] = cur;
+            } else {
+                li->weight = 0;
+            }
+        }
+    }
+}
 
 STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     DEBUG_printf("start_pass(pass=%u, scope=%p)\n", pass, scope);
@@ -317,12 +525,27 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     emit->last_emit_was_return_value = false;
     emit->scope = scope;
 
-    // allocate memory for keeping track of the types of locals
+    // allocate memory for keeping track of the types and registers of locals
     if (emit->local_vtype_alloc < scope->num_locals) {
         emit->local_vtype = m_renew(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc, scope->num_locals);
+        emit->local_info = m_renew(local_info_t, emit->local_info, emit->local_vtype_alloc, scope->num_locals);
         emit->local_vtype_alloc = scope->num_locals;
     }
 
+    // the first pass collects live ranges of locals, the next assigns registers
+    if (pass == MP_PASS_STACK_SIZE) {
+        memset(emit->local_info, 0, scope->num_locals * sizeof(local_info_t));
+        for (mp_uint_t i = 0; i < scope->num_locals; ++i) {
+            emit->local_info[i].reg = REG_LOCAL_NONE;
+        }
+        memset(emit->label_pos, 0, emit->max_num_labels * sizeof(uint16_t));
+        emit->local_pos = 0;
+        emit->access_len = 0;
+        emit->jump_len = 0;
+    } else if (pass == MP_PASS_CODE_SIZE) {
+        emit_native_alloc_regs(emit);
+    }
+
     // set default type for arguments
     mp_uint_t num_args = emit->scope->num_pos_args + emit->scope->num_kwonly_args;
     if (scope->scope_flags & MP_SCOPE_FLAG_VARARGS) {
@@ -371,17 +594,6 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         // Work out size of state (locals plus stack)
         // n_state counts all stack and locals, even those in registers
         emit->n_state = scope->num_locals + scope->stack_size;
-        int num_locals_in_regs = 0;
-        if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            num_locals_in_regs = scope->num_locals;
-            if (num_locals_in_regs > REG_LOCAL_NUM) {
-                num_locals_in_regs = REG_LOCAL_NUM;
-            }
-            // Need a spot for REG_LOCAL_3 if 4 or more args (see below)
-            if (scope->num_pos_args >= 4) {
-                --num_locals_in_regs;
-            }
-        }
 
         // Work out where the locals and Python stack start within the C stack
         if (NEED_GLOBAL_EXC_HANDLER(emit)) {
@@ -395,7 +607,7 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         }
 
         // Entry to function
-        ASM_ENTRY(emit->as, emit->stack_start + emit->n_state - num_locals_in_regs);
+        ASM_ENTRY(emit->as, emit->stack_start + emit->n_state);
 
         #if N_X86
         asm_x86_mov_arg_to_r32(emit->as, 0, REG_ARG_1);
@@ -431,6 +643,7 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         mp_asm_base_label_assign(&emit->as->base, *emit->label_slot + 5);
 
         // Store arguments into locals (reg or stack), converting to native if needed
+        int arg_in_local_3 = -1;
         for (int i = 0; i < emit->scope->num_pos_args; i++) {
             int r = REG_ARG_1;
             ASM_LOAD_REG_REG_OFFSET(emit->as, REG_ARG_1, REG_LOCAL_3, i);
@@ -439,15 +652,19 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
                 r = REG_RET;
             }
             // REG_LOCAL_3 points to the args array so be sure not to overwrite it if it's still needed
-            if (i < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit) && (i != 2 || emit->scope->num_pos_args == 3)) {
-                ASM_MOV_REG_REG(emit->as, reg_local_table[i], r);
+            int reg_local = emit->local_info[i].reg;
+            if (reg_local != REG_LOCAL_NONE && (reg_local != REG_LOCAL_3 || i == emit->scope->num_pos_args - 1)) {
+                ASM_MOV_REG_REG(emit->as, reg_local, r);
             } else {
                 emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, i), r);
+                if (reg_local == REG_LOCAL_3) {
+                    arg_in_local_3 = i;
+                }
             }
         }
-        // Get 3rd local from the stack back into REG_LOCAL_3 if this reg couldn't be written to above
-        if (emit->scope->num_pos_args >= 4 && CAN_USE_REGS_FOR_LOCALS(emit)) {
-            ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, 2));
+        // Get the local from the stack back into REG_LOCAL_3 if this reg couldn't be written to above
+        if (arg_in_local_3 >= 0) {
+            ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, arg_in_local_3));
         }
 
         emit_native_global_exc_entry(emit);
@@ -504,8 +721,10 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
             ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_FUN_OBJ(emit), REG_ARG_1);
 
             // Set code_state.ip (offset from start of this function to prelude info)
-            // TODO this encoding may change size in the final pass, need to make it fixed
-            emit_native_mov_state_imm_via(emit, emit->code_state_start + offsetof(mp_code_state_t, ip) / sizeof(uintptr_t), emit->prelude_offset, REG_ARG_1);
+            // This uses a fixed-size encoding because the offset can change between
+            // passes once registers have been assigned to locals
+            ASM_MOV_REG_IMM_FIX_WORD(emit->as, REG_ARG_1, emit->prelude_offset);
+            emit_native_mov_state_reg(emit, emit->code_state_start + offsetof(mp_code_state_t, ip) / sizeof(uintptr_t), REG_ARG_1);
 
             // Put address of code_state into first arg
             ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, emit->code_state_start);
@@ -522,10 +741,11 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
         emit_native_global_exc_entry(emit);
 
-        // cache some locals in registers, but only if no exception handlers
-        if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            for (int i = 0; i < REG_LOCAL_NUM && i < scope->num_locals; ++i) {
-                ASM_MOV_REG_LOCAL(emit->as, reg_local_table[i], LOCAL_IDX_LOCAL_VAR(emit, i));
+        // load locals that live in registers and are needed on entry (arguments
+        // and cells); this is only done if there are no exception handlers
+        for (mp_uint_t i = 0; i < scope->num_locals; ++i) {
+            if (emit->local_info[i].reg != REG_LOCAL_NONE && emit->local_info[i].live_in) {
+                ASM_MOV_REG_LOCAL(emit->as, emit->local_info[i].reg, LOCAL_IDX_LOCAL_VAR(emit, i));
             }
         }
 
@@ -1066,6 +1286,7 @@ STATIC void emit_native_label_assign(emit_t *emit, mp_uint_t l) {
     }
 
     emit_native_pre(emit);
+    emit_native_note_label(emit, l);
     // need to commit stack because we can jump here from elsewhere
     need_stack_settled(emit);
     mp_asm_base_label_assign(&emit->as->base, l);
@@ -1316,8 +1537,9 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
         EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "local '%q' used before type known", qst);
     }
     emit_native_pre(emit);
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_post_push_reg(emit, vtype, reg_local_table[local_num]);
+    emit_native_note_local(emit, local_num, true);
+    if (emit->local_info[local_num].reg != REG_LOCAL_NONE) {
+        emit_post_push_reg(emit, vtype, emit->local_info[local_num].reg);
     } else {
         need_reg_single(emit, REG_TEMP0, 0);
         emit_native_mov_reg_state(emit, REG_TEMP0, LOCAL_IDX_LOCAL_VAR(emit, local_num));
@@ -1425,6 +1647,9 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
         // TODO The different machine architectures have very different
         // capabilities and requirements for loads, so probably best to
         // write a completely separate load-optimiser for each one.
+        // The result goes in REG_RET, which may hold a value lower down the
+        // stack if the operands came straight from locals in registers.
+        need_reg_single(emit, REG_RET, 0);
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_INT && top->kind == STACK_IMM) {
             // index is an immediate
@@ -1432,6 +1657,7 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
             emit_pre_pop_discard(emit); // discard index
             int reg_base = REG_ARG_1;
             int reg_index = REG_ARG_2;
+            need_reg_single(emit, reg_index, 0);
             emit_pre_pop_reg_flexible(emit, &vtype_base, &reg_base, reg_index, reg_index);
             switch (vtype_base) {
                 case VTYPE_PTR8: {
@@ -1535,8 +1761,9 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
 
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     vtype_kind_t vtype;
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_pre_pop_reg(emit, &vtype, reg_local_table[local_num]);
+    emit_native_note_local(emit, local_num, false);
+    if (emit->local_info[local_num].reg != REG_LOCAL_NONE) {
+        emit_pre_pop_reg(emit, &vtype, emit->local_info[local_num].reg);
     } else {
         emit_pre_pop_reg(emit, &vtype, REG_TEMP0);
         emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, local_num), REG_TEMP0);
@@ -1642,6 +1869,7 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
             int reg_base = REG_ARG_1;
             int reg_index = REG_ARG_2;
             int reg_value = REG_ARG_3;
+            need_reg_single(emit, reg_index, 0);
             emit_pre_pop_reg_flexible(emit, &vtype_base, &reg_base, reg_index, reg_value);
             #if N_X86
             // special case: x86 needs byte stores to be from lower 4 regs (REG_ARG_3 is EDX)
@@ -1879,6 +2107,7 @@ STATIC void emit_native_rot_three(emit_t *emit) {
 STATIC void emit_native_jump(emit_t *emit, mp_uint_t label) {
     DEBUG_printf("jump(label=" UINT_FMT ")\n", label);
     emit_native_pre(emit);
+    emit_native_note_jump(emit, label);
     // need to commit stack because we are jumping elsewhere
     need_stack_settled(emit);
     ASM_JUMP(emit->as, label);
@@ -1910,6 +2139,7 @@ STATIC void emit_native_jump_helper(emit_t *emit, bool cond, mp_uint_t label, bo
     }
     // need to commit stack because we may jump elsewhere
     need_stack_settled(emit);
+    emit_native_note_jump(emit, label);
     // Emit the jump
     if (cond) {
         ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label, vtype == VTYPE_PYOBJ);
@@ -2177,6 +2407,17 @@ STATIC void emit_native_unary_op(emit_t *emit, mp_unary_op_t op) {
     if (vtype == VTYPE_PYOBJ) {
         emit_call_with_imm_arg(emit, MP_F_UNARY_OP, op, REG_ARG_1);
         emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
+    #if MICROPY_EMIT_NATIVE_FLOAT
+    } else if (vtype == VTYPE_FLOAT && (op == MP_UNARY_OP_POSITIVE || op == MP_UNARY_OP_NEGATIVE)) {
+        if (op == MP_UNARY_OP_NEGATIVE) {
+            // flip the sign bit, the top bit of the target's word
+            mp_uint_t sign_bit = (mp_uint_t)1 << (8 * ASM_WORD_SIZE - 1);
+            need_reg_single(emit, REG_ARG_3, 0);
+            ASM_MOV_REG_IMM(emit->as, REG_ARG_3, sign_bit);
+            ASM_XOR_REG_REG(emit->as, REG_ARG_2, REG_ARG_3);
+        }
+        emit_post_push_reg(emit, VTYPE_FLOAT, REG_ARG_2);
+    #endif
     } else {
         adjust_stack(emit, 1);
         EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
@@ -2184,6 +2425,19 @@ STATIC void emit_native_unary_op(emit_t *emit, mp_unary_op_t op) {
     }
 }
 
+#if MICROPY_EMIT_NATIVE_FLOAT
+// convert the object at stack position pos (1 is TOS) to an unboxed float
+STATIC void emit_native_unbox_float(emit_t *emit, int pos) {
+    vtype_kind_t vtype;
+    emit_access_stack(emit, pos, &vtype, REG_ARG_1);
+    emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, VTYPE_FLOAT, REG_ARG_2);
+    stack_info_t *si = peek_stack(emit, pos - 1);
+    si->vtype = VTYPE_FLOAT;
+    si->kind = STACK_REG;
+    si->data.u_reg = REG_RET;
+}
+#endif
+
 STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
     DEBUG_printf("binary_op(" UINT_FMT ")\n", op);
     vtype_kind_t vtype_lhs = peek_vtype(emit, 1);
@@ -2337,6 +2591,27 @@ STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
             EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                 "binary op %q not implemented", mp_binary_op_method_name[op]);
         }
+    #if MICROPY_EMIT_NATIVE_FLOAT
+    } else if ((vtype_lhs == VTYPE_FLOAT || vtype_rhs == VTYPE_FLOAT)
+        && (vtype_lhs == VTYPE_FLOAT || vtype_lhs == VTYPE_PYOBJ)
+        && (vtype_rhs == VTYPE_FLOAT || vtype_rhs == VTYPE_PYOBJ)
+        && (op <= MP_BINARY_OP_NOT_EQUAL
+            || (MP_BINARY_OP_INPLACE_OR <= op && op <= MP_BINARY_OP_POWER))) {
+        // an object operand, eg a float constant, is unboxed first
+        if (vtype_rhs == VTYPE_PYOBJ) {
+            emit_native_unbox_float(emit, 1);
+        }
+        if (vtype_lhs == VTYPE_PYOBJ) {
+            emit_native_unbox_float(emit, 2);
+        }
+        emit_pre_pop_reg_reg(emit, &vtype_rhs, REG_ARG_3, &vtype_lhs, REG_ARG_2);
+        emit_call_with_imm_arg(emit, MP_F_NATIVE_FLOAT_BINARY_OP, op, REG_ARG_1);
+        if (op <= MP_BINARY_OP_NOT_EQUAL) {
+            emit_post_push_reg(emit, VTYPE_BOOL, REG_RET);
+        } else {
+            emit_post_push_reg(emit, VTYPE_FLOAT, REG_RET);
+        }
+    #endif
     } else if (vtype_lhs == VTYPE_PYOBJ && vtype_rhs == VTYPE_PYOBJ) {
         emit_pre_pop_reg_reg(emit, &vtype_rhs, REG_ARG_3, &vtype_lhs, REG_ARG_2);
         bool invert = false;
@@ -2521,6 +2796,9 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
                 emit_post_push_reg(emit, vtype_cast, REG_RET);
                 break;
             }
+            #if MICROPY_EMIT_NATIVE_FLOAT
+            case VTYPE_FLOAT:
+            #endif
             case VTYPE_BOOL:
             case VTYPE_INT:
             case VTYPE_UINT:
@@ -2529,6 +2807,19 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
             case VTYPE_PTR16:
             case VTYPE_PTR32:
             case VTYPE_PTR_NONE:
+                #if MICROPY_EMIT_NATIVE_FLOAT
+                if ((peek_vtype(emit, 0) == VTYPE_FLOAT) != (vtype_cast == VTYPE_FLOAT)) {
+                    // floats are represented differently so convert via an object
+                    vtype_kind_t vtype;
+                    emit_pre_pop_reg(emit, &vtype, REG_ARG_1);
+                    emit_pre_pop_discard(emit);
+                    emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, vtype, REG_ARG_2);
+                    ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_RET);
+                    emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, vtype_cast, REG_ARG_2);
+                    emit_post_push_reg(emit, vtype_cast, REG_RET);
+                    break;
+                }
+                #endif
                 emit_fold_stack_top(emit, REG_ARG_1);
                 emit_post_top_set_vtype(emit, vtype_cast);
                 break;
@@ -2595,6 +2886,14 @@ STATIC void emit_native_return_value(emit_t *emit) {
             }
         } else {
             vtype_kind_t vtype;
+            #if MICROPY_EMIT_NATIVE_FLOAT
+            if (return_vtype == VTYPE_PYOBJ && peek_vtype(emit, 0) == VTYPE_FLOAT) {
+                // float(x) used to give an object, so keep returning one
+                emit_pre_pop_reg(emit, &vtype, REG_ARG_1);
+                emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, VTYPE_FLOAT, REG_ARG_2);
+                vtype = VTYPE_PYOBJ;
+            } else
+            #endif
             emit_pre_pop_reg(emit, &vtype, return_vtype == VTYPE_PYOBJ ? REG_RET : REG_ARG_1);
             if (vtype != return_vtype) {
                 EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
@@ -2619,8 +2918,15 @@ STATIC void emit_native_return_value(emit_t *emit) {
 }
 
 STATIC void emit_native_raise_varargs(emit_t *emit, mp_uint_t n_args) {
-    (void)n_args;
-    assert(n_args == 1);
+    if (n_args != 1) {
+        // bare "raise" and "raise ... from ..." are not supported; report it
+        // as a compile error so the compiler can fall back to bytecode
+        if (*emit->error_slot == MP_OBJ_NULL) {
+            *emit->error_slot = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "native raise");
+        }
+        emit_native_adjust_stack_size(emit, -(mp_int_t)n_args);
+        return;
+    }
     vtype_kind_t vtype_exc;
     emit_pre_pop_reg(emit, &vtype_exc, REG_ARG_1); // arg1 = object to raise
     if (vtype_exc != VTYPE_PYOBJ) {
@@ -31,6 +31,7 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/heaptrace.h"
 
 #if MICROPY_ENABLE_GC
 
@@ -161,6 +162,12 @@ void gc_init(void *start, void *end) {
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    // not tracing
+    MP_STATE_MEM(heap_trace_countdown) = MP_SSIZE_MAX;
+    MP_STATE_MEM(heap_trace_pending) = NULL;
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
@@ -554,6 +561,13 @@ found:
     gc_dump_alloc_table();
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    MP_STATE_MEM(heap_trace_countdown) -= n_bytes;
+    if (MP_STATE_MEM(heap_trace_countdown) <= 0 || MP_STATE_MEM(heap_trace_pending) != NULL) {
+        mp_heap_trace_alloc(ret_ptr, n_bytes);
+    }
+    #endif
+
     return ret_ptr;
 }
 
@@ -794,6 +808,24 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 }
 #endif // Alternative gc_realloc impl
 
+#if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+// Call f with the address and size of each allocated block in the heap.  If f
+// allocates then the new blocks may or may not be visited.
+void gc_foreach_block(void (*f)(void *arg, void *ptr, size_t n_bytes), void *arg) {
+    size_t n_blocks = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    for (size_t bl = 0; bl < n_blocks; bl++) {
+        if (ATB_GET_KIND(bl) == AT_HEAD) {
+            size_t n = 1;
+            while (bl + n < n_blocks && ATB_GET_KIND(bl + n) == AT_TAIL) {
+                n++;
+            }
+            f(arg, (void*)PTR_FROM_BLOCK(bl), n * BYTES_PER_BLOCK);
+            bl += n - 1;
+        }
+    }
+}
+#endif
+
 void gc_dump_info(void) {
     gc_info_t info;
     gc_info(&info);
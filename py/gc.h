@@ -71,4 +71,8 @@ void gc_info(gc_info_t *info);
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
+#if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+void gc_foreach_block(void (*f)(void *arg, void *ptr, size_t n_bytes), void *arg);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_GC_H
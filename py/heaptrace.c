@@ -0,0 +1,302 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/objlist.h"
+#include "py/objmodule.h"
+#include "py/builtin.h"
+#include "py/gc.h"
+#include "py/profile.h"
+#include "py/heaptrace.h"
+
+#if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+
+#if !MICROPY_ENABLE_GC || !MICROPY_PY_MICROPYTHON_PROFILE
+#error MICROPY_PY_MICROPYTHON_HEAP_TRACE requires MICROPY_ENABLE_GC and MICROPY_PY_MICROPYTHON_PROFILE
+#endif
+
+typedef struct _mp_heap_trace_sample_t {
+    const void *type; // first word of the block, which is its type if it's an object
+    size_t n_bytes;
+    qstr block_name; // MP_QSTR_NULL if no bytecode was running
+    qstr source_file;
+    size_t line;
+} mp_heap_trace_sample_t;
+
+void mp_heap_trace_start(size_t interval, size_t ring_len) {
+    mp_heap_trace_stop();
+    // drop the old ring first so that a failed allocation leaves no samples
+    MP_STATE_VM(heap_trace_count) = 0;
+    MP_STATE_VM(heap_trace_ring_len) = 0;
+    MP_STATE_VM(heap_trace_ring) = NULL;
+    MP_STATE_VM(heap_trace_ring) = m_new(mp_heap_trace_sample_t, ring_len);
+    MP_STATE_VM(heap_trace_ring_len) = ring_len;
+    MP_STATE_VM(heap_trace_interval) = interval;
+    MP_STATE_VM(heap_trace_active) = true;
+    MP_STATE_MEM(heap_trace_countdown) = interval;
+}
+
+
+// The caller of gc_alloc for the last sample has had the chance to set the
+// type of its object by now, so record it.  If ptr is the same block then
+// that object was freed already and its type is lost.
+STATIC void heap_trace_resolve_pending(void *ptr) {
+    void *pending = MP_STATE_MEM(heap_trace_pending);
+    if (pending != NULL) {
+        size_t i = (MP_STATE_VM(heap_trace_count) - 1) % MP_STATE_VM(heap_trace_ring_len);
+        MP_STATE_VM(heap_trace_ring)[i].type = pending == ptr ? NULL : *(void**)pending;
+        MP_STATE_MEM(heap_trace_pending) = NULL;
+    }
+}
+
+void mp_heap_trace_stop(void) {
+    heap_trace_resolve_pending(NULL);
+    MP_STATE_VM(heap_trace_active) = false;
+    MP_STATE_MEM(heap_trace_countdown) = MP_SSIZE_MAX;
+}
+
+void mp_heap_trace_alloc(void *ptr, size_t n_bytes) {
+    heap_trace_resolve_pending(ptr);
+    if (MP_STATE_MEM(heap_trace_countdown) > 0) {
+        return;
+    }
+    if (!MP_STATE_VM(heap_trace_active)) {
+        MP_STATE_MEM(heap_trace_countdown) = MP_SSIZE_MAX;
+        return;
+    }
+    MP_STATE_MEM(heap_trace_countdown) = MP_STATE_VM(heap_trace_interval);
+
+    size_t count = MP_STATE_VM(heap_trace_count);
+    mp_heap_trace_sample_t *s = &MP_STATE_VM(heap_trace_ring)[count % MP_STATE_VM(heap_trace_ring_len)];
+    s->type = NULL;
+    s->n_bytes = n_bytes;
+    volatile mp_profile_frame_t *f = MP_STATE_THREAD(profile_frame);
+    if (f == NULL) {
+        s->block_name = MP_QSTR_NULL;
+    } else {
+        mp_code_state_t *code_state = f->code_state;
+        mp_bytecode_get_source(code_state->fun_bc->bytecode, code_state->ip,
+            &s->block_name, &s->source_file, &s->line);
+    }
+    MP_STATE_VM(heap_trace_count) = count + 1;
+    MP_STATE_MEM(heap_trace_pending) = ptr;
+}
+
+// The first word of a block is compared against the addresses of all the
+// types that can be found, without following it unless it points into the
+// heap, because the block may hold raw data rather than an object.  The
+// types are kept in a map keyed on their address, as a small int.
+
+STATIC mp_obj_t heap_trace_type_key(const void *type) {
+    return MP_OBJ_NEW_SMALL_INT((uintptr_t)type >> 2);
+}
+
+STATIC void heap_trace_add_type(mp_map_t *types, const mp_obj_type_t *type) {
+    mp_map_lookup(types, heap_trace_type_key(type), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = MP_OBJ_FROM_PTR(type);
+}
+
+STATIC void heap_trace_add_types(mp_map_t *types, const mp_map_t *map) {
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i) && MP_OBJ_IS_TYPE(map->table[i].value, &mp_type_type)) {
+            heap_trace_add_type(types, MP_OBJ_TO_PTR(map->table[i].value));
+        }
+    }
+}
+
+STATIC void heap_trace_add_module_types(mp_map_t *types, const mp_map_t *modules) {
+    for (size_t i = 0; i < modules->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(modules, i) && MP_OBJ_IS_TYPE(modules->table[i].value, &mp_type_module)) {
+            mp_obj_module_t *module = MP_OBJ_TO_PTR(modules->table[i].value);
+            heap_trace_add_types(types, &module->globals->map);
+        }
+    }
+}
+
+STATIC void heap_trace_find_types(mp_map_t *types) {
+    mp_map_init(types, 0);
+    // types of objects made internally, which are not in any module
+    heap_trace_add_type(types, &mp_type_fun_bc);
+    heap_trace_add_type(types, &mp_type_gen_wrap);
+    heap_trace_add_type(types, &mp_type_gen_instance);
+    heap_trace_add_type(types, &mp_type_module);
+    heap_trace_add_types(types, &mp_module_builtins.globals->map);
+    heap_trace_add_module_types(types, &mp_builtin_module_map);
+    heap_trace_add_module_types(types, &MP_STATE_VM(mp_loaded_modules_dict).map);
+}
+
+// Return the name of the type whose address is the first word of a block, or
+// MP_QSTR_NULL if the block doesn't hold an object of a known type
+STATIC qstr heap_trace_type_name(mp_map_t *types, const void *type) {
+    if ((uintptr_t)type % sizeof(void*) != 0) {
+        return MP_QSTR_NULL;
+    }
+    if ((const byte*)type >= MP_STATE_MEM(gc_pool_start)
+        && (const byte*)type < MP_STATE_MEM(gc_pool_end)) {
+        // a class defined in Python is itself an object on the heap
+        if (*(const void* const*)type == &mp_type_type) {
+            return ((const mp_obj_type_t*)type)->name;
+        }
+        return MP_QSTR_NULL;
+    }
+    mp_map_elem_t *elem = mp_map_lookup(types, heap_trace_type_key(type), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        return MP_QSTR_NULL;
+    }
+    return ((mp_obj_type_t*)MP_OBJ_TO_PTR(elem->value))->name;
+}
+
+STATIC void heap_trace_print_type(const mp_print_t *print, qstr name) {
+    if (name == MP_QSTR_NULL) {
+        mp_print_str(print, "?");
+    } else {
+        mp_printf(print, "%q", name);
+    }
+}
+
+// Add n_bytes to the group with the given key in the maps of counts and sizes
+STATIC void heap_trace_count(mp_map_t *counts, mp_map_t *sizes, mp_obj_t key, size_t n_bytes) {
+    mp_map_elem_t *elem = mp_map_lookup(counts, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    elem->value = MP_OBJ_NEW_SMALL_INT(elem->value == MP_OBJ_NULL ? 1 : MP_OBJ_SMALL_INT_VALUE(elem->value) + 1);
+    elem = mp_map_lookup(sizes, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    n_bytes += elem->value == MP_OBJ_NULL ? 0 : mp_obj_get_int_truncated(elem->value);
+    elem->value = mp_obj_new_int_from_uint(n_bytes);
+}
+
+// Print "<key> <count> <bytes>" for each group, sorted by key so that the
+// output is stable and can be diffed
+STATIC void heap_trace_print_groups(const mp_print_t *print, mp_map_t *counts, mp_map_t *sizes) {
+    mp_obj_t keys = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < counts->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(counts, i)) {
+            mp_obj_list_append(keys, counts->table[i].key);
+        }
+    }
+    mp_obj_list_sort(1, &keys, (mp_map_t*)&mp_const_empty_map);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(keys, &len, &items);
+    for (size_t i = 0; i < len; ++i) {
+        mp_printf(print, "%s %d " UINT_FMT "\n", mp_obj_str_get_str(items[i]),
+            (int)MP_OBJ_SMALL_INT_VALUE(mp_map_lookup(counts, items[i], MP_MAP_LOOKUP)->value),
+            (mp_uint_t)mp_obj_get_int_truncated(mp_map_lookup(sizes, items[i], MP_MAP_LOOKUP)->value));
+    }
+}
+
+STATIC void heap_trace_dump_samples(const mp_print_t *print) {
+    size_t n_samples = MP_STATE_VM(heap_trace_count);
+    if (n_samples > MP_STATE_VM(heap_trace_ring_len)) {
+        n_samples = MP_STATE_VM(heap_trace_ring_len);
+    }
+    mp_map_t types, counts, sizes;
+    heap_trace_find_types(&types);
+    mp_map_init(&counts, 0);
+    mp_map_init(&sizes, 0);
+    vstr_t vstr;
+    mp_print_t vstr_print;
+    vstr_init_print(&vstr, 64, &vstr_print);
+    for (size_t i = 0; i < n_samples; ++i) {
+        const mp_heap_trace_sample_t *s = &MP_STATE_VM(heap_trace_ring)[i];
+        vstr_reset(&vstr);
+        if (s->block_name == MP_QSTR_NULL) {
+            vstr_add_str(&vstr, "? (?:0) ");
+        } else {
+            mp_printf(&vstr_print, "%q (%q:%u) ", s->block_name, s->source_file, (uint)s->line);
+        }
+        heap_trace_print_type(&vstr_print, heap_trace_type_name(&types, s->type));
+        heap_trace_count(&counts, &sizes, mp_obj_new_str(vstr.buf, vstr.len), s->n_bytes);
+    }
+    vstr_clear(&vstr);
+    heap_trace_print_groups(print, &counts, &sizes);
+}
+
+void mp_heap_trace_dump(const mp_print_t *print) {
+    // pause sampling so the ring doesn't change under us
+    heap_trace_resolve_pending(NULL);
+    mp_int_t countdown = MP_STATE_MEM(heap_trace_countdown);
+    MP_STATE_MEM(heap_trace_countdown) = MP_SSIZE_MAX;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        heap_trace_dump_samples(print);
+        nlr_pop();
+        MP_STATE_MEM(heap_trace_countdown) = countdown;
+    } else {
+        MP_STATE_MEM(heap_trace_countdown) = countdown;
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+typedef struct _heap_snapshot_t {
+    mp_map_t types;
+    mp_map_t counts;
+    mp_map_t sizes;
+} heap_snapshot_t;
+
+STATIC void heap_snapshot_block(void *arg, void *ptr, size_t n_bytes) {
+    heap_snapshot_t *snap = arg;
+    size_t size_class = 0;
+    while (((size_t)1 << size_class) < n_bytes) {
+        ++size_class;
+    }
+    // the groups are keyed on small ints while walking the heap, so that
+    // walking doesn't allocate a new block for each one it visits
+    qstr name = heap_trace_type_name(&snap->types, *(void**)ptr);
+    heap_trace_count(&snap->counts, &snap->sizes, MP_OBJ_NEW_SMALL_INT(name << 6 | size_class), n_bytes);
+}
+
+void mp_heap_snapshot(const mp_print_t *print) {
+    gc_collect();
+    heap_snapshot_t snap;
+    heap_trace_find_types(&snap.types);
+    mp_map_init(&snap.counts, 0);
+    mp_map_init(&snap.sizes, 0);
+    gc_foreach_block(heap_snapshot_block, &snap);
+
+    // give each group its name now that the walk is done
+    mp_map_t counts, sizes;
+    mp_map_init(&counts, snap.counts.used);
+    mp_map_init(&sizes, snap.counts.used);
+    vstr_t vstr;
+    mp_print_t vstr_print;
+    vstr_init_print(&vstr, 32, &vstr_print);
+    for (size_t i = 0; i < snap.counts.alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(&snap.counts, i)) {
+            mp_obj_t key = snap.counts.table[i].key;
+            mp_int_t group = MP_OBJ_SMALL_INT_VALUE(key);
+            vstr_reset(&vstr);
+            heap_trace_print_type(&vstr_print, group >> 6);
+            mp_printf(&vstr_print, " %u", (uint)((size_t)1 << (group & 63)));
+            mp_obj_t name = mp_obj_new_str(vstr.buf, vstr.len);
+            mp_map_lookup(&counts, name, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = snap.counts.table[i].value;
+            mp_map_lookup(&sizes, name, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = mp_map_lookup(&snap.sizes, key, MP_MAP_LOOKUP)->value;
+        }
+    }
+    vstr_clear(&vstr);
+    heap_trace_print_groups(print, &counts, &sizes);
+}
+
+#endif // MICROPY_PY_MICROPYTHON_HEAP_TRACE
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_HEAPTRACE_H
+#define MICROPY_INCLUDED_PY_HEAPTRACE_H
+
+#include "py/obj.h"
+
+#if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+
+// Start sampling one allocation every interval bytes allocated, into a new
+// ring of the given number (at least 1) of samples.
+void mp_heap_trace_start(size_t interval, size_t ring_len);
+void mp_heap_trace_stop(void);
+
+// Called by gc_alloc with each new block while a sample is due, or while the
+// type of the last sampled block is still to be read.
+void mp_heap_trace_alloc(void *ptr, size_t n_bytes);
+
+// Print the samples in the ring grouped by allocating code and type, one
+// "<function> (<file>:<line>) <type> <count> <bytes>" line per group.
+void mp_heap_trace_dump(const mp_print_t *print);
+
+// Collect garbage, then print the live blocks grouped by type and by size
+// rounded up to a power of 2, one "<type> <size> <count> <bytes>" line per
+// group.
+void mp_heap_snapshot(const mp_print_t *print);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_HEAPTRACE_H
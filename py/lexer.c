@@ -119,6 +119,28 @@ STATIC bool is_tail_of_identifier(mp_lexer_t *lex) {
     return is_head_of_identifier(lex) || is_digit(lex);
 }
 
+STATIC MP_NOINLINE unichar read_chunk(mp_lexer_t *lex) {
+    if (lex->reader.readchunk == NULL) {
+        return lex->reader.readbyte(lex->reader.data);
+    }
+    size_t len;
+    const byte *buf = lex->reader.readchunk(lex->reader.data, &len);
+    if (len == 0) {
+        return MP_LEXER_EOF;
+    }
+    lex->buf_cur = buf + 1;
+    lex->buf_end = buf + len;
+    return buf[0];
+}
+
+// get the next byte from the reader, going through it a chunk at a time
+static inline unichar read_byte(mp_lexer_t *lex) {
+    if (lex->buf_cur < lex->buf_end) {
+        return *lex->buf_cur++;
+    }
+    return read_chunk(lex);
+}
+
 STATIC void next_char(mp_lexer_t *lex) {
     if (lex->chr0 == '\n') {
         // a new line
@@ -134,14 +156,14 @@ STATIC void next_char(mp_lexer_t *lex) {
 
     lex->chr0 = lex->chr1;
     lex->chr1 = lex->chr2;
-    lex->chr2 = lex->reader.readbyte(lex->reader.data);
+    lex->chr2 = read_byte(lex);
 
     if (lex->chr1 == '\r') {
         // CR is a new line, converted to LF
         lex->chr1 = '\n';
         if (lex->chr2 == '\n') {
             // CR LF is a single new line, throw out the extra LF
-            lex->chr2 = lex->reader.readbyte(lex->reader.data);
+            lex->chr2 = read_byte(lex);
         }
     }
 
@@ -151,6 +173,88 @@ STATIC void next_char(mp_lexer_t *lex) {
     }
 }
 
+#if MICROPY_OPT_LEXER_FAST_SCAN
+
+// Characters that can be moved past in a run must be worth one column each
+// and not be the start of a new line: \t, \n and \r are never in a run.
+enum {
+    RUN_SPACE,
+    RUN_COMMENT,
+    RUN_NAME,
+    RUN_STRING, // characters added to a string literal as they are
+};
+
+static inline bool is_comment_byte(byte c) {
+    return c != '\t' && c != '\n' && c != '\r';
+}
+
+static inline bool is_name_byte(byte c) {
+    byte lower = c | 0x20;
+    return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static inline bool is_plain_string_byte(byte c) {
+    return is_comment_byte(c) && c != '\'' && c != '"' && c != '\\';
+}
+
+// return the end of the run of the given kind that starts at buf
+STATIC const byte *scan_run(const byte *buf, const byte *top, int kind) {
+    switch (kind) {
+        case RUN_SPACE:
+            while (buf < top && *buf == ' ') {
+                ++buf;
+            }
+            break;
+        case RUN_COMMENT:
+            while (buf < top && is_comment_byte(*buf)) {
+                ++buf;
+            }
+            break;
+        case RUN_NAME:
+            while (buf < top && is_name_byte(*buf)) {
+                ++buf;
+            }
+            break;
+        default:
+            while (buf < top && is_plain_string_byte(*buf)) {
+                ++buf;
+            }
+            break;
+    }
+    return buf;
+}
+
+// Move past the current character, and the run of characters of the given
+// kind after it, adding them to vstr if it is not NULL.  Only the current
+// character is moved past unless it and the two after it are in the run; the
+// run also ends at the end of the last chunk read from the reader.
+STATIC void next_run(mp_lexer_t *lex, int kind, vstr_t *vstr) {
+    byte win[3] = {lex->chr0, lex->chr1, lex->chr2};
+    if (lex->chr0 < 0x100 && lex->chr1 < 0x100 && lex->chr2 < 0x100 && scan_run(win, win + 3, kind) == win + 3) {
+        const byte *run = lex->buf_cur;
+        size_t len = scan_run(run, lex->buf_end, kind) - run;
+        if (vstr != NULL) {
+            char *s = vstr_add_len(vstr, 3 + len);
+            memcpy(s, win, 3);
+            memcpy(s + 3, run, len);
+        }
+        lex->buf_cur = run + len;
+        lex->column += len;
+        // the current characters are each worth a column, so next_char()
+        // can refill them from the character after the run
+        next_char(lex);
+        next_char(lex);
+        next_char(lex);
+    } else {
+        if (vstr != NULL) {
+            vstr_add_byte(vstr, CUR_CHAR(lex));
+        }
+        next_char(lex);
+    }
+}
+
+#endif
+
 STATIC void indent_push(mp_lexer_t *lex, size_t indent) {
     if (lex->num_indent_level >= lex->alloc_indent_level) {
         lex->indent_level = m_renew(uint16_t, lex->indent_level, lex->alloc_indent_level, lex->alloc_indent_level + MICROPY_ALLOC_LEXEL_INDENT_INC);
@@ -384,7 +488,12 @@ STATIC void parse_string_literal(mp_lexer_t *lex, bool is_raw) {
             } else {
                 // Add the "character" as a byte so that we remain 8-bit clean.
                 // This way, strings are parsed correctly whether or not they contain utf-8 chars.
+                #if MICROPY_OPT_LEXER_FAST_SCAN
+                next_run(lex, RUN_STRING, &lex->vstr);
+                continue;
+                #else
                 vstr_add_byte(&lex->vstr, CUR_CHAR(lex));
+                #endif
             }
         }
         next_char(lex);
@@ -409,11 +518,19 @@ STATIC bool skip_whitespace(mp_lexer_t *lex, bool stop_at_newline) {
             had_physical_newline = true;
             next_char(lex);
         } else if (is_whitespace(lex)) {
+            #if MICROPY_OPT_LEXER_FAST_SCAN
+            next_run(lex, RUN_SPACE, NULL);
+            #else
             next_char(lex);
+            #endif
         } else if (is_char(lex, '#')) {
             next_char(lex);
             while (!is_end(lex) && !is_physical_newline(lex)) {
+                #if MICROPY_OPT_LEXER_FAST_SCAN
+                next_run(lex, RUN_COMMENT, NULL);
+                #else
                 next_char(lex);
+                #endif
             }
             // had_physical_newline will be set on next loop
         } else if (is_char_and(lex, '\\', '\n')) {
@@ -536,16 +653,24 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
 
         // get tail chars
         while (!is_end(lex) && is_tail_of_identifier(lex)) {
+            #if MICROPY_OPT_LEXER_FAST_SCAN
+            next_run(lex, RUN_NAME, &lex->vstr);
+            #else
             vstr_add_byte(&lex->vstr, CUR_CHAR(lex));
             next_char(lex);
+            #endif
         }
 
         // Check if the name is a keyword.
         // We also check for __debug__ here and convert it to its value.  This is
         // so the parser gives a syntax error on, eg, x.__debug__.  Otherwise, we
         // need to check for this special token in many places in the compiler.
+        // The table is sorted so it can be binary searched.
         const char *s = vstr_null_terminated_str(&lex->vstr);
-        for (size_t i = 0; i < MP_ARRAY_SIZE(tok_kw); i++) {
+        size_t lo = 0;
+        size_t hi = MP_ARRAY_SIZE(tok_kw);
+        while (lo < hi) {
+            size_t i = (lo + hi) / 2;
             int cmp = strcmp(s, tok_kw[i]);
             if (cmp == 0) {
                 lex->tok_kind = MP_TOKEN_KW_FALSE + i;
@@ -554,8 +679,9 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
                 }
                 break;
             } else if (cmp < 0) {
-                // Table is sorted and comparison was less-than, so stop searching
-                break;
+                hi = i;
+            } else {
+                lo = i + 1;
             }
         }
 
@@ -672,6 +798,8 @@ mp_lexer_t *mp_lexer_new(qstr src_name, mp_reader_t reader) {
 
     lex->source_name = src_name;
     lex->reader = reader;
+    lex->buf_cur = NULL;
+    lex->buf_end = NULL;
     lex->line = 1;
     lex->column = (size_t)-2; // account for 3 dummy bytes
     lex->emit_dent = 0;
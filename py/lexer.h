@@ -148,6 +148,8 @@ typedef enum _mp_token_kind_t {
 typedef struct _mp_lexer_t {
     qstr source_name;           // name of source
     mp_reader_t reader;         // stream source
+    const byte *buf_cur;        // unread bytes of the last chunk from reader
+    const byte *buf_end;
 
     unichar chr0, chr1, chr2;   // current cached characters from source
 
@@ -186,6 +188,26 @@ typedef enum {
 } mp_import_stat_t;
 
 mp_import_stat_t mp_import_stat(const char *path);
+
+#if MICROPY_MODULE_IMPORT_CACHE
+// store name->MP_IMPORT_STAT_xxx (as a small int) in dict for each entry of the
+// directory at path ("" is the current directory); return false if the port
+// can't list it, in which case mp_import_stat is used for that directory.  On
+// a case-insensitive filesystem the names are stored in lower case (ASCII only)
+// and *fold_case is set to true, so they are looked up case-insensitively.
+bool mp_import_listdir(const char *path, mp_obj_t dict, bool *fold_case);
+// return a value that changes whenever entries are added to or removed from
+// the directory at path, eg derived from its mtime, with a non-zero value for
+// a missing directory; 0 means the port can't tell, and then the listing stays
+// cached until mp_import_cache_invalidate is called.  A cached listing is
+// checked against its stamp at most once per import statement.
+mp_uint_t mp_import_dir_stamp(const char *path);
+// drop all cached listings; must be called when the filesystem is changed by
+// this process, and may be called from any thread
+void mp_import_cache_invalidate(void);
+#else
+#define mp_import_cache_invalidate()
+#endif
 mp_lexer_t *mp_lexer_new_from_file(const char *filename);
 
 #if MICROPY_HELPER_LEXER_UNIX
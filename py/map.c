@@ -73,9 +73,175 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
     return (x + x / 2) | 1;
 }
 
+STATIC mp_uint_t mp_map_hash(mp_obj_t index) {
+    // fast path for common case of qstr
+    if (mp_obj_is_qstr(index)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(index));
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
+}
+
+/******************************************************************************/
+/* ordered map index                                                          */
+
+#if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+
+// An ordered map that grows beyond a few entries gets a hash index, stored
+// in the same block right after its entries.  The entries stay in insertion
+// order; a deleted one is left in place with its key set to MP_OBJ_SENTINEL
+// until the table is next rebuilt.  Each index slot holds the position of an
+// entry plus one (0 is a free slot), in 1, 2 or 4 bytes depending on the
+// number of entries, and the index is never more than 2/3 full.  The search
+// through the index mixes in the high bits of the hash as CPython does, so
+// that runs of consecutive small ints do not pile up in one cluster.
+
+#define MP_MAP_ORDERED_INDEX_MIN (8)
+
+typedef struct _mp_map_index_t {
+    size_t fill; // entries used so far, including deleted ones
+    size_t mask; // number of slots minus one
+    byte slots[];
+} mp_map_index_t;
+
+static inline mp_map_index_t *mp_map_index(const mp_map_t *map) {
+    return (mp_map_index_t*)&map->table[map->alloc];
+}
+
+STATIC size_t mp_map_index_width(size_t alloc) {
+    return alloc < 0xff ? 1 : alloc < 0xffff ? 2 : 4;
+}
+
+STATIC size_t mp_map_index_slots(size_t alloc) {
+    size_t n = 8;
+    while (n < alloc + alloc / 2) {
+        n <<= 1;
+    }
+    return n;
+}
+
+STATIC size_t mp_map_index_get(const mp_map_index_t *idx, size_t width, size_t pos) {
+    if (width == 1) {
+        return idx->slots[pos];
+    } else if (width == 2) {
+        return ((const uint16_t*)idx->slots)[pos];
+    } else {
+        return ((const uint32_t*)idx->slots)[pos];
+    }
+}
+
+STATIC void mp_map_index_set(mp_map_index_t *idx, size_t width, size_t pos, size_t value) {
+    if (width == 1) {
+        idx->slots[pos] = value;
+    } else if (width == 2) {
+        ((uint16_t*)idx->slots)[pos] = value;
+    } else {
+        ((uint32_t*)idx->slots)[pos] = value;
+    }
+}
+
+static inline size_t mp_map_index_next(size_t pos, mp_uint_t *perturb, size_t mask) {
+    *perturb >>= 5;
+    return (pos * 5 + *perturb + 1) & mask;
+}
+
+STATIC size_t mp_map_table_bytes(size_t alloc, bool is_indexed) {
+    size_t n = alloc * sizeof(mp_map_elem_t);
+    if (is_indexed) {
+        n += sizeof(mp_map_index_t) + mp_map_index_slots(alloc) * mp_map_index_width(alloc);
+    }
+    return n;
+}
+
+// Moves the live entries of an ordered map, in order, to a new indexed table
+// of new_alloc entries.
+STATIC void mp_map_ordered_rebuild(mp_map_t *map, size_t new_alloc) {
+    size_t old_alloc = map->alloc;
+    size_t old_fill = map->is_indexed ? mp_map_index(map)->fill : map->used;
+    mp_map_elem_t *old_table = map->table;
+    size_t old_bytes = mp_map_table_bytes(old_alloc, map->is_indexed);
+    DEBUG_printf("mp_map_ordered_rebuild(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
+    mp_map_elem_t *new_table = m_malloc0(mp_map_table_bytes(new_alloc, true));
+    // If we reach this point, table resizing succeeded, now we can edit the old map.
+    map->alloc = new_alloc;
+    map->is_indexed = 1;
+    map->table = new_table;
+    mp_map_index_t *idx = mp_map_index(map);
+    size_t width = mp_map_index_width(new_alloc);
+    idx->mask = mp_map_index_slots(new_alloc) - 1;
+    idx->fill = 0;
+    for (size_t i = 0; i < old_fill; i++) {
+        if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
+            mp_uint_t perturb = mp_map_hash(old_table[i].key);
+            size_t pos = perturb & idx->mask;
+            while (mp_map_index_get(idx, width, pos) != 0) {
+                pos = mp_map_index_next(pos, &perturb, idx->mask);
+            }
+            new_table[idx->fill] = old_table[i];
+            mp_map_index_set(idx, width, pos, ++idx->fill);
+        }
+    }
+    m_del(byte, old_table, old_bytes);
+}
+
+STATIC mp_map_elem_t *mp_map_ordered_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind, bool compare_only_ptrs) {
+    mp_uint_t hash = mp_map_hash(index);
+    for (;;) {
+        mp_map_index_t *idx = mp_map_index(map);
+        size_t width = mp_map_index_width(map->alloc);
+        mp_uint_t perturb = hash;
+        size_t pos = hash & idx->mask;
+        size_t slot;
+        while ((slot = mp_map_index_get(idx, width, pos)) != 0) {
+            mp_map_elem_t *elem = &map->table[slot - 1];
+            if (elem->key == index
+                || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && mp_obj_equal(elem->key, index))) {
+                if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
+                    // the index slot keeps pointing here, the entry goes at the next rebuild
+                    --map->used;
+                    elem->key = MP_OBJ_SENTINEL;
+                    // keep elem->value so that caller can access it if needed
+                }
+                return elem;
+            }
+            pos = mp_map_index_next(pos, &perturb, idx->mask);
+        }
+        if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            return NULL;
+        }
+        if (idx->fill < map->alloc) {
+            // append the entry and take the free slot the search ended on
+            mp_map_elem_t *elem = &map->table[idx->fill];
+            mp_map_index_set(idx, width, pos, ++idx->fill);
+            map->used++;
+            elem->key = index;
+            elem->value = MP_OBJ_NULL;
+            if (!mp_obj_is_qstr(index)) {
+                map->all_keys_are_qstrs = 0;
+            }
+            return elem;
+        }
+        // no entries left: drop the deleted ones, growing if the live ones
+        // fill more than 2/3 of the table, then search again
+        mp_map_ordered_rebuild(map, get_hash_alloc_greater_or_equal_to(map->used + map->used / 2 + 1));
+    }
+}
+
+#endif // MICROPY_PY_COLLECTIONS_ORDEREDDICT
+
 /******************************************************************************/
 /* map                                                                        */
 
+// Frees the table of a map that is not fixed.
+STATIC void mp_map_free_table(mp_map_t *map) {
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    m_del(byte, map->table, mp_map_table_bytes(map->alloc, map->is_indexed));
+    map->is_indexed = 0;
+    #else
+    m_del(mp_map_elem_t, map->table, map->alloc);
+    #endif
+}
+
 void mp_map_init(mp_map_t *map, size_t n) {
     if (n == 0) {
         map->alloc = 0;
@@ -88,6 +254,7 @@ void mp_map_init(mp_map_t *map, size_t n) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
     map->is_ordered = 0;
+    map->is_indexed = 0;
 }
 
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
@@ -96,25 +263,27 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 1;
     map->is_ordered = 1;
+    map->is_indexed = 0;
     map->table = (mp_map_elem_t*)table;
 }
 
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        mp_map_free_table(map);
     }
     map->used = map->alloc = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        mp_map_free_table(map);
     }
     map->alloc = 0;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
+    map->is_indexed = 0;
     map->table = NULL;
 }
 
@@ -166,8 +335,14 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // if the map is an ordered array then we must do a brute force linear search
+    // if the map is an ordered array then we must do a brute force linear search,
+    // unless it grew big enough to get an index
     if (map->is_ordered) {
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        if (map->is_indexed) {
+            return mp_map_ordered_lookup(map, index, lookup_kind, compare_only_ptrs);
+        }
+        #endif
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
             if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
                 #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
@@ -190,7 +365,11 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             return NULL;
         }
         if (map->used == map->alloc) {
-            // TODO: Alloc policy
+            if (map->alloc >= MP_MAP_ORDERED_INDEX_MIN) {
+                // from here on a linear search costs more than hashing the key
+                mp_map_ordered_rebuild(map, get_hash_alloc_greater_or_equal_to(map->alloc + map->alloc / 2));
+                return mp_map_ordered_lookup(map, index, lookup_kind, compare_only_ptrs);
+            }
             map->alloc += 4;
             map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
             mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
@@ -216,13 +395,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
-    mp_uint_t hash;
-    if (mp_obj_is_qstr(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
-        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
-    }
+    mp_uint_t hash = mp_map_hash(index);
 
     size_t pos = hash % map->alloc;
     size_t start_pos = pos;
@@ -31,6 +31,10 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/stream.h"
+#include "py/profile.h"
+#include "py/vmstats.h"
+#include "py/heaptrace.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -155,6 +159,141 @@ STATIC mp_obj_t mp_micropython_kbd_intr(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_kbd_intr_obj, 1, 2, mp_micropython_kbd_intr);
 #endif
 
+#if MICROPY_MODULE_COMPILE_CACHE
+STATIC mp_obj_t mp_micropython_compile_cache_dir(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_STATE_VM(compile_cache_dir);
+    } else {
+        if (args[0] != mp_const_none) {
+            mp_obj_str_get_str(args[0]); // check it's a str
+        }
+        MP_STATE_VM(compile_cache_dir) = args[0];
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_compile_cache_dir_obj, 0, 1, mp_micropython_compile_cache_dir);
+
+STATIC mp_obj_t mp_micropython_compile_cache_info(void) {
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_uint(MP_STATE_VM(compile_cache_hits)),
+        mp_obj_new_int_from_uint(MP_STATE_VM(compile_cache_misses)),
+        mp_obj_new_int_from_uint(MP_STATE_VM(compile_cache_saves)),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_compile_cache_info_obj, mp_micropython_compile_cache_info);
+#endif
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+STATIC mp_obj_t mp_micropython_profile_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period_us = 1000;
+    mp_int_t n_samples = 256;
+    if (n_args >= 1) {
+        period_us = mp_obj_get_int(args[0]);
+    }
+    if (n_args >= 2) {
+        n_samples = mp_obj_get_int(args[1]);
+    }
+    if (period_us < 1 || n_samples < 1) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_profile_start(period_us, n_samples);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_start_obj, 0, 2, mp_micropython_profile_start);
+
+STATIC mp_obj_t mp_micropython_profile_stop(void) {
+    mp_profile_stop();
+    return mp_obj_new_int_from_uint(MP_STATE_VM(profile_count));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_stop_obj, mp_micropython_profile_stop);
+
+STATIC mp_obj_t mp_micropython_profile_dump(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        mp_profile_dump(&mp_plat_print);
+    } else {
+        // arg given means write to that stream
+        mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+        mp_profile_dump(&print);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_dump_obj, 0, 1, mp_micropython_profile_dump);
+#endif
+
+#if MICROPY_PY_MICROPYTHON_VM_STATS
+STATIC mp_obj_t mp_micropython_vm_stats(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t stats = mp_vm_stats_get();
+    if (n_args == 1 && mp_obj_is_true(args[0])) {
+        // arg given means reset the counts after reading them
+        mp_vm_stats_reset();
+    }
+    return stats;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_vm_stats_obj, 0, 1, mp_micropython_vm_stats);
+
+STATIC mp_obj_t mp_micropython_vm_stats_dump(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        mp_vm_stats_dump(&mp_plat_print);
+    } else {
+        // arg given means write to that stream
+        mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+        mp_vm_stats_dump(&print);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_vm_stats_dump_obj, 0, 1, mp_micropython_vm_stats_dump);
+#endif
+
+#if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+STATIC mp_obj_t mp_micropython_alloc_trace_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t interval = 4096;
+    mp_int_t n_samples = 256;
+    if (n_args >= 1) {
+        interval = mp_obj_get_int(args[0]);
+    }
+    if (n_args >= 2) {
+        n_samples = mp_obj_get_int(args[1]);
+    }
+    if (interval < 1 || n_samples < 1) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_heap_trace_start(interval, n_samples);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_alloc_trace_start_obj, 0, 2, mp_micropython_alloc_trace_start);
+
+STATIC mp_obj_t mp_micropython_alloc_trace_stop(void) {
+    mp_heap_trace_stop();
+    return mp_obj_new_int_from_uint(MP_STATE_VM(heap_trace_count));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_alloc_trace_stop_obj, mp_micropython_alloc_trace_stop);
+
+// Call dump with the print adaptor for an optional stream argument
+STATIC mp_obj_t micropython_heap_trace_print(size_t n_args, const mp_obj_t *args, void (*dump)(const mp_print_t*)) {
+    if (n_args == 0) {
+        dump(&mp_plat_print);
+    } else {
+        mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+        dump(&print);
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t mp_micropython_alloc_trace_dump(size_t n_args, const mp_obj_t *args) {
+    return micropython_heap_trace_print(n_args, args, mp_heap_trace_dump);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_alloc_trace_dump_obj, 0, 1, mp_micropython_alloc_trace_dump);
+
+STATIC mp_obj_t mp_micropython_heap_snapshot(size_t n_args, const mp_obj_t *args) {
+    return micropython_heap_trace_print(n_args, args, mp_heap_snapshot);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_heap_snapshot_obj, 0, 1, mp_micropython_heap_snapshot);
+#endif
+
 #if MICROPY_ENABLE_SCHEDULER
 STATIC mp_obj_t mp_micropython_schedule(mp_obj_t function, mp_obj_t arg) {
     if (!mp_sched_schedule(function, arg)) {
@@ -199,6 +338,25 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #if MICROPY_ENABLE_SCHEDULER
     { MP_ROM_QSTR(MP_QSTR_schedule), MP_ROM_PTR(&mp_micropython_schedule_obj) },
     #endif
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile_start), MP_ROM_PTR(&mp_micropython_profile_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_stop), MP_ROM_PTR(&mp_micropython_profile_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_dump), MP_ROM_PTR(&mp_micropython_profile_dump_obj) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_VM_STATS
+    { MP_ROM_QSTR(MP_QSTR_vm_stats), MP_ROM_PTR(&mp_micropython_vm_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vm_stats_dump), MP_ROM_PTR(&mp_micropython_vm_stats_dump_obj) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    { MP_ROM_QSTR(MP_QSTR_alloc_trace_start), MP_ROM_PTR(&mp_micropython_alloc_trace_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_alloc_trace_stop), MP_ROM_PTR(&mp_micropython_alloc_trace_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_alloc_trace_dump), MP_ROM_PTR(&mp_micropython_alloc_trace_dump_obj) },
+    { MP_ROM_QSTR(MP_QSTR_heap_snapshot), MP_ROM_PTR(&mp_micropython_heap_snapshot_obj) },
+    #endif
+    #if MICROPY_MODULE_COMPILE_CACHE
+    { MP_ROM_QSTR(MP_QSTR_compile_cache_dir), MP_ROM_PTR(&mp_micropython_compile_cache_dir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_compile_cache_info), MP_ROM_PTR(&mp_micropython_compile_cache_info_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_micropython_globals, mp_module_micropython_globals_table);
@@ -33,6 +33,7 @@
 #include "py/objtuple.h"
 #include "py/binary.h"
 #include "py/parsenum.h"
+#include "py/smallint.h"
 
 #if MICROPY_PY_STRUCT
 
@@ -110,6 +111,468 @@ STATIC size_t calc_size_items(const char *fmt, size_t *total_sz) {
     return total_cnt;
 }
 
+#if MICROPY_PY_STRUCT_COMPILED
+
+/*
+    A format is compiled once into a Struct object: a list of fields, each
+    with its offset in the record (alignment already applied), its size and
+    its byte order.  Integer fields of up to 4 bytes and float fields are
+    then read and written directly; everything else goes through
+    mp_binary_get_val/mp_binary_set_val.  The module-level functions take
+    their compiled format from a small cache indexed by the format's qstr,
+    so that a literal format is only parsed the first time it is used.
+ */
+
+enum {
+    STRUCT_FIELD_INT,       // signed, up to 4 bytes
+    STRUCT_FIELD_UINT,      // unsigned, up to 4 bytes
+    STRUCT_FIELD_FLOAT,     // 'f'
+    STRUCT_FIELD_DOUBLE,    // 'd'
+    STRUCT_FIELD_BYTES,     // 's', size bytes
+    STRUCT_FIELD_OTHER,
+};
+
+typedef struct _mp_struct_field_t {
+    uint32_t offset;
+    uint32_t size;
+    char type;
+    char endian;            // '<' or '>', '@' is resolved to the native order
+    uint8_t kind;
+} mp_struct_field_t;
+
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t format;
+    size_t size;
+    size_t num_fields;
+    mp_struct_field_t fields[];
+} mp_obj_struct_t;
+
+typedef struct _mp_obj_struct_it_t {
+    mp_obj_base_t base;
+    mp_obj_struct_t *st;
+    mp_obj_t buf;
+    size_t pos;
+} mp_obj_struct_it_t;
+
+STATIC const mp_obj_type_t struct_type;
+
+STATIC mp_obj_struct_t *struct_compile(mp_obj_t fmt_in) {
+    const char *fmt = mp_obj_str_get_str(fmt_in);
+    size_t total_sz;
+    size_t num_fields = calc_size_items(fmt, &total_sz);
+    mp_obj_struct_t *self = m_new_obj_var(mp_obj_struct_t, mp_struct_field_t, num_fields);
+    self->base.type = &struct_type;
+    self->format = fmt_in;
+    self->size = total_sz;
+    self->num_fields = num_fields;
+
+    char fmt_type = get_fmt_type(&fmt);
+    char endian = fmt_type;
+    if (endian == '@') {
+        endian = MP_ENDIANNESS_LITTLE ? '<' : '>';
+    }
+    size_t offset = 0;
+    mp_struct_field_t *f = self->fields;
+    for (; *fmt; fmt++) {
+        mp_uint_t cnt = 1;
+        if (unichar_isdigit(*fmt)) {
+            cnt = get_fmt_num(&fmt);
+        }
+        if (*fmt == 's') {
+            f->offset = offset;
+            f->size = cnt;
+            f->type = 's';
+            f->endian = endian;
+            f->kind = STRUCT_FIELD_BYTES;
+            offset += cnt;
+            f++;
+            continue;
+        }
+        mp_uint_t align;
+        size_t sz = mp_binary_get_size(fmt_type, *fmt, &align);
+        uint8_t kind = STRUCT_FIELD_OTHER;
+        if (sz <= 4 && strchr("bhilq", *fmt) != NULL) {
+            kind = STRUCT_FIELD_INT;
+        } else if (sz <= 4 && strchr("BHILQ", *fmt) != NULL) {
+            kind = STRUCT_FIELD_UINT;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        } else if (*fmt == 'f') {
+            kind = STRUCT_FIELD_FLOAT;
+        } else if (*fmt == 'd') {
+            kind = STRUCT_FIELD_DOUBLE;
+        #endif
+        }
+        while (cnt--) {
+            offset = (offset + align - 1) & ~(align - 1);
+            f->offset = offset;
+            f->size = sz;
+            f->type = *fmt;
+            f->endian = endian;
+            f->kind = kind;
+            offset += sz;
+            f++;
+        }
+    }
+    return self;
+}
+
+// Cache of the formats compiled for the module-level functions.
+STATIC mp_obj_struct_t *struct_get_compiled(mp_obj_t fmt_in) {
+    if (mp_obj_is_type(fmt_in, &struct_type)) {
+        return MP_OBJ_TO_PTR(fmt_in);
+    }
+    if (!mp_obj_is_qstr(fmt_in)) {
+        // a str built at runtime may be freed and its address reused
+        return struct_compile(fmt_in);
+    }
+    mp_obj_t *slot = &MP_STATE_VM(struct_cache)[MP_OBJ_QSTR_VALUE(fmt_in) % MICROPY_PY_STRUCT_CACHE_SIZE];
+    if (*slot == MP_OBJ_NULL || ((mp_obj_struct_t*)MP_OBJ_TO_PTR(*slot))->format != fmt_in) {
+        *slot = MP_OBJ_FROM_PTR(struct_compile(fmt_in));
+    }
+    return MP_OBJ_TO_PTR(*slot);
+}
+
+STATIC uint32_t struct_get_u32(const byte *p, size_t size, bool big_endian) {
+    uint32_t val = 0;
+    if (big_endian) {
+        for (size_t i = 0; i < size; i++) {
+            val = (val << 8) | p[i];
+        }
+    } else {
+        for (size_t i = size; i-- > 0;) {
+            val = (val << 8) | p[i];
+        }
+    }
+    return val;
+}
+
+STATIC void struct_set_u32(byte *p, size_t size, bool big_endian, uint32_t val) {
+    if (big_endian) {
+        for (size_t i = size; i-- > 0; val >>= 8) {
+            p[i] = val;
+        }
+    } else {
+        for (size_t i = 0; i < size; i++, val >>= 8) {
+            p[i] = val;
+        }
+    }
+}
+
+static inline int32_t struct_sign_extend(uint32_t val, size_t size) {
+    uint32_t sign = 1u << (size * 8 - 1);
+    return (int32_t)((val ^ sign) - sign);
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC float struct_get_float(const mp_struct_field_t *f, const byte *p) {
+    union { uint32_t i; float f; } fpu = {struct_get_u32(p, 4, f->endian == '>')};
+    return fpu.f;
+}
+
+STATIC double struct_get_double(const mp_struct_field_t *f, const byte *p) {
+    union { uint64_t i; double f; } fpu;
+    fpu.i = (uint64_t)mp_binary_get_int(8, false, f->endian == '>', p);
+    return fpu.f;
+}
+#endif
+
+STATIC mp_obj_t struct_get_field(const mp_struct_field_t *f, const byte *p) {
+    p += f->offset;
+    switch (f->kind) {
+        case STRUCT_FIELD_INT:
+            return mp_obj_new_int(struct_sign_extend(struct_get_u32(p, f->size, f->endian == '>'), f->size));
+        case STRUCT_FIELD_UINT:
+            return mp_obj_new_int_from_uint(struct_get_u32(p, f->size, f->endian == '>'));
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case STRUCT_FIELD_FLOAT:
+            return mp_obj_new_float(struct_get_float(f, p));
+        case STRUCT_FIELD_DOUBLE:
+            return mp_obj_new_float(struct_get_double(f, p));
+        #endif
+        case STRUCT_FIELD_BYTES:
+            return mp_obj_new_bytes(p, f->size);
+        default: {
+            byte *q = (byte*)p;
+            return mp_binary_get_val(f->endian, f->type, &q);
+        }
+    }
+}
+
+STATIC void struct_set_field(const mp_struct_field_t *f, byte *p, mp_obj_t val_in) {
+    p += f->offset;
+    if ((f->kind == STRUCT_FIELD_INT || f->kind == STRUCT_FIELD_UINT) && mp_obj_is_small_int(val_in)) {
+        struct_set_u32(p, f->size, f->endian == '>', MP_OBJ_SMALL_INT_VALUE(val_in));
+    } else if (f->kind == STRUCT_FIELD_BYTES) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(val_in, &bufinfo, MP_BUFFER_READ);
+        size_t to_copy = MIN(bufinfo.len, f->size);
+        memcpy(p, bufinfo.buf, to_copy);
+        memset(p + to_copy, 0, f->size - to_copy);
+    } else {
+        mp_binary_set_val(f->endian, f->type, val_in, &p);
+    }
+}
+
+// Returns the start of the record at offset in buf, checking that it fits.
+STATIC byte *struct_get_record(mp_obj_struct_t *self, mp_buffer_info_t *bufinfo, mp_int_t offset) {
+    if (offset < 0) {
+        // negative offsets are relative to the end of the buffer
+        offset = (mp_int_t)bufinfo->len + offset;
+    }
+    if (offset < 0 || (size_t)offset > bufinfo->len || bufinfo->len - offset < self->size) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return (byte*)bufinfo->buf + offset;
+}
+
+STATIC mp_obj_t struct_unpack_record(mp_obj_struct_t *self, const byte *p) {
+    mp_obj_tuple_t *res = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->num_fields, NULL));
+    for (size_t i = 0; i < self->num_fields; i++) {
+        res->items[i] = struct_get_field(&self->fields[i], p);
+    }
+    return MP_OBJ_FROM_PTR(res);
+}
+
+// As before, more arguments than the format uses are ignored and missing
+// ones are left as zeros; CPython would raise struct.error.
+STATIC void struct_pack_record(mp_obj_struct_t *self, byte *p, size_t n_args, const mp_obj_t *args) {
+    for (size_t i = 0; i < self->num_fields && i < n_args; i++) {
+        struct_set_field(&self->fields[i], p, args[i]);
+    }
+}
+
+STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
+    return MP_OBJ_NEW_SMALL_INT(struct_get_compiled(fmt_in)->size);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(struct_calcsize_obj, struct_calcsize);
+
+// unpack requires that the buffer be exactly the right size.
+// unpack_from requires that the buffer be "big enough".
+// Since we implement unpack and unpack_from using the same function
+// we relax the "exact" requirement, and only implement "big enough".
+STATIC mp_obj_t struct_unpack_from_helper(mp_obj_struct_t *self, size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    byte *p = struct_get_record(self, &bufinfo, n_args > 1 ? mp_obj_get_int(args[1]) : 0);
+    return struct_unpack_record(self, p);
+}
+
+STATIC mp_obj_t struct_unpack_from(size_t n_args, const mp_obj_t *args) {
+    return struct_unpack_from_helper(struct_get_compiled(args[0]), n_args - 1, args + 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_unpack_from_obj, 2, 3, struct_unpack_from);
+
+STATIC mp_obj_t struct_pack_helper(mp_obj_struct_t *self, size_t n_args, const mp_obj_t *args) {
+    // TODO: "The arguments must match the values required by the format exactly."
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->size);
+    byte *p = (byte*)vstr.buf;
+    memset(p, 0, self->size);
+    struct_pack_record(self, p, n_args, args);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t struct_pack(size_t n_args, const mp_obj_t *args) {
+    return struct_pack_helper(struct_get_compiled(args[0]), n_args - 1, args + 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_pack);
+
+STATIC mp_obj_t struct_pack_into_helper(mp_obj_struct_t *self, size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+    byte *p = struct_get_record(self, &bufinfo, mp_obj_get_int(args[1]));
+    struct_pack_record(self, p, n_args - 2, args + 2);
+    return mp_const_none;
+}
+
+STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
+    return struct_pack_into_helper(struct_get_compiled(args[0]), n_args - 1, args + 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
+
+/******************************************************************************/
+/* Struct objects                                                             */
+
+STATIC void struct_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_print_str(print, "Struct(");
+    mp_obj_print_helper(print, self->format, PRINT_REPR);
+    mp_print_str(print, ")");
+}
+
+STATIC mp_obj_t struct_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)type;
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    return MP_OBJ_FROM_PTR(struct_compile(args[0]));
+}
+
+STATIC mp_obj_t struct_obj_pack(size_t n_args, const mp_obj_t *args) {
+    return struct_pack_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack);
+
+STATIC mp_obj_t struct_obj_pack_into(size_t n_args, const mp_obj_t *args) {
+    return struct_pack_into_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack_into);
+
+STATIC mp_obj_t struct_obj_unpack_from(size_t n_args, const mp_obj_t *args) {
+    return struct_unpack_from_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_from_obj, 2, 3, struct_obj_unpack_from);
+
+STATIC mp_obj_t struct_it_iternext(mp_obj_t self_in) {
+    mp_obj_struct_it_t *self = MP_OBJ_TO_PTR(self_in);
+    // the buffer is looked up each time, it may have been resized meanwhile
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(self->buf, &bufinfo, MP_BUFFER_READ);
+    if (self->pos > bufinfo.len || bufinfo.len - self->pos < self->st->size) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_t res = struct_unpack_record(self->st, (byte*)bufinfo.buf + self->pos);
+    self->pos += self->st->size;
+    return res;
+}
+
+STATIC const mp_obj_type_t struct_it_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity_getiter,
+    .iternext = struct_it_iternext,
+};
+
+STATIC mp_obj_t struct_obj_iter_unpack(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (self->size == 0 || bufinfo.len % self->size != 0) {
+        mp_raise_ValueError("buffer size must be a multiple of the struct size");
+    }
+    mp_obj_struct_it_t *it = m_new_obj(mp_obj_struct_it_t);
+    it->base.type = &struct_it_type;
+    it->st = self;
+    it->buf = buf_in;
+    it->pos = 0;
+    return MP_OBJ_FROM_PTR(it);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(struct_obj_iter_unpack_obj, struct_obj_iter_unpack);
+
+// Struct.unpack_into(buf, *columns): unpacks consecutive records from buf,
+// field i of record n going to columns[i][n].  A column is an array (or any
+// other typed writable buffer), an object supporting item assignment such as
+// a list, or None to skip the field.  Stops at the end of buf or of the
+// shortest column and returns the number of records unpacked.
+STATIC mp_obj_t struct_obj_unpack_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    const mp_obj_t *columns = args + 2;
+    if (n_args - 2 != self->num_fields) {
+        mp_raise_ValueError("need one column per field");
+    }
+    if (self->size == 0) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
+    size_t count = bufinfo.len / self->size;
+    mp_buffer_info_t *colinfo = m_new(mp_buffer_info_t, self->num_fields);
+    for (size_t i = 0; i < self->num_fields; i++) {
+        colinfo[i].buf = NULL;
+        if (columns[i] == mp_const_none) {
+            continue;
+        }
+        size_t len;
+        if (mp_get_buffer(columns[i], &colinfo[i], MP_BUFFER_WRITE)) {
+            mp_uint_t align;
+            len = colinfo[i].len / mp_binary_get_size('@', colinfo[i].typecode, &align);
+        } else {
+            len = mp_obj_get_int(mp_obj_len(columns[i]));
+        }
+        count = MIN(count, len);
+    }
+
+    for (size_t i = 0; i < self->num_fields; i++) {
+        const mp_struct_field_t *f = &self->fields[i];
+        const byte *p = bufinfo.buf;
+        void *dest = colinfo[i].buf;
+        char typecode = colinfo[i].typecode;
+        if (columns[i] == mp_const_none) {
+            continue;
+        }
+        for (size_t n = 0; n < count; n++, p += self->size) {
+            if (dest == NULL) {
+                mp_obj_subscr(columns[i], MP_OBJ_NEW_SMALL_INT(n), struct_get_field(f, p));
+            } else if (f->kind == STRUCT_FIELD_INT || f->kind == STRUCT_FIELD_UINT) {
+                uint32_t val = struct_get_u32(p + f->offset, f->size, f->endian == '>');
+                if (f->kind == STRUCT_FIELD_INT) {
+                    mp_binary_set_val_array_from_int(typecode, dest, n, struct_sign_extend(val, f->size));
+                } else if (val <= (uint32_t)MP_SMALL_INT_MAX || typecode == 'I' || typecode == 'L') {
+                    mp_binary_set_val_array_from_int(typecode, dest, n, (mp_int_t)val);
+                } else {
+                    mp_binary_set_val_array(typecode, dest, n, mp_obj_new_int_from_uint(val));
+                }
+            #if MICROPY_PY_BUILTINS_FLOAT
+            } else if ((f->kind == STRUCT_FIELD_FLOAT || f->kind == STRUCT_FIELD_DOUBLE) && (typecode == 'f' || typecode == 'd')) {
+                double val = f->kind == STRUCT_FIELD_FLOAT ? (double)struct_get_float(f, p + f->offset) : struct_get_double(f, p + f->offset);
+                if (typecode == 'f') {
+                    ((float*)dest)[n] = val;
+                } else {
+                    ((double*)dest)[n] = val;
+                }
+            #endif
+            } else {
+                mp_binary_set_val_array(typecode, dest, n, struct_get_field(f, p));
+            }
+        }
+    }
+    m_del(mp_buffer_info_t, colinfo, self->num_fields);
+    return MP_OBJ_NEW_SMALL_INT(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_into_obj, 2, MP_OBJ_FUN_ARGS_MAX, struct_obj_unpack_into);
+
+STATIC const mp_rom_map_elem_t struct_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack), MP_ROM_PTR(&struct_obj_pack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_obj_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_iter_unpack), MP_ROM_PTR(&struct_obj_iter_unpack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_into), MP_ROM_PTR(&struct_obj_unpack_into_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(struct_locals_dict, struct_locals_dict_table);
+
+STATIC void struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // can't store or delete attributes
+        return;
+    }
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    if (attr == MP_QSTR_size) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+    } else if (attr == MP_QSTR_format) {
+        dest[0] = self->format;
+    } else {
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&struct_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            dest[0] = elem->value;
+            dest[1] = self_in;
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .print = struct_print,
+    .make_new = struct_make_new,
+    .attr = struct_attr,
+    .locals_dict = (mp_obj_dict_t*)&struct_locals_dict,
+};
+
+#else
+
 STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
     const char *fmt = mp_obj_str_get_str(fmt_in);
     size_t size;
@@ -248,6 +711,8 @@ STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
 
+#endif // MICROPY_PY_STRUCT_COMPILED
+
 STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ustruct) },
     { MP_ROM_QSTR(MP_QSTR_calcsize), MP_ROM_PTR(&struct_calcsize_obj) },
@@ -255,6 +720,9 @@ STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_pack_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_unpack_from_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_unpack_from_obj) },
+    #if MICROPY_PY_STRUCT_COMPILED
+    { MP_ROM_QSTR(MP_QSTR_Struct), MP_ROM_PTR(&struct_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
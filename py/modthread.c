@@ -167,6 +167,10 @@ STATIC void *thread_entry(void *args_in) {
     mp_pystack_init(mini_pystack, &mini_pystack[128]);
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    MP_STATE_THREAD(profile_frame) = NULL;
+    #endif
+
     // set locals and globals from the calling context
     mp_locals_set(args->dict_locals);
     mp_globals_set(args->dict_globals);
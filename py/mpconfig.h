@@ -161,6 +161,13 @@
 #define MICROPY_ALLOC_LEXER_INDENT_INIT (10)
 #endif
 
+// Size of the buffer that the POSIX and VFS readers read a file into.  It is
+// allocated on the heap with the reader, so it is only used while a file is
+// being imported or executed.  Larger means fewer calls to the file layer.
+#ifndef MICROPY_ALLOC_READER_BUF_SIZE
+#define MICROPY_ALLOC_READER_BUF_SIZE (32)
+#endif
+
 // Increment for lexer indentation level
 #ifndef MICROPY_ALLOC_LEXEL_INDENT_INC
 #define MICROPY_ALLOC_LEXEL_INDENT_INC (8)
@@ -267,6 +274,14 @@
 #define MICROPY_PERSISTENT_CODE_LOAD (0)
 #endif
 
+// Whether constant bytes data is referenced in place (instead of copied to
+// the heap) when loading with mp_raw_code_load_mapped from static memory such
+// as flash, and whether .mpy files on a POSIX filesystem are loaded that way
+// from an mmap of the file, which is kept for as long as the program runs
+#ifndef MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+#define MICROPY_PERSISTENT_CODE_LOAD_MAPPED (0)
+#endif
+
 // Whether to support saving of persistent code
 #ifndef MICROPY_PERSISTENT_CODE_SAVE
 #define MICROPY_PERSISTENT_CODE_SAVE (0)
@@ -329,6 +344,12 @@
 // Convenience definition for whether any inline assembler emitter is enabled
 #define MICROPY_EMIT_INLINE_ASM (MICROPY_EMIT_INLINE_THUMB || MICROPY_EMIT_INLINE_XTENSA)
 
+// Whether viper code supports the "float" type, with values held unboxed in
+// a machine word.  Requires sizeof(mp_float_t) == sizeof(mp_uint_t).
+#ifndef MICROPY_EMIT_NATIVE_FLOAT
+#define MICROPY_EMIT_NATIVE_FLOAT (0)
+#endif
+
 /*****************************************************************************/
 /* Compiler configuration                                                    */
 
@@ -389,6 +410,20 @@
 #define MICROPY_COMP_RETURN_IF_EXPR (0)
 #endif
 
+// Whether the bytecode emitter generates each scope in a single pass, growing
+// its buffers and back-patching forward jumps, instead of first making passes
+// to size the stack and code; costs an extra byte per function in persistent code
+#ifndef MICROPY_COMP_SINGLE_PASS_BC
+#define MICROPY_COMP_SINGLE_PASS_BC (0)
+#endif
+
+// Whether the parse tree of each def and class is freed as soon as its code
+// is generated, rather than all at the end; lowers the peak heap use of
+// compiling a large script at the cost of smaller parse-tree chunks
+#ifndef MICROPY_COMP_FREE_PARSE_TREE
+#define MICROPY_COMP_FREE_PARSE_TREE (0)
+#endif
+
 /*****************************************************************************/
 /* Internal debugging stuff                                                  */
 
@@ -454,6 +489,24 @@
 #define MICROPY_OPT_MATH_FACTORIAL (0)
 #endif
 
+// Whether the lexer scans runs of characters within an identifier, string
+// literal, comment or indentation directly from the input buffer, instead of
+// moving along one character at a time.  Increases code size by a little.
+#ifndef MICROPY_OPT_LEXER_FAST_SCAN
+#define MICROPY_OPT_LEXER_FAST_SCAN (0)
+#endif
+
+// Whether the VM writes the result of a float arithmetic op into the float
+// produced by the previous op, when that float is a temporary that is only
+// referenced from the VM stack.  Saves a heap allocation per op in chained
+// float expressions.  Requires an object representation with boxed floats.
+#ifndef MICROPY_OPT_FLOAT_TEMP_REUSE
+#define MICROPY_OPT_FLOAT_TEMP_REUSE (0)
+#endif
+#if MICROPY_OPT_FLOAT_TEMP_REUSE && MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_A && MICROPY_OBJ_REPR != MICROPY_OBJ_REPR_B
+#error MICROPY_OPT_FLOAT_TEMP_REUSE requires MICROPY_OBJ_REPR_A or MICROPY_OBJ_REPR_B
+#endif
+
 /*****************************************************************************/
 /* Python internal features                                                  */
 
@@ -694,6 +747,22 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_WEAK_LINKS (0)
 #endif
 
+// Whether import caches directory listings, so that resolving a module costs
+// one listing per sys.path entry rather than a stat per candidate file
+// When enabled, a port must implement mp_import_listdir and mp_import_dir_stamp
+#ifndef MICROPY_MODULE_IMPORT_CACHE
+#define MICROPY_MODULE_IMPORT_CACHE (0)
+#endif
+
+// Whether the code compiled from an imported .py file can be saved in a cache
+// directory and loaded from there while the source is unchanged; the cache is
+// only used once a directory is set with micropython.compile_cache_dir()
+// Requires MICROPY_PERSISTENT_CODE_LOAD, MICROPY_PERSISTENT_CODE_SAVE and
+// MICROPY_READER_POSIX
+#ifndef MICROPY_MODULE_COMPILE_CACHE
+#define MICROPY_MODULE_COMPILE_CACHE (0)
+#endif
+
 // Whether frozen modules are supported in the form of strings
 #ifndef MICROPY_MODULE_FROZEN_STR
 #define MICROPY_MODULE_FROZEN_STR (0)
@@ -1021,6 +1090,38 @@ typedef double mp_float_t;
 #define MICROPY_PY_MICROPYTHON_STACK_USE (MICROPY_PY_MICROPYTHON_MEM_INFO)
 #endif
 
+// Whether to provide the "micropython.profile_start", "profile_stop" and
+// "profile_dump" functions of a sampling profiler, which records the stack of
+// bytecode functions being run each time a timer fires.  The port must
+// provide mp_hal_profile_timer() and call mp_profile_sample() from the timer
+// interrupt or signal.
+#ifndef MICROPY_PY_MICROPYTHON_PROFILE
+#define MICROPY_PY_MICROPYTHON_PROFILE (0)
+#endif
+
+// Number of innermost functions of the stack recorded by each profile sample
+#ifndef MICROPY_PY_MICROPYTHON_PROFILE_DEPTH
+#define MICROPY_PY_MICROPYTHON_PROFILE_DEPTH (8)
+#endif
+
+// Whether the VM counts the opcodes it executes, consecutive pairs of
+// opcodes, and calls to each bytecode function, and provides the
+// "micropython.vm_stats" and "vm_stats_dump" functions to read them out.
+// This slows down the VM and uses 256*256 words of RAM for the pair counts,
+// so it is meant for analysis builds only.
+#ifndef MICROPY_PY_MICROPYTHON_VM_STATS
+#define MICROPY_PY_MICROPYTHON_VM_STATS (0)
+#endif
+
+// Whether to provide the "micropython.alloc_trace_start", "alloc_trace_stop",
+// "alloc_trace_dump" and "heap_snapshot" functions, to sample heap
+// allocations with the code that made them and to summarise the live heap by
+// type.  The allocating code is found from the frames kept for the sampling
+// profiler, so this needs MICROPY_PY_MICROPYTHON_PROFILE.
+#ifndef MICROPY_PY_MICROPYTHON_HEAP_TRACE
+#define MICROPY_PY_MICROPYTHON_HEAP_TRACE (0)
+#endif
+
 // Whether to provide "array" module. Note that large chunk of the
 // underlying code is shared with "bytearray" builtin type, so to
 // get real savings, it should be disabled too.
@@ -1131,6 +1232,17 @@ typedef double mp_float_t;
 #define MICROPY_PY_STRUCT (1)
 #endif
 
+// Whether struct formats are compiled into a list of fields, provided as
+// "struct.Struct" objects and cached for the module-level functions
+#ifndef MICROPY_PY_STRUCT_COMPILED
+#define MICROPY_PY_STRUCT_COMPILED (0)
+#endif
+
+// Number of compiled formats cached for the module-level struct functions
+#ifndef MICROPY_PY_STRUCT_CACHE_SIZE
+#define MICROPY_PY_STRUCT_CACHE_SIZE (4)
+#endif
+
 // Whether to provide "sys" module
 #ifndef MICROPY_PY_SYS
 #define MICROPY_PY_SYS (1)
@@ -1348,6 +1460,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_BTREE (0)
 #endif
 
+// Whether to provide the "arrayops" module, elementwise operations and
+// reductions over arrays; depends on MICROPY_PY_ARRAY
+#ifndef MICROPY_PY_ARRAYOPS
+#define MICROPY_PY_ARRAYOPS (0)
+#endif
+
 /*****************************************************************************/
 /* Hooks for a port to add builtins                                          */
 
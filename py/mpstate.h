@@ -42,11 +42,17 @@
 
 // This structure contains dynamic configuration for the compiler.
 #if MICROPY_DYNAMIC_COMPILER
+struct _scope_t;
 typedef struct mp_dynamic_compiler_t {
     uint8_t small_int_bits; // must be <= host small_int_bits
     bool opt_cache_map_lookup_in_bytecode;
     bool py_builtins_str_unicode;
     uint8_t native_arch;
+    // compile native scopes that the native emitter can't handle as bytecode
+    bool native_fallback;
+    // if non-NULL, called for each function without a built-in decorator to
+    // choose its emitter; parent is the enclosing scope, name the function name
+    uint (*select_emit)(const struct _scope_t *parent, qstr name, uint emit_opt);
 } mp_dynamic_compiler_t;
 extern mp_dynamic_compiler_t mp_dynamic_compiler;
 #endif
@@ -93,6 +99,11 @@ typedef struct _mp_state_mem_t {
 
     size_t gc_last_free_atb_index;
 
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    mp_int_t heap_trace_countdown; // bytes left to allocate until the next sample
+    void *heap_trace_pending; // sampled block whose type is not yet known
+    #endif
+
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
@@ -183,6 +194,36 @@ typedef struct _mp_state_vm_t {
     struct _mp_vfs_mount_t *vfs_mount_table;
     #endif
 
+    #if MICROPY_MODULE_IMPORT_CACHE
+    // dict of directory path -> listing (tuple) used to resolve imports
+    mp_obj_t import_cache;
+    #endif
+
+    #if MICROPY_MODULE_COMPILE_CACHE
+    // directory where code compiled from imported .py files is saved, or None
+    mp_obj_t compile_cache_dir;
+    #endif
+
+    #if MICROPY_PY_STRUCT_COMPILED
+    // Struct objects compiled from the formats last given to ustruct functions
+    mp_obj_t struct_cache[MICROPY_PY_STRUCT_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    // ring of profile samples, written by mp_profile_sample()
+    struct _mp_profile_sample_t *profile_ring;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_VM_STATS
+    // hash table of the bytecode functions seen by the VM, see py/vmstats.c
+    struct _mp_vm_stats_fun_t *vm_stats_funs;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    // ring of allocation samples, written by mp_heap_trace_alloc()
+    struct _mp_heap_trace_sample_t *heap_trace_ring;
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -202,6 +243,37 @@ typedef struct _mp_state_vm_t {
     mp_uint_t mp_optimise_value;
     #endif
 
+    #if MICROPY_MODULE_IMPORT_CACHE
+    volatile bool import_cache_stale;
+    mp_uint_t import_cache_gen;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    size_t profile_ring_len;
+    volatile size_t profile_count; // number of samples written to the ring
+    volatile bool profile_active;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_VM_STATS
+    size_t vm_stats_funs_alloc;
+    size_t vm_stats_funs_used;
+    mp_uint_t vm_stats_op[256];
+    mp_uint_t vm_stats_op_pair[256][256]; // indexed by previous opcode, then opcode
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    size_t heap_trace_ring_len;
+    size_t heap_trace_count; // number of samples written to the ring
+    size_t heap_trace_interval; // bytes allocated between samples
+    bool heap_trace_active;
+    #endif
+
+    #if MICROPY_MODULE_COMPILE_CACHE
+    mp_uint_t compile_cache_hits;
+    mp_uint_t compile_cache_misses;
+    mp_uint_t compile_cache_saves;
+    #endif
+
     // size of the emergency exception buf, if it's dynamically allocated
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0
     mp_int_t mp_emergency_exception_buf_size;
@@ -235,6 +307,11 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    // innermost bytecode function being run, for the sampling profiler
+    volatile struct _mp_profile_frame_t *volatile profile_frame;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -39,6 +39,14 @@
 #define DEBUG_printf(...) (void)0
 #endif
 
+#if MICROPY_EMIT_NATIVE_FLOAT
+// viper float values are held unboxed in a machine word
+typedef union _mp_native_float_t {
+    mp_float_t f;
+    mp_uint_t u;
+} mp_native_float_t;
+#endif
+
 #if MICROPY_EMIT_NATIVE
 
 int mp_native_type_from_qstr(qstr qst) {
@@ -51,6 +59,9 @@ int mp_native_type_from_qstr(qstr qst) {
         case MP_QSTR_ptr8: return MP_NATIVE_TYPE_PTR8;
         case MP_QSTR_ptr16: return MP_NATIVE_TYPE_PTR16;
         case MP_QSTR_ptr32: return MP_NATIVE_TYPE_PTR32;
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case MP_QSTR_float: return MP_NATIVE_TYPE_FLOAT;
+        #endif
         default: return -1;
     }
 }
@@ -62,7 +73,19 @@ mp_uint_t mp_native_from_obj(mp_obj_t obj, mp_uint_t type) {
         case MP_NATIVE_TYPE_OBJ: return (mp_uint_t)obj;
         case MP_NATIVE_TYPE_BOOL: return mp_obj_is_true(obj);
         case MP_NATIVE_TYPE_INT:
-        case MP_NATIVE_TYPE_UINT: return mp_obj_get_int_truncated(obj);
+        case MP_NATIVE_TYPE_UINT:
+            #if MICROPY_EMIT_NATIVE_FLOAT
+            if (mp_obj_is_float(obj)) {
+                return (mp_int_t)mp_obj_float_get(obj);
+            }
+            #endif
+            return mp_obj_get_int_truncated(obj);
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case MP_NATIVE_TYPE_FLOAT: {
+            mp_native_float_t val = {.f = mp_obj_get_float(obj)};
+            return val.u;
+        }
+        #endif
         default: { // cast obj to a pointer
             mp_buffer_info_t bufinfo;
             if (mp_get_buffer(obj, &bufinfo, MP_BUFFER_RW)) {
@@ -87,6 +110,12 @@ mp_obj_t mp_native_to_obj(mp_uint_t val, mp_uint_t type) {
         case MP_NATIVE_TYPE_BOOL: return mp_obj_new_bool(val);
         case MP_NATIVE_TYPE_INT: return mp_obj_new_int(val);
         case MP_NATIVE_TYPE_UINT: return mp_obj_new_int_from_uint(val);
+        #if MICROPY_EMIT_NATIVE_FLOAT
+        case MP_NATIVE_TYPE_FLOAT: {
+            mp_native_float_t x = {.u = val};
+            return mp_obj_new_float(x.f);
+        }
+        #endif
         default: // a pointer
             // we return just the value of the pointer as an integer
             return mp_obj_new_int_from_uint(val);
@@ -187,6 +216,36 @@ STATIC bool mp_native_yield_from(mp_obj_t gen, mp_obj_t send_value, mp_obj_t *re
     return false;
 }
 
+#if MICROPY_EMIT_NATIVE_FLOAT
+// binary op on unboxed viper floats; comparisons return a native bool
+STATIC mp_uint_t mp_native_float_binary_op(mp_binary_op_t op, mp_uint_t lhs_in, mp_uint_t rhs_in) {
+    MP_STATIC_ASSERT(sizeof(mp_float_t) == sizeof(mp_uint_t));
+    mp_native_float_t lhs = {.u = lhs_in};
+    mp_native_float_t rhs = {.u = rhs_in};
+    switch (op) {
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD: lhs.f += rhs.f; break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT: lhs.f -= rhs.f; break;
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY: lhs.f *= rhs.f; break;
+        case MP_BINARY_OP_LESS: return lhs.f < rhs.f;
+        case MP_BINARY_OP_MORE: return lhs.f > rhs.f;
+        case MP_BINARY_OP_EQUAL: return lhs.f == rhs.f;
+        case MP_BINARY_OP_LESS_EQUAL: return lhs.f <= rhs.f;
+        case MP_BINARY_OP_MORE_EQUAL: return lhs.f >= rhs.f;
+        case MP_BINARY_OP_NOT_EQUAL: return lhs.f != rhs.f;
+        default: {
+            // division, power, etc: use the float object implementation so
+            // that errors and corner cases match the non-viper behaviour
+            mp_obj_t res = mp_binary_op(op, mp_obj_new_float(lhs.f), mp_obj_new_float(rhs.f));
+            return mp_native_from_obj(res, MP_NATIVE_TYPE_FLOAT);
+        }
+    }
+    return lhs.u;
+}
+#endif
+
 // these must correspond to the respective enum in runtime0.h
 const void *const mp_fun_table[MP_F_NUMBER_OF] = {
     &mp_const_none_obj,
@@ -243,6 +302,9 @@ const void *const mp_fun_table[MP_F_NUMBER_OF] = {
     mp_small_int_floor_divide,
     mp_small_int_modulo,
     mp_native_yield_from,
+#if MICROPY_EMIT_NATIVE_FLOAT
+    mp_native_float_binary_op,
+#endif
 };
 
 /*
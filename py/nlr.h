@@ -83,6 +83,10 @@ struct _nlr_buf_t {
     #if MICROPY_ENABLE_PYSTACK
     void *pystack;
     #endif
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    volatile void *profile_frame;
+    #endif
 };
 
 // Helper macros to save/restore the pystack state
@@ -94,6 +98,16 @@ struct _nlr_buf_t {
 #define MP_NLR_RESTORE_PYSTACK(nlr_buf) (void)nlr_buf
 #endif
 
+// Helper macros to save/restore the innermost frame seen by the profiler, so
+// that frames jumped out of are dropped from it
+#if MICROPY_PY_MICROPYTHON_PROFILE
+#define MP_NLR_SAVE_PROFILE_FRAME(nlr_buf) (nlr_buf)->profile_frame = MP_STATE_THREAD(profile_frame)
+#define MP_NLR_RESTORE_PROFILE_FRAME(nlr_buf) MP_STATE_THREAD(profile_frame) = (nlr_buf)->profile_frame
+#else
+#define MP_NLR_SAVE_PROFILE_FRAME(nlr_buf) (void)nlr_buf
+#define MP_NLR_RESTORE_PROFILE_FRAME(nlr_buf) (void)nlr_buf
+#endif
+
 // Helper macro to use at the start of a specific nlr_jump implementation
 #define MP_NLR_JUMP_HEAD(val, top) \
     nlr_buf_t **_top_ptr = &MP_STATE_THREAD(nlr_top); \
@@ -103,6 +117,7 @@ struct _nlr_buf_t {
     } \
     top->ret_val = val; \
     MP_NLR_RESTORE_PYSTACK(top); \
+    MP_NLR_RESTORE_PROFILE_FRAME(top); \
     *_top_ptr = top->prev; \
 
 #if MICROPY_NLR_SETJMP
@@ -122,7 +122,7 @@ NORETURN void nlr_jump(void *val) {
     "bx     lr                  \n" // return
     :                               // output operands
     : "r"(top)                      // input operands
-    :                               // clobbered registers
+    : "memory"                      // clobbered: memory, so the stores above are not dropped
     );
 
     #if defined(__GNUC__)
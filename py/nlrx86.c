@@ -97,7 +97,7 @@ NORETURN void nlr_jump(void *val) {
     "ret                        \n" // return
     :                               // output operands
     : "r"(top)                      // input operands
-    :                               // clobbered registers
+    : "memory"                      // clobbered: memory, so the stores above are not dropped
     );
 
     for (;;); // needed to silence compiler warning
@@ -609,6 +609,13 @@ mp_obj_t mp_obj_new_bytearray_by_ref(size_t n, void *items) {
 }
 #endif
 
+#if MICROPY_PY_ARRAY
+// Create array of n items, whose values are left uninitialised
+mp_obj_t mp_obj_new_array(char typecode, size_t n) {
+    return MP_OBJ_FROM_PTR(array_new(typecode, n));
+}
+#endif
+
 /******************************************************************************/
 // array iterator
 
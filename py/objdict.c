@@ -221,6 +221,21 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_clear_obj, dict_clear);
 STATIC mp_obj_t dict_copy(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    if (self->map.is_indexed) {
+        // the table holds deleted entries and an index, so add the live ones afresh
+        mp_obj_t other_out = mp_obj_new_dict(0);
+        mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
+        other->base.type = self->base.type;
+        other->map.is_ordered = 1;
+        size_t cur = 0;
+        mp_map_elem_t *elem = NULL;
+        while ((elem = dict_iter_next(self, &cur)) != NULL) {
+            mp_map_lookup(&other->map, elem->key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = elem->value;
+        }
+        return other_out;
+    }
+    #endif
     mp_obj_t other_out = mp_obj_new_dict(self->map.alloc);
     mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
     other->base.type = self->base.type;
@@ -327,4 +327,38 @@ mp_obj_t mp_obj_float_binary_op(mp_binary_op_t op, mp_float_t lhs_val, mp_obj_t
     return mp_obj_new_float(lhs_val);
 }
 
+#if MICROPY_OPT_FLOAT_TEMP_REUSE
+// Store the result of lhs_in op rhs_in into dest, a float that nothing else
+// references.  Only handles the ops that can't fail on float/int operands;
+// returns false (leaving dest untouched) if the caller must use mp_binary_op.
+bool mp_obj_float_binary_op_into(mp_obj_t dest, mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    mp_float_t lhs_val, rhs_val;
+    if (!mp_obj_get_float_maybe(lhs_in, &lhs_val) || !mp_obj_get_float_maybe(rhs_in, &rhs_val)) {
+        return false;
+    }
+
+    switch (op) {
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD: lhs_val += rhs_val; break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT: lhs_val -= rhs_val; break;
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY: lhs_val *= rhs_val; break;
+        case MP_BINARY_OP_TRUE_DIVIDE:
+        case MP_BINARY_OP_INPLACE_TRUE_DIVIDE:
+            if (rhs_val == 0) {
+                return false; // let the general path raise ZeroDivisionError
+            }
+            lhs_val /= rhs_val;
+            break;
+        default:
+            return false;
+    }
+
+    mp_obj_float_t *o = MP_OBJ_TO_PTR(dest);
+    o->value = lhs_val;
+    return true;
+}
+#endif
+
 #endif // MICROPY_PY_BUILTINS_FLOAT
@@ -215,6 +215,9 @@ typedef struct _rule_stack_t {
 
 typedef struct _mp_parse_chunk_t {
     size_t alloc;
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    size_t region;
+    #endif
     union {
         size_t used;
         struct _mp_parse_chunk_t *next;
@@ -236,6 +239,14 @@ typedef struct _parser_t {
     mp_parse_tree_t tree;
     mp_parse_chunk_t *cur_chunk;
 
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    // each def and class gets its own region of chunks, nested in the enclosing one
+    size_t cur_region;
+    size_t region_stack_alloc;
+    size_t region_stack_top;
+    size_t *region_stack;
+    #endif
+
     #if MICROPY_COMP_CONST
     mp_map_t consts;
     #endif
@@ -249,6 +260,36 @@ STATIC const uint16_t *get_rule_arg(uint8_t r_id) {
     return &rule_arg_combined_table[off];
 }
 
+// shrink the current chunk to fit and link it into the chain of chunks
+STATIC void parser_close_chunk(parser_t *parser) {
+    mp_parse_chunk_t *chunk = parser->cur_chunk;
+    if (chunk != NULL) {
+        (void)m_renew_maybe(byte, chunk, sizeof(mp_parse_chunk_t) + chunk->alloc,
+            sizeof(mp_parse_chunk_t) + chunk->union_.used, false);
+        chunk->alloc = chunk->union_.used;
+        chunk->union_.next = parser->tree.chunk;
+        parser->tree.chunk = chunk;
+        parser->cur_chunk = NULL;
+    }
+}
+
+#if MICROPY_COMP_FREE_PARSE_TREE
+STATIC void parser_enter_region(parser_t *parser) {
+    if (parser->region_stack_top >= parser->region_stack_alloc) {
+        parser->region_stack = m_renew(size_t, parser->region_stack, parser->region_stack_alloc, parser->region_stack_alloc + 4);
+        parser->region_stack_alloc += 4;
+    }
+    parser_close_chunk(parser);
+    parser->region_stack[parser->region_stack_top++] = parser->cur_region;
+    parser->cur_region = parser->tree.num_regions++;
+}
+
+STATIC void parser_leave_region(parser_t *parser) {
+    parser_close_chunk(parser);
+    parser->cur_region = parser->region_stack[--parser->region_stack_top];
+}
+#endif
+
 STATIC void *parser_alloc(parser_t *parser, size_t num_bytes) {
     // use a custom memory allocator to store parse nodes sequentially in large chunks
 
@@ -261,11 +302,7 @@ STATIC void *parser_alloc(parser_t *parser, size_t num_bytes) {
             sizeof(mp_parse_chunk_t) + chunk->alloc + num_bytes, false);
         if (new_data == NULL) {
             // could not grow existing memory; shrink it to fit previous
-            (void)m_renew_maybe(byte, chunk, sizeof(mp_parse_chunk_t) + chunk->alloc,
-                sizeof(mp_parse_chunk_t) + chunk->union_.used, false);
-            chunk->alloc = chunk->union_.used;
-            chunk->union_.next = parser->tree.chunk;
-            parser->tree.chunk = chunk;
+            parser_close_chunk(parser);
             chunk = NULL;
         } else {
             // could grow existing memory
@@ -281,6 +318,9 @@ STATIC void *parser_alloc(parser_t *parser, size_t num_bytes) {
         }
         chunk = (mp_parse_chunk_t*)m_new(byte, sizeof(mp_parse_chunk_t) + alloc);
         chunk->alloc = alloc;
+        #if MICROPY_COMP_FREE_PARSE_TREE
+        chunk->region = parser->cur_region;
+        #endif
         chunk->union_.used = 0;
         parser->cur_chunk = chunk;
     }
@@ -848,6 +888,14 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     parser.tree.chunk = NULL;
     parser.cur_chunk = NULL;
 
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    parser.tree.num_regions = 1;
+    parser.cur_region = 0;
+    parser.region_stack_alloc = 0;
+    parser.region_stack_top = 0;
+    parser.region_stack = NULL;
+    #endif
+
     #if MICROPY_COMP_CONST
     mp_map_init(&parser.consts, 0);
     #endif
@@ -917,6 +965,16 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
 
             case RULE_ACT_AND: {
 
+                #if MICROPY_COMP_FREE_PARSE_TREE
+                // the nodes of a def or class go in their own region, so the
+                // compiler can free them once the function or class is compiled
+                if (i == 0 && !backtrack
+                    && ((rule_id == RULE_funcdef && lex->tok_kind == MP_TOKEN_KW_DEF)
+                        || (rule_id == RULE_classdef && lex->tok_kind == MP_TOKEN_KW_CLASS))) {
+                    parser_enter_region(&parser);
+                }
+                #endif
+
                 // failed, backtrack if we can, else syntax error
                 if (backtrack) {
                     assert(i > 0);
@@ -1026,6 +1084,12 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     }
 
                     push_result_rule(&parser, rule_src_line, rule_id, i);
+
+                    #if MICROPY_COMP_FREE_PARSE_TREE
+                    if (rule_id == RULE_funcdef || rule_id == RULE_classdef) {
+                        parser_leave_region(&parser);
+                    }
+                    #endif
                 }
                 break;
             }
@@ -1124,15 +1188,11 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     #endif
 
     // truncate final chunk and link into chain of chunks
-    if (parser.cur_chunk != NULL) {
-        (void)m_renew_maybe(byte, parser.cur_chunk,
-            sizeof(mp_parse_chunk_t) + parser.cur_chunk->alloc,
-            sizeof(mp_parse_chunk_t) + parser.cur_chunk->union_.used,
-            false);
-        parser.cur_chunk->alloc = parser.cur_chunk->union_.used;
-        parser.cur_chunk->union_.next = parser.tree.chunk;
-        parser.tree.chunk = parser.cur_chunk;
-    }
+    parser_close_chunk(&parser);
+
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    m_del(size_t, parser.region_stack, parser.region_stack_alloc);
+    #endif
 
     if (
         lex->tok_kind != MP_TOKEN_END // check we are at the end of the token stream
@@ -1170,6 +1230,32 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     return parser.tree;
 }
 
+#if MICROPY_COMP_FREE_PARSE_TREE
+size_t mp_parse_tree_find_region(mp_parse_tree_t *tree, mp_parse_node_t pn) {
+    if (MP_PARSE_NODE_IS_STRUCT(pn)) {
+        for (mp_parse_chunk_t *chunk = tree->chunk; chunk != NULL; chunk = chunk->union_.next) {
+            if ((byte*)pn >= chunk->data && (byte*)pn < chunk->data + chunk->alloc) {
+                return chunk->region;
+            }
+        }
+    }
+    return 0;
+}
+
+void mp_parse_tree_free_region(mp_parse_tree_t *tree, size_t region) {
+    mp_parse_chunk_t **link = &tree->chunk;
+    while (*link != NULL) {
+        mp_parse_chunk_t *chunk = *link;
+        if (chunk->region == region) {
+            *link = chunk->union_.next;
+            m_del(byte, chunk, sizeof(mp_parse_chunk_t) + chunk->alloc);
+        } else {
+            link = &chunk->union_.next;
+        }
+    }
+}
+#endif
+
 void mp_parse_tree_clear(mp_parse_tree_t *tree) {
     mp_parse_chunk_t *chunk = tree->chunk;
     while (chunk != NULL) {
@@ -97,6 +97,9 @@ typedef enum {
 typedef struct _mp_parse_t {
     mp_parse_node_t root;
     struct _mp_parse_chunk_t *chunk;
+    #if MICROPY_COMP_FREE_PARSE_TREE
+    size_t num_regions; // region 0 is the top level, then one for each def and class
+    #endif
 } mp_parse_tree_t;
 
 // the parser will raise an exception if an error occurred
@@ -104,4 +107,10 @@ typedef struct _mp_parse_t {
 mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
 void mp_parse_tree_clear(mp_parse_tree_t *tree);
 
+#if MICROPY_COMP_FREE_PARSE_TREE
+// for freeing the nodes of each def and class as soon as it is compiled
+size_t mp_parse_tree_find_region(mp_parse_tree_t *tree, mp_parse_node_t pn);
+void mp_parse_tree_free_region(mp_parse_tree_t *tree, size_t region);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_PARSE_H
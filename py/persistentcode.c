@@ -182,6 +182,7 @@ STATIC void extract_prelude(const byte **ip, const byte **ip2, bytecode_prelude_
 #if MICROPY_PERSISTENT_CODE_LOAD
 
 #include "py/parsenum.h"
+#include "py/objstr.h"
 
 #if MICROPY_EMIT_NATIVE
 
@@ -224,6 +225,11 @@ STATIC int read_byte(mp_reader_t *reader) {
 }
 
 STATIC void read_bytes(mp_reader_t *reader, byte *buf, size_t len) {
+    const byte *src = mp_reader_mem_take(reader, len, NULL);
+    if (src != NULL) {
+        memcpy(buf, src, len);
+        return;
+    }
     while (len-- > 0) {
         *buf++ = reader->readbyte(reader->data);
     }
@@ -256,10 +262,17 @@ STATIC qstr load_qstr(mp_reader_t *reader, qstr_window_t *qw) {
         return qstr_window_access(qw, len >> 1);
     }
     len >>= 1;
-    char *str = m_new(char, len);
-    read_bytes(reader, (byte*)str, len);
-    qstr qst = qstr_from_strn(str, len);
-    m_del(char, str, len);
+    qstr qst;
+    const char *src = (const char*)mp_reader_mem_take(reader, len, NULL);
+    if (src != NULL) {
+        // intern straight from the reader's memory, no temporary copy
+        qst = qstr_from_strn(src, len);
+    } else {
+        char *str = m_new(char, len);
+        read_bytes(reader, (byte*)str, len);
+        qst = qstr_from_strn(str, len);
+        m_del(char, str, len);
+    }
     qstr_window_push(qw, qst);
     return qst;
 }
@@ -270,6 +283,34 @@ STATIC mp_obj_t load_obj(mp_reader_t *reader) {
         return MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj);
     } else {
         size_t len = read_uint(reader, NULL);
+        bool is_static;
+        const byte *src = mp_reader_mem_take(reader, len, &is_static);
+        if (src != NULL) {
+            // data is directly addressable so parse it in place
+            if (obj_type == 's' || obj_type == 'b') {
+                const mp_obj_type_t *type = obj_type == 's' ? &mp_type_str : &mp_type_bytes;
+                #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+                if (is_static && obj_type == 'b') {
+                    // reference the data without copying it to the heap; str
+                    // data is always copied because it must be NUL terminated
+                    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+                    o->base.type = type;
+                    o->len = len;
+                    o->hash = qstr_compute_hash(src, len);
+                    o->data = src;
+                    return MP_OBJ_FROM_PTR(o);
+                }
+                #else
+                (void)is_static;
+                #endif
+                return mp_obj_new_str_copy(type, src, len);
+            } else if (obj_type == 'i') {
+                return mp_parse_num_integer((const char*)src, len, 10, NULL);
+            } else {
+                assert(obj_type == 'f' || obj_type == 'c');
+                return mp_parse_num_decimal((const char*)src, len, obj_type == 'c', false, NULL);
+            }
+        }
         vstr_t vstr;
         vstr_init_len(&vstr, len);
         read_bytes(reader, (byte*)vstr.buf, len);
@@ -337,7 +378,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     byte *ip2;
     bytecode_prelude_t prelude = {0};
     #if MICROPY_EMIT_NATIVE
-    size_t prelude_offset;
+    size_t prelude_offset = 0;
     mp_uint_t type_sig = 0;
     size_t n_qstr_link = 0;
     #endif
@@ -405,12 +446,14 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     }
 
     mp_uint_t *const_table = NULL;
+    size_t n_obj = 0;
+    size_t n_raw_code = 0;
     if (kind != MP_CODE_NATIVE_ASM) {
         // Load constant table for bytecode, native and viper
 
         // Number of entries in constant table
-        size_t n_obj = read_uint(reader, NULL);
-        size_t n_raw_code = read_uint(reader, NULL);
+        n_obj = read_uint(reader, NULL);
+        n_raw_code = read_uint(reader, NULL);
 
         // Allocate constant table
         size_t n_alloc = prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code;
@@ -474,7 +517,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     return rc;
 }
 
-mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+STATIC mp_raw_code_t *raw_code_load(mp_reader_t *reader) {
     byte header[4];
     read_bytes(reader, header, sizeof(header));
     if (header[0] != 'M'
@@ -490,9 +533,21 @@ mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
     }
     qstr_window_t qw;
     qw.idx = 0;
-    mp_raw_code_t *rc = load_raw_code(reader, &qw);
-    reader->close(reader->data);
-    return rc;
+    return load_raw_code(reader, &qw);
+}
+
+mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+    // the reader is closed whether or not loading succeeds
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_raw_code_t *rc = raw_code_load(reader);
+        nlr_pop();
+        reader->close(reader->data);
+        return rc;
+    } else {
+        reader->close(reader->data);
+        nlr_jump(nlr.ret_val);
+    }
 }
 
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
@@ -501,9 +556,45 @@ mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
     return mp_raw_code_load(&reader);
 }
 
+mp_raw_code_t *mp_raw_code_load_mapped(const byte *buf, size_t len) {
+    mp_reader_t reader;
+    mp_reader_new_mem_static(&reader, buf, len);
+    return mp_raw_code_load(&reader);
+}
+
 #if MICROPY_HAS_FILE_READER
 
+#if MICROPY_PERSISTENT_CODE_LOAD_MAPPED && MICROPY_READER_POSIX
+mp_raw_code_t *mp_raw_code_load_file_mapped(const char *filename, const byte *prefix, size_t prefix_len) {
+    size_t len;
+    const byte *buf = mp_reader_map_file(filename, &len);
+    if (buf == NULL) {
+        return NULL;
+    }
+    if (len < prefix_len || memcmp(buf, prefix, prefix_len) != 0) {
+        mp_reader_unmap_file(buf, len);
+        return NULL;
+    }
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // the code references the mapping, so it is never unmapped
+        mp_raw_code_t *rc = mp_raw_code_load_mapped(buf + prefix_len, len - prefix_len);
+        nlr_pop();
+        return rc;
+    } else {
+        mp_reader_unmap_file(buf, len);
+        nlr_jump(nlr.ret_val);
+    }
+}
+#endif
+
 mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
+    #if MICROPY_PERSISTENT_CODE_LOAD_MAPPED && MICROPY_READER_POSIX
+    mp_raw_code_t *rc = mp_raw_code_load_file_mapped(filename, NULL, 0);
+    if (rc != NULL) {
+        return rc;
+    }
+    #endif
     mp_reader_t reader;
     mp_reader_new_file(&reader, filename);
     return mp_raw_code_load(&reader);
@@ -750,6 +841,7 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
 
 #if defined(__i386__) || defined(__x86_64__) || defined(__unix__)
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -767,6 +859,46 @@ void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
     close(fd);
 }
 
+bool mp_raw_code_save_file_prefixed(mp_raw_code_t *rc, const char *filename, const byte *prefix, size_t prefix_len) {
+    // create the directory of the file if it doesn't exist
+    const char *sep = strrchr(filename, '/');
+    if (sep != NULL && sep != filename) {
+        vstr_t dir;
+        vstr_init(&dir, sep - filename + 1);
+        vstr_add_strn(&dir, filename, sep - filename);
+        mkdir(vstr_null_terminated_str(&dir), 0755);
+        vstr_clear(&dir);
+    }
+
+    // write to a temporary file and rename it into place, so that code which
+    // was loaded (maybe mapped) from an older version of the file is unaffected;
+    // the temporary name is unique so concurrent saves of one file don't mix
+    vstr_t tmp;
+    vstr_init(&tmp, strlen(filename) + 8);
+    vstr_printf(&tmp, "%s.XXXXXX", filename);
+    char *tmp_str = vstr_null_terminated_str(&tmp);
+    int fd = mkstemp(tmp_str);
+    if (fd < 0) {
+        vstr_clear(&tmp);
+        return false;
+    }
+    fchmod(fd, 0644);
+    // build the whole file in memory so it's written with a single call
+    vstr_t buf;
+    mp_print_t buf_print;
+    vstr_init_print(&buf, 256, &buf_print);
+    mp_print_bytes(&buf_print, prefix, prefix_len);
+    mp_raw_code_save(rc, &buf_print);
+    bool ok = write(fd, buf.buf, buf.len) == (ssize_t)buf.len;
+    vstr_clear(&buf);
+    if (close(fd) != 0 || !ok || rename(tmp_str, filename) != 0) {
+        unlink(tmp_str);
+        ok = false;
+    }
+    vstr_clear(&tmp);
+    return ok;
+}
+
 #else
 #error mp_raw_code_save_file not implemented for this platform
 #endif
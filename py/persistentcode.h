@@ -48,9 +48,18 @@ enum {
 
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
+// buf must stay valid for as long as the loaded code is alive (eg flash)
+mp_raw_code_t *mp_raw_code_load_mapped(const byte *buf, size_t len);
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
+// mmap the file and load the code after its first prefix_len bytes, returning
+// NULL if it can't be mapped or doesn't start with prefix; the mapping is kept
+// for as long as the program runs
+mp_raw_code_t *mp_raw_code_load_file_mapped(const char *filename, const byte *prefix, size_t prefix_len);
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename);
+// Save to a file after prefix_len bytes of prefix, creating the directory of
+// the file if needed and replacing any existing file whole; false on failure
+bool mp_raw_code_save_file_prefixed(mp_raw_code_t *rc, const char *filename, const byte *prefix, size_t prefix_len);
 
 #endif // MICROPY_INCLUDED_PY_PERSISTENTCODE_H
@@ -0,0 +1,157 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/objlist.h"
+#include "py/profile.h"
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+typedef struct _mp_profile_loc_t {
+    qstr block_name;
+    qstr source_file;
+    size_t line;
+} mp_profile_loc_t;
+
+// One sampled stack, with the innermost function first
+typedef struct _mp_profile_sample_t {
+    uint16_t n_frames;
+    bool truncated; // whether there were more than n_frames outer functions
+    mp_profile_loc_t frames[MICROPY_PY_MICROPYTHON_PROFILE_DEPTH];
+} mp_profile_sample_t;
+
+void mp_profile_start(mp_uint_t period_us, size_t ring_len) {
+    mp_profile_stop();
+    // allocate the new ring before sampling starts, because the sampler
+    // cannot allocate from an interrupt; the old ring is dropped first so
+    // that a failed allocation leaves an empty profile behind
+    MP_STATE_VM(profile_count) = 0;
+    MP_STATE_VM(profile_ring_len) = 0;
+    MP_STATE_VM(profile_ring) = NULL;
+    MP_STATE_VM(profile_ring) = m_new(mp_profile_sample_t, ring_len);
+    MP_STATE_VM(profile_ring_len) = ring_len;
+    MP_STATE_VM(profile_active) = true;
+    mp_hal_profile_timer(period_us);
+}
+
+void mp_profile_stop(void) {
+    mp_hal_profile_timer(0);
+    MP_STATE_VM(profile_active) = false;
+}
+
+void mp_profile_sample(void) {
+    if (!MP_STATE_VM(profile_active)) {
+        return;
+    }
+    volatile mp_profile_frame_t *f = MP_STATE_THREAD(profile_frame);
+    if (f == NULL) {
+        // not running bytecode, eg the REPL is waiting for input
+        return;
+    }
+    size_t count = MP_STATE_VM(profile_count);
+    mp_profile_sample_t *s = &MP_STATE_VM(profile_ring)[count % MP_STATE_VM(profile_ring_len)];
+    size_t n = 0;
+    for (; f != NULL && n < MICROPY_PY_MICROPYTHON_PROFILE_DEPTH; f = f->prev, ++n) {
+        mp_code_state_t *code_state = f->code_state;
+        mp_profile_loc_t *loc = &s->frames[n];
+        mp_bytecode_get_source(code_state->fun_bc->bytecode, code_state->ip,
+            &loc->block_name, &loc->source_file, &loc->line);
+    }
+    s->n_frames = n;
+    s->truncated = f != NULL;
+    MP_STATE_VM(profile_count) = count + 1;
+}
+
+STATIC void profile_dump_samples(const mp_print_t *print) {
+    size_t n_samples = MP_STATE_VM(profile_count);
+    if (n_samples > MP_STATE_VM(profile_ring_len)) {
+        n_samples = MP_STATE_VM(profile_ring_len);
+    }
+
+    // count the samples of each distinct stack, keyed by its folded form
+    mp_obj_t counts = mp_obj_new_dict(0);
+    mp_map_t *map = mp_obj_dict_get_map(counts);
+    vstr_t vstr;
+    mp_print_t vstr_print;
+    vstr_init_print(&vstr, 64, &vstr_print);
+    for (size_t i = 0; i < n_samples; ++i) {
+        const mp_profile_sample_t *s = &MP_STATE_VM(profile_ring)[i];
+        vstr_reset(&vstr);
+        if (s->truncated) {
+            vstr_add_str(&vstr, "...;");
+        }
+        for (size_t j = s->n_frames; j-- > 0;) {
+            const mp_profile_loc_t *loc = &s->frames[j];
+            mp_printf(&vstr_print, "%q (%q:%u)%s", loc->block_name, loc->source_file,
+                (uint)loc->line, j > 0 ? ";" : "");
+        }
+        mp_obj_t key = mp_obj_new_str(vstr.buf, vstr.len);
+        mp_map_elem_t *elem = mp_map_lookup(map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+        if (elem->value == MP_OBJ_NULL) {
+            elem->value = MP_OBJ_NEW_SMALL_INT(1);
+        } else {
+            elem->value = MP_OBJ_NEW_SMALL_INT(MP_OBJ_SMALL_INT_VALUE(elem->value) + 1);
+        }
+    }
+    vstr_clear(&vstr);
+
+    // print the stacks in sorted order so that the output is stable
+    mp_obj_t keys = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i)) {
+            mp_obj_list_append(keys, map->table[i].key);
+        }
+    }
+    mp_obj_list_sort(1, &keys, (mp_map_t*)&mp_const_empty_map);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(keys, &len, &items);
+    for (size_t i = 0; i < len; ++i) {
+        size_t key_len;
+        const char *key = mp_obj_str_get_data(items[i], &key_len);
+        mp_printf(print, "%.*s %d\n", (int)key_len, key,
+            (int)MP_OBJ_SMALL_INT_VALUE(mp_obj_dict_get(counts, items[i])));
+    }
+}
+
+void mp_profile_dump(const mp_print_t *print) {
+    // pause sampling so the ring doesn't change under us
+    bool active = MP_STATE_VM(profile_active);
+    MP_STATE_VM(profile_active) = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        profile_dump_samples(print);
+        nlr_pop();
+        MP_STATE_VM(profile_active) = active;
+    } else {
+        MP_STATE_VM(profile_active) = active;
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+#endif // MICROPY_PY_MICROPYTHON_PROFILE
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_PROFILE_H
+#define MICROPY_INCLUDED_PY_PROFILE_H
+
+#include "py/bc.h"
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+// Each call of mp_execute_bytecode() links one of these into the list at
+// MP_STATE_THREAD(profile_frame) while it runs, so that the sampler can walk
+// the stack of bytecode functions from an interrupt.  The fields are written
+// before the frame is linked in, which the volatile qualifiers keep in order.
+typedef struct _mp_profile_frame_t {
+    volatile struct _mp_profile_frame_t *prev;
+    mp_code_state_t *code_state;
+} mp_profile_frame_t;
+
+// Start sampling every period_us microseconds, into a new ring of the given
+// number (at least 1) of samples.
+void mp_profile_start(mp_uint_t period_us, size_t ring_len);
+void mp_profile_stop(void);
+
+// Record the stack of the function being run; call from the timer interrupt.
+void mp_profile_sample(void);
+
+// Print the samples in the ring as folded stacks, one line per distinct
+// stack, with its frames outermost first separated by ";" and then its count.
+void mp_profile_dump(const mp_print_t *print);
+
+// Must be provided by the port: call mp_profile_sample() every period_us
+// microseconds of run time, or stop doing so if period_us is 0.
+void mp_hal_profile_timer(mp_uint_t period_us);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_PROFILE_H
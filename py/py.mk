@@ -251,6 +251,9 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	modmath.o \
 	modcmath.o \
 	modmicropython.o \
+	profile.o \
+	vmstats.o \
+	heaptrace.o \
 	modstruct.o \
 	modsys.o \
 	moduerrno.o \
@@ -287,6 +290,7 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/moduwebsocket.o \
 	extmod/modwebrepl.o \
 	extmod/modframebuf.o \
+	extmod/modarrayops.o \
 	extmod/vfs.o \
 	extmod/vfs_reader.o \
 	extmod/vfs_posix.o \
@@ -355,6 +359,9 @@ $(PY_BUILD)/nlr%.o: CFLAGS += -Os
 # optimising gc for speed; 5ms down to 4ms on pybv2
 $(PY_BUILD)/gc.o: CFLAGS += $(CSUPEROPT)
 
+# the array kernels are written to be unrolled and vectorised
+$(BUILD)/extmod/modarrayops.o: CFLAGS += $(CSUPEROPT)
+
 # optimising vm for speed, adds only a small amount to code size but makes a huge difference to speed (20% faster)
 $(PY_BUILD)/vm.o: CFLAGS += $(CSUPEROPT)
 # Optimizing vm.o for modern deeply pipelined CPUs with branch predictors
@@ -33,6 +33,7 @@
 
 typedef struct _mp_reader_mem_t {
     size_t free_len; // if >0 mem is freed on close by: m_free(beg, free_len)
+    bool is_static; // mem outlives everything that is loaded from it
     const byte *beg;
     const byte *cur;
     const byte *end;
@@ -47,6 +48,14 @@ STATIC mp_uint_t mp_reader_mem_readbyte(void *data) {
     }
 }
 
+STATIC const byte *mp_reader_mem_readchunk(void *data, size_t *len) {
+    mp_reader_mem_t *reader = (mp_reader_mem_t*)data;
+    const byte *buf = reader->cur;
+    *len = reader->end - buf;
+    reader->cur = reader->end;
+    return buf;
+}
+
 STATIC void mp_reader_mem_close(void *data) {
     mp_reader_mem_t *reader = (mp_reader_mem_t*)data;
     if (reader->free_len > 0) {
@@ -58,12 +67,35 @@ STATIC void mp_reader_mem_close(void *data) {
 void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t free_len) {
     mp_reader_mem_t *rm = m_new_obj(mp_reader_mem_t);
     rm->free_len = free_len;
+    rm->is_static = false;
     rm->beg = buf;
     rm->cur = buf;
     rm->end = buf + len;
     reader->data = rm;
     reader->readbyte = mp_reader_mem_readbyte;
     reader->close = mp_reader_mem_close;
+    reader->readchunk = mp_reader_mem_readchunk;
+}
+
+void mp_reader_new_mem_static(mp_reader_t *reader, const byte *buf, size_t len) {
+    mp_reader_new_mem(reader, buf, len, 0);
+    ((mp_reader_mem_t*)reader->data)->is_static = true;
+}
+
+const byte *mp_reader_mem_take(mp_reader_t *reader, size_t len, bool *is_static) {
+    if (reader->readbyte != mp_reader_mem_readbyte) {
+        return NULL;
+    }
+    mp_reader_mem_t *rm = (mp_reader_mem_t*)reader->data;
+    if ((size_t)(rm->end - rm->cur) < len) {
+        return NULL;
+    }
+    const byte *buf = rm->cur;
+    rm->cur += len;
+    if (is_static != NULL) {
+        *is_static = rm->is_static;
+    }
+    return buf;
 }
 
 #if MICROPY_READER_POSIX
@@ -77,27 +109,47 @@ typedef struct _mp_reader_posix_t {
     int fd;
     size_t len;
     size_t pos;
-    byte buf[20];
+    byte buf[MICROPY_ALLOC_READER_BUF_SIZE];
 } mp_reader_posix_t;
 
-STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
-    mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
+// make sure there are bytes buffered, returning false if end of stream
+STATIC bool mp_reader_posix_fill(mp_reader_posix_t *reader) {
     if (reader->pos >= reader->len) {
         if (reader->len == 0) {
-            return MP_READER_EOF;
+            return false;
         } else {
             int n = read(reader->fd, reader->buf, sizeof(reader->buf));
             if (n <= 0) {
                 reader->len = 0;
-                return MP_READER_EOF;
+                return false;
             }
             reader->len = n;
             reader->pos = 0;
         }
     }
+    return true;
+}
+
+STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
+    mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
+    if (!mp_reader_posix_fill(reader)) {
+        return MP_READER_EOF;
+    }
     return reader->buf[reader->pos++];
 }
 
+STATIC const byte *mp_reader_posix_readchunk(void *data, size_t *len) {
+    mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
+    if (!mp_reader_posix_fill(reader)) {
+        *len = 0;
+        return NULL;
+    }
+    const byte *buf = reader->buf + reader->pos;
+    *len = reader->len - reader->pos;
+    reader->pos = reader->len;
+    return buf;
+}
+
 STATIC void mp_reader_posix_close(void *data) {
     mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
     if (reader->close_fd) {
@@ -122,6 +174,7 @@ void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd) {
     reader->data = rp;
     reader->readbyte = mp_reader_posix_readbyte;
     reader->close = mp_reader_posix_close;
+    reader->readchunk = mp_reader_posix_readchunk;
 }
 
 #if !MICROPY_VFS_POSIX
@@ -135,4 +188,32 @@ void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
 }
 #endif
 
+#if MICROPY_PERSISTENT_CODE_LOAD_MAPPED
+
+#include <sys/mman.h>
+
+const byte *mp_reader_map_file(const char *filename, size_t *len) {
+    int fd = open(filename, O_RDONLY, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void *buf = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (buf == MAP_FAILED) {
+        return NULL;
+    }
+    *len = st.st_size;
+    return buf;
+}
+
+void mp_reader_unmap_file(const byte *buf, size_t len) {
+    munmap((void*)buf, len);
+}
+
+#endif
+
 #endif
@@ -33,14 +33,33 @@
 // it can be called again after returning MP_READER_EOF, and in that case must return MP_READER_EOF
 #define MP_READER_EOF ((mp_uint_t)(-1))
 
+// the readchunk function is optional (it may be NULL) and reads a block of
+// the stream: it must return a pointer to the next *len bytes in the stream,
+// which are then consumed; it must set *len to 0 if end of stream
+// the bytes stay valid until the next call to readchunk, readbyte or close
+// calls to readbyte and readchunk may be mixed freely
 typedef struct _mp_reader_t {
     void *data;
     mp_uint_t (*readbyte)(void *data);
     void (*close)(void *data);
+    const byte *(*readchunk)(void *data, size_t *len);
 } mp_reader_t;
 
 void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t free_len);
+
+// buf must stay valid and unmodified for as long as anything loaded from it
+// is alive (eg it is in ROM or memory-mapped flash)
+void mp_reader_new_mem_static(mp_reader_t *reader, const byte *buf, size_t len);
+
+// if reader is a memory reader with at least len bytes remaining, return a
+// pointer to them and advance past them, otherwise return NULL and consume
+// nothing; *is_static (if non-NULL) is set to whether the memory is static
+const byte *mp_reader_mem_take(mp_reader_t *reader, size_t len, bool *is_static);
+
 void mp_reader_new_file(mp_reader_t *reader, const char *filename);
 void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd);
+// mmap the whole file read-only, returning NULL if it can't be mapped
+const byte *mp_reader_map_file(const char *filename, size_t *len);
+void mp_reader_unmap_file(const byte *buf, size_t len);
 
 #endif // MICROPY_INCLUDED_PY_READER_H
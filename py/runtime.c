@@ -41,6 +41,7 @@
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/vmstats.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -118,6 +119,45 @@ void mp_init(void) {
     MP_STATE_VM(vfs_mount_table) = NULL;
     #endif
 
+    #if MICROPY_MODULE_IMPORT_CACHE
+    MP_STATE_VM(import_cache) = MP_OBJ_NULL;
+    MP_STATE_VM(import_cache_stale) = false;
+    MP_STATE_VM(import_cache_gen) = 0;
+    #endif
+
+    #if MICROPY_MODULE_COMPILE_CACHE
+    MP_STATE_VM(compile_cache_dir) = mp_const_none;
+    MP_STATE_VM(compile_cache_hits) = 0;
+    MP_STATE_VM(compile_cache_misses) = 0;
+    MP_STATE_VM(compile_cache_saves) = 0;
+    #endif
+
+    #if MICROPY_PY_STRUCT_COMPILED
+    for (size_t i = 0; i < MICROPY_PY_STRUCT_CACHE_SIZE; ++i) {
+        MP_STATE_VM(struct_cache)[i] = MP_OBJ_NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    MP_STATE_VM(profile_ring) = NULL;
+    MP_STATE_VM(profile_count) = 0;
+    MP_STATE_VM(profile_active) = false;
+    MP_STATE_THREAD(profile_frame) = NULL;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_VM_STATS
+    MP_STATE_VM(vm_stats_funs) = NULL;
+    MP_STATE_VM(vm_stats_funs_alloc) = 0;
+    MP_STATE_VM(vm_stats_funs_used) = 0;
+    mp_vm_stats_reset();
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_HEAP_TRACE
+    MP_STATE_VM(heap_trace_ring) = NULL;
+    MP_STATE_VM(heap_trace_count) = 0;
+    MP_STATE_VM(heap_trace_active) = false;
+    #endif
+
     #if MICROPY_PY_THREAD_GIL
     mp_thread_mutex_init(&MP_STATE_VM(gil_mutex));
     #endif
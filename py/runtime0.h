@@ -34,7 +34,7 @@
 #define MP_SCOPE_FLAG_DEFKWARGS    (0x08)
 #define MP_SCOPE_FLAG_REFGLOBALS   (0x10) // used only if native emitter enabled
 #define MP_SCOPE_FLAG_HASCONSTS    (0x20) // used only if native emitter enabled
-#define MP_SCOPE_FLAG_VIPERRET_POS    (6) // 3 bits used for viper return type
+#define MP_SCOPE_FLAG_VIPERRET_POS    (6) // 4 bits used for viper return type
 
 // types for native (viper) function signature
 #define MP_NATIVE_TYPE_OBJ  (0x00)
@@ -45,6 +45,7 @@
 #define MP_NATIVE_TYPE_PTR8 (0x05)
 #define MP_NATIVE_TYPE_PTR16 (0x06)
 #define MP_NATIVE_TYPE_PTR32 (0x07)
+#define MP_NATIVE_TYPE_FLOAT (0x08)
 
 typedef enum {
     // These ops may appear in the bytecode. Changing this group
@@ -202,6 +203,9 @@ typedef enum {
     MP_F_SMALL_INT_FLOOR_DIVIDE,
     MP_F_SMALL_INT_MODULO,
     MP_F_NATIVE_YIELD_FROM,
+#if MICROPY_EMIT_NATIVE_FLOAT
+    MP_F_NATIVE_FLOAT_BINARY_OP,
+#endif
     MP_F_NUMBER_OF,
 } mp_fun_kind_t;
 
@@ -34,6 +34,8 @@
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/profile.h"
+#include "py/vmstats.h"
 
 #if 0
 #define TRACE(ip) printf("sp=%d ", (int)(sp - &code_state->state[0] + 1)); mp_bytecode_print2(ip, 1, code_state->fun_bc->const_table);
@@ -41,6 +43,21 @@
 #define TRACE(ip)
 #endif
 
+#if MICROPY_PY_MICROPYTHON_VM_STATS
+// count the opcode about to run, and the pair it makes with the previous one
+// run by this function (vm_stats_prev_op is 0 at the start of the function)
+#define VM_STATS_OPCODE(ip) do { \
+    byte op = *(ip); \
+    ++MP_STATE_VM(vm_stats_op)[op]; \
+    ++MP_STATE_VM(vm_stats_op_pair)[vm_stats_prev_op][op]; \
+    vm_stats_prev_op = op; \
+} while (0)
+#define VM_STATS_MAKE_FUNCTION(rc) mp_vm_stats_make_function((rc), code_state->fun_bc->bytecode)
+#else
+#define VM_STATS_OPCODE(ip)
+#define VM_STATS_MAKE_FUNCTION(rc)
+#endif
+
 // Value stack grows up (this makes it incompatible with native C stack, but
 // makes sure that arguments to functions are in natural order arg1..argN
 // (Python semantics mandates left-to-right evaluation order, including for
@@ -108,6 +125,63 @@
     exc_sp--; /* pop back to previous exception handler */ \
     CLEAR_SYS_EXC_INFO() /* just clear sys.exc_info(), not compliant, but it shouldn't be used in 1st place */
 
+#if MICROPY_OPT_FLOAT_TEMP_REUSE
+
+// A float created by a BINARY_OP is referenced only from the VM stack until
+// the next instruction runs.  If that instruction is another BINARY_OP (or a
+// simple load followed by a BINARY_OP) then the float is still a temporary
+// and the next result can be written into it instead of allocating.
+typedef struct _vm_float_tmp_t {
+    mp_obj_t obj; // the temporary float, or MP_OBJ_NULL
+    const byte *ip; // the instruction following the op that created it
+} vm_float_tmp_t;
+
+// Return the instruction following ip if ip is a load that pushes one value
+// without running any other code, otherwise NULL.
+STATIC const byte *vm_skip_simple_load(const byte *ip) {
+    byte op = *ip++;
+    if ((MP_BC_LOAD_CONST_SMALL_INT_MULTI <= op && op < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64)
+        || (MP_BC_LOAD_FAST_MULTI <= op && op < MP_BC_LOAD_FAST_MULTI + 16)) {
+        return ip;
+    } else if (op == MP_BC_LOAD_FAST_N) {
+        return mp_decode_uint_skip(ip);
+    } else if (op == MP_BC_LOAD_CONST_OBJ) {
+        #if MICROPY_PERSISTENT_CODE
+        return mp_decode_uint_skip(ip);
+        #else
+        return (const byte*)MP_ALIGN(ip, sizeof(mp_obj_t)) + sizeof(mp_obj_t);
+        #endif
+    }
+    return NULL;
+}
+
+// ip points just past the BINARY_OP opcode
+STATIC mp_obj_t vm_binary_op(vm_float_tmp_t *tmp, const byte *ip, mp_obj_t lhs, mp_obj_t rhs) {
+    mp_binary_op_t op = ip[-1] - MP_BC_BINARY_OP_MULTI;
+    mp_obj_t dest = tmp->obj;
+    tmp->obj = MP_OBJ_NULL;
+    mp_obj_t res;
+    if (dest != MP_OBJ_NULL
+        && ((rhs == dest && ip - 1 == tmp->ip)
+            || (lhs == dest && ip - 1 == vm_skip_simple_load(tmp->ip)))
+        && mp_obj_float_binary_op_into(dest, op, lhs, rhs)) {
+        res = dest;
+    } else {
+        res = mp_binary_op(op, lhs, rhs);
+        // a float result of an op on floats and ints is always a new object
+        if (!mp_obj_is_float(res)
+            || !(mp_obj_is_float(lhs) || mp_obj_is_int(lhs))
+            || !(mp_obj_is_float(rhs) || mp_obj_is_int(rhs))) {
+            return res;
+        }
+    }
+    tmp->obj = res;
+    tmp->ip = ip;
+    return res;
+}
+
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
@@ -127,6 +201,7 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     #include "py/vmentrytable.h"
     #define DISPATCH() do { \
         TRACE(ip); \
+        VM_STATS_OPCODE(ip); \
         MARK_EXC_IP_GLOBAL(); \
         goto *entry_table[*ip++]; \
     } while (0)
@@ -146,8 +221,22 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     // loop and the exception handler, leading to very obscure bugs.
     #define RAISE(o) do { nlr_pop(); nlr.ret_val = MP_OBJ_TO_PTR(o); goto exception_handler; } while (0)
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+    // link this function into the stack seen by the sampling profiler
+    volatile mp_profile_frame_t profile_frame;
+    profile_frame.prev = MP_STATE_THREAD(profile_frame);
+    profile_frame.code_state = code_state;
+    MP_STATE_THREAD(profile_frame) = &profile_frame;
+    #define PROFILE_FRAME_POP() MP_STATE_THREAD(profile_frame) = profile_frame.prev
+    #define PROFILE_FRAME_SET(cs) profile_frame.code_state = (cs)
+#else
+    #define PROFILE_FRAME_POP()
+    #define PROFILE_FRAME_SET(cs)
+#endif
+
 #if MICROPY_STACKLESS
 run_code_state: ;
+    PROFILE_FRAME_SET(code_state);
 #endif
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn;
@@ -176,6 +265,12 @@ outer_dispatch_loop:
             const byte *ip = code_state->ip;
             mp_obj_t *sp = code_state->sp;
             mp_obj_t obj_shared;
+            #if MICROPY_OPT_FLOAT_TEMP_REUSE
+            vm_float_tmp_t float_tmp = {MP_OBJ_NULL, NULL};
+            #endif
+            #if MICROPY_PY_MICROPYTHON_VM_STATS
+            byte vm_stats_prev_op = 0;
+            #endif
             MICROPY_VM_HOOK_INIT
 
             // If we have exception to inject, now that we finish setting up
@@ -197,6 +292,7 @@ dispatch_loop:
                 DISPATCH();
 #else
                 TRACE(ip);
+                VM_STATS_OPCODE(ip);
                 MARK_EXC_IP_GLOBAL();
                 switch (*ip++) {
 #endif
@@ -856,12 +952,14 @@ unwind_jump:;
 
                 ENTRY(MP_BC_MAKE_FUNCTION): {
                     DECODE_PTR;
+                    VM_STATS_MAKE_FUNCTION(ptr);
                     PUSH(mp_make_function_from_raw_code(ptr, MP_OBJ_NULL, MP_OBJ_NULL));
                     DISPATCH();
                 }
 
                 ENTRY(MP_BC_MAKE_FUNCTION_DEFARGS): {
                     DECODE_PTR;
+                    VM_STATS_MAKE_FUNCTION(ptr);
                     // Stack layout: def_tuple def_dict <- TOS
                     mp_obj_t def_dict = POP();
                     SET_TOP(mp_make_function_from_raw_code(ptr, TOP(), def_dict));
@@ -870,6 +968,7 @@ unwind_jump:;
 
                 ENTRY(MP_BC_MAKE_CLOSURE): {
                     DECODE_PTR;
+                    VM_STATS_MAKE_FUNCTION(ptr);
                     size_t n_closed_over = *ip++;
                     // Stack layout: closed_overs <- TOS
                     sp -= n_closed_over - 1;
@@ -879,6 +978,7 @@ unwind_jump:;
 
                 ENTRY(MP_BC_MAKE_CLOSURE_DEFARGS): {
                     DECODE_PTR;
+                    VM_STATS_MAKE_FUNCTION(ptr);
                     size_t n_closed_over = *ip++;
                     // Stack layout: def_tuple def_dict closed_overs <- TOS
                     sp -= 2 + n_closed_over - 1;
@@ -1099,6 +1199,7 @@ unwind_return:
                         goto run_code_state;
                     }
                     #endif
+                    PROFILE_FRAME_POP();
                     return MP_VM_RETURN_NORMAL;
 
                 ENTRY(MP_BC_RAISE_VARARGS): {
@@ -1136,6 +1237,7 @@ yield:
                     code_state->ip = ip;
                     code_state->sp = sp;
                     code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, 0);
+                    PROFILE_FRAME_POP();
                     return MP_VM_RETURN_YIELD;
 
                 ENTRY(MP_BC_YIELD_FROM): {
@@ -1234,7 +1336,11 @@ yield:
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t rhs = POP();
                     mp_obj_t lhs = TOP();
+                    #if MICROPY_OPT_FLOAT_TEMP_REUSE
+                    SET_TOP(vm_binary_op(&float_tmp, ip, lhs, rhs));
+                    #else
                     SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
+                    #endif
                     DISPATCH();
                 }
 
@@ -1257,7 +1363,11 @@ yield:
                     } else if (ip[-1] < MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_NUM_BYTECODE) {
                         mp_obj_t rhs = POP();
                         mp_obj_t lhs = TOP();
+                        #if MICROPY_OPT_FLOAT_TEMP_REUSE
+                        SET_TOP(vm_binary_op(&float_tmp, ip, lhs, rhs));
+                        #else
                         SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
+                        #endif
                         DISPATCH();
                     } else
 #endif
@@ -1265,6 +1375,7 @@ yield:
                     mp_obj_t obj = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "byte code not implemented");
                     nlr_pop();
                     code_state->state[0] = obj;
+                    PROFILE_FRAME_POP();
                     return MP_VM_RETURN_EXCEPTION;
                 }
 
@@ -1362,50 +1473,9 @@ unwind_loop:
             // TODO: don't set traceback for exceptions re-raised by END_FINALLY.
             // But consider how to handle nested exceptions.
             if (nlr.ret_val != &mp_const_GeneratorExit_obj) {
-                const byte *ip = code_state->fun_bc->bytecode;
-                ip = mp_decode_uint_skip(ip); // skip n_state
-                ip = mp_decode_uint_skip(ip); // skip n_exc_stack
-                ip++; // skip scope_params
-                ip++; // skip n_pos_args
-                ip++; // skip n_kwonly_args
-                ip++; // skip n_def_pos_args
-                size_t bc = code_state->ip - ip;
-                size_t code_info_size = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip); // skip code_info_size
-                bc -= code_info_size;
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                qstr source_file = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                #endif
-                size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    size_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
+                qstr block_name, source_file;
+                size_t source_line;
+                mp_bytecode_get_source(code_state->fun_bc->bytecode, code_state->ip, &block_name, &source_file, &source_line);
                 mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
             }
 
@@ -1444,6 +1514,7 @@ unwind_loop:
                 mp_nonlocal_free(code_state, sizeof(mp_code_state_t));
                 #endif
                 code_state = new_code_state;
+                PROFILE_FRAME_SET(code_state);
                 size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
                 fastn = &code_state->state[n_state - 1];
                 exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
@@ -1456,6 +1527,7 @@ unwind_loop:
                 // propagate exception to higher level
                 // Note: ip and sp don't have usable values at this point
                 code_state->state[0] = MP_OBJ_FROM_PTR(nlr.ret_val); // put exception here because sp is invalid
+                PROFILE_FRAME_POP();
                 return MP_VM_RETURN_EXCEPTION;
             }
         }
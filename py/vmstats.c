@@ -0,0 +1,236 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/objlist.h"
+#include "py/bc.h"
+#include "py/vmstats.h"
+
+#if MICROPY_PY_MICROPYTHON_VM_STATS
+
+// Functions are kept in an open-addressed hash table keyed on their bytecode
+// pointer, which is shared by all function objects made from the same code.
+// The table also keeps that bytecode alive, so its names can be read out
+// after the function itself has gone.
+
+STATIC size_t vm_stats_hash(const byte *bytecode) {
+    uintptr_t h = (uintptr_t)bytecode >> 2;
+    return h ^ (h >> 9);
+}
+
+STATIC mp_vm_stats_fun_t *vm_stats_find(const byte *bytecode) {
+    size_t alloc = MP_STATE_VM(vm_stats_funs_alloc);
+    if (alloc == 0) {
+        return NULL;
+    }
+    mp_vm_stats_fun_t *table = MP_STATE_VM(vm_stats_funs);
+    for (size_t i = vm_stats_hash(bytecode) & (alloc - 1);; i = (i + 1) & (alloc - 1)) {
+        if (table[i].bytecode == bytecode) {
+            return &table[i];
+        } else if (table[i].bytecode == NULL) {
+            return NULL;
+        }
+    }
+}
+
+// Find the entry for the given bytecode, adding it if it's not there yet.
+// Returns NULL if the table is full and can't be grown.
+STATIC mp_vm_stats_fun_t *vm_stats_lookup(const byte *bytecode) {
+    mp_vm_stats_fun_t *f = vm_stats_find(bytecode);
+    if (f != NULL) {
+        return f;
+    }
+
+    // grow the table when it's 3/4 full
+    mp_vm_stats_fun_t *table = MP_STATE_VM(vm_stats_funs);
+    size_t alloc = MP_STATE_VM(vm_stats_funs_alloc);
+    if (4 * (MP_STATE_VM(vm_stats_funs_used) + 1) > 3 * alloc) {
+        size_t new_alloc = alloc == 0 ? 32 : 2 * alloc;
+        mp_vm_stats_fun_t *new_table = m_new_maybe(mp_vm_stats_fun_t, new_alloc);
+        if (new_table != NULL && MP_STATE_VM(vm_stats_funs) != table) {
+            // a finaliser run by the allocation already grew the table
+            m_del(mp_vm_stats_fun_t, new_table, new_alloc);
+            return vm_stats_lookup(bytecode);
+        }
+        if (new_table != NULL) {
+            memset(new_table, 0, new_alloc * sizeof(mp_vm_stats_fun_t));
+            MP_STATE_VM(vm_stats_funs) = new_table;
+            MP_STATE_VM(vm_stats_funs_alloc) = new_alloc;
+            for (size_t i = 0; i < alloc; ++i) {
+                if (table[i].bytecode != NULL) {
+                    size_t j = vm_stats_hash(table[i].bytecode) & (new_alloc - 1);
+                    while (new_table[j].bytecode != NULL) {
+                        j = (j + 1) & (new_alloc - 1);
+                    }
+                    new_table[j] = table[i];
+                }
+            }
+            m_del(mp_vm_stats_fun_t, table, alloc);
+            table = new_table;
+            alloc = new_alloc;
+        } else if (MP_STATE_VM(vm_stats_funs_used) + 1 >= alloc) {
+            // out of memory, and there must always be a free slot
+            return NULL;
+        }
+    }
+
+    size_t i = vm_stats_hash(bytecode) & (alloc - 1);
+    while (table[i].bytecode != NULL) {
+        i = (i + 1) & (alloc - 1);
+    }
+    table[i].bytecode = bytecode;
+    MP_STATE_VM(vm_stats_funs_used) += 1;
+    return &table[i];
+}
+
+void mp_vm_stats_reset(void) {
+    memset(MP_STATE_VM(vm_stats_op), 0, sizeof(MP_STATE_VM(vm_stats_op)));
+    memset(MP_STATE_VM(vm_stats_op_pair), 0, sizeof(MP_STATE_VM(vm_stats_op_pair)));
+    for (size_t i = 0; i < MP_STATE_VM(vm_stats_funs_alloc); ++i) {
+        MP_STATE_VM(vm_stats_funs)[i].n_calls = 0;
+    }
+}
+
+void mp_vm_stats_make_function(const mp_raw_code_t *rc, const byte *parent) {
+    if (rc->kind == MP_CODE_BYTECODE) {
+        mp_vm_stats_fun_t *f = vm_stats_lookup(rc->fun_data);
+        if (f != NULL) {
+            f->parent = parent;
+        }
+    }
+}
+
+void mp_vm_stats_call(const byte *bytecode) {
+    mp_vm_stats_fun_t *f = vm_stats_lookup(bytecode);
+    if (f != NULL) {
+        f->n_calls += 1;
+    }
+}
+
+STATIC qstr vm_stats_block_name(const byte *bytecode) {
+    qstr block_name, source_file;
+    size_t line;
+    mp_bytecode_get_source(bytecode, bytecode, &block_name, &source_file, &line);
+    return block_name;
+}
+
+// Print the names of the enclosing functions and classes, outermost first,
+// up to but not including the module
+STATIC void vm_stats_print_qualname(const mp_print_t *print, const mp_vm_stats_fun_t *f, size_t depth) {
+    if (f->parent != NULL && depth < 16) {
+        const mp_vm_stats_fun_t *parent = vm_stats_find(f->parent);
+        if (parent != NULL && vm_stats_block_name(parent->bytecode) != MP_QSTR__lt_module_gt_) {
+            vm_stats_print_qualname(print, parent, depth + 1);
+            mp_print_str(print, ".");
+        }
+    }
+    mp_printf(print, "%q", vm_stats_block_name(f->bytecode));
+}
+
+STATIC mp_obj_t vm_stats_get_calls(void) {
+    mp_obj_t calls = mp_obj_new_dict(0);
+    mp_map_t *map = mp_obj_dict_get_map(calls);
+    vstr_t vstr;
+    mp_print_t vstr_print;
+    vstr_init_print(&vstr, 32, &vstr_print);
+    for (size_t i = 0; i < MP_STATE_VM(vm_stats_funs_alloc); ++i) {
+        const mp_vm_stats_fun_t *f = &MP_STATE_VM(vm_stats_funs)[i];
+        if (f->bytecode == NULL || f->n_calls == 0
+            || vm_stats_block_name(f->bytecode) == MP_QSTR__lt_module_gt_) {
+            continue;
+        }
+        vstr_reset(&vstr);
+        vm_stats_print_qualname(&vstr_print, f, 0);
+        // functions with the same name in different modules are summed
+        mp_map_elem_t *elem = mp_map_lookup(map, mp_obj_new_str(vstr.buf, vstr.len), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+        mp_uint_t n_calls = f->n_calls;
+        if (elem->value != MP_OBJ_NULL) {
+            n_calls += mp_obj_get_int_truncated(elem->value);
+        }
+        elem->value = mp_obj_new_int_from_uint(n_calls);
+    }
+    vstr_clear(&vstr);
+    return calls;
+}
+
+mp_obj_t mp_vm_stats_get(void) {
+    mp_obj_t ops = mp_obj_new_dict(0);
+    mp_obj_t pairs = mp_obj_new_dict(0);
+    for (size_t op = 0; op < 256; ++op) {
+        if (MP_STATE_VM(vm_stats_op)[op] != 0) {
+            mp_obj_dict_store(ops, MP_OBJ_NEW_SMALL_INT(op), mp_obj_new_int_from_uint(MP_STATE_VM(vm_stats_op)[op]));
+        }
+        // row 0 holds the first opcode run by each function, which has no
+        // previous opcode (0 is not a valid opcode)
+        for (size_t next = 0; op != 0 && next < 256; ++next) {
+            mp_uint_t n = MP_STATE_VM(vm_stats_op_pair)[op][next];
+            if (n != 0) {
+                mp_obj_t key[2] = {MP_OBJ_NEW_SMALL_INT(op), MP_OBJ_NEW_SMALL_INT(next)};
+                mp_obj_dict_store(pairs, mp_obj_new_tuple(2, key), mp_obj_new_int_from_uint(n));
+            }
+        }
+    }
+    mp_obj_t tuple[3] = {ops, pairs, vm_stats_get_calls()};
+    return mp_obj_new_tuple(3, tuple);
+}
+
+void mp_vm_stats_dump(const mp_print_t *print) {
+    // print the calls sorted by name so that the output is stable
+    mp_obj_t calls = vm_stats_get_calls();
+    mp_obj_t names = mp_obj_new_list(0, NULL);
+    mp_map_t *map = mp_obj_dict_get_map(calls);
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i)) {
+            mp_obj_list_append(names, map->table[i].key);
+        }
+    }
+    mp_obj_list_sort(1, &names, (mp_map_t*)&mp_const_empty_map);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_list_get(names, &len, &items);
+    for (size_t i = 0; i < len; ++i) {
+        mp_printf(print, "%s " UINT_FMT "\n", mp_obj_str_get_str(items[i]),
+            (mp_uint_t)mp_obj_get_int_truncated(mp_obj_dict_get(calls, items[i])));
+    }
+
+    for (size_t op = 1; op < 256; ++op) {
+        if (MP_STATE_VM(vm_stats_op)[op] != 0) {
+            mp_printf(print, "# opcode 0x%02x " UINT_FMT "\n", (uint)op, MP_STATE_VM(vm_stats_op)[op]);
+        }
+    }
+    for (size_t op = 1; op < 256; ++op) {
+        for (size_t next = 0; next < 256; ++next) {
+            mp_uint_t n = MP_STATE_VM(vm_stats_op_pair)[op][next];
+            if (n != 0) {
+                mp_printf(print, "# pair 0x%02x 0x%02x " UINT_FMT "\n", (uint)op, (uint)next, n);
+            }
+        }
+    }
+}
+
+#endif // MICROPY_PY_MICROPYTHON_VM_STATS
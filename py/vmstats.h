@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Pycom Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_VMSTATS_H
+#define MICROPY_INCLUDED_PY_VMSTATS_H
+
+#include "py/emitglue.h"
+
+#if MICROPY_PY_MICROPYTHON_VM_STATS
+
+// Number of calls to a bytecode function, and the function whose code
+// created it, which gives its qualified name (eg "Sensor.read")
+typedef struct _mp_vm_stats_fun_t {
+    const byte *bytecode;
+    const byte *parent;
+    mp_uint_t n_calls;
+} mp_vm_stats_fun_t;
+
+// Set all counts to zero; the functions seen so far are remembered
+void mp_vm_stats_reset(void);
+
+// Called by the VM when it creates a function from raw code within the
+// bytecode function parent, and by mp_setup_code_state on each call
+void mp_vm_stats_make_function(const mp_raw_code_t *rc, const byte *parent);
+void mp_vm_stats_call(const byte *bytecode);
+
+// Return a tuple of dicts (opcode counts, opcode pair counts, call counts by
+// qualified name), leaving out anything with a count of zero
+mp_obj_t mp_vm_stats_get(void);
+
+// Print the call counts as "<qualname> <count>" lines, as read by the
+// native-profile option of mpy-cross, followed by the opcode and pair counts
+// as "#" comment lines
+void mp_vm_stats_dump(const mp_print_t *print);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_VMSTATS_H
@@ -83,3 +83,22 @@ try:
     exec(r"'\U0000000'")
 except SyntaxError:
     print("SyntaxError")
+
+# long runs of name, string, comment and space characters
+name = 'a' * 100 + '_9'
+exec(name + ' = 1\nprint(' + name + ')')
+print(len(eval("'" + 'ab' * 50 + "'")))
+print(eval("'" + 'ab' * 20 + '\t' + 'cd' * 20 + "'"))
+print(eval('"""' + 'ab\r\ncd\r' * 3 + '"""'))
+print(eval("'" + 'ab' * 20 + '\\x41' + '"' * 3 + "'"))
+exec('# ' + 'c' * 100 + '\tx\r\nprint(2)')
+exec('if 1:\n' + ' ' * 40 + 'print(3)\n' + ' ' * 40 + 'print(4)')
+
+# keywords and names that are close to them
+for s in ('Fals', 'Falsee', 'an', 'anda', 'whil', 'whilee', 'yiel', 'yieldd', 'A', 'z', '_'):
+    exec(s + ' = 1')
+for s in ('False', 'None', 'and', 'as', 'class', 'from', 'is', 'not', 'while', 'with', 'yield'):
+    try:
+        exec(s + ' = 1')
+    except SyntaxError:
+        print('SyntaxError', s)
@@ -0,0 +1,67 @@
+# OrderedDict with enough entries to be indexed, with deletions and re-insertions
+
+try:
+    from collections import OrderedDict
+except ImportError:
+    try:
+        from ucollections import OrderedDict
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+# growing past the linear scan keeps the order and the lookups
+for n in (7, 8, 9, 100, 1000):
+    d = OrderedDict()
+    for i in range(n):
+        d[i * 7 % n] = i
+    print(n, len(d), list(d.keys()) == [i * 7 % n for i in range(n)])
+    print(all(d[i * 7 % n] == i for i in range(n)), -1 in d, n in d)
+
+# mixed keys, including strings not interned
+d = OrderedDict()
+for i in range(50):
+    d[i] = i
+    d[str(i) + "x"] = i
+    d[(i, "t")] = i
+print(len(d), d["17x"], d[(49, "t")], d[33])
+print(list(d.keys())[:6])
+
+# deleting keeps the order of the rest; deleted keys come back at the end
+d = OrderedDict((i, i) for i in range(20))
+for i in range(0, 20, 3):
+    del d[i]
+print(list(d.keys()))
+d[3] = "three"
+d[0] = "zero"
+print(list(d.keys()))
+print(d.pop(4), 4 in d, len(d))
+try:
+    del d[4]
+except KeyError:
+    print("KeyError")
+
+# an LRU cache: pop and re-insert, so the deleted entries must be reclaimed
+cache = OrderedDict()
+for i in range(300):
+    cache[i] = i
+for i in range(5000):
+    k = i * 13 % 300
+    cache[k] = cache.pop(k) + 1
+print(len(cache), sum(cache.values()), list(cache.keys())[:5])
+
+# copy, equality and clear
+d = OrderedDict((i, i * i) for i in range(40))
+del d[5]
+c = d.copy()
+print(type(c) is OrderedDict, c == d, list(c.keys()) == list(d.keys()), 5 in c)
+c[5] = 25
+print(c == d, list(c.keys())[-1])
+d.clear()
+print(len(d), list(d.keys()))
+d[1] = 1
+print(list(d.items()))
+
+# update from another dict
+d = OrderedDict((i, i) for i in range(12))
+d.update(OrderedDict((i, -i) for i in range(10, 20)))
+print(list(d.items())[8:14])
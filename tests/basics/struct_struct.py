@@ -0,0 +1,66 @@
+# precompiled formats with struct.Struct
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    struct.Struct
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct("<hBIb2s")
+print(s.size, s.format, s.size == struct.calcsize(s.format))
+b = s.pack(-2, 200, 0xFFFFFFFF, -128, b"xyz")
+print(b, b == struct.pack(s.format, -2, 200, 0xFFFFFFFF, -128, b"xyz"))
+print(s.unpack(b))
+print(s.unpack_from(b"..." + b, 3))
+
+# native format with alignment, big endian, every int size
+for fmt in ("bhi", "@bHiB", ">bHiq", "<BhIQ", "!Hh"):
+    s = struct.Struct(fmt)
+    vals = (1, 2, 3, 4)[:len(s.unpack(bytes(s.size)))]
+    b = s.pack(*vals)
+    print(fmt, s.size, s.unpack(b) == vals, b == struct.pack(fmt, *vals))
+
+# values at the limits of the fast paths
+s = struct.Struct(">bBhHiI")
+vals = (-128, 255, -32768, 65535, -2147483648, 4294967295)
+print(s.unpack(s.pack(*vals)))
+vals = (127, 0, 32767, 0, 2147483647, 0)
+print(s.unpack(s.pack(*vals)))
+
+# pack_into at an offset, negative offsets from the end
+s = struct.Struct("<HH")
+buf = bytearray(8)
+s.pack_into(buf, 2, 0x1234, 0x5678)
+print(buf)
+print(s.unpack_from(buf, -6))
+try:
+    s.pack_into(buf, 6, 1, 2)
+except Exception:
+    print("Exception")
+try:
+    s.unpack_from(buf, 5)
+except Exception:
+    print("Exception")
+
+# iter_unpack over consecutive records
+s = struct.Struct("<hB")
+data = b"".join(s.pack(i * 100 - 500, i) for i in range(8))
+print(list(s.iter_unpack(data)))
+print([a for a, b in s.iter_unpack(memoryview(data)[6:12])])
+try:
+    s.iter_unpack(data[:-1])
+except Exception:
+    print("Exception")
+
+# the module functions give the same results as a Struct
+for i in range(3):
+    print(struct.unpack("<hB", data[i * 3:i * 3 + 3]), struct.calcsize("<hB"))
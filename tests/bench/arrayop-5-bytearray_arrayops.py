@@ -0,0 +1,12 @@
+# Array operation
+# Type: bytearray, inplace operation using the arrayops module. Like
+# arrayop-3, but the loop over the elements runs in C.
+import bench
+import arrayops
+
+def test(num):
+    for i in iter(range(num//10000)):
+        arr = bytearray(b"\0" * 1000)
+        arrayops.add(arr, 1, out=arr)
+
+bench.run(test)
@@ -0,0 +1,18 @@
+# Array operation
+# Type: array('H') of ADC readings converted to volts in an array('f'),
+# then averaged, using for.
+import bench
+from array import array
+
+def test(num):
+    raw = array('H', range(0, 4096, 4))
+    volts = array('f', [0] * len(raw))
+    for i in iter(range(num//10000)):
+        for j in range(len(raw)):
+            volts[j] = raw[j] * (3.3 / 4095)
+        s = 0
+        for v in volts:
+            s += v
+        mean = s / len(volts)
+
+bench.run(test)
@@ -0,0 +1,15 @@
+# Array operation
+# Type: array('H') of ADC readings converted to volts in an array('f'),
+# then averaged, using the arrayops module.
+import bench
+import arrayops
+from array import array
+
+def test(num):
+    raw = array('H', range(0, 4096, 4))
+    volts = array('f', [0] * len(raw))
+    for i in iter(range(num//10000)):
+        arrayops.scale(raw, 3.3 / 4095, out=volts)
+        mean = arrayops.mean(volts)
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    x = 0.5
+    s = 0.0
+    for i in iter(range(num // 20)):
+        s += ((x * 1.5 + 2.0) * x - 0.5) * x + 1.0
+    return s
+
+bench.run(test)
@@ -0,0 +1,15 @@
+import bench
+import micropython
+
+@micropython.viper
+def test(num: int) -> float:
+    x = float(0.5)
+    s = float(0)
+    i = 0
+    n = num // 20
+    while i < n:
+        s += ((x * 1.5 + 2.0) * x - 0.5) * x + 1.0
+        i += 1
+    return s
+
+bench.run(test)
@@ -0,0 +1,15 @@
+# Framebuffer: fill and fill_rect over a 320x240 display in each format.
+import bench
+import framebuf
+
+FORMATS = (framebuf.MONO_VLSB, framebuf.MONO_HLSB, framebuf.GS2_HMSB,
+    framebuf.GS4_HMSB, framebuf.GS8, framebuf.RGB565)
+
+def test(num):
+    fbufs = [framebuf.FrameBuffer(bytearray(320 * 240 * 2), 320, 240, fmt) for fmt in FORMATS]
+    for i in iter(range(num // 20000)):
+        for fbuf in fbufs:
+            fbuf.fill(i & 1)
+            fbuf.fill_rect(13, 7, 291, 221, 1)
+
+bench.run(test)
@@ -0,0 +1,16 @@
+# Framebuffer: blit a 120x80 sprite into a 320x240 display of the same format,
+# at an unaligned position, in each format.
+import bench
+import framebuf
+
+FORMATS = (framebuf.MONO_VLSB, framebuf.MONO_HLSB, framebuf.GS2_HMSB,
+    framebuf.GS4_HMSB, framebuf.GS8, framebuf.RGB565)
+
+def test(num):
+    pairs = [(framebuf.FrameBuffer(bytearray(320 * 240 * 2), 320, 240, fmt),
+        framebuf.FrameBuffer(bytearray(120 * 80 * 2), 120, 80, fmt)) for fmt in FORMATS]
+    for i in iter(range(num // 20000)):
+        for fbuf, sprite in pairs:
+            fbuf.blit(sprite, 101, 51)
+
+bench.run(test)
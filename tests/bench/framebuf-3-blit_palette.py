@@ -0,0 +1,16 @@
+# Framebuffer: blit a 1-bit 120x80 sprite into a 320x240 RGB565 display
+# through a 2-colour palette, with and without a transparent colour.
+import bench
+import framebuf
+
+def test(num):
+    fbuf = framebuf.FrameBuffer(bytearray(320 * 240 * 2), 320, 240, framebuf.RGB565)
+    sprite = framebuf.FrameBuffer(bytearray(120 * 80 // 8), 120, 80, framebuf.MONO_HLSB)
+    sprite.text("sprite", 0, 0, 1)
+    palette = framebuf.FrameBuffer(bytearray(2 * 2), 2, 1, framebuf.RGB565)
+    palette.pixel(1, 0, 0xffff)
+    for i in iter(range(num // 20000)):
+        fbuf.blit(sprite, 101, 51, -1, palette)
+        fbuf.blit(sprite, 11, 21, 0, palette)
+
+bench.run(test)
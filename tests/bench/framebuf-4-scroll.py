@@ -0,0 +1,16 @@
+# Framebuffer: scroll a 320x240 display by one text line and by a few
+# pixels sideways, in each format.
+import bench
+import framebuf
+
+FORMATS = (framebuf.MONO_VLSB, framebuf.MONO_HLSB, framebuf.GS2_HMSB,
+    framebuf.GS4_HMSB, framebuf.GS8, framebuf.RGB565)
+
+def test(num):
+    fbufs = [framebuf.FrameBuffer(bytearray(320 * 240 * 2), 320, 240, fmt) for fmt in FORMATS]
+    for i in iter(range(num // 20000)):
+        for fbuf in fbufs:
+            fbuf.scroll(0, -8)
+            fbuf.scroll(8, 0)
+
+bench.run(test)
@@ -0,0 +1,10 @@
+# Lexer: source that is mostly comment lines.
+import bench
+
+SRC = ('# this is a fairly typical comment line, explaining the code below\n' * 20 + 'x = 1\n') * 10
+
+def test(num):
+    for i in iter(range(num // 20000)):
+        compile(SRC, 'lexer', 'exec')
+
+bench.run(test)
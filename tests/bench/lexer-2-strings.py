@@ -0,0 +1,10 @@
+# Lexer: source that is mostly long string literals.
+import bench
+
+SRC = ('s = """' + ('Docstring text describing a function in some detail. ' * 4 + '\n') * 8 + '"""\n') * 10
+
+def test(num):
+    for i in iter(range(num // 20000)):
+        compile(SRC, 'lexer', 'exec')
+
+bench.run(test)
@@ -0,0 +1,10 @@
+# Lexer: source that is mostly long names, indented.
+import bench
+
+SRC = 'def f():\n' + '        some_long_variable_name = another_long_variable_name + yet_another_name\n' * 80
+
+def test(num):
+    for i in iter(range(num // 20000)):
+        compile(SRC, 'lexer', 'exec')
+
+bench.run(test)
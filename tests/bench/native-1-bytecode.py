@@ -0,0 +1,25 @@
+# Profile-guided native code: everything as bytecode.
+import bench
+import micropython
+
+def fib(n):
+    if n < 2:
+        return n
+    return fib(n - 1) + fib(n - 2)
+
+def checksum(buf):
+    s = 0
+    for b in buf:
+        s = (s * 31 + b) & 0xffff
+    return s
+
+def setup(n):
+    return bytes((i * 7) & 0xff for i in range(n))
+
+def test(num):
+    buf = setup(100)
+    for i in iter(range(num // 200)):
+        fib(8)
+        checksum(buf)
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+from ucollections import OrderedDict
+
+def test(num):
+    for n in (10, 100, 1000, 10000):
+        for r in range(num // 40 // n):
+            d = OrderedDict()
+            for i in range(n):
+                d[i] = i
+
+bench.run(test)
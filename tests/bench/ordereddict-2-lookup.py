@@ -0,0 +1,13 @@
+import bench
+from ucollections import OrderedDict
+
+def test(num):
+    for n in (10, 100, 1000, 10000):
+        d = OrderedDict()
+        for i in range(n):
+            d[i] = i
+        for r in range(num // 40 // n):
+            for i in range(n):
+                d[i]
+
+bench.run(test)
@@ -0,0 +1,14 @@
+import bench
+from ucollections import OrderedDict
+
+# an LRU cache: every hit moves the key to the end
+def test(num):
+    for n in (10, 100, 1000, 10000):
+        d = OrderedDict()
+        for i in range(n):
+            d[i] = i
+        for r in range(num // 40 // n):
+            for i in range(n):
+                d[i] = d.pop(i)
+
+bench.run(test)
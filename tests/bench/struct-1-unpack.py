@@ -0,0 +1,11 @@
+import bench
+import ustruct
+
+# a sensor record: id, flags, timestamp, three readings
+def test(num):
+    buf = ustruct.pack("<HBIhhh", 7, 1, 123456, -20, 300, 4000) * 64
+    for i in range(num // 4000):
+        for o in range(0, 64 * 13, 13):
+            ustruct.unpack_from("<HBIhhh", buf, o)
+
+bench.run(test)
@@ -0,0 +1,12 @@
+import bench
+import ustruct
+
+def test(num):
+    s = ustruct.Struct("<HBIhhh")
+    buf = s.pack(7, 1, 123456, -20, 300, 4000) * 64
+    unpack_from = s.unpack_from
+    for i in range(num // 4000):
+        for o in range(0, 64 * 13, 13):
+            unpack_from(buf, o)
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+import ustruct
+
+def test(num):
+    s = ustruct.Struct("<HBIhhh")
+    buf = s.pack(7, 1, 123456, -20, 300, 4000) * 64
+    for i in range(num // 4000):
+        for r in s.iter_unpack(buf):
+            pass
+
+bench.run(test)
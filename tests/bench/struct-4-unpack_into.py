@@ -0,0 +1,13 @@
+import bench
+import ustruct
+from array import array
+
+def test(num):
+    s = ustruct.Struct("<HBIhhh")
+    buf = s.pack(7, 1, 123456, -20, 300, 4000) * 64
+    cols = (array("H", range(64)), bytearray(64), array("I", range(64)),
+        array("h", range(64)), array("h", range(64)), array("h", range(64)))
+    for i in range(num // 4000):
+        s.unpack_into(buf, *cols)
+
+bench.run(test)
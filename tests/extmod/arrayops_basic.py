@@ -0,0 +1,57 @@
+# test the arrayops module
+
+try:
+    import arrayops
+    from array import array
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+a = array('h', [1, -2, 3, 30000])
+b = array('h', [10, 20, 30, 40])
+
+# elementwise, with broadcasting and wrap-around
+print(arrayops.add(a, b))
+print(arrayops.sub(a, b))
+print(arrayops.mul(a, 2))
+print(arrayops.sub(100, a))
+print(arrayops.clip(a, -1, 10))
+print(arrayops.cumsum(b))
+print(arrayops.cumsum(array('B', [200, 100])))
+
+# mixed typecodes are converted to the output typecode
+print(arrayops.add(a, array('f', [0.5, 1.5, 2.5, 3.5])))
+print(arrayops.add(array('f', [0.5, 1.5]), array('h', [1, 2])))
+
+# scale, integer outputs saturate when the factor is a float
+print([round(v, 3) for v in arrayops.scale(array('H', [0, 2048, 4095]), 3.3 / 4095, out=array('f', [0] * 3))])
+print(arrayops.scale(array('H', [0, 2048, 4095]), 100, 5))
+print(arrayops.scale(array('b', [100, -100, 3]), 2.5))
+print(arrayops.scale(array('f', [1e10, -1e10, float('nan')]), 1, out=array('h', [0] * 3)))
+
+# reductions
+print(arrayops.sum(a), arrayops.sum(array('B', range(256))), arrayops.sum(array('f', [0.25] * 10)))
+print(arrayops.mean(b), arrayops.min(a), arrayops.max(a), arrayops.min(array('d', [3.5, -1.25])))
+print(arrayops.dot(b, b), arrayops.dot(b, array('f', [0.5] * 4)))
+print(arrayops.dot(array('i', [1, 2]), array('b', [-1, 3])))
+
+# 64-bit elements
+q = array('Q', [2**64 - 1, 1])
+print(arrayops.max(q), arrayops.sum(array('q', [2**62, 2**62])), arrayops.add(q, 1))
+
+# longer than one chunk
+print(arrayops.cumsum(array('f', range(40)), out=array('f', [0] * 40))[-1], sum(range(40)))
+
+# bytearray, memoryview and in-place output
+ba = bytearray(b'\x01\x02\x03')
+print(arrayops.add(ba, 1), arrayops.add(memoryview(ba), 254))
+arrayops.mul(b, b, out=b)
+print(b)
+
+# errors
+for f, *args in ((arrayops.add, 1, 2), (arrayops.add, a, array('h', [1])),
+        (arrayops.add, a, 0.5), (arrayops.min, array('h')), (arrayops.add, array('O', [1]), 1)):
+    try:
+        f(*args)
+    except (TypeError, ValueError) as e:
+        print(type(e).__name__, e)
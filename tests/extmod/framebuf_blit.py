@@ -0,0 +1,67 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def printbuf(fbuf, w, h):
+    print("--8<--")
+    for y in range(h):
+        print(''.join('%x' % fbuf.pixel(x, y) for x in range(w)))
+    print("-->8--")
+
+# same-format copies, aligned and not aligned to bytes
+for fmt, col in ((framebuf.MONO_VLSB, 1), (framebuf.MONO_HLSB, 1), (framebuf.MONO_HMSB, 1),
+        (framebuf.GS2_HMSB, 3), (framebuf.GS4_HMSB, 15), (framebuf.GS8, 255), (framebuf.RGB565, 0xf800)):
+    src = framebuf.FrameBuffer(bytearray(2 * 16 * 16), 16, 16, fmt)
+    src.fill(0)
+    src.line(0, 0, 15, 15, col)
+    src.rect(2, 1, 12, 9, col)
+    dst = framebuf.FrameBuffer(bytearray(2 * 20 * 20), 20, 20, fmt)
+    for x, y in ((0, 0), (8, 8), (-3, 5), (5, -9)):
+        dst.fill(0)
+        dst.blit(src, x, y)
+        print(fmt, x, y, [dst.pixel(i, j) for i, j in ((0, 0), (x + 3, y + 3), (x + 13, y + 1), (x + 2, y + 9), (19, 19))])
+
+# blit within one framebuffer, overlapping regions are copied as memmove does
+w = 12
+h = 6
+fbuf = framebuf.FrameBuffer(bytearray(w * h), w, h, framebuf.GS8)
+for i in range(w):
+    fbuf.vline(i, 0, h, i)
+fbuf.blit(fbuf, 3, 1)
+printbuf(fbuf, w, h)
+fbuf.blit(fbuf, -2, -1)
+printbuf(fbuf, w, h)
+
+# key, with and without a palette
+w2 = 4
+h2 = 2
+fbuf2 = framebuf.FrameBuffer(bytearray(w2 * h2 // 8 + 1), w2, h2, framebuf.MONO_HLSB)
+fbuf2.fill(0)
+fbuf2.hline(0, 0, w2, 1)
+fbuf2.pixel(1, 1, 1)
+palette = framebuf.FrameBuffer(bytearray(2 * 2), 2, 1, framebuf.RGB565)
+palette.pixel(0, 0, 0x1234)
+palette.pixel(1, 0, 0xabcd)
+fbuf16 = framebuf.FrameBuffer(bytearray(6 * 3 * 2), 6, 3, framebuf.RGB565)
+fbuf16.fill(0xeeee)
+fbuf16.blit(fbuf2, 1, 1, -1, palette)
+fbuf16.blit(fbuf2, -2, 0, 0x1234, palette)
+print([hex(fbuf16.pixel(x, y)) for y in range(3) for x in range(6)])
+fbuf.fill(5)
+fbuf.blit(fbuf2, 0, 0, 0)
+printbuf(fbuf, w, h)
+
+# a short palette leaves the colours past its end alone
+gs4 = framebuf.FrameBuffer(bytearray(2), 4, 1, framebuf.GS4_HMSB)
+for i in range(4):
+    gs4.pixel(i, 0, i)
+fbuf.fill(0)
+fbuf.blit(gs4, 0, 0, -1, framebuf.FrameBuffer(bytearray(2), 2, 1, framebuf.GS8))
+printbuf(fbuf, w, 1)
+
+# scrolling everything out leaves the buffer as it was
+fbuf.scroll(w, 0)
+fbuf.scroll(0, -h)
+printbuf(fbuf, w, 1)
@@ -0,0 +1,48 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 20
+h = 10
+fbuf = framebuf.FrameBuffer(bytearray(w * h * 2), w, h, framebuf.RGB565)
+
+# nothing drawn yet
+print(fbuf.dirty())
+
+# the region grows to cover everything drawn, and is reset when read
+fbuf.pixel(3, 4, 1)
+print(fbuf.dirty())
+print(fbuf.dirty())
+fbuf.pixel(2, 2, 1)
+fbuf.hline(5, 7, 4, 1)
+print(fbuf.dirty())
+
+# clipped to the framebuffer
+fbuf.fill_rect(-5, -5, 8, 7, 1)
+print(fbuf.dirty())
+fbuf.line(15, 8, 30, -3, 1)
+print(fbuf.dirty())
+fbuf.text("ab", 10, 5, 1)
+print(fbuf.dirty())
+fbuf.rect(30, 30, 5, 5, 1)
+print(fbuf.dirty())
+
+# blit, scroll and fill
+src = framebuf.FrameBuffer(bytearray(4 * 4 * 2), 4, 4, framebuf.RGB565)
+fbuf.blit(src, 18, -1)
+print(fbuf.dirty())
+fbuf.scroll(-2, 3)
+print(fbuf.dirty())
+fbuf.fill(0)
+print(fbuf.dirty())
+
+# regions changed through the buffer can be added by hand
+fbuf.dirty(1, 1, 2, 2)
+fbuf.dirty(8, 0, 1, 1)
+print(fbuf.dirty())
+try:
+    fbuf.dirty(1, 2)
+except TypeError:
+    print("TypeError")
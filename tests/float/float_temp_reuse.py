@@ -0,0 +1,65 @@
+# test that chained float arithmetic doesn't modify values that are referenced elsewhere
+
+def f(a, b, c):
+    x = a * b + c
+    y = a
+    z = y * 2.0
+    z += 1
+    return x, y, z, a, b, c
+
+print(f(1.5, 2.0, 3.0))
+
+# temporaries on either side of an op
+a = 1.5
+b = 2.5
+print((a * b) * (b * a), a - (b - a), 1 - a * b, (a + b) / 2, a * b / 0.5)
+print(a, b)
+
+# result of a previous op stored in a local is not reused
+def g(n):
+    x = 1.0
+    l = []
+    for i in range(n):
+        x = x * 2.0
+        l.append(x)
+        x = x + 1.0
+        l.append(x)
+    return l
+
+print(g(4))
+
+# same object on both sides
+def h(a):
+    t = a * a
+    return t, t * t, (a * a) * (a * a)
+
+print(h(3.0))
+
+# mixed with ints, bools and division by zero
+print(1.5 * 2 + 1, 2 * 1.5 - True, 3 / 2 * 2.0, 1 / 4 + 1 / 4)
+try:
+    print((1.0 + 2.0) / 0)
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+try:
+    print((1.0 + 2.0) / (1.0 - 1.0))
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+
+# a class returning a shared float from an operator
+class A:
+    v = 10.0
+    def __add__(self, other):
+        return A.v
+
+r = (A() + 1) * 2.0
+print(r, A.v)
+
+# loops accumulating floats
+def acc(xs, ys):
+    s = 0.0
+    for i in range(len(xs)):
+        s += xs[i] * ys[i]
+    return s
+
+print(acc([1.0, 2.0, 3.0], [4.0, 5.0, 6.0]))
@@ -0,0 +1,64 @@
+# test that code compiled from an imported .py file is cached and reused
+# while the source is unchanged
+
+import sys
+
+try:
+    import uos
+    uos.system
+    from micropython import compile_cache_dir, compile_cache_info
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+sys.path.insert(0, '')
+
+DIR = 'compile_cache_dir'
+
+def write(src):
+    with open('compile_cache_mod.py', 'w') as f:
+        f.write(src)
+
+def load():
+    before = compile_cache_info()
+    sys.modules.pop('compile_cache_mod', None)
+    import compile_cache_mod
+    after = compile_cache_info()
+    hit = after[0] - before[0]
+    miss = after[1] - before[1]
+    print(compile_cache_mod.f(), compile_cache_mod.__file__, hit, miss)
+
+# the cache is off until a directory is given
+print(compile_cache_dir())
+write('def f():\n    return [x * 2 for x in range(3)]\n')
+load()
+
+# first import compiles and saves, the next ones load the saved code
+compile_cache_dir(DIR)
+print(compile_cache_dir())
+load()
+load()
+load()
+print(len([e for e in uos.ilistdir(DIR) if e[0].endswith('.mpy')]))
+
+# a change to the source, even keeping its size, is compiled again; the mtime
+# is set to a fixed time in the past so it differs even with coarse timestamps
+write('def f():\n    return [x * 3 for x in range(3)]\n')
+uos.system('touch -t 200001010000 compile_cache_mod.py')
+load()
+load()
+
+# compile errors aren't cached
+write('def f(:\n')
+try:
+    load()
+except SyntaxError:
+    print('SyntaxError')
+
+compile_cache_dir(None)
+uos.unlink('compile_cache_mod.py')
+for entry in uos.ilistdir(DIR):
+    if entry[0] not in ('.', '..'):
+        uos.unlink(DIR + '/' + entry[0])
+uos.rmdir(DIR)
+sys.path.pop(0)
@@ -0,0 +1,27 @@
+# test that modules created at runtime are found by import, even after a
+# failed lookup in the same directory (ie any import cache is invalidated)
+
+import sys
+
+try:
+    import uos
+    uos.unlink
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+sys.path.insert(0, '')
+
+try:
+    import import_cache_mod
+except ImportError:
+    print('ImportError')
+
+with open('import_cache_mod.py', 'w') as f:
+    f.write('x = 1\n')
+
+import import_cache_mod
+print(import_cache_mod.x)
+uos.unlink('import_cache_mod.py')
+
+sys.path.pop(0)
@@ -0,0 +1,30 @@
+# test that a module written by another process is found by import, even
+# after a failed lookup in the same directory
+
+import sys
+
+try:
+    import uos
+    uos.system
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+DIR = 'import_cache_extern_dir'
+uos.mkdir(DIR)
+sys.path.insert(0, DIR)
+
+try:
+    import import_cache_extern_mod
+except ImportError:
+    print('ImportError')
+
+# write the module from another process, then set the directory's mtime to a
+# fixed time in the past so the change is seen even with coarse timestamps
+uos.system('echo "x = 2" > %s/import_cache_extern_mod.py && touch -t 200001010000 %s' % (DIR, DIR))
+import import_cache_extern_mod
+print(import_cache_extern_mod.x)
+
+sys.path.pop(0)
+uos.unlink(DIR + '/import_cache_extern_mod.py')
+uos.rmdir(DIR)
@@ -0,0 +1,59 @@
+# test importing an .mpy file directly from the filesystem, which on ports
+# with MICROPY_PERSISTENT_CODE_LOAD_MAPPED loads it from a mapped region
+
+import sys
+
+try:
+    import uos
+    uos.unlink
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# compiled with "mpy-cross -mcache-lookup-bc" from:
+#   s = 'str constant referenced from a mapped file'
+#   b = b'\x00\x01bytes constant'
+#   n = 123456789012345678901234567890
+#   def f(x):
+#       return x * 2 + len(s)
+mpy = (
+    b'M\x04\x03\x1f \x81\x1c\x01\x000\x00\x00\x00\n\x07\x00Q\x01&%%\x00\x00\xff'
+    b'\x17\x00$\x02s\x17\x01$\x02b\x17\x02$\x02n`\x03$\x02f\x11[\x00\x07\x12mapmod.py'
+    b'\x03\x01s*str constant referenced from a mapped file'
+    b'b\x10\x00\x01bytes constant'
+    b'i\x1e123456789012345678901234567890'
+    b'|\x04\x00\x10\x01\x00\x00\tT\x01Q\x01a \x00\x00\xff\xb0\x82\xf3\x1c\x00k\x00'
+    b'\x1c\t\x00d\x01\xf1[\x05\x05\x00\x00\x02x'
+)
+
+with open('mpy_mapped_mod.mpy', 'wb') as f:
+    f.write(mpy)
+sys.path.insert(0, '')
+
+try:
+    import mpy_mapped_mod as m
+except ValueError:
+    # .mpy features don't match this build
+    m = None
+finally:
+    sys.path.pop(0)
+    uos.unlink('mpy_mapped_mod.mpy')
+
+if m is None:
+    print("SKIP")
+    raise SystemExit
+
+# constants behave like ordinary str/bytes/int objects, and bytes data
+# referenced from the mapping stays valid after the file is removed
+print(m.s, len(m.s), hash(m.s) == hash('str constant referenced from a mapped file'))
+print(m.s == 'str constant referenced from a mapped file', m.s[:3] + '!')
+print(m.b, len(m.b), m.b[2:7])
+print(m.n + 1)
+print(m.f(10))
+print({m.s: 1}['str constant referenced from a mapped file'])
+
+# str data is NUL terminated, so it can be passed to functions taking a path
+with open(m.s, 'w') as f:
+    pass
+print(uos.stat(m.s)[6])
+uos.unlink(m.s)
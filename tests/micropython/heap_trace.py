@@ -0,0 +1,59 @@
+# test allocation tracing and heap snapshots in the micropython module
+import micropython
+
+try:
+    micropython.alloc_trace_start
+    import uio as io
+except (AttributeError, ImportError):
+    print('SKIP')
+    raise SystemExit
+
+def dump(f):
+    s = io.StringIO()
+    f(s)
+    return [l.rsplit(' ', 2) for l in s.getvalue().splitlines()]
+
+class Foo:
+    pass
+
+def make(n):
+    return [Foo() for i in range(n)]
+
+# sample every allocation
+micropython.alloc_trace_start(1, 1000)
+foos = make(50)
+print(micropython.alloc_trace_stop() >= 50)
+n = 0
+for key, count, size in dump(micropython.alloc_trace_dump):
+    if key.startswith('<listcomp> (') and key.endswith(' Foo'):
+        n += int(count)
+print(n)
+
+# live objects are found by type
+n = 0
+for key, count, size in dump(micropython.heap_snapshot):
+    if key.startswith('Foo '):
+        n += int(count)
+print(n)
+foos = None
+n = 0
+for key, count, size in dump(micropython.heap_snapshot):
+    if key.startswith('Foo '):
+        n += int(count)
+print(n < 50) # the GC is conservative so a few may remain
+
+# bad arguments
+try:
+    micropython.alloc_trace_start(0)
+except ValueError:
+    print('ValueError')
+
+# a ring that can't be allocated leaves no samples
+micropython.alloc_trace_start(1, 100)
+make(10)
+micropython.alloc_trace_stop()
+try:
+    micropython.alloc_trace_start(1, 1 << 40)
+except MemoryError:
+    print('MemoryError')
+print(dump(micropython.alloc_trace_dump))
@@ -0,0 +1,86 @@
+# test native and viper functions with more locals than there are registers
+
+# many locals, all live at once
+@micropython.native
+def f(a, b, c, d, e):
+    g = a + b
+    h = c + d
+    i = e + g
+    j = h + i
+    k = j + a
+    return a, b, c, d, e, g, h, i, j, k
+print(f(1, 2, 3, 4, 5))
+
+# locals with disjoint live ranges that can share registers
+@micropython.native
+def f(n):
+    s = 0
+    for i in range(n):
+        s += i
+    t = 0
+    for j in range(n):
+        t += j * j
+    u = 1
+    k = 0
+    while k < n:
+        u = u * 2
+        k += 1
+    return s, t, u
+print(f(10))
+
+# nested loops, with a local only read in the inner loop
+@micropython.native
+def f(n, m):
+    x = 3
+    total = 0
+    for i in range(n):
+        y = i * 10
+        for j in range(m):
+            total += x + y + j
+    return total
+print(f(4, 5))
+
+# a local assigned in a loop and read after it
+@micropython.native
+def f(lst):
+    last = None
+    for item in lst:
+        last = item
+    return last
+print(f([1, 2, 3]))
+
+# swapping locals
+@micropython.native
+def f(a, b, n):
+    for i in range(n):
+        a, b = b, a + b
+    return a, b
+print(f(0, 1, 10))
+
+# viper with many arguments and locals
+@micropython.viper
+def f(a:int, b:int, c:int, d:int) -> int:
+    s = 0
+    for i in range(a):
+        s += b * i
+    t = 0
+    for j in range(c):
+        t += d + j
+    return s + t
+print(f(5, 2, 3, 7))
+
+# viper pointer loop with extra locals live across the loop
+@micropython.viper
+def f(buf:ptr8, n:int) -> int:
+    lo = 255
+    hi = 0
+    sum = 0
+    for i in range(n):
+        v = buf[i]
+        sum += v
+        if v < lo:
+            lo = v
+        if v > hi:
+            hi = v
+    return (hi - lo) * 1000 + sum
+print(f(bytearray(b'\x05\x01\x09\x03'), 4))
@@ -0,0 +1,71 @@
+# test that mpy-cross compiles the functions that a call-count profile says
+# are hot to native code, and keeps the others as bytecode, including a hot
+# function that the native emitter can't compile
+
+try:
+    import uos
+    uos.system
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+mpy_cross = uos.getenv('MICROPY_MPYCROSS') or '../mpy-cross/mpy-cross'
+try:
+    uos.stat(mpy_cross)
+except OSError:
+    print("SKIP")
+    raise SystemExit
+
+with open('native_profile_src.py', 'w') as f:
+    f.write('''
+def hot(n):
+    return n * 2
+
+def cold(n):
+    return n + 1
+
+def reraise(n):
+    try:
+        return n * 3
+    except ValueError:
+        raise
+
+class Sensor:
+    def read(self, n):
+        return n * 4
+''')
+
+with open('native_profile.txt', 'w') as f:
+    f.write('# qualname count\nhot 1000\ncold 5\nreraise 1000\nSensor.read 200\n')
+
+# the .mpy is built for unix on x64, it won't import anywhere else
+status = uos.system(
+    mpy_cross + ' -mcache-lookup-bc -march=x64 -X native-profile=native_profile.txt'
+    ' -X native-min-calls=100 -o native_profile_mod.mpy native_profile_src.py'
+)
+uos.unlink('native_profile_src.py')
+uos.unlink('native_profile.txt')
+
+import sys
+sys.path.insert(0, '')
+try:
+    import native_profile_mod as m
+except (ImportError, ValueError):
+    m = None
+finally:
+    sys.path.pop(0)
+    if status == 0:
+        uos.unlink('native_profile_mod.mpy')
+
+if m is None:
+    print("SKIP")
+    raise SystemExit
+
+# native functions are printed without their name
+def kind(f):
+    return 'native' if repr(f) == '<function>' else 'bytecode'
+
+print('hot', kind(m.hot), m.hot(1))
+print('cold', kind(m.cold), m.cold(1))
+print('reraise', kind(m.reraise), m.reraise(1))
+print('Sensor.read', kind(m.Sensor.read), m.Sensor().read(1))
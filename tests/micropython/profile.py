@@ -0,0 +1,58 @@
+# test the sampling profiler in the micropython module
+import micropython
+
+try:
+    micropython.profile_start
+    import uio as io
+except (AttributeError, ImportError):
+    print('SKIP')
+    raise SystemExit
+
+def inner(n):
+    s = 0
+    for i in range(n):
+        s += i
+    return s
+
+def dump():
+    f = io.StringIO()
+    micropython.profile_dump(f)
+    return f.getvalue().splitlines()
+
+# nothing sampled yet
+micropython.profile_start(1000, 8)
+print(dump())
+
+# keep running until the hot function has been sampled (output varies)
+for _ in range(1000):
+    inner(1000)
+    lines = dump()
+    if any('inner (' in l for l in lines):
+        break
+micropython.profile_stop()
+print(any('inner (' in l for l in lines))
+
+# each line is a stack and its count, and the ring holds at most 8 samples
+n = 0
+for l in lines:
+    stack, count = l.rsplit(' ', 1)
+    n += int(count)
+    if not stack.startswith('<module> ('):
+        print(l)
+print(1 <= n <= 8)
+
+# bad arguments
+try:
+    micropython.profile_start(1000, 0)
+except ValueError:
+    print('ValueError')
+
+# a ring that can't be allocated leaves an empty profile
+micropython.profile_start(1000, 8)
+inner(10000)
+micropython.profile_stop()
+try:
+    micropython.profile_start(1000, 1 << 40)
+except MemoryError:
+    print('MemoryError')
+print(dump())
@@ -0,0 +1,49 @@
+# Struct.unpack_into: records unpacked field by field into columns
+
+try:
+    import ustruct as struct
+    from array import array
+    struct.Struct
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct("<hBIf")
+data = b"".join(s.pack(i * 1000 - 3000, i * 30, i * 0x20000000, i * 0.5) for i in range(8))
+
+# arrays of matching and of different types, a list, a field skipped
+a = array("h", [0] * 8)
+b = bytearray(8)
+c = array("I", [0] * 8)
+d = array("f", [0] * 8)
+print(s.unpack_into(data, a, b, c, d))
+print(list(a), list(b))
+print(list(c))
+print(list(d))
+
+a = array("i", [0] * 8)
+c = [None] * 8
+d = array("d", [0] * 8)
+print(s.unpack_into(data, a, None, c, d))
+print(list(a), c == [s.unpack_from(data, i * s.size)[2] for i in range(8)], list(d))
+
+# stops at the shortest column or at the last whole record
+a = array("h", [0] * 3)
+print(s.unpack_into(data, a, None, None, None), list(a))
+a = array("h", [0] * 8)
+print(s.unpack_into(data[:s.size * 2 + 5], a, None, None, None), list(a[:3]))
+print(s.unpack_into(memoryview(data)[s.size * 6:], a, None, None, None), list(a[:3]))
+
+# one column per field
+try:
+    s.unpack_into(data, a)
+except ValueError:
+    print("ValueError")
+
+# big endian and fields that go through the generic path
+s = struct.Struct(">Hqd")
+data = s.pack(1, -5, 2.25) + s.pack(65535, 1 << 40, -1.5)
+a = array("H", [0, 0])
+q = [0, 0]
+f = array("f", [0, 0])
+print(s.unpack_into(data, a, q, f), list(a), q, list(f))
@@ -0,0 +1,68 @@
+# test viper float type
+
+import micropython
+
+# skip if the port doesn't support unboxed floats in viper
+try:
+    exec("@micropython.viper\ndef f(x: float): pass")
+except:
+    print("SKIP")
+    raise SystemExit
+
+# float args, locals and return value
+@micropython.viper
+def f1(x: float, n: int) -> float:
+    acc = float(0)
+    i = 0
+    while i < n:
+        acc = acc * 0.5 + x
+        i += 1
+    return acc
+print(f1(1.0, 10))
+print(f1(3, 1))
+
+# arithmetic and comparison
+@micropython.viper
+def f2(a: float, b: float):
+    print(a + b, a - b, a * b, a / b, a // b, a % b, a ** 2.0)
+    print(a < b, a > b, a == b, a <= b, a >= b, a != b)
+f2(3.5, 2.0)
+f2(-1.0, -1.0)
+
+# object operands are unboxed
+@micropython.viper
+def f3(a: float, b) -> float:
+    return 2.0 * a + b
+print(f3(1.5, 1))
+
+# casting between int and float
+@micropython.viper
+def f4(a: float) -> int:
+    return int(a) + int(-a)
+print(f4(2.75))
+
+@micropython.viper
+def f5(x: int) -> float:
+    return float(x) / 4.0
+print(f5(3))
+
+# float(x) still gives an object when returned without annotation
+@micropython.viper
+def f6(x):
+    y = float(x)
+    y += 1.0
+    return y
+print(f6(2), f6(2.5))
+
+# errors
+@micropython.viper
+def f7(a: float, b: float) -> float:
+    return a / b
+try:
+    f7(1.0, 0.0)
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+try:
+    f7(1.0, "a")
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,53 @@
+# test VM execution counters in the micropython module
+import micropython
+
+try:
+    micropython.vm_stats
+    import uio as io
+except (AttributeError, ImportError):
+    print('SKIP')
+    raise SystemExit
+
+class Sensor:
+    def read(self):
+        return 1
+
+def main(n):
+    def helper(x):
+        return x + 1
+    s = Sensor()
+    t = 0
+    for i in range(n):
+        t += helper(s.read())
+    return t
+
+# pairs are counted from startup, before the stats are first read
+main(2)
+print(len(micropython.vm_stats()[1]) > 0)
+
+# counts start from zero after a reset
+micropython.vm_stats(True)
+main(10)
+ops, pairs, calls = micropython.vm_stats(True)
+print(sorted(calls.items()))
+print(sum(ops.values()) > 0, sum(pairs.values()) <= sum(ops.values()))
+print(all(isinstance(k, int) for k in ops))
+print(all(ops[a] >= n and ops[b] >= n for (a, b), n in pairs.items()))
+ops, pairs, calls = micropython.vm_stats()
+print(calls.get('main'), calls.get('main.helper'))
+
+# generators are counted when they are created
+def gen():
+    yield 1
+micropython.vm_stats(True)
+list(gen())
+print(micropython.vm_stats()[2])
+
+# the dump starts with the call counts in the form read by mpy-cross
+micropython.vm_stats(True)
+main(3)
+f = io.StringIO()
+micropython.vm_stats_dump(f)
+for l in f.getvalue().splitlines():
+    if not l.startswith('#'):
+        print(l)
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+# Measure the heap peak and the time taken by compile() for a corpus of
+# scripts, optionally comparing two builds of MicroPython, eg:
+#
+#   make -C ports/unix
+#   make -C ports/unix multipass
+#   tools/compile_stats.py ports/unix/micropython_multipass -c ports/unix/micropython \
+#       tools/mpy-tool.py tools/pyboard.py esp32/tools/fw_updater/esptool.py
+#
+# Each script is measured in a fresh process so the heap peak is its own.
+# "peak" is the heap peak during the first compile() above what was in use
+# before it, time is the best of --repeat runs of --number compiles.
+
+import argparse
+import subprocess
+import sys
+
+MEASURE = """
+import gc, micropython, utime
+src = open(%r).read()
+gc.collect()
+base = micropython.mem_current()
+compile(src, 'f', 'exec')
+peak = micropython.mem_peak() - base
+best = None
+for r in range(%d):
+    t = utime.ticks_us()
+    for i in range(%d):
+        compile(src, 'f', 'exec')
+    t = utime.ticks_diff(utime.ticks_us(), t)
+    if best is None or t < best:
+        best = t
+print(peak, best)
+"""
+
+
+def measure(micropython, path, repeat, number):
+    out = subprocess.check_output(
+        [micropython, "-X", "heapsize=16M", "-c", MEASURE % (path, repeat, number)]
+    )
+    peak, best = out.split()
+    return int(peak), int(best) / number / 1000
+
+
+def main():
+    argparser = argparse.ArgumentParser(description="Measure the cost of compiling scripts")
+    argparser.add_argument("micropython", help="MicroPython executable to measure")
+    argparser.add_argument("-c", "--compare", help="second executable, to compare against the first")
+    argparser.add_argument("-r", "--repeat", type=int, default=5, help="runs to take the best of")
+    argparser.add_argument("-n", "--number", type=int, default=100, help="compiles per run")
+    argparser.add_argument("files", nargs="+", help="scripts to compile")
+    args = argparser.parse_args()
+
+    for path in args.files:
+        peak, time = measure(args.micropython, path, args.repeat, args.number)
+        if args.compare is None:
+            print("%-40s peak %8d  time %7.2f ms" % (path[-40:], peak, time))
+        else:
+            peak2, time2 = measure(args.compare, path, args.repeat, args.number)
+            print(
+                "%-40s peak %8d -> %8d (%+3d%%)  time %7.2f -> %7.2f ms"
+                % (path[-40:], peak, peak2, (peak2 - peak) * 100 // peak, time, time2)
+            )
+
+
+if __name__ == "__main__":
+    main()
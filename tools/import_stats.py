@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+#
+# Measure the time taken to import modules at startup from the last of many
+# sys.path entries, optionally comparing two builds of MicroPython, eg:
+#
+#   make -C ports/unix
+#   make -C ports/unix BUILD=build-nocache PROG=micropython_nocache \
+#       CFLAGS_EXTRA=-DMICROPY_MODULE_IMPORT_CACHE=0
+#   tools/import_stats.py ports/unix/micropython -c ports/unix/micropython_nocache
+#
+# Each of --dirs directories holds --files other files, and the last one also
+# holds --modules empty modules which are imported in turn.  Each run is a
+# fresh process so nothing is cached; time is the best of --repeat runs.
+
+import argparse
+import os
+import subprocess
+import tempfile
+
+MEASURE = """
+import sys, utime
+sys.path[:] = %r
+t = utime.ticks_us()
+for i in range(%d):
+    __import__('import_stats_mod%%d' %% i)
+print(utime.ticks_diff(utime.ticks_us(), t))
+"""
+
+
+def make_tree(root, n_dirs, n_files, n_modules):
+    dirs = []
+    for d in range(n_dirs):
+        dir = os.path.join(root, "d%d" % d)
+        os.mkdir(dir)
+        for f in range(n_files):
+            open(os.path.join(dir, "other%d.py" % f), "w").close()
+        dirs.append(dir)
+    for m in range(n_modules):
+        open(os.path.join(dirs[-1], "import_stats_mod%d.py" % m), "w").close()
+    return dirs
+
+
+def measure(micropython, dirs, n_modules, repeat):
+    best = None
+    for r in range(repeat):
+        out = subprocess.check_output([micropython, "-c", MEASURE % (dirs, n_modules)])
+        t = int(out)
+        if best is None or t < best:
+            best = t
+    return best / 1000
+
+
+def main():
+    argparser = argparse.ArgumentParser(description="Measure the cost of importing at startup")
+    argparser.add_argument("micropython", help="MicroPython executable to measure")
+    argparser.add_argument("-c", "--compare", help="second executable, to compare against the first")
+    argparser.add_argument("-d", "--dirs", type=int, default=20, help="sys.path entries")
+    argparser.add_argument("-f", "--files", type=int, default=50, help="other files in each entry")
+    argparser.add_argument("-m", "--modules", type=int, default=100, help="modules to import")
+    argparser.add_argument("-r", "--repeat", type=int, default=20, help="runs to take the best of")
+    args = argparser.parse_args()
+
+    with tempfile.TemporaryDirectory() as root:
+        dirs = make_tree(root, args.dirs, args.files, args.modules)
+        time = measure(args.micropython, dirs, args.modules, args.repeat)
+        label = "%d modules, %d dirs x %d files" % (args.modules, args.dirs, args.files)
+        if args.compare is None:
+            print("%s: time %7.2f ms" % (label, time))
+        else:
+            time2 = measure(args.compare, dirs, args.modules, args.repeat)
+            print("%s: time %7.2f -> %7.2f ms" % (label, time, time2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Measure the heap used and the time taken to import an .mpy file with a given
+# amount of constant data, optionally comparing two builds of MicroPython, eg:
+#
+#   make -C ports/unix
+#   make -C ports/unix BUILD=build-copy PROG=micropython_copy \
+#       CFLAGS_EXTRA=-DMICROPY_PERSISTENT_CODE_LOAD_MAPPED=0
+#   tools/mpy_load_stats.py ports/unix/micropython -c ports/unix/micropython_copy
+#
+# The module is made of functions, each with a bytes constant and a str
+# constant of --size bytes, and is compiled with mpy-cross.  "heap" is the
+# heap in use after the import above what was in use before it, time is the
+# best of --repeat imports.
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+MEASURE = """
+import gc, micropython, sys, utime
+sys.path[0] = %r
+gc.collect()
+base = micropython.mem_current()
+import mpy_load_stats_mod
+gc.collect()
+heap = micropython.mem_current() - base
+best = None
+for r in range(%d):
+    del sys.modules['mpy_load_stats_mod']
+    gc.collect()
+    t = utime.ticks_us()
+    import mpy_load_stats_mod
+    t = utime.ticks_diff(utime.ticks_us(), t)
+    if best is None or t < best:
+        best = t
+print(heap, best)
+"""
+
+
+def make_module(path, n_funcs, size):
+    with open(path, "w") as f:
+        for i in range(n_funcs):
+            f.write("def f%d():\n" % i)
+            f.write("    return (%r, %r)\n" % (bytes((i + j) & 0xFF for j in range(size)), "%d" % i * (size // len("%d" % i))))
+
+
+def measure(micropython, dir, repeat):
+    out = subprocess.check_output(
+        [micropython, "-X", "heapsize=16M", "-c", MEASURE % (dir, repeat)]
+    )
+    heap, best = out.split()
+    return int(heap), int(best) / 1000
+
+
+def main():
+    argparser = argparse.ArgumentParser(description="Measure the cost of importing an .mpy file")
+    argparser.add_argument("micropython", help="MicroPython executable to measure")
+    argparser.add_argument("-c", "--compare", help="second executable, to compare against the first")
+    argparser.add_argument("-m", "--mpy-cross", default=os.path.join(os.path.dirname(__file__), "../mpy-cross/mpy-cross"), help="mpy-cross executable")
+    argparser.add_argument("-f", "--funcs", type=int, default=100, help="functions in the module")
+    argparser.add_argument("-s", "--size", type=int, default=1000, help="bytes in each constant")
+    argparser.add_argument("-r", "--repeat", type=int, default=20, help="imports to take the best of")
+    args = argparser.parse_args()
+
+    with tempfile.TemporaryDirectory() as dir:
+        src = os.path.join(dir, "src.py")
+        make_module(src, args.funcs, args.size)
+        subprocess.check_call(
+            [args.mpy_cross, "-mcache-lookup-bc", "-o", os.path.join(dir, "mpy_load_stats_mod.mpy"), src]
+        )
+        heap, time = measure(args.micropython, dir, args.repeat)
+        label = "%d x 2 x %d bytes" % (args.funcs, args.size)
+        if args.compare is None:
+            print("%s: heap %8d  time %7.2f ms" % (label, heap, time))
+        else:
+            heap2, time2 = measure(args.compare, dir, args.repeat)
+            print(
+                "%s: heap %8d -> %8d  time %7.2f -> %7.2f ms"
+                % (label, heap, heap2, time, time2)
+            )
+
+
+if __name__ == "__main__":
+    main()